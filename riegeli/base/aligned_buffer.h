@@ -0,0 +1,93 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BASE_ALIGNED_BUFFER_H_
+#define RIEGELI_BASE_ALIGNED_BUFFER_H_
+
+#include <stddef.h>
+
+#include <utility>
+
+#include "absl/base/attributes.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/new_aligned.h"
+
+namespace riegeli {
+
+// Like `Buffer`, but the data pointer and the capacity are multiples of
+// `alignment`, as required e.g. for direct I/O.
+template <size_t alignment>
+class AlignedBuffer {
+ public:
+  AlignedBuffer() = default;
+
+  // Ensures at least `min_capacity` of space.
+  explicit AlignedBuffer(size_t min_capacity) {
+    AllocateInternal(min_capacity);
+  }
+
+  // The source `AlignedBuffer` is left deallocated.
+  AlignedBuffer(AlignedBuffer&& that) noexcept
+      : data_(std::exchange(that.data_, nullptr)),
+        capacity_(std::exchange(that.capacity_, 0)) {}
+  AlignedBuffer& operator=(AlignedBuffer&& that) noexcept {
+    // Exchange `that.data_` early to support self-assignment.
+    char* const data = std::exchange(that.data_, nullptr);
+    DeleteInternal();
+    data_ = data;
+    capacity_ = std::exchange(that.capacity_, 0);
+    return *this;
+  }
+
+  ~AlignedBuffer() { DeleteInternal(); }
+
+  // Ensures at least `min_capacity` of space. Existing contents are lost.
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(size_t min_capacity = 0) {
+    if (data_ != nullptr) {
+      if (capacity_ >= min_capacity) return;
+      DeleteInternal();
+    }
+    AllocateInternal(min_capacity);
+  }
+
+  // Returns the data pointer.
+  char* data() const { return data_; }
+
+  // Returns the usable data size. It can be greater than the requested size.
+  size_t capacity() const { return capacity_; }
+
+ private:
+  void AllocateInternal(size_t min_capacity) {
+    if (min_capacity == 0) return;
+    const size_t capacity = RoundUp<alignment>(min_capacity);
+    data_ = NewAligned<char, alignment>(capacity);
+    capacity_ = capacity;
+  }
+
+  void DeleteInternal() {
+    if (data_ != nullptr) {
+      DeleteAligned<char, alignment>(data_, capacity_);
+      data_ = nullptr;
+      capacity_ = 0;
+    }
+  }
+
+  char* data_ = nullptr;
+  size_t capacity_ = 0;
+  // Invariant: if `data_ == nullptr` then `capacity_ == 0`
+};
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BASE_ALIGNED_BUFFER_H_
@@ -22,6 +22,7 @@
 #include <cstring>
 #include <functional>
 #include <limits>
+#include <new>
 #include <ostream>
 #include <string>
 #include <tuple>
@@ -38,6 +39,7 @@
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/buffering.h"
+#include "riegeli/base/chain_block_allocator.h"
 #include "riegeli/base/cord_utils.h"
 #include "riegeli/base/intrusive_ref_count.h"
 #include "riegeli/base/memory_estimator.h"
@@ -298,11 +300,27 @@ inline void Chain::FlatCordRef::PrependSubstrTo(absl::string_view substr,
 inline Chain::RawBlock* Chain::RawBlock::NewInternal(size_t min_capacity) {
   RIEGELI_ASSERT_GT(min_capacity, 0u)
       << "Failed precondition of Chain::RawBlock::NewInternal(): zero capacity";
+  static_assert(kInternalAllocatedOffset() + kDefaultMaxBlockSize <=
+                    ChainBlockAllocator::kMaxAllocatedSize,
+                "ChainBlockAllocator should cover blocks of the default size");
   size_t raw_capacity;
+  void* const ptr = chain_block_allocator_internal::Allocate(
+      kInternalAllocatedOffset() + min_capacity, raw_capacity);
+  if (ptr != nullptr) return new (ptr) RawBlock(&raw_capacity);
   return SizeReturningNewAligned<RawBlock>(
       kInternalAllocatedOffset() + min_capacity, &raw_capacity, &raw_capacity);
 }
 
+void Chain::RawBlock::DeleteInternal() {
+  const size_t raw_capacity = kInternalAllocatedOffset() + capacity();
+  if (chain_block_allocator_internal::Owns(this)) {
+    this->~RawBlock();
+    chain_block_allocator_internal::Free(this, raw_capacity);
+    return;
+  }
+  DeleteAligned<RawBlock>(this, raw_capacity);
+}
+
 inline Chain::RawBlock::RawBlock(const size_t* raw_capacity)
     : data_(allocated_begin_, 0),
       // Redundant cast is needed for `-fsanitize=bounds`.
@@ -1255,6 +1255,9 @@ class Chain::RawBlock {
                          std::index_sequence<indices...>);
 #endif
 
+  // Frees an internal block, with the allocator it came from.
+  void DeleteInternal();
+
   bool is_mutable() const { return is_internal() && has_unique_owner(); }
 
   bool has_unique_owner() const;
@@ -1520,7 +1523,7 @@ void Chain::RawBlock::Unref() {
       (has_unique_owner() ||
        ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1)) {
     if (is_internal()) {
-      DeleteAligned<RawBlock>(this, kInternalAllocatedOffset() + capacity());
+      DeleteInternal();
     } else {
       external_.methods->delete_block(this);
     }
@@ -0,0 +1,77 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of building and flattening a `Chain` from small fragments.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "riegeli/base/chain.h"
+
+namespace riegeli {
+namespace {
+
+// Appends `state.range(0)` fragments of `state.range(1)` bytes.
+void BM_ChainAppend(benchmark::State& state) {
+  const size_t num_fragments = static_cast<size_t>(state.range(0));
+  const std::string fragment(static_cast<size_t>(state.range(1)), 'a');
+  for (auto _ : state) {
+    Chain chain;
+    for (size_t i = 0; i < num_fragments; ++i) chain.Append(fragment);
+    benchmark::DoNotOptimize(chain);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0) * state.range(1));
+}
+BENCHMARK(BM_ChainAppend)->ArgsProduct({{1 << 10}, {1, 16, 256, 4096}});
+
+// Prepends `state.range(0)` fragments of `state.range(1)` bytes.
+void BM_ChainPrepend(benchmark::State& state) {
+  const size_t num_fragments = static_cast<size_t>(state.range(0));
+  const std::string fragment(static_cast<size_t>(state.range(1)), 'a');
+  for (auto _ : state) {
+    Chain chain;
+    for (size_t i = 0; i < num_fragments; ++i) chain.Prepend(fragment);
+    benchmark::DoNotOptimize(chain);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0) * state.range(1));
+}
+BENCHMARK(BM_ChainPrepend)->ArgsProduct({{1 << 10}, {1, 16, 256, 4096}});
+
+// Flattens a `Chain` made of `state.range(0)` external blocks of
+// `state.range(1)` bytes each, which are not merged when appended.
+void BM_ChainFlatten(benchmark::State& state) {
+  const size_t num_fragments = static_cast<size_t>(state.range(0));
+  const size_t fragment_size = static_cast<size_t>(state.range(1));
+  Chain fragmented;
+  for (size_t i = 0; i < num_fragments; ++i) {
+    fragmented.Append(Chain::FromExternal(std::string(fragment_size, 'a')));
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    Chain chain = fragmented;
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(chain.Flatten());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0) * state.range(1));
+}
+BENCHMARK(BM_ChainFlatten)->ArgsProduct({{16, 256}, {4096, 65536}});
+
+}  // namespace
+}  // namespace riegeli
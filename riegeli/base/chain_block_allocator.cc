@@ -0,0 +1,347 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/base/chain_block_allocator.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/no_destructor.h"
+
+namespace riegeli {
+
+// Before C++17 if a constexpr static data member is ODR-used, its definition at
+// namespace scope is required. Since C++17 these definitions are deprecated:
+// http://en.cppreference.com/w/cpp/language/static
+#if __cplusplus < 201703
+constexpr size_t ChainBlockAllocator::kMaxAllocatedSize;
+#endif
+
+namespace {
+
+constexpr size_t kMinAllocatedSize = 64;
+constexpr size_t kSlabSize = size_t{2} << 20;
+
+// Size classes are 64, then 80, 96, 112, 128, then 160, 192, 224, 256, etc.,
+// up to `kMaxAllocatedSize`.
+constexpr size_t SizeClassSize(size_t index) {
+  return index == 0 ? kMinAllocatedSize
+                    : ((index - 1) % 4 + 5) << ((index - 1) / 4 + 4);
+}
+
+inline size_t SizeClassIndex(size_t size) {
+  if (size <= kMinAllocatedSize) return 0;
+  const size_t max_offset = size - 1;
+  const int width = absl::bit_width(max_offset);
+  return IntCast<size_t>(width - 7) * 4 + (max_offset >> (width - 3)) - 3;
+}
+
+constexpr size_t kNumSizeClasses = 42;
+
+static_assert(SizeClassSize(kNumSizeClasses - 1) ==
+                  ChainBlockAllocator::kMaxAllocatedSize,
+              "kNumSizeClasses does not match kMaxAllocatedSize");
+
+// A free block, linked into a free list.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  FreeBlock* head = nullptr;
+  size_t length = 0;
+};
+
+struct SizeClass {
+  absl::Mutex mutex;
+  // Free blocks shared between threads.
+  FreeList free_list ABSL_GUARDED_BY(mutex);
+  // The part of the current slab of this size class not carved yet.
+  char* slab_cursor ABSL_GUARDED_BY(mutex) = nullptr;
+  char* slab_limit ABSL_GUARDED_BY(mutex) = nullptr;
+};
+
+// Bounds of the reserved memory, both 0 before it is reserved. They are
+// constant-initialized, so that `Owns()` does not need to check whether
+// `GlobalState()` is initialized.
+std::atomic<uintptr_t> arena_begin{0};
+std::atomic<uintptr_t> arena_end{0};
+std::atomic<bool> allocator_enabled{false};
+
+struct State {
+  absl::Mutex enable_mutex;
+  std::atomic<size_t> thread_cache_size{0};
+  // Total size of slabs carved from the reserved memory.
+  std::atomic<size_t> slab_size{0};
+  std::atomic<size_t> num_fallbacks{0};
+  SizeClass size_classes[kNumSizeClasses];
+};
+
+State& GlobalState() {
+  static NoDestructor<State> kState;
+  return *kState;
+}
+
+// Reserves memory for slabs. Returns `false` if this is not possible.
+bool ReserveArena(const ChainBlockAllocator::Options& options) {
+#ifdef _WIN32
+  return false;
+#else
+  const size_t arena_size = RoundUp<kSlabSize>(options.arena_size());
+  // Over-allocate to align the arena to a slab, which lets a slab coincide with
+  // a huge page.
+  void* const reserved =
+      mmap(nullptr, arena_size + kSlabSize, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS
+#ifdef MAP_NORESERVE
+               | MAP_NORESERVE
+#endif
+           ,
+           -1, 0);
+  if (ABSL_PREDICT_FALSE(reserved == MAP_FAILED)) return false;
+  const uintptr_t begin =
+      RoundUp<kSlabSize>(reinterpret_cast<uintptr_t>(reserved));
+#ifdef MADV_HUGEPAGE
+  if (options.huge_pages()) {
+    madvise(reinterpret_cast<void*>(begin), arena_size, MADV_HUGEPAGE);
+  }
+#endif
+  arena_end.store(begin + arena_size, std::memory_order_relaxed);
+  arena_begin.store(begin, std::memory_order_release);
+  return true;
+#endif
+}
+
+// Takes a new slab from the reserved memory, or returns `nullptr` if it is
+// exhausted.
+char* NewSlab(State& state) {
+  const uintptr_t begin = arena_begin.load(std::memory_order_acquire);
+  const size_t arena_size = arena_end.load(std::memory_order_relaxed) - begin;
+  size_t slab_size = state.slab_size.load(std::memory_order_relaxed);
+  do {
+    if (ABSL_PREDICT_FALSE(slab_size >= arena_size)) return nullptr;
+  } while (!state.slab_size.compare_exchange_weak(slab_size,
+                                                  slab_size + kSlabSize,
+                                                  std::memory_order_relaxed));
+  return reinterpret_cast<char*>(begin + slab_size);
+}
+
+// Moves up to `max_length` blocks from the shared free list of the size class,
+// or from new blocks carved from a slab, to `dest`.
+void Refill(State& state, size_t index, size_t max_length, FreeList& dest) {
+  SizeClass& size_class = state.size_classes[index];
+  const size_t size = SizeClassSize(index);
+  absl::MutexLock lock(&size_class.mutex);
+  while (dest.length < max_length) {
+    FreeBlock* block = size_class.free_list.head;
+    if (block != nullptr) {
+      size_class.free_list.head = block->next;
+      --size_class.free_list.length;
+    } else {
+      if (PtrDistance(size_class.slab_cursor, size_class.slab_limit) < size) {
+        char* const slab = NewSlab(state);
+        if (ABSL_PREDICT_FALSE(slab == nullptr)) return;
+        size_class.slab_cursor = slab;
+        size_class.slab_limit = slab + kSlabSize;
+      }
+      block = reinterpret_cast<FreeBlock*>(size_class.slab_cursor);
+      size_class.slab_cursor += size;
+    }
+    block->next = dest.head;
+    dest.head = block;
+    ++dest.length;
+  }
+}
+
+// Moves `length` blocks from `src` to the shared free list of the size class.
+void Release(State& state, size_t index, size_t length, FreeList& src) {
+  RIEGELI_ASSERT_LE(length, src.length)
+      << "Failed precondition of Release(): not enough blocks";
+  if (length == 0) return;
+  FreeBlock* const first = src.head;
+  FreeBlock* last = first;
+  for (size_t i = 1; i < length; ++i) last = last->next;
+  src.head = last->next;
+  src.length -= length;
+  SizeClass& size_class = state.size_classes[index];
+  absl::MutexLock lock(&size_class.mutex);
+  last->next = size_class.free_list.head;
+  size_class.free_list.head = first;
+  size_class.free_list.length += length;
+}
+
+// Maximum number of free blocks of the size class kept by a thread.
+inline size_t ThreadCacheLength(const State& state, size_t index) {
+  return UnsignedMax(
+      state.thread_cache_size.load(std::memory_order_relaxed) /
+          SizeClassSize(index),
+      size_t{1});
+}
+
+struct ThreadCache {
+  FreeList free_lists[kNumSizeClasses];
+};
+
+// Thread-local variables with trivial destructors remain usable while other
+// thread-local variables are being destroyed, e.g. if they free `Chain` blocks.
+thread_local ThreadCache* thread_cache = nullptr;
+thread_local bool thread_cache_destroyed = false;
+
+class ThreadCacheHolder {
+ public:
+  ThreadCacheHolder() { thread_cache = &cache_; }
+
+  ThreadCacheHolder(const ThreadCacheHolder&) = delete;
+  ThreadCacheHolder& operator=(const ThreadCacheHolder&) = delete;
+
+  ~ThreadCacheHolder() {
+    thread_cache = nullptr;
+    thread_cache_destroyed = true;
+    State& state = GlobalState();
+    for (size_t index = 0; index < kNumSizeClasses; ++index) {
+      FreeList& free_list = cache_.free_lists[index];
+      Release(state, index, free_list.length, free_list);
+    }
+  }
+
+ private:
+  ThreadCache cache_;
+};
+
+// Returns the cache of the current thread, or `nullptr` if it has already been
+// destroyed.
+inline ThreadCache* CurrentThreadCache() {
+  ThreadCache* const cache = thread_cache;
+  if (ABSL_PREDICT_TRUE(cache != nullptr)) return cache;
+  if (thread_cache_destroyed) return nullptr;
+  thread_local ThreadCacheHolder holder;
+  return thread_cache;
+}
+
+}  // namespace
+
+void ChainBlockAllocator::Enable(Options options) {
+  State& state = GlobalState();
+  absl::MutexLock lock(&state.enable_mutex);
+  state.thread_cache_size.store(options.thread_cache_size(),
+                                std::memory_order_relaxed);
+  if (arena_begin.load(std::memory_order_relaxed) == 0 &&
+      !ReserveArena(options)) {
+    return;
+  }
+  allocator_enabled.store(true, std::memory_order_relaxed);
+}
+
+void ChainBlockAllocator::Disable() {
+  allocator_enabled.store(false, std::memory_order_relaxed);
+}
+
+bool ChainBlockAllocator::enabled() {
+  return allocator_enabled.load(std::memory_order_relaxed);
+}
+
+ChainBlockAllocator::Stats ChainBlockAllocator::stats() {
+  State& state = GlobalState();
+  Stats stats;
+  stats.slab_size = state.slab_size.load(std::memory_order_relaxed);
+  for (size_t index = 0; index < kNumSizeClasses; ++index) {
+    SizeClass& size_class = state.size_classes[index];
+    absl::MutexLock lock(&size_class.mutex);
+    stats.shared_free_size +=
+        size_class.free_list.length * SizeClassSize(index);
+  }
+  stats.num_fallbacks = state.num_fallbacks.load(std::memory_order_relaxed);
+  return stats;
+}
+
+namespace chain_block_allocator_internal {
+
+void* Allocate(size_t min_size, size_t& size) {
+  if (!allocator_enabled.load(std::memory_order_relaxed) ||
+      min_size > ChainBlockAllocator::kMaxAllocatedSize) {
+    return nullptr;
+  }
+  State& state = GlobalState();
+  const size_t index = SizeClassIndex(min_size);
+  ThreadCache* const cache = CurrentThreadCache();
+  FreeList single_block;
+  FreeList& free_list =
+      cache == nullptr ? single_block : cache->free_lists[index];
+  if (free_list.head == nullptr) {
+    Refill(state, index,
+           cache == nullptr
+               ? size_t{1}
+               : UnsignedMax(ThreadCacheLength(state, index) / 2, size_t{1}),
+           free_list);
+    if (ABSL_PREDICT_FALSE(free_list.head == nullptr)) {
+      state.num_fallbacks.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  FreeBlock* const block = free_list.head;
+  free_list.head = block->next;
+  --free_list.length;
+  size = SizeClassSize(index);
+  return block;
+}
+
+bool Owns(const void* ptr) {
+  const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  return address >= arena_begin.load(std::memory_order_relaxed) &&
+         address < arena_end.load(std::memory_order_relaxed);
+}
+
+void Free(void* ptr, size_t size) {
+  RIEGELI_ASSERT(Owns(ptr))
+      << "Failed precondition of chain_block_allocator_internal::Free(): "
+         "pointer not allocated by ChainBlockAllocator";
+  const size_t index = SizeClassIndex(size);
+  RIEGELI_ASSERT_EQ(SizeClassSize(index), size)
+      << "Failed precondition of chain_block_allocator_internal::Free(): "
+         "size does not match a size class";
+  State& state = GlobalState();
+  FreeBlock* const block = static_cast<FreeBlock*>(ptr);
+  ThreadCache* const cache = CurrentThreadCache();
+  if (ABSL_PREDICT_FALSE(cache == nullptr)) {
+    FreeList single_block;
+    block->next = nullptr;
+    single_block.head = block;
+    single_block.length = 1;
+    Release(state, index, 1, single_block);
+    return;
+  }
+  FreeList& free_list = cache->free_lists[index];
+  block->next = free_list.head;
+  free_list.head = block;
+  ++free_list.length;
+  const size_t max_length = ThreadCacheLength(state, index);
+  if (ABSL_PREDICT_FALSE(free_list.length > max_length)) {
+    Release(state, index, free_list.length - max_length / 2, free_list);
+  }
+}
+
+}  // namespace chain_block_allocator_internal
+
+}  // namespace riegeli
@@ -0,0 +1,160 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BASE_CHAIN_BLOCK_ALLOCATOR_H_
+#define RIEGELI_BASE_CHAIN_BLOCK_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include <utility>
+
+#include "riegeli/base/assert.h"
+
+namespace riegeli {
+
+// A process-wide allocator of internal blocks of `Chain`, used instead of
+// `operator new` when enabled.
+//
+// Allocated sizes are rounded up to size classes, with four size classes per
+// power of 2. Blocks are carved from 2 MiB slabs, each dedicated to a single
+// size class, which are taken from a contiguous range of virtual memory
+// reserved once. A freed block is kept in a free list of the freeing thread;
+// when it grows too large, half of it is moved to a free list of the size class
+// shared between threads. Allocation takes blocks from these free lists in the
+// reverse order, and carves new blocks only when they are empty.
+//
+// Memory of slabs is never returned to the system, so this is suitable for
+// long-running processes with a steady working set of `Chain` data, where
+// it avoids fragmentation and allocator contention.
+//
+// The allocator is disabled by default. Enabling and disabling it is safe at
+// any time, also concurrently with `Chain` operations, and affects only blocks
+// allocated afterwards. Each block is freed by the allocator it came from.
+//
+// Blocks larger than `kMaxAllocatedSize` (which covers blocks up to
+// `Chain::kDefaultMaxBlockSize`) and blocks requested after the reserved memory
+// is exhausted are allocated with `operator new` as usual.
+//
+// The allocator requires `mmap()`; on other platforms `Enable()` has no effect.
+class ChainBlockAllocator {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Size of virtual memory reserved for slabs. Physical memory is used only
+    // by slabs which have been carved.
+    //
+    // Default: 16G on 64-bit platforms, 256M on 32-bit platforms.
+    Options& set_arena_size(size_t arena_size) & {
+      RIEGELI_ASSERT_GT(arena_size, 0u)
+          << "Failed precondition of "
+             "ChainBlockAllocator::Options::set_arena_size(): "
+             "zero arena size";
+      arena_size_ = arena_size;
+      return *this;
+    }
+    Options&& set_arena_size(size_t arena_size) && {
+      return std::move(set_arena_size(arena_size));
+    }
+    size_t arena_size() const { return arena_size_; }
+
+    // If `true`, the reserved memory is aligned to 2 MiB and the system is
+    // advised to back it with transparent huge pages (`MADV_HUGEPAGE` on
+    // Linux), which reduces TLB misses when many blocks are touched. Each slab
+    // then occupies a single huge page.
+    //
+    // Default: `false`.
+    Options& set_huge_pages(bool huge_pages) & {
+      huge_pages_ = huge_pages;
+      return *this;
+    }
+    Options&& set_huge_pages(bool huge_pages) && {
+      return std::move(set_huge_pages(huge_pages));
+    }
+    bool huge_pages() const { return huge_pages_; }
+
+    // Maximum total size of free blocks of a single size class kept by a
+    // thread. Free blocks beyond that are shared with other threads.
+    //
+    // Default: 256K.
+    Options& set_thread_cache_size(size_t thread_cache_size) & {
+      thread_cache_size_ = thread_cache_size;
+      return *this;
+    }
+    Options&& set_thread_cache_size(size_t thread_cache_size) && {
+      return std::move(set_thread_cache_size(thread_cache_size));
+    }
+    size_t thread_cache_size() const { return thread_cache_size_; }
+
+   private:
+    size_t arena_size_ =
+        sizeof(void*) >= 8 ? size_t{16} << 30 : size_t{256} << 20;
+    bool huge_pages_ = false;
+    size_t thread_cache_size_ = size_t{256} << 10;
+  };
+
+  struct Stats {
+    // Total size of slabs carved from the reserved memory.
+    size_t slab_size = 0;
+    // Total size of free blocks shared between threads. Free blocks kept by
+    // threads are not included.
+    size_t shared_free_size = 0;
+    // Number of allocations which fell back to `operator new` because the
+    // reserved memory was exhausted.
+    size_t num_fallbacks = 0;
+  };
+
+  // The largest allocated size, including the block header, served by the
+  // allocator.
+  static constexpr size_t kMaxAllocatedSize = size_t{80} << 10;
+
+  ChainBlockAllocator() = delete;
+
+  // Enables the allocator for blocks allocated afterwards.
+  //
+  // Memory is reserved by the first call which has an effect, and `arena_size`
+  // and `huge_pages` of later calls are ignored.
+  static void Enable(Options options = Options());
+
+  // Disables the allocator for blocks allocated afterwards. Slabs are kept,
+  // and blocks which came from the allocator are returned to it when freed.
+  static void Disable();
+
+  // Returns `true` if the allocator is enabled.
+  static bool enabled();
+
+  // Returns a snapshot of allocator statistics.
+  static Stats stats();
+};
+
+namespace chain_block_allocator_internal {
+
+// If the allocator is enabled and `min_size <= kMaxAllocatedSize`, allocates
+// at least `min_size` bytes aligned to 16, sets `size` to the allocated size,
+// and returns the allocated pointer. Otherwise returns `nullptr`.
+void* Allocate(size_t min_size, size_t& size);
+
+// Returns `true` if `ptr` was returned by `Allocate()`.
+bool Owns(const void* ptr);
+
+// Frees memory returned by `Allocate()`. `size` must be the size set by
+// `Allocate()`.
+void Free(void* ptr, size_t size);
+
+}  // namespace chain_block_allocator_internal
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BASE_CHAIN_BLOCK_ALLOCATOR_H_
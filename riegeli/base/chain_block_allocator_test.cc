@@ -0,0 +1,141 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/base/chain_block_allocator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "riegeli/base/chain.h"
+
+namespace riegeli {
+namespace {
+
+using chain_block_allocator_internal::Allocate;
+using chain_block_allocator_internal::Free;
+using chain_block_allocator_internal::Owns;
+
+// The allocator is process-wide, so all tests use the same options.
+void EnableAllocator() {
+  ChainBlockAllocator::Enable(ChainBlockAllocator::Options()
+                                  .set_arena_size(size_t{256} << 20)
+                                  .set_thread_cache_size(size_t{16} << 10));
+  ASSERT_TRUE(ChainBlockAllocator::enabled());
+}
+
+TEST(ChainBlockAllocatorTest, SizeClassRoundTrip) {
+  EnableAllocator();
+  size_t previous_size = 0;
+  for (size_t min_size = 1; min_size <= ChainBlockAllocator::kMaxAllocatedSize;
+       ++min_size) {
+    size_t size;
+    void* const ptr = Allocate(min_size, size);
+    ASSERT_NE(ptr, nullptr) << "Min size: " << min_size;
+    ASSERT_TRUE(Owns(ptr));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % 16, 0u);
+    ASSERT_GE(size, min_size);
+    ASSERT_GE(size, previous_size) << "Min size: " << min_size;
+    if (size != previous_size) {
+      // A new size class begins just above the previous one, and wastes less
+      // than a quarter of the block, except for the smallest size class.
+      ASSERT_EQ(min_size, previous_size + 1);
+      if (min_size > 64) {
+        ASSERT_LT(size - min_size, min_size / 4);
+      }
+      previous_size = size;
+    }
+    // Allocating the rounded up size gives the same size class.
+    size_t size_again;
+    void* const ptr_again = Allocate(size, size_again);
+    ASSERT_NE(ptr_again, nullptr);
+    ASSERT_EQ(size_again, size) << "Min size: " << min_size;
+    ASSERT_NE(ptr_again, ptr);
+    // The whole block is usable.
+    memset(ptr, 0, size);
+    Free(ptr_again, size_again);
+    Free(ptr, size);
+  }
+  EXPECT_EQ(previous_size, ChainBlockAllocator::kMaxAllocatedSize);
+  size_t size;
+  EXPECT_EQ(Allocate(ChainBlockAllocator::kMaxAllocatedSize + 1, size),
+            nullptr);
+}
+
+TEST(ChainBlockAllocatorTest, ReusesFreedBlocks) {
+  EnableAllocator();
+  size_t size;
+  void* const ptr = Allocate(1000, size);
+  ASSERT_NE(ptr, nullptr);
+  Free(ptr, size);
+  size_t size_again;
+  EXPECT_EQ(Allocate(1000, size_again), ptr);
+  EXPECT_EQ(size_again, size);
+  Free(ptr, size);
+}
+
+TEST(ChainBlockAllocatorTest, FreeFromAnotherThread) {
+  EnableAllocator();
+  constexpr size_t kNumBlocks = 1000;
+  std::vector<void*> blocks;
+  size_t size;
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    blocks.push_back(Allocate(4096, size));
+    ASSERT_NE(blocks.back(), nullptr);
+  }
+  // Blocks freed by another thread over its cache size are shared.
+  std::thread([&] {
+    for (void* block : blocks) Free(block, size);
+  }).join();
+  EXPECT_GE(ChainBlockAllocator::stats().shared_free_size,
+            kNumBlocks * size - (size_t{16} << 10));
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    size_t size_again;
+    void* const ptr = Allocate(4096, size_again);
+    ASSERT_NE(ptr, nullptr);
+    blocks[i] = ptr;
+  }
+  for (void* block : blocks) Free(block, size);
+}
+
+TEST(ChainBlockAllocatorTest, ChainContents) {
+  EnableAllocator();
+  std::string expected;
+  Chain chain;
+  for (size_t i = 0; i < 10000; ++i) {
+    const std::string piece(i % 100, static_cast<char>('a' + i % 26));
+    chain.Append(piece);
+    expected.append(piece);
+  }
+  EXPECT_GT(ChainBlockAllocator::stats().slab_size, 0u);
+  EXPECT_EQ(chain, expected);
+
+  // Blocks allocated while the allocator was enabled are freed correctly after
+  // it is disabled.
+  ChainBlockAllocator::Disable();
+  EXPECT_FALSE(ChainBlockAllocator::enabled());
+  size_t size;
+  EXPECT_EQ(Allocate(100, size), nullptr);
+  Chain copy = chain;
+  chain.Clear();
+  EXPECT_EQ(copy, expected);
+}
+
+}  // namespace
+}  // namespace riegeli
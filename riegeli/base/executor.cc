@@ -0,0 +1,229 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include "riegeli/base/executor.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <stddef.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/synchronization/mutex.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/no_destructor.h"
+
+namespace riegeli {
+
+namespace {
+
+// The `WorkStealingExecutor` whose worker is the current thread, or `nullptr`.
+thread_local const WorkStealingExecutor* current_executor = nullptr;
+// The index of the worker which is the current thread, if `current_executor`
+// is not `nullptr`.
+thread_local size_t current_worker = 0;
+
+#ifdef __linux__
+
+// Reads up to two integers from the first line of a file, where the first one
+// may be "max". Returns the number of integers read, with "max" counting as 0.
+int ReadCgroupValues(const char* filename, long long& first,
+                     long long& second) {
+  FILE* const file = fopen(filename, "r");
+  if (file == nullptr) return 0;
+  char first_text[32];
+  int num_read = fscanf(file, "%31s %lld", first_text, &second);
+  fclose(file);
+  if (num_read < 1) return 0;
+  if (sscanf(first_text, "%lld", &first) != 1) {
+    // "max" means no limit.
+    first = -1;
+  }
+  return num_read;
+}
+
+// Returns the CPU bandwidth limit from cgroups, rounded up, or 0 if there is no
+// limit.
+size_t CgroupCpuLimit() {
+  long long quota, period;
+  // cgroup v2: "<quota> <period>" or "max <period>".
+  if (ReadCgroupValues("/sys/fs/cgroup/cpu.max", quota, period) == 2) {
+    if (quota <= 0 || period <= 0) return 0;
+    return IntCast<size_t>((quota + period - 1) / period);
+  }
+  // cgroup v1: quota is -1 if there is no limit.
+  long long unused;
+  if (ReadCgroupValues("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", quota, unused) !=
+          1 ||
+      ReadCgroupValues("/sys/fs/cgroup/cpu/cpu.cfs_period_us", period,
+                       unused) != 1 ||
+      quota <= 0 || period <= 0) {
+    return 0;
+  }
+  return IntCast<size_t>((quota + period - 1) / period);
+}
+
+#endif
+
+}  // namespace
+
+Executor::~Executor() {}
+
+Executor& Executor::global() {
+  static NoDestructor<WorkStealingExecutor> kStaticExecutor;
+  return *kStaticExecutor;
+}
+
+size_t WorkStealingExecutor::CpuQuota() {
+  static const size_t kCpuQuota = [] {
+    size_t num_cpus = IntCast<size_t>(std::thread::hardware_concurrency());
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+      num_cpus = IntCast<size_t>(CPU_COUNT(&cpu_set));
+    }
+    const size_t cgroup_limit = CgroupCpuLimit();
+    if (cgroup_limit > 0) num_cpus = UnsignedMin(num_cpus, cgroup_limit);
+#endif
+    return UnsignedMax(num_cpus, size_t{1});
+  }();
+  return kCpuQuota;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(Options options) {
+  const size_t num_threads = options.num_threads() == 0
+                                 ? CpuQuota()
+                                 : IntCast<size_t>(options.num_threads());
+  workers_.reserve(num_threads);
+  for (size_t index = 0; index < num_threads; ++index) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  // Start threads after all workers exist, because they look at each other's
+  // queues.
+  for (size_t index = 0; index < num_threads; ++index) {
+    const int cpu = options.cpu_affinity().empty()
+                        ? -1
+                        : options.cpu_affinity()[index %
+                                                 options.cpu_affinity().size()];
+    workers_[index]->thread = std::thread([this, index, cpu] { Run(index, cpu); });
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  {
+    absl::MutexLock lock(&mutex_);
+    exiting_ = true;
+  }
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void WorkStealingExecutor::Schedule(std::function<void()> task) {
+  const size_t index =
+      current_executor == this
+          ? current_worker
+          : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                workers_.size();
+  // Increment `num_queued_` before pushing the task, so that it never
+  // underflows. A worker may see the task counted before it can find it, which
+  // only makes it retry.
+  num_queued_.fetch_add(1);
+  {
+    Worker& worker = *workers_[index];
+    absl::MutexLock lock(&worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  // Increment `num_scheduled_` after pushing the task, so that a worker which
+  // did not find the task sees the change.
+  num_scheduled_.fetch_add(1);
+  // Pairs with incrementing `num_sleeping_` before checking `num_scheduled_` in
+  // `Run()`: either the worker sees the task, or this sees the worker.
+  if (num_sleeping_.load() > 0) {
+    // Releasing `mutex_` makes waiting workers reevaluate their condition.
+    absl::MutexLock lock(&mutex_);
+  }
+}
+
+void WorkStealingExecutor::Run(size_t index, int cpu) {
+#ifdef __linux__
+  if (cpu >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    // Failure is not fatal: the worker runs unpinned.
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  }
+#endif
+  current_executor = this;
+  current_worker = index;
+  for (;;) {
+    const size_t num_scheduled = num_scheduled_.load();
+    if (TryRunTask(index)) continue;
+    absl::MutexLock lock(&mutex_);
+    if (exiting_ && num_queued_.load() == 0) return;
+    num_sleeping_.fetch_add(1);
+    // Do not wake up merely because `num_queued_ > 0`: a task counted there
+    // might not be pushed yet, and waking up again and again would busy-spin
+    // until then.
+    const auto has_work = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return num_scheduled_.load() != num_scheduled ||
+             (exiting_ && num_queued_.load() == 0);
+    };
+    mutex_.Await(absl::Condition(&has_work));
+    num_sleeping_.fetch_sub(1);
+  }
+}
+
+bool WorkStealingExecutor::TryRunTask(size_t index) {
+  std::function<void()> task;
+  // Look at the own queue first, then steal from the others.
+  for (size_t remaining = workers_.size(); remaining > 0; --remaining) {
+    Worker& worker = *workers_[index];
+    {
+      absl::MutexLock lock(&worker.mutex);
+      if (!worker.tasks.empty()) {
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+      }
+    }
+    if (task != nullptr) break;
+    index = index + 1 == workers_.size() ? 0 : index + 1;
+  }
+  if (ABSL_PREDICT_FALSE(task == nullptr)) return false;
+  if (num_queued_.fetch_sub(1) == 1 && num_sleeping_.load() > 0) {
+    // Releasing `mutex_` makes waiting workers reevaluate their condition,
+    // which lets them exit if the executor is being destroyed.
+    absl::MutexLock lock(&mutex_);
+  }
+  task();
+  return true;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,155 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BASE_EXECUTOR_H_
+#define RIEGELI_BASE_EXECUTOR_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "riegeli/base/assert.h"
+
+namespace riegeli {
+
+// `Executor` runs tasks in background, e.g. encoding or decoding of chunks or
+// blocks by objects configured with parallelism.
+//
+// Tasks are CPU-bound and must not block waiting for other tasks scheduled on
+// the same `Executor`, because an `Executor` may run a bounded number of tasks
+// at a time.
+//
+// Implementations must be thread-safe.
+class Executor {
+ public:
+  Executor() = default;
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  virtual ~Executor();
+
+  // Returns the default `Executor` shared by all objects which are not given
+  // an explicit `Executor`. This is a `WorkStealingExecutor` with default
+  // options.
+  static Executor& global();
+
+  // Schedules `task` to be run in background.
+  virtual void Schedule(std::function<void()> task) = 0;
+};
+
+// `WorkStealingExecutor` runs tasks on a fixed number of worker threads.
+//
+// Each worker has its own queue of tasks. Tasks scheduled by a worker go to its
+// own queue, other tasks are distributed among workers round-robin. A worker
+// with an empty queue takes tasks from queues of other workers. Tasks from a
+// given queue are run in the order they were scheduled.
+class WorkStealingExecutor : public Executor {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Number of worker threads.
+    //
+    // 0 means the CPU quota of the process: the number of CPUs it may run on,
+    // further limited by the cgroup CPU bandwidth limit if any.
+    //
+    // Default: 0.
+    Options& set_num_threads(int num_threads) & {
+      RIEGELI_ASSERT_GE(num_threads, 0)
+          << "Failed precondition of "
+             "WorkStealingExecutor::Options::set_num_threads(): "
+             "negative number of threads";
+      num_threads_ = num_threads;
+      return *this;
+    }
+    Options&& set_num_threads(int num_threads) && {
+      return std::move(set_num_threads(num_threads));
+    }
+    int num_threads() const { return num_threads_; }
+
+    // If not empty, worker `i` is pinned to CPU `cpu_affinity[i %
+    // cpu_affinity.size()]`. Passing the CPUs of a single NUMA node keeps the
+    // workers and the memory they allocate on that node.
+    //
+    // Pinning is supported only on Linux and is ignored elsewhere.
+    //
+    // Default: empty.
+    Options& set_cpu_affinity(std::vector<int> cpu_affinity) & {
+      cpu_affinity_ = std::move(cpu_affinity);
+      return *this;
+    }
+    Options&& set_cpu_affinity(std::vector<int> cpu_affinity) && {
+      return std::move(set_cpu_affinity(std::move(cpu_affinity)));
+    }
+    std::vector<int>& cpu_affinity() { return cpu_affinity_; }
+    const std::vector<int>& cpu_affinity() const { return cpu_affinity_; }
+
+   private:
+    int num_threads_ = 0;
+    std::vector<int> cpu_affinity_;
+  };
+
+  // Starts the worker threads.
+  explicit WorkStealingExecutor(Options options = Options());
+
+  // Runs remaining tasks and stops the worker threads.
+  ~WorkStealingExecutor() override;
+
+  void Schedule(std::function<void()> task) override;
+
+  // Returns the number of worker threads.
+  size_t num_threads() const { return workers_.size(); }
+
+  // Returns the CPU quota of the process: the number of CPUs it may run on,
+  // further limited by the cgroup CPU bandwidth limit if any. At least 1.
+  static size_t CpuQuota();
+
+ private:
+  struct Worker {
+    absl::Mutex mutex;
+    std::deque<std::function<void()>> tasks ABSL_GUARDED_BY(mutex);
+    std::thread thread;
+  };
+
+  void Run(size_t index, int cpu);
+  bool TryRunTask(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // The number of tasks in all queues.
+  std::atomic<size_t> num_queued_{0};
+  // The number of tasks pushed to queues so far. A worker which found no task
+  // waits until this changes.
+  std::atomic<size_t> num_scheduled_{0};
+  // The number of workers about to wait for `num_scheduled_` to change, which
+  // need to be woken up by `Schedule()`.
+  std::atomic<size_t> num_sleeping_{0};
+  // The queue for the next task scheduled outside of workers.
+  std::atomic<size_t> next_worker_{0};
+  absl::Mutex mutex_;
+  bool exiting_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BASE_EXECUTOR_H_
@@ -0,0 +1,117 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/base/memory_budget.h"
+
+#include <stddef.h>
+
+#include <atomic>
+
+#include "absl/base/optimization.h"
+#include "absl/synchronization/mutex.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/no_destructor.h"
+
+namespace riegeli {
+
+MemoryBudget& MemoryBudget::global() {
+  static NoDestructor<MemoryBudget> kGlobal;
+  return *kGlobal;
+}
+
+void MemoryBudget::set_limit(size_t limit) {
+  absl::MutexLock lock(&mutex_);
+  limit_.store(limit, std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::peak_usage() const {
+  absl::MutexLock lock(&mutex_);
+  return peak_usage_;
+}
+
+size_t MemoryBudget::num_waits() const {
+  absl::MutexLock lock(&mutex_);
+  return num_waits_;
+}
+
+inline bool MemoryBudget::HasCapacityFor(size_t size) const {
+  const size_t usage = usage_.load(std::memory_order_relaxed);
+  return usage == 0 || size <= SaturatingSub(limit(), usage);
+}
+
+inline void MemoryBudget::AcquireLocked(size_t size) {
+  const size_t usage =
+      SaturatingAdd(usage_.load(std::memory_order_relaxed), size);
+  usage_.store(usage, std::memory_order_relaxed);
+  peak_usage_ = UnsignedMax(peak_usage_, usage);
+}
+
+void MemoryBudget::Acquire(size_t size) {
+  if (size == 0) return;
+  absl::MutexLock lock(&mutex_);
+  if (ABSL_PREDICT_FALSE(!HasCapacityFor(size))) {
+    ++num_waits_;
+    struct Request {
+      const MemoryBudget* self;
+      size_t size;
+    };
+    Request request = {this, size};
+    mutex_.Await(absl::Condition(
+        +[](Request* request) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+          return request->self->HasCapacityFor(request->size);
+        },
+        &request));
+  }
+  AcquireLocked(size);
+}
+
+bool MemoryBudget::TryAcquire(size_t size) {
+  if (size == 0) return true;
+  absl::MutexLock lock(&mutex_);
+  if (ABSL_PREDICT_FALSE(!HasCapacityFor(size))) return false;
+  AcquireLocked(size);
+  return true;
+}
+
+void MemoryBudget::Release(size_t size) {
+  if (size == 0) return;
+  absl::MutexLock lock(&mutex_);
+  const size_t usage = usage_.load(std::memory_order_relaxed);
+  RIEGELI_ASSERT_LE(size, usage)
+      << "Failed precondition of MemoryBudget::Release(): "
+         "releasing more than acquired";
+  usage_.store(usage - size, std::memory_order_relaxed);
+}
+
+void MemoryReservation::Resize(size_t size) {
+  if (budget_ == nullptr || TryResize(size)) return;
+  budget_->Release(size_);
+  size_ = 0;
+  budget_->Acquire(size);
+  size_ = size;
+}
+
+bool MemoryReservation::TryResize(size_t size) {
+  if (budget_ == nullptr) return true;
+  if (size <= size_) {
+    budget_->Release(size_ - size);
+  } else if (ABSL_PREDICT_FALSE(!budget_->TryAcquire(size - size_))) {
+    return false;
+  }
+  size_ = size;
+  return true;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,172 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BASE_MEMORY_BUDGET_H_
+#define RIEGELI_BASE_MEMORY_BUDGET_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <limits>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace riegeli {
+
+// A limit on memory used by buffers and work in progress, shared between
+// objects which draw from it, possibly in different threads.
+//
+// Memory is drawn by `Acquire()` which blocks until enough memory is available,
+// or by `TryAcquire()` which does not block, and returned by `Release()`.
+// `MemoryReservation` does this with RAII.
+//
+// An amount larger than available is granted when no memory is in use, so that
+// an object needing more than `limit()` makes progress instead of waiting
+// forever.
+//
+// Objects which can work with less memory, e.g. by using smaller buffers,
+// should do so when `under_pressure()`.
+//
+// Objects using a `MemoryBudget` do not own it. It must outlive them.
+//
+// `MemoryBudget` is thread-safe.
+class MemoryBudget {
+ public:
+  // Creates a `MemoryBudget` with the given limit in bytes.
+  explicit MemoryBudget(size_t limit = std::numeric_limits<size_t>::max())
+      : limit_(limit) {}
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  // A process-wide `MemoryBudget`, initially unlimited.
+  static MemoryBudget& global();
+
+  // Changes the limit. If it is decreased below `usage()`, memory in use is
+  // not taken back, but further requests wait until enough is released.
+  void set_limit(size_t limit);
+  size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+  // Returns the amount of memory currently drawn.
+  size_t usage() const { return usage_.load(std::memory_order_relaxed); }
+
+  // Returns the maximum of `usage()` so far.
+  size_t peak_usage() const;
+
+  // Returns the number of `Acquire()` calls which had to wait.
+  size_t num_waits() const;
+
+  // Returns `true` if `usage()` is at least 3/4 of `limit()`.
+  bool under_pressure() const {
+    const size_t limit = this->limit();
+    return usage() >= limit - limit / 4;
+  }
+
+  // Draws `size` bytes, waiting until they are available.
+  void Acquire(size_t size);
+
+  // Draws `size` bytes if they are available, returning `true`, or returns
+  // `false` without waiting.
+  bool TryAcquire(size_t size);
+
+  // Returns `size` bytes drawn by `Acquire()` or `TryAcquire()`.
+  void Release(size_t size);
+
+ private:
+  bool HasCapacityFor(size_t size) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void AcquireLocked(size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  // `limit_` and `usage_` are written under `mutex_`, and read also without it.
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> usage_{0};
+  size_t peak_usage_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t num_waits_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Holds memory drawn from a `MemoryBudget`, returning it when destroyed.
+//
+// A default-constructed `MemoryReservation` holds nothing.
+class MemoryReservation {
+ public:
+  MemoryReservation() = default;
+
+  // Draws `size` bytes from `*budget`, waiting until they are available.
+  // The amount can be changed later with `Resize()`.
+  //
+  // If `budget == nullptr`, holds nothing.
+  explicit MemoryReservation(MemoryBudget* budget, size_t size = 0);
+
+  MemoryReservation(MemoryReservation&& that) noexcept;
+  MemoryReservation& operator=(MemoryReservation&& that) noexcept;
+
+  ~MemoryReservation() { Reset(); }
+
+  // Returns the held memory and holds nothing.
+  void Reset();
+
+  // Changes the held amount to `size`, keeping `budget()`. Growing waits until
+  // more memory is available. Meanwhile the memory held so far is returned,
+  // so that waiting does not depend on this reservation itself.
+  //
+  // If `budget() == nullptr`, holds nothing.
+  void Resize(size_t size);
+
+  // Like `Resize()`, but instead of waiting returns `false` and leaves the
+  // held amount unchanged.
+  bool TryResize(size_t size);
+
+  MemoryBudget* budget() const { return budget_; }
+  size_t size() const { return size_; }
+
+ private:
+  MemoryBudget* budget_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Implementation details follow.
+
+inline MemoryReservation::MemoryReservation(MemoryBudget* budget, size_t size)
+    : budget_(budget), size_(budget == nullptr ? 0 : size) {
+  if (budget_ != nullptr) budget_->Acquire(size_);
+}
+
+inline MemoryReservation::MemoryReservation(MemoryReservation&& that) noexcept
+    : budget_(std::exchange(that.budget_, nullptr)),
+      size_(std::exchange(that.size_, 0)) {}
+
+inline MemoryReservation& MemoryReservation::operator=(
+    MemoryReservation&& that) noexcept {
+  MemoryBudget* const budget = std::exchange(that.budget_, nullptr);
+  const size_t size = std::exchange(that.size_, 0);
+  Reset();
+  budget_ = budget;
+  size_ = size;
+  return *this;
+}
+
+inline void MemoryReservation::Reset() {
+  if (budget_ != nullptr) {
+    budget_->Release(size_);
+    budget_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BASE_MEMORY_BUDGET_H_
@@ -16,6 +16,7 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <thread>
 
 #include "riegeli/base/arithmetic.h"
@@ -29,5 +30,22 @@ size_t DefaultGlobalMaxSize() {
   return kDefaultGlobalMaxSize;
 }
 
+size_t ThreadCacheIndex() {
+  static std::atomic<size_t> next_index(0);
+  thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+size_t MaxThreadCacheSize() {
+  static const size_t kNumThreads = UnsignedMax(
+      size_t{1}, IntCast<size_t>(std::thread::hardware_concurrency()));
+  return kNumThreads;
+}
+
+size_t ThreadCacheSize(size_t max_size) {
+  return UnsignedMin(max_size, MaxThreadCacheSize());
+}
+
 }  // namespace recycling_pool_internal
 }  // namespace riegeli
@@ -16,6 +16,7 @@
 #define RIEGELI_BASE_RECYCLING_POOL_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <atomic>
 #include <list>
@@ -34,8 +35,84 @@
 namespace riegeli {
 
 namespace recycling_pool_internal {
+
 RIEGELI_INLINE_CONSTEXPR(size_t, kDefaultMaxSize, 16);
 size_t DefaultGlobalMaxSize();
+
+// Returns a small number identifying the current thread, used to pick a
+// thread cache slot. Numbers are assigned consecutively to threads as they
+// first call this function.
+size_t ThreadCacheIndex();
+
+// Returns the maximum number of thread cache slots of a pool: the number of
+// available threads.
+size_t MaxThreadCacheSize();
+
+// Returns the number of thread cache slots for a pool with the given maximum
+// number of objects to keep: the minimum of `max_size` and
+// `MaxThreadCacheSize()`.
+size_t ThreadCacheSize(size_t max_size);
+
+// `ThreadCaches<Value>` is an array of slots holding a `Value` each, with each
+// thread preferring its own slot.
+//
+// A slot is acquired with a single atomic exchange and is never waited for:
+// if it is in use by another thread, the operation reports failure and the
+// caller falls back to the shared part of the pool.
+//
+// `MaxThreadCacheSize()` slots are allocated, so that the number of slots in
+// use can grow without moving slots which might be in use.
+template <typename Value>
+class ThreadCaches {
+ public:
+  explicit ThreadCaches(size_t size)
+      : capacity_(MaxThreadCacheSize()),
+        size_(size),
+        slots_(new Slot[capacity_]) {
+    RIEGELI_ASSERT_LE(size, capacity_)
+        << "Failed precondition of ThreadCaches: size exceeds capacity";
+  }
+
+  ThreadCaches(const ThreadCaches&) = delete;
+  ThreadCaches& operator=(const ThreadCaches&) = delete;
+
+  // Increases the number of slots in use to `size` if it was smaller.
+  //
+  // Precondition: `size <= MaxThreadCacheSize()`
+  void EnsureSize(size_t size);
+
+  // Calls `action(Value&)` with the slot of the current thread and returns its
+  // result, or returns `false` if the slot is in use by another thread.
+  template <typename Action>
+  bool WithOwnSlot(Action&& action);
+
+  // Calls `action(Value&)` with successive slots, starting from the slot of
+  // the current thread, until it returns `true`. Returns `false` if it never
+  // returned `true`. Slots in use by other threads are skipped.
+  template <typename Action>
+  bool WithAnySlot(Action&& action);
+
+  // Calls `action(Value&)` with each slot. Slots in use by other threads are
+  // skipped.
+  template <typename Action>
+  void ForEachSlot(Action&& action);
+
+ private:
+  struct Slot {
+    std::atomic<bool> in_use{false};
+    Value value;
+    // Keep slots used by different threads in different cache lines.
+    char padding[ABSL_CACHELINE_SIZE];
+  };
+
+  template <typename Action>
+  static bool WithSlot(Slot& slot, Action& action);
+
+  size_t capacity_;
+  std::atomic<size_t> size_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
 }  // namespace recycling_pool_internal
 
 // `RecyclingPool<T, Deleter>` keeps a pool of idle objects of type `T`, so that
@@ -46,6 +123,16 @@ size_t DefaultGlobalMaxSize();
 // Deleter specifies how an object should be eventually deleted, like in
 // `std::unique_ptr<T, Deleter>`.
 //
+// Besides the shared pool of up to `max_size` objects, each thread keeps its
+// most recently returned object in a thread cache slot, which can be accessed
+// without contending for the shared pool. Objects which are not found in the
+// slot of the current thread are looked up in the shared pool, and then in
+// slots of other threads.
+//
+// Objects in slots are subject to the same freshness-based eviction as objects
+// in the shared pool: an object is evicted after `max_size` newer objects were
+// put into the shared pool.
+//
 // `RecyclingPool` is thread-safe.
 template <typename T, typename Deleter = std::default_delete<T>>
 class RecyclingPool {
@@ -79,7 +166,9 @@ class RecyclingPool {
 
   // Creates a pool with the given maximum number of objects to keep.
   explicit RecyclingPool(size_t max_size = kDefaultMaxSize)
-      : max_size_(max_size), ring_buffer_by_freshness_(max_size) {}
+      : thread_caches_(recycling_pool_internal::ThreadCacheSize(max_size)),
+        max_size_(max_size),
+        ring_buffer_by_freshness_(max_size) {}
 
   RecyclingPool(const RecyclingPool&) = delete;
   RecyclingPool& operator=(const RecyclingPool&) = delete;
@@ -113,11 +202,34 @@ class RecyclingPool {
   void RawPut(RawHandle object);
 
  private:
+  struct CachedObject {
+    RawHandle object;
+    // `num_shared_puts_` when `object` was put into the slot.
+    uint64_t stamp = 0;
+  };
+
   void EnsureMaxSize(size_t max_size) ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Returns `true` if an object put into a slot when `num_shared_puts_` was
+  // `stamp` would have been evicted from the shared pool by now.
+  bool IsStale(uint64_t stamp) const;
+  // Evicts stale objects from slots.
+  void EvictStaleCachedObjects();
+
+  RawHandle SharedGet() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns `true` if `EvictStaleCachedObjects()` is due.
+  bool SharedPut(RawHandle object) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // The most recently returned object of each thread. `object == nullptr` if
+  // absent.
+  recycling_pool_internal::ThreadCaches<CachedObject> thread_caches_;
   absl::Mutex mutex_;
   // May be read without holding `mutex_`.
   std::atomic<size_t> max_size_;
+  // The number of objects put into the shared pool so far, which measures the
+  // age of objects in slots. Modified under `mutex_`, may be read without
+  // holding it.
+  std::atomic<uint64_t> num_shared_puts_{0};
   // All objects, ordered by freshness (older to newer).
   size_t ring_buffer_end_ ABSL_GUARDED_BY(mutex_) = 0;
   size_t ring_buffer_size_ ABSL_GUARDED_BY(mutex_) = 0;
@@ -140,6 +252,16 @@ class RecyclingPool {
 // equality comparable, hashable (by `absl::Hash`), default constructible, and
 // copyable.
 //
+// Besides the shared pool of up to `max_size` objects, each thread keeps its
+// most recently returned object in a thread cache slot, which can be accessed
+// without contending for the shared pool. Objects which are not found in the
+// slot of the current thread are looked up in the shared pool, and then in
+// slots of other threads.
+//
+// Objects in slots are subject to the same freshness-based eviction as objects
+// in the shared pool: an object is evicted after `max_size` newer objects were
+// put into the shared pool.
+//
 // `KeyedRecyclingPool` is thread-safe.
 template <typename T, typename Key, typename Deleter = std::default_delete<T>>
 class KeyedRecyclingPool {
@@ -173,7 +295,9 @@ class KeyedRecyclingPool {
 
   // Creates a pool with the given maximum number of objects to keep.
   explicit KeyedRecyclingPool(size_t max_size = kDefaultMaxSize)
-      : max_size_(max_size), cache_(by_key_.end()) {}
+      : thread_caches_(recycling_pool_internal::ThreadCacheSize(max_size)),
+        max_size_(max_size),
+        cache_(by_key_.end()) {}
 
   KeyedRecyclingPool(const KeyedRecyclingPool&) = delete;
   KeyedRecyclingPool& operator=(const KeyedRecyclingPool&) = delete;
@@ -224,9 +348,33 @@ class KeyedRecyclingPool {
 
   using ByKey = absl::flat_hash_map<Key, Entries>;
 
+  struct CachedEntry {
+    Key key;
+    RawHandle object;
+    // `num_shared_puts_` when `object` was put into the slot.
+    uint64_t stamp = 0;
+  };
+
   void EnsureMaxSize(size_t max_size);
 
+  // Returns `true` if an object put into a slot when `num_shared_puts_` was
+  // `stamp` would have been evicted from the shared pool by now.
+  bool IsStale(uint64_t stamp) const;
+  // Evicts stale objects from slots.
+  void EvictStaleCachedEntries();
+
+  RawHandle SharedGet(const Key& key) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns `true` if `EvictStaleCachedEntries()` is due.
+  bool SharedPut(const Key& key, RawHandle object) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // The most recently returned object of each thread, with its key.
+  // `object == nullptr` if absent.
+  recycling_pool_internal::ThreadCaches<CachedEntry> thread_caches_;
   std::atomic<size_t> max_size_;
+  // The number of objects put into the shared pool so far, which measures the
+  // age of objects in slots. Modified under `mutex_`, may be read without
+  // holding it.
+  std::atomic<uint64_t> num_shared_puts_{0};
   absl::Mutex mutex_;
   // The key of each object, ordered by the freshness of the object (older to
   // newer).
@@ -243,6 +391,73 @@ class KeyedRecyclingPool {
 
 // Implementation details follow.
 
+namespace recycling_pool_internal {
+
+template <typename Value>
+void ThreadCaches<Value>::EnsureSize(size_t size) {
+  RIEGELI_ASSERT_LE(size, capacity_)
+      << "Failed precondition of ThreadCaches::EnsureSize(): "
+         "size exceeds capacity";
+  size_t previous_size = size_.load(std::memory_order_relaxed);
+  while (previous_size < size) {
+    if (size_.compare_exchange_weak(previous_size, size,
+                                    std::memory_order_relaxed)) {
+      break;
+    }
+  }
+}
+
+template <typename Value>
+template <typename Action>
+inline bool ThreadCaches<Value>::WithOwnSlot(Action&& action) {
+  const size_t size = size_.load(std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(size == 0)) return false;
+  return WithSlot(slots_[ThreadCacheIndex() % size], action);
+}
+
+template <typename Value>
+template <typename Action>
+bool ThreadCaches<Value>::WithAnySlot(Action&& action) {
+  const size_t size = size_.load(std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(size == 0)) return false;
+  size_t index = ThreadCacheIndex() % size;
+  for (size_t remaining = size; remaining > 0; --remaining) {
+    if (WithSlot(slots_[index], action)) return true;
+    index = index + 1 == size ? 0 : index + 1;
+  }
+  return false;
+}
+
+template <typename Value>
+template <typename Action>
+void ThreadCaches<Value>::ForEachSlot(Action&& action) {
+  const size_t size = size_.load(std::memory_order_relaxed);
+  for (size_t index = 0; index < size; ++index) {
+    const auto action_returning_bool = [&](Value& value) {
+      action(value);
+      return true;
+    };
+    WithSlot(slots_[index], action_returning_bool);
+  }
+}
+
+template <typename Value>
+template <typename Action>
+inline bool ThreadCaches<Value>::WithSlot(Slot& slot, Action& action) {
+  // Check before exchanging to avoid taking the cache line for writing when
+  // the slot is in use.
+  if (ABSL_PREDICT_FALSE(slot.in_use.load(std::memory_order_relaxed) ||
+                         slot.in_use.exchange(true,
+                                              std::memory_order_acquire))) {
+    return false;
+  }
+  const bool result = action(slot.value);
+  slot.in_use.store(false, std::memory_order_release);
+  return result;
+}
+
+}  // namespace recycling_pool_internal
+
 template <typename T, typename Deleter>
 class RecyclingPool<T, Deleter>::Recycler : private Deleter {
  public:
@@ -308,6 +523,22 @@ inline void RecyclingPool<T, Deleter>::EnsureMaxSize(size_t max_size) {
     new_ring_buffer[new_idx] = std::move(ring_buffer_by_freshness_[old_idx]);
   }
   ring_buffer_by_freshness_ = std::move(new_ring_buffer);
+  thread_caches_.EnsureSize(recycling_pool_internal::ThreadCacheSize(max_size));
+}
+
+template <typename T, typename Deleter>
+inline bool RecyclingPool<T, Deleter>::IsStale(uint64_t stamp) const {
+  return num_shared_puts_.load(std::memory_order_relaxed) - stamp >=
+         max_size_.load(std::memory_order_relaxed);
+}
+
+template <typename T, typename Deleter>
+void RecyclingPool<T, Deleter>::EvictStaleCachedObjects() {
+  thread_caches_.ForEachSlot([&](CachedObject& cached) {
+    if (cached.object != nullptr && IsStale(cached.stamp)) {
+      cached.object.reset();
+    }
+  });
 }
 
 template <typename T, typename Deleter>
@@ -325,16 +556,20 @@ template <typename Factory, typename Refurbisher>
 typename RecyclingPool<T, Deleter>::RawHandle RecyclingPool<T, Deleter>::RawGet(
     Factory&& factory, Refurbisher&& refurbisher) {
   RawHandle returned;
-  {
-    absl::MutexLock lock(&mutex_);
-    if (ABSL_PREDICT_TRUE(ring_buffer_size_ > 0)) {
-      ring_buffer_end_ = ring_buffer_end_ == 0
-                             ? max_size_.load(std::memory_order_relaxed) - 1
-                             : ring_buffer_end_ - 1;
-      // Return the newest entry.
-      returned = std::move(ring_buffer_by_freshness_[ring_buffer_end_]);
-      --ring_buffer_size_;
+  const auto take = [&](CachedObject& cached) {
+    if (cached.object == nullptr) return false;
+    if (ABSL_PREDICT_FALSE(IsStale(cached.stamp))) {
+      cached.object.reset();
+      return false;
     }
+    returned = std::move(cached.object);
+    return true;
+  };
+  if (ABSL_PREDICT_FALSE(!thread_caches_.WithOwnSlot(take))) {
+    returned = SharedGet();
+    // Objects left in slots of other threads are the last resort before
+    // creating a new object.
+    if (returned == nullptr) thread_caches_.WithAnySlot(take);
   }
   if (ABSL_PREDICT_TRUE(returned != nullptr)) {
     std::forward<Refurbisher>(refurbisher)(returned.get());
@@ -344,12 +579,45 @@ typename RecyclingPool<T, Deleter>::RawHandle RecyclingPool<T, Deleter>::RawGet(
   return returned;
 }
 
+template <typename T, typename Deleter>
+typename RecyclingPool<T, Deleter>::RawHandle
+RecyclingPool<T, Deleter>::SharedGet() {
+  absl::MutexLock lock(&mutex_);
+  if (ABSL_PREDICT_FALSE(ring_buffer_size_ == 0)) return nullptr;
+  ring_buffer_end_ = ring_buffer_end_ == 0
+                         ? max_size_.load(std::memory_order_relaxed) - 1
+                         : ring_buffer_end_ - 1;
+  --ring_buffer_size_;
+  // Return the newest entry.
+  return std::move(ring_buffer_by_freshness_[ring_buffer_end_]);
+}
+
 template <typename T, typename Deleter>
 void RecyclingPool<T, Deleter>::RawPut(RawHandle object) {
+  // Keep the newest object in the slot of the current thread. Move the
+  // previous object from the slot, if any, to the shared pool, unless it is
+  // stale.
+  uint64_t previous_stamp = 0;
+  if (ABSL_PREDICT_TRUE(thread_caches_.WithOwnSlot([&](CachedObject& cached) {
+        object = std::exchange(cached.object, std::move(object));
+        previous_stamp = std::exchange(
+            cached.stamp, num_shared_puts_.load(std::memory_order_relaxed));
+        return true;
+      }))) {
+    if (ABSL_PREDICT_TRUE(object == nullptr)) return;
+    if (ABSL_PREDICT_FALSE(IsStale(previous_stamp))) return;
+  }
+  if (ABSL_PREDICT_FALSE(SharedPut(std::move(object)))) {
+    EvictStaleCachedObjects();
+  }
+}
+
+template <typename T, typename Deleter>
+bool RecyclingPool<T, Deleter>::SharedPut(RawHandle object) {
   RawHandle evicted;
   absl::MutexLock lock(&mutex_);
   // Add a newest entry. Evict the oldest entry if the pool is full.
-  if (ABSL_PREDICT_FALSE(ring_buffer_by_freshness_.empty())) return;
+  if (ABSL_PREDICT_FALSE(ring_buffer_by_freshness_.empty())) return false;
   evicted = std::exchange(ring_buffer_by_freshness_[ring_buffer_end_],
                           std::move(object));
   ring_buffer_end_ =
@@ -360,7 +628,15 @@ void RecyclingPool<T, Deleter>::RawPut(RawHandle object) {
                         max_size_.load(std::memory_order_relaxed))) {
     ++ring_buffer_size_;
   }
+  const uint64_t num_shared_puts =
+      num_shared_puts_.load(std::memory_order_relaxed) + 1;
+  num_shared_puts_.store(num_shared_puts, std::memory_order_relaxed);
   // Destroy `evicted` after releasing `mutex_`.
+  //
+  // Look for stale objects in slots once per `max_size` shared puts, which
+  // keeps the cost amortized constant.
+  const size_t max_size = max_size_.load(std::memory_order_relaxed);
+  return max_size > 0 && num_shared_puts % max_size == 0;
 }
 
 template <typename T, typename Key, typename Deleter>
@@ -417,6 +693,23 @@ inline void KeyedRecyclingPool<T, Key, Deleter>::EnsureMaxSize(
                                         std::memory_order_relaxed))
       break;
   }
+  thread_caches_.EnsureSize(recycling_pool_internal::ThreadCacheSize(max_size));
+}
+
+template <typename T, typename Key, typename Deleter>
+inline bool KeyedRecyclingPool<T, Key, Deleter>::IsStale(
+    uint64_t stamp) const {
+  return num_shared_puts_.load(std::memory_order_relaxed) - stamp >=
+         max_size_.load(std::memory_order_relaxed);
+}
+
+template <typename T, typename Key, typename Deleter>
+void KeyedRecyclingPool<T, Key, Deleter>::EvictStaleCachedEntries() {
+  thread_caches_.ForEachSlot([&](CachedEntry& cached) {
+    if (cached.object != nullptr && IsStale(cached.stamp)) {
+      cached.object.reset();
+    }
+  });
 }
 
 template <typename T, typename Key, typename Deleter>
@@ -437,6 +730,34 @@ typename KeyedRecyclingPool<T, Key, Deleter>::RawHandle
 KeyedRecyclingPool<T, Key, Deleter>::RawGet(const Key& key, Factory&& factory,
                                             Refurbisher&& refurbisher) {
   RawHandle returned;
+  const auto take = [&](CachedEntry& cached) {
+    if (cached.object == nullptr) return false;
+    if (ABSL_PREDICT_FALSE(IsStale(cached.stamp))) {
+      cached.object.reset();
+      return false;
+    }
+    if (!(cached.key == key)) return false;
+    returned = std::move(cached.object);
+    return true;
+  };
+  if (ABSL_PREDICT_FALSE(!thread_caches_.WithOwnSlot(take))) {
+    returned = SharedGet(key);
+    // Objects left in slots of other threads are the last resort before
+    // creating a new object.
+    if (returned == nullptr) thread_caches_.WithAnySlot(take);
+  }
+  if (ABSL_PREDICT_TRUE(returned != nullptr)) {
+    std::forward<Refurbisher>(refurbisher)(returned.get());
+  } else {
+    returned = std::forward<Factory>(factory)();
+  }
+  return returned;
+}
+
+template <typename T, typename Key, typename Deleter>
+typename KeyedRecyclingPool<T, Key, Deleter>::RawHandle
+KeyedRecyclingPool<T, Key, Deleter>::SharedGet(const Key& key) {
+  RawHandle returned;
   {
     absl::MutexLock lock(&mutex_);
     if (cache_ != by_key_.end()) {
@@ -466,17 +787,35 @@ KeyedRecyclingPool<T, Key, Deleter>::RawGet(const Key& key, Factory&& factory,
     }
     cache_ = by_key_iter;
   }
-  if (ABSL_PREDICT_TRUE(returned != nullptr)) {
-    std::forward<Refurbisher>(refurbisher)(returned.get());
-  } else {
-    returned = std::forward<Factory>(factory)();
-  }
   return returned;
 }
 
 template <typename T, typename Key, typename Deleter>
 void KeyedRecyclingPool<T, Key, Deleter>::RawPut(const Key& key,
                                                  RawHandle object) {
+  // Keep the newest object in the slot of the current thread. Move the
+  // previous object from the slot, if any, to the shared pool, unless it is
+  // stale.
+  Key evicted_key = key;
+  uint64_t previous_stamp = 0;
+  if (ABSL_PREDICT_TRUE(thread_caches_.WithOwnSlot([&](CachedEntry& cached) {
+        std::swap(cached.key, evicted_key);
+        object = std::exchange(cached.object, std::move(object));
+        previous_stamp = std::exchange(
+            cached.stamp, num_shared_puts_.load(std::memory_order_relaxed));
+        return true;
+      }))) {
+    if (ABSL_PREDICT_TRUE(object == nullptr)) return;
+    if (ABSL_PREDICT_FALSE(IsStale(previous_stamp))) return;
+  }
+  if (ABSL_PREDICT_FALSE(SharedPut(evicted_key, std::move(object)))) {
+    EvictStaleCachedEntries();
+  }
+}
+
+template <typename T, typename Key, typename Deleter>
+bool KeyedRecyclingPool<T, Key, Deleter>::SharedPut(const Key& key,
+                                                    RawHandle object) {
   RawHandle evicted;
   absl::MutexLock lock(&mutex_);
   // Add a newest entry with this key.
@@ -492,7 +831,7 @@ void KeyedRecyclingPool<T, Key, Deleter>::RawPut(const Key& key,
              "non-nullptr object pointed to by cache_";
       entries.back().object = std::move(object);
       cache_ = by_key_.end();
-      return;
+      return false;
     }
     // `cache_` miss. Finish erasing the cached entry.
     by_freshness_.erase(entries.back().by_freshness_iter);
@@ -525,7 +864,15 @@ void KeyedRecyclingPool<T, Key, Deleter>::RawPut(const Key& key,
     by_freshness_.pop_front();
   }
   cache_ = by_key_.end();
+  const uint64_t num_shared_puts =
+      num_shared_puts_.load(std::memory_order_relaxed) + 1;
+  num_shared_puts_.store(num_shared_puts, std::memory_order_relaxed);
   // Destroy `evicted` after releasing `mutex_`.
+  //
+  // Look for stale objects in slots once per `max_size` shared puts, which
+  // keeps the cost amortized constant.
+  const size_t max_size = max_size_.load(std::memory_order_relaxed);
+  return max_size > 0 && num_shared_puts % max_size == 0;
 }
 
 }  // namespace riegeli
@@ -0,0 +1,89 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Contention benchmarks of `RecyclingPool` and `KeyedRecyclingPool` with 1 to
+// 128 threads.
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "riegeli/base/recycling_pool.h"
+
+namespace riegeli {
+namespace {
+
+// Stands for a compression context: expensive to create, cheap to reset.
+struct Context {
+  char state[256];
+};
+
+std::unique_ptr<Context> NewContext() { return std::make_unique<Context>(); }
+
+// Each iteration gets one object and returns it, which is served by the slot
+// of the current thread.
+void BM_RecyclingPoolGetPut(benchmark::State& state) {
+  RecyclingPool<Context>& pool = RecyclingPool<Context>::global();
+  for (auto _ : state) {
+    RecyclingPool<Context>::Handle context = pool.Get(NewContext);
+    benchmark::DoNotOptimize(context.get());
+  }
+}
+BENCHMARK(BM_RecyclingPoolGetPut)->ThreadRange(1, 128)->UseRealTime();
+
+// Each iteration gets two objects and returns them, which goes through the
+// shared pool for one of them.
+void BM_RecyclingPoolGetPutTwo(benchmark::State& state) {
+  RecyclingPool<Context>& pool = RecyclingPool<Context>::global();
+  for (auto _ : state) {
+    RecyclingPool<Context>::Handle first = pool.Get(NewContext);
+    RecyclingPool<Context>::Handle second = pool.Get(NewContext);
+    benchmark::DoNotOptimize(first.get());
+    benchmark::DoNotOptimize(second.get());
+  }
+}
+BENCHMARK(BM_RecyclingPoolGetPutTwo)->ThreadRange(1, 128)->UseRealTime();
+
+// Like `BM_RecyclingPoolGetPut()`, but with a key varying between threads, like
+// a compression level.
+void BM_KeyedRecyclingPoolGetPut(benchmark::State& state) {
+  KeyedRecyclingPool<Context, int>& pool =
+      KeyedRecyclingPool<Context, int>::global();
+  const int key = state.thread_index() % 4;
+  for (auto _ : state) {
+    KeyedRecyclingPool<Context, int>::Handle context =
+        pool.Get(key, NewContext);
+    benchmark::DoNotOptimize(context.get());
+  }
+}
+BENCHMARK(BM_KeyedRecyclingPoolGetPut)->ThreadRange(1, 128)->UseRealTime();
+
+// Like `BM_RecyclingPoolGetPutTwo()`, but with a key varying between threads.
+void BM_KeyedRecyclingPoolGetPutTwo(benchmark::State& state) {
+  KeyedRecyclingPool<Context, int>& pool =
+      KeyedRecyclingPool<Context, int>::global();
+  const int key = state.thread_index() % 4;
+  for (auto _ : state) {
+    KeyedRecyclingPool<Context, int>::Handle first = pool.Get(key, NewContext);
+    KeyedRecyclingPool<Context, int>::Handle second =
+        pool.Get(key, NewContext);
+    benchmark::DoNotOptimize(first.get());
+    benchmark::DoNotOptimize(second.get());
+  }
+}
+BENCHMARK(BM_KeyedRecyclingPoolGetPutTwo)->ThreadRange(1, 128)->UseRealTime();
+
+}  // namespace
+}  // namespace riegeli
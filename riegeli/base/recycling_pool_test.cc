@@ -0,0 +1,160 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/base/recycling_pool.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace riegeli {
+namespace {
+
+// Counts live objects, and marks itself as destroyed in `*destroyed`.
+class Tracked {
+ public:
+  explicit Tracked(std::atomic<int>* num_live, bool* destroyed = nullptr)
+      : num_live_(num_live), destroyed_(destroyed) {
+    num_live_->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Tracked(const Tracked&) = delete;
+  Tracked& operator=(const Tracked&) = delete;
+
+  ~Tracked() {
+    num_live_->fetch_sub(1, std::memory_order_relaxed);
+    if (destroyed_ != nullptr) *destroyed_ = true;
+  }
+
+ private:
+  std::atomic<int>* num_live_;
+  bool* destroyed_;
+};
+
+TEST(RecyclingPoolTest, ReusesObject) {
+  std::atomic<int> num_live{0};
+  RecyclingPool<Tracked> pool(4);
+  Tracked* first;
+  {
+    RecyclingPool<Tracked>::Handle handle =
+        pool.Get([&] { return std::make_unique<Tracked>(&num_live); });
+    first = handle.get();
+  }
+  RecyclingPool<Tracked>::Handle handle =
+      pool.Get([&] { return std::make_unique<Tracked>(&num_live); });
+  EXPECT_EQ(handle.get(), first);
+  EXPECT_EQ(num_live.load(), 1);
+}
+
+TEST(RecyclingPoolTest, ObjectInSlotIsEvicted) {
+  constexpr size_t kMaxSize = 4;
+  std::atomic<int> num_live{0};
+  bool destroyed = false;
+  RecyclingPool<Tracked> pool(kMaxSize);
+  // Leave an object in the slot of this thread.
+  pool.RawPut(std::make_unique<Tracked>(&num_live, &destroyed));
+  // Put many newer objects from another thread. They go through the slot of
+  // that thread into the shared pool.
+  std::thread([&] {
+    for (size_t i = 0; i < 10 * kMaxSize; ++i) {
+      pool.RawPut(std::make_unique<Tracked>(&num_live));
+    }
+  }).join();
+  EXPECT_TRUE(destroyed);
+  // The shared pool and the slots of both threads.
+  EXPECT_LE(num_live.load(), static_cast<int>(kMaxSize + 2));
+}
+
+TEST(RecyclingPoolTest, ConcurrentGetAndPut) {
+  std::atomic<int> num_live{0};
+  RecyclingPool<Tracked> pool(8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 10000; ++j) {
+        RecyclingPool<Tracked>::Handle first =
+            pool.Get([&] { return std::make_unique<Tracked>(&num_live); });
+        RecyclingPool<Tracked>::Handle second =
+            pool.Get([&] { return std::make_unique<Tracked>(&num_live); });
+        EXPECT_NE(first.get(), second.get());
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  // The shared pool and one slot per thread.
+  EXPECT_LE(num_live.load(), 8 + 8);
+}
+
+TEST(RecyclingPoolTest, GlobalGrows) {
+  struct Object {};
+  RecyclingPool<Object>& pool = RecyclingPool<Object>::global(1);
+  EXPECT_EQ(&RecyclingPool<Object>::global(64), &pool);
+  std::vector<std::unique_ptr<Object>> objects;
+  for (int i = 0; i < 64; ++i) objects.push_back(std::make_unique<Object>());
+  std::vector<Object*> pointers;
+  for (std::unique_ptr<Object>& object : objects) {
+    pointers.push_back(object.get());
+    pool.RawPut(std::move(object));
+  }
+  // All objects fit in the grown pool and are reused.
+  for (size_t i = 0; i < pointers.size(); ++i) {
+    std::unique_ptr<Object> object =
+        pool.RawGet([] { return std::make_unique<Object>(); });
+    EXPECT_NE(std::find(pointers.begin(), pointers.end(), object.get()),
+              pointers.end());
+  }
+}
+
+TEST(KeyedRecyclingPoolTest, ReusesObjectWithMatchingKey) {
+  std::atomic<int> num_live{0};
+  KeyedRecyclingPool<Tracked, int> pool(4);
+  Tracked* first;
+  {
+    KeyedRecyclingPool<Tracked, int>::Handle handle =
+        pool.Get(1, [&] { return std::make_unique<Tracked>(&num_live); });
+    first = handle.get();
+  }
+  {
+    KeyedRecyclingPool<Tracked, int>::Handle handle =
+        pool.Get(2, [&] { return std::make_unique<Tracked>(&num_live); });
+    EXPECT_NE(handle.get(), first);
+  }
+  KeyedRecyclingPool<Tracked, int>::Handle handle =
+      pool.Get(1, [&] { return std::make_unique<Tracked>(&num_live); });
+  EXPECT_EQ(handle.get(), first);
+}
+
+TEST(KeyedRecyclingPoolTest, ObjectInSlotIsEvicted) {
+  constexpr size_t kMaxSize = 4;
+  std::atomic<int> num_live{0};
+  bool destroyed = false;
+  KeyedRecyclingPool<Tracked, int> pool(kMaxSize);
+  pool.RawPut(0, std::make_unique<Tracked>(&num_live, &destroyed));
+  std::thread([&] {
+    for (size_t i = 0; i < 10 * kMaxSize; ++i) {
+      pool.RawPut(static_cast<int>(i % 3), std::make_unique<Tracked>(&num_live));
+    }
+  }).join();
+  EXPECT_TRUE(destroyed);
+  EXPECT_LE(num_live.load(), static_cast<int>(kMaxSize + 2));
+}
+
+}  // namespace
+}  // namespace riegeli
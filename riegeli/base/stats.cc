@@ -0,0 +1,87 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/base/stats.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/no_destructor.h"
+
+namespace riegeli {
+
+namespace {
+
+struct ProcessStatsState {
+  absl::Mutex mutex;
+  ProcessStats stats ABSL_GUARDED_BY(mutex);
+};
+
+ProcessStatsState& GlobalProcessStats() {
+  static NoDestructor<ProcessStatsState> kState;
+  return *kState;
+}
+
+template <typename Stats>
+void AddToProcessStatsImpl(Stats ProcessStats::*member, const Stats& stats) {
+  ProcessStatsState& state = GlobalProcessStats();
+  absl::MutexLock lock(&state.mutex);
+  state.stats.*member += stats;
+}
+
+}  // namespace
+
+void SetStatsEnabled(bool enabled) {
+  stats_internal::stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+ProcessStats GetProcessStats() {
+  ProcessStatsState& state = GlobalProcessStats();
+  absl::MutexLock lock(&state.mutex);
+  return state.stats;
+}
+
+namespace stats_internal {
+
+std::atomic<bool> stats_enabled{false};
+
+uint64_t Now_ns() {
+  const std::chrono::steady_clock::duration now =
+      std::chrono::steady_clock::now().time_since_epoch();
+  return IntCast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void AddToProcessStats(IoStats ProcessStats::*member, const IoStats& stats) {
+  AddToProcessStatsImpl(member, stats);
+}
+
+void AddToProcessStats(CodecStats ProcessStats::*member,
+                       const CodecStats& stats) {
+  AddToProcessStatsImpl(member, stats);
+}
+
+void AddToProcessStats(RecordStats ProcessStats::*member,
+                       const RecordStats& stats) {
+  AddToProcessStatsImpl(member, stats);
+}
+
+}  // namespace stats_internal
+
+}  // namespace riegeli
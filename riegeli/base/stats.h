@@ -0,0 +1,151 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BASE_STATS_H_
+#define RIEGELI_BASE_STATS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace riegeli {
+
+// Opt-in statistics of Riegeli objects, showing whether time goes to I/O,
+// compression, hashing, or parsing.
+//
+// Collecting statistics is disabled by default, and then costs a relaxed atomic
+// load per instrumented operation. While enabled, instrumented objects count
+// operations and bytes, and measure wall time of the calling thread with a
+// monotonic clock. For CPU-bound work like compression and hashing this is
+// close to CPU time.
+//
+// Instrumented objects expose their statistics with `stats()`. When an object
+// is closed, its statistics are added to process-wide totals returned by
+// `GetProcessStats()`.
+
+// Enables or disables collecting statistics in the whole process.
+void SetStatsEnabled(bool enabled);
+
+// Returns `true` if collecting statistics is enabled.
+bool StatsEnabled();
+
+// Statistics of operations on an underlying source or destination, e.g. of
+// `BufferedReader::ReadInternal()` or `BufferedWriter::WriteInternal()`.
+struct IoStats {
+  // Number of operations.
+  uint64_t num_ops = 0;
+  // Number of bytes transferred.
+  uint64_t bytes = 0;
+  // Time spent in the operations, in nanoseconds.
+  uint64_t time_ns = 0;
+
+  IoStats& operator+=(const IoStats& that);
+};
+
+// Statistics of a compressor or decompressor.
+struct CodecStats {
+  // Number of bytes consumed: uncompressed when compressing, compressed when
+  // decompressing.
+  uint64_t bytes_in = 0;
+  // Number of bytes produced: compressed when compressing, uncompressed when
+  // decompressing.
+  uint64_t bytes_out = 0;
+  // Time spent compressing or decompressing, in nanoseconds.
+  uint64_t time_ns = 0;
+
+  CodecStats& operator+=(const CodecStats& that);
+};
+
+// Statistics of a `RecordReader` or `RecordWriter`.
+struct RecordStats {
+  // Number of chunks read or written.
+  uint64_t num_chunks = 0;
+  // Number of records read or written.
+  uint64_t num_records = 0;
+  // Time spent computing or verifying hashes of chunks, in nanoseconds.
+  uint64_t hash_time_ns = 0;
+  // Time spent parsing or serializing proto messages, in nanoseconds.
+  uint64_t message_time_ns = 0;
+
+  RecordStats& operator+=(const RecordStats& that);
+};
+
+// Totals of statistics of objects closed so far in the process.
+struct ProcessStats {
+  // `BufferedReader::ReadInternal()`. This includes decompressing readers like
+  // `ZstdReader`, so time spent there is also counted in `decompression`.
+  IoStats buffered_reads;
+  // `BufferedWriter::WriteInternal()`. This includes compressing writers like
+  // `ZstdWriter`, so time spent there is also counted in `compression`.
+  IoStats buffered_writes;
+  // Chunk compression.
+  CodecStats compression;
+  // Chunk decompression.
+  CodecStats decompression;
+  // `RecordReader`.
+  RecordStats record_reads;
+  // `RecordWriter`.
+  RecordStats record_writes;
+};
+
+// Returns totals of statistics of objects closed so far in the process.
+ProcessStats GetProcessStats();
+
+namespace stats_internal {
+
+extern std::atomic<bool> stats_enabled;
+
+// Returns the current time of a monotonic clock, in nanoseconds.
+uint64_t Now_ns();
+
+// Adds statistics of a closed object to `ProcessStats::*member`.
+void AddToProcessStats(IoStats ProcessStats::*member, const IoStats& stats);
+void AddToProcessStats(CodecStats ProcessStats::*member,
+                       const CodecStats& stats);
+void AddToProcessStats(RecordStats ProcessStats::*member,
+                       const RecordStats& stats);
+
+}  // namespace stats_internal
+
+// Implementation details follow.
+
+inline bool StatsEnabled() {
+  return stats_internal::stats_enabled.load(std::memory_order_relaxed);
+}
+
+inline IoStats& IoStats::operator+=(const IoStats& that) {
+  num_ops += that.num_ops;
+  bytes += that.bytes;
+  time_ns += that.time_ns;
+  return *this;
+}
+
+inline CodecStats& CodecStats::operator+=(const CodecStats& that) {
+  bytes_in += that.bytes_in;
+  bytes_out += that.bytes_out;
+  time_ns += that.time_ns;
+  return *this;
+}
+
+inline RecordStats& RecordStats::operator+=(const RecordStats& that) {
+  num_chunks += that.num_chunks;
+  num_records += that.num_records;
+  hash_time_ns += that.hash_time_ns;
+  message_time_ns += that.message_time_ns;
+  return *this;
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BASE_STATS_H_
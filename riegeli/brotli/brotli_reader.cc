@@ -31,6 +31,7 @@
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/intrusive_ref_count.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/pullable_reader.h"
@@ -126,12 +127,18 @@ bool BrotliReaderBase::PullBehindScratch(size_t recommended_length) {
   Reader& src = *SrcReader();
   truncated_ = false;
   size_t available_out = 0;
+  const bool stats_enabled = StatsEnabled();
   for (;;) {
     size_t available_in = src.available();
     const uint8_t* next_in = reinterpret_cast<const uint8_t*>(src.cursor());
+    const uint64_t start_ns = stats_enabled ? stats_internal::Now_ns() : 0;
     const BrotliDecoderResult result = BrotliDecoderDecompressStream(
         decompressor_.get(), &available_in, &next_in, &available_out, nullptr,
         nullptr);
+    if (ABSL_PREDICT_FALSE(stats_enabled)) {
+      stats_.time_ns += stats_internal::Now_ns() - start_ns;
+      ++stats_.num_ops;
+    }
     src.set_cursor(reinterpret_cast<const char*>(next_in));
     switch (result) {
       case BROTLI_DECODER_RESULT_ERROR:
@@ -154,6 +161,7 @@ bool BrotliReaderBase::PullBehindScratch(size_t recommended_length) {
         const char* const data = reinterpret_cast<const char*>(
             BrotliDecoderTakeOutput(decompressor_.get(), &length));
         if (length > 0) {
+          if (ABSL_PREDICT_FALSE(stats_enabled)) stats_.bytes += length;
           const Position max_length =
               std::numeric_limits<Position>::max() - limit_pos();
           if (ABSL_PREDICT_FALSE(length > max_length)) {
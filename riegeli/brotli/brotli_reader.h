@@ -28,6 +28,7 @@
 #include "brotli/decode.h"
 #include "riegeli/base/dependency.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/brotli/brotli_allocator.h"
 #include "riegeli/brotli/brotli_dictionary.h"
@@ -99,6 +100,10 @@ class BrotliReaderBase : public PullableReader {
   // does not grow, `Close()` will fail.
   bool truncated() const { return truncated_ && available() == 0; }
 
+  // Returns statistics of `BrotliDecoderDecompressStream()` calls, collected
+  // while `StatsEnabled()`. `bytes` counts decompressed bytes.
+  const IoStats& stats() const { return stats_; }
+
   bool ToleratesReadingAhead() override;
   bool SupportsRewind() override;
   bool SupportsNewReader() override;
@@ -143,6 +148,7 @@ class BrotliReaderBase : public PullableReader {
   // If `ok()` but `decompressor_ == nullptr` then all data have been
   // decompressed.
   std::unique_ptr<BrotliDecoderState, BrotliDecoderStateDeleter> decompressor_;
+  IoStats stats_;
 
   // Invariant if scratch is not used:
   //   `start()` and `limit()` point to the buffer returned by
@@ -240,7 +246,8 @@ inline BrotliReaderBase::BrotliReaderBase(BrotliReaderBase&& that) noexcept
       allocator_(std::move(that.allocator_)),
       truncated_(that.truncated_),
       initial_compressed_pos_(that.initial_compressed_pos_),
-      decompressor_(std::move(that.decompressor_)) {}
+      decompressor_(std::move(that.decompressor_)),
+      stats_(std::exchange(that.stats_, IoStats())) {}
 
 inline BrotliReaderBase& BrotliReaderBase::operator=(
     BrotliReaderBase&& that) noexcept {
@@ -250,6 +257,7 @@ inline BrotliReaderBase& BrotliReaderBase::operator=(
   truncated_ = that.truncated_;
   initial_compressed_pos_ = that.initial_compressed_pos_;
   decompressor_ = std::move(that.decompressor_);
+  stats_ = std::exchange(that.stats_, IoStats());
   return *this;
 }
 
@@ -258,6 +266,7 @@ inline void BrotliReaderBase::Reset(Closed) {
   truncated_ = false;
   initial_compressed_pos_ = 0;
   decompressor_.reset();
+  stats_ = IoStats();
   dictionary_ = BrotliDictionary();
   allocator_ = BrotliAllocator();
 }
@@ -268,6 +277,7 @@ inline void BrotliReaderBase::Reset(BrotliDictionary&& dictionary,
   truncated_ = false;
   initial_compressed_pos_ = 0;
   decompressor_.reset();
+  stats_ = IoStats();
   dictionary_ = std::move(dictionary);
   allocator_ = std::move(allocator);
 }
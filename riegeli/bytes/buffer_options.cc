@@ -16,10 +16,12 @@
 
 #include <stddef.h>
 
+#include "absl/base/optimization.h"
 #include "absl/types/optional.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/buffering.h"
+#include "riegeli/base/memory_budget.h"
 #include "riegeli/base/types.h"
 
 namespace riegeli {
@@ -32,6 +34,39 @@ constexpr size_t BufferOptions::kDefaultMinBufferSize;
 constexpr size_t BufferOptions::kDefaultMaxBufferSize;
 #endif
 
+namespace {
+
+// Limits `length` to `min_buffer_size()` while the memory budget is under
+// pressure, but not below `min_length`.
+inline size_t ApplyMemoryPressure(size_t length, size_t min_length,
+                                  const BufferOptions& buffer_options) {
+  const MemoryBudget* const memory_budget = buffer_options.memory_budget();
+  if (ABSL_PREDICT_TRUE(memory_budget == nullptr) ||
+      !memory_budget->under_pressure()) {
+    return length;
+  }
+  return UnsignedMax(UnsignedMin(length, buffer_options.min_buffer_size()),
+                     min_length);
+}
+
+}  // namespace
+
+size_t ReserveBufferLength(size_t kept_length, size_t min_length,
+                           size_t buffer_length,
+                           const BufferOptions& buffer_options,
+                           MemoryReservation& reservation) {
+  if (ABSL_PREDICT_TRUE(reservation.budget() == nullptr)) return buffer_length;
+  if (ABSL_PREDICT_TRUE(reservation.TryResize(UnsignedMax(
+          SaturatingAdd(kept_length, buffer_length), reservation.size())))) {
+    return buffer_length;
+  }
+  buffer_length = UnsignedMax(
+      UnsignedMin(buffer_length, buffer_options.min_buffer_size()), min_length);
+  reservation.Resize(UnsignedMax(SaturatingAdd(kept_length, buffer_length),
+                                 reservation.size()));
+  return buffer_length;
+}
+
 size_t ReadBufferSizer::BufferLength(Position pos, size_t min_length,
                                      size_t recommended_length) const {
   RIEGELI_ASSERT_GT(min_length, 0u)
@@ -72,13 +107,16 @@ template <Position (*ApplySizeHint)(Position recommended_length,
                                     Position pos, bool multiple_runs)>
 inline size_t ReadBufferSizer::BufferLengthImpl(
     Position pos, size_t min_length, size_t recommended_length) const {
-  return UnsignedClamp(
-      UnsignedMax(ApplySizeHint(
-                      UnsignedMax(pos - base_pos_, buffer_length_from_last_run_,
-                                  buffer_options_.min_buffer_size()),
-                      exact_size(), pos, !read_all_hint_),
-                  recommended_length),
-      min_length, buffer_options_.max_buffer_size());
+  return ApplyMemoryPressure(
+      UnsignedClamp(
+          UnsignedMax(
+              ApplySizeHint(
+                  UnsignedMax(pos - base_pos_, buffer_length_from_last_run_,
+                              buffer_options_.min_buffer_size()),
+                  exact_size(), pos, !read_all_hint_),
+              recommended_length),
+          min_length, buffer_options_.max_buffer_size()),
+      min_length, buffer_options_);
 }
 
 size_t WriteBufferSizer::BufferLength(Position pos, size_t min_length,
@@ -89,13 +127,16 @@ size_t WriteBufferSizer::BufferLength(Position pos, size_t min_length,
   RIEGELI_ASSERT_GE(pos, base_pos_)
       << "Failed precondition of WriteBufferSizer::WriteBufferLength(): "
       << "position earlier than base position of the run";
-  return UnsignedClamp(
-      UnsignedMax(ApplyWriteSizeHint(
-                      UnsignedMax(pos - base_pos_, buffer_length_from_last_run_,
-                                  buffer_options_.min_buffer_size()),
-                      size_hint(), pos, buffer_length_from_last_run_ > 0),
-                  recommended_length),
-      min_length, buffer_options_.max_buffer_size());
+  return ApplyMemoryPressure(
+      UnsignedClamp(
+          UnsignedMax(
+              ApplyWriteSizeHint(
+                  UnsignedMax(pos - base_pos_, buffer_length_from_last_run_,
+                              buffer_options_.min_buffer_size()),
+                  size_hint(), pos, buffer_length_from_last_run_ > 0),
+              recommended_length),
+          min_length, buffer_options_.max_buffer_size()),
+      min_length, buffer_options_);
 }
 
 size_t WriteBufferSizer::LengthToWriteDirectly(Position pos,
@@ -28,6 +28,9 @@
 
 namespace riegeli {
 
+class MemoryBudget;
+class MemoryReservation;
+
 // Common options related to buffering in a `Reader` or `Writer`.
 class BufferOptions {
  public:
@@ -76,10 +79,33 @@ class BufferOptions {
     return std::move(set_buffer_size(buffer_size));
   }
 
+  // `MemoryBudget` from which the buffer is drawn. Allocating the buffer waits
+  // until the budget has room for a buffer of at least `min_buffer_size()`.
+  // While the budget is `under_pressure()`, the buffer size does not grow
+  // beyond `min_buffer_size()`, unless a larger buffer is needed for a single
+  // operation. It is not owned and must outlive objects using these options.
+  //
+  // Objects sharing a budget in a single thread should leave room for each
+  // other's buffers, because a buffer held by one of them is not returned while
+  // another one waits.
+  //
+  // `nullptr` means that the buffer is not limited by a budget.
+  //
+  // Default: `nullptr`.
+  BufferOptions& set_memory_budget(MemoryBudget* memory_budget) & {
+    memory_budget_ = memory_budget;
+    return *this;
+  }
+  BufferOptions&& set_memory_budget(MemoryBudget* memory_budget) && {
+    return std::move(set_memory_budget(memory_budget));
+  }
+  MemoryBudget* memory_budget() const { return memory_budget_; }
+
  private:
   // Use `uint32_t` instead of `size_t` to reduce the object size.
   uint32_t min_buffer_size_ = uint32_t{kDefaultMinBufferSize};
   uint32_t max_buffer_size_ = uint32_t{kDefaultMaxBufferSize};
+  MemoryBudget* memory_budget_ = nullptr;
 };
 
 // Deriving `Options` from `BufferOptionsBase<Options>` makes it easier to
@@ -132,6 +158,18 @@ class BufferOptionsBase {
     return std::move(set_buffer_size(buffer_size));
   }
 
+  // See `BufferOptions::set_memory_budget()`.
+  Options& set_memory_budget(MemoryBudget* memory_budget) & {
+    buffer_options_.set_memory_budget(memory_budget);
+    return static_cast<Options&>(*this);
+  }
+  Options&& set_memory_budget(MemoryBudget* memory_budget) && {
+    return std::move(set_memory_budget(memory_budget));
+  }
+  MemoryBudget* memory_budget() const {
+    return buffer_options_.memory_budget();
+  }
+
   // Grouped options related to buffering.
   Options& set_buffer_options(const BufferOptions& buffer_options) & {
     buffer_options_ = buffer_options;
@@ -150,6 +188,22 @@ class BufferOptionsBase {
   BufferOptions buffer_options_;
 };
 
+// Draws memory for a buffer about to be allocated from `reservation.budget()`.
+// The buffer will hold `kept_length` bytes of existing data followed by
+// `buffer_length` bytes of new data. Memory already held by `reservation`
+// counts towards that.
+//
+// Returns `buffer_length` if the budget has room for it. Otherwise waits until
+// the budget has room for a shorter buffer, as short as `min_buffer_size()` but
+// not shorter than `min_length`, and returns its length.
+//
+// After allocating the buffer, `reservation` should be resized to match the
+// allocated size.
+size_t ReserveBufferLength(size_t kept_length, size_t min_length,
+                           size_t buffer_length,
+                           const BufferOptions& buffer_options,
+                           MemoryReservation& reservation);
+
 // Recommends an adaptive buffer length based on the access pattern of a
 // `Reader`.
 //
@@ -15,6 +15,7 @@
 #include "riegeli/bytes/buffered_reader.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <cstring>
 #include <limits>
@@ -29,6 +30,8 @@
 #include "riegeli/base/assert.h"
 #include "riegeli/base/buffering.h"
 #include "riegeli/base/chain.h"
+#include "riegeli/base/memory_budget.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/backward_writer.h"
 #include "riegeli/bytes/buffer_options.h"
@@ -38,11 +41,15 @@
 namespace riegeli {
 
 void BufferedReader::Done() {
+  if (stats_.num_ops > 0) {
+    stats_internal::AddToProcessStats(&ProcessStats::buffered_reads, stats_);
+  }
   if (available() > 0) {
     if (!SupportsRandomAccess()) {
       // Seeking back is not feasible.
       Reader::Done();
       buffer_ = ChainBlock();
+      buffer_memory_.Reset();
       return;
     }
     const Position new_pos = pos();
@@ -51,6 +58,22 @@ void BufferedReader::Done() {
   }
   Reader::Done();
   buffer_ = ChainBlock();
+  buffer_memory_.Reset();
+}
+
+inline bool BufferedReader::ReadInternalWithStats(size_t min_length,
+                                                  size_t max_length,
+                                                  char* dest) {
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) {
+    return ReadInternal(min_length, max_length, dest);
+  }
+  const Position limit_pos_before = limit_pos();
+  const uint64_t start_ns = stats_internal::Now_ns();
+  const bool read_ok = ReadInternal(min_length, max_length, dest);
+  stats_.time_ns += stats_internal::Now_ns() - start_ns;
+  ++stats_.num_ops;
+  stats_.bytes += limit_pos() - limit_pos_before;
+  return read_ok;
 }
 
 inline void BufferedReader::SyncBuffer() {
@@ -58,6 +81,17 @@ inline void BufferedReader::SyncBuffer() {
   buffer_.Clear();
 }
 
+inline size_t BufferedReader::ReserveBuffer(size_t min_length,
+                                           size_t buffer_length) {
+  return ReserveBufferLength(buffer_.size(), min_length, buffer_length,
+                             buffer_sizer_.buffer_options(), buffer_memory_);
+}
+
+inline void BufferedReader::SyncBufferMemory() {
+  if (ABSL_PREDICT_TRUE(buffer_memory_.budget() == nullptr)) return;
+  buffer_memory_.Resize(buffer_.EstimateMemory() - sizeof(ChainBlock));
+}
+
 void BufferedReader::SetReadAllHintImpl(bool read_all_hint) {
   buffer_sizer_.set_read_all_hint(read_all_hint);
 }
@@ -70,7 +104,11 @@ bool BufferedReader::PullSlow(size_t min_length, size_t recommended_length) {
   const size_t available_length = available();
   size_t cursor_index = start_to_cursor();
   const size_t buffer_length =
-      buffer_sizer_.BufferLength(pos(), min_length, recommended_length);
+      available_length +
+      ReserveBuffer(
+          min_length - available_length,
+          buffer_sizer_.BufferLength(pos(), min_length, recommended_length) -
+              available_length);
   absl::Span<char> flat_buffer = buffer_.AppendBuffer(
       0, buffer_length - available_length,
       SaturatingAdd(buffer_length, buffer_length) - available_length);
@@ -83,13 +121,15 @@ bool BufferedReader::PullSlow(size_t min_length, size_t recommended_length) {
         buffer_length - available_length, buffer_length - available_length,
         SaturatingAdd(buffer_length, buffer_length) - available_length);
   }
+  SyncBufferMemory();
   // Read more data into `buffer_`.
   const size_t min_length_to_read = ToleratesReadingAhead()
                                         ? flat_buffer.size()
                                         : min_length - available_length;
   const Position pos_before = limit_pos();
   const bool read_ok =
-      ReadInternal(min_length_to_read, flat_buffer.size(), flat_buffer.data());
+      ReadInternalWithStats(min_length_to_read, flat_buffer.size(),
+                            flat_buffer.data());
   RIEGELI_ASSERT_GE(limit_pos(), pos_before)
       << "BufferedReader::ReadInternal() decreased limit_pos()";
   const Position length_read = limit_pos() - pos_before;
@@ -147,7 +187,7 @@ bool BufferedReader::ReadSlow(size_t length, char* dest) {
     }
     SyncBuffer();
     if (ABSL_PREDICT_FALSE(!ok())) return false;
-    return ReadInternal(length, length, dest);
+    return ReadInternalWithStats(length, length, dest);
   }
   return Reader::ReadSlow(length, dest);
 }
@@ -169,8 +209,9 @@ bool BufferedReader::ReadSlow(size_t length, Chain& dest) {
     }
     size_t available_length = available();
     size_t cursor_index = start_to_cursor();
-    const size_t buffer_length =
-        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length);
+    const size_t buffer_length = ReserveBuffer(
+        1,
+        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length));
     absl::Span<char> flat_buffer = buffer_.AppendBuffer(
         0, buffer_length, SaturatingAdd(buffer_length, buffer_length));
     if (flat_buffer.empty()) {
@@ -186,14 +227,15 @@ bool BufferedReader::ReadSlow(size_t length, Chain& dest) {
           buffer_.AppendBuffer(buffer_length, buffer_length,
                                SaturatingAdd(buffer_length, buffer_length));
     }
+    SyncBufferMemory();
     // Read more data into `buffer_`.
     const size_t min_length_to_read =
         ToleratesReadingAhead()
             ? flat_buffer.size()
             : UnsignedMin(length - available_length, flat_buffer.size());
     const Position pos_before = limit_pos();
-    const bool read_ok = ReadInternal(min_length_to_read, flat_buffer.size(),
-                                      flat_buffer.data());
+    const bool read_ok = ReadInternalWithStats(
+        min_length_to_read, flat_buffer.size(), flat_buffer.data());
     RIEGELI_ASSERT_GE(limit_pos(), pos_before)
         << "BufferedReader::ReadInternal() decreased limit_pos()";
     const Position length_read = limit_pos() - pos_before;
@@ -238,8 +280,9 @@ bool BufferedReader::ReadSlow(size_t length, absl::Cord& dest) {
     }
     size_t available_length = available();
     size_t cursor_index = start_to_cursor();
-    const size_t buffer_length =
-        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length);
+    const size_t buffer_length = ReserveBuffer(
+        1,
+        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length));
     absl::Span<char> flat_buffer = buffer_.AppendBuffer(
         0, buffer_length, SaturatingAdd(buffer_length, buffer_length));
     if (flat_buffer.empty()) {
@@ -255,14 +298,15 @@ bool BufferedReader::ReadSlow(size_t length, absl::Cord& dest) {
           buffer_.AppendBuffer(buffer_length, buffer_length,
                                SaturatingAdd(buffer_length, buffer_length));
     }
+    SyncBufferMemory();
     // Read more data into `buffer_`.
     const size_t min_length_to_read =
         ToleratesReadingAhead()
             ? flat_buffer.size()
             : UnsignedMin(length - available_length, flat_buffer.size());
     const Position pos_before = limit_pos();
-    const bool read_ok = ReadInternal(min_length_to_read, flat_buffer.size(),
-                                      flat_buffer.data());
+    const bool read_ok = ReadInternalWithStats(
+        min_length_to_read, flat_buffer.size(), flat_buffer.data());
     RIEGELI_ASSERT_GE(limit_pos(), pos_before)
         << "BufferedReader::ReadInternal() decreased limit_pos()";
     const Position length_read = limit_pos() - pos_before;
@@ -322,8 +366,9 @@ bool BufferedReader::CopySlow(Position length, Writer& dest) {
       // filled more to avoid attaching a wasteful `Chain`.
     }
     size_t cursor_index = start_to_cursor();
-    const size_t buffer_length =
-        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length);
+    const size_t buffer_length = ReserveBuffer(
+        1,
+        buffer_sizer_.BufferLength(limit_pos(), 1, length - available_length));
     absl::Span<char> flat_buffer = buffer_.AppendBuffer(
         0, buffer_length, SaturatingAdd(buffer_length, buffer_length));
     if (flat_buffer.empty()) {
@@ -349,6 +394,7 @@ bool BufferedReader::CopySlow(Position length, Writer& dest) {
       buffer_.Clear();
       if (read_directly) {
         set_buffer();
+        SyncBufferMemory();
         return CopyUsingPush(length, dest);
       }
       available_length = 0;
@@ -357,14 +403,15 @@ bool BufferedReader::CopySlow(Position length, Writer& dest) {
           buffer_.AppendBuffer(buffer_length, buffer_length,
                                SaturatingAdd(buffer_length, buffer_length));
     }
+    SyncBufferMemory();
     // Read more data into `buffer_`.
     const size_t min_length_to_read =
         ToleratesReadingAhead()
             ? flat_buffer.size()
             : UnsignedMin(length - available_length, flat_buffer.size());
     const Position pos_before = limit_pos();
-    const bool read_ok = ReadInternal(min_length_to_read, flat_buffer.size(),
-                                      flat_buffer.data());
+    const bool read_ok = ReadInternalWithStats(
+        min_length_to_read, flat_buffer.size(), flat_buffer.data());
     RIEGELI_ASSERT_GE(limit_pos(), pos_before)
         << "BufferedReader::ReadInternal() decreased limit_pos()";
     const Position length_read = limit_pos() - pos_before;
@@ -415,7 +462,7 @@ inline bool BufferedReader::CopyUsingPush(Position length, Writer& dest) {
     const size_t length_to_copy = UnsignedMin(length, dest.available());
     const Position pos_before = limit_pos();
     const bool read_ok =
-        ReadInternal(length_to_copy, length_to_copy, dest.cursor());
+        ReadInternalWithStats(length_to_copy, length_to_copy, dest.cursor());
     RIEGELI_ASSERT_GE(limit_pos(), pos_before)
         << "BufferedReader::ReadInternal() decreased limit_pos()";
     const Position length_read = limit_pos() - pos_before;
@@ -22,7 +22,9 @@
 #include "absl/strings/cord.h"
 #include "absl/types/optional.h"
 #include "riegeli/base/chain.h"
+#include "riegeli/base/memory_budget.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/reader.h"
@@ -45,6 +47,10 @@ class BufferedReader : public Reader {
   // other cases.
   bool ToleratesReadingAhead() override { return read_all_hint(); }
 
+  // Returns statistics of `ReadInternal()` calls, collected while
+  // `StatsEnabled()`.
+  const IoStats& stats() const { return stats_; }
+
  protected:
   // Creates a closed `BufferedReader`.
   explicit BufferedReader(Closed) noexcept : Reader(kClosed) {}
@@ -176,10 +182,24 @@ class BufferedReader : public Reader {
   // Precondition: `length > 0`
   bool CopyUsingPush(Position length, Writer& dest);
 
+  // Calls `ReadInternal()`, updating `stats_` if `StatsEnabled()`.
+  bool ReadInternalWithStats(size_t min_length, size_t max_length, char* dest);
+
+  // Draws memory for `buffer_` about to hold `buffer_.size()` bytes followed by
+  // `buffer_length` bytes from `buffer_memory_`. Returns the length which can
+  // be appended, see `ReserveBufferLength()`.
+  size_t ReserveBuffer(size_t min_length, size_t buffer_length);
+
+  // Resizes `buffer_memory_` to match the memory allocated for `buffer_`.
+  void SyncBufferMemory();
+
   ReadBufferSizer buffer_sizer_;
   // Buffered data, read directly before the physical source position which is
   // `limit_pos()`.
   ChainBlock buffer_;
+  // Memory of `buffer_` drawn from `buffer_options().memory_budget()`.
+  MemoryReservation buffer_memory_;
+  IoStats stats_;
 
   // Invariants:
   //   if `!buffer_.empty()` then `start() == buffer_.data()`
@@ -190,18 +210,23 @@ class BufferedReader : public Reader {
 
 inline BufferedReader::BufferedReader(
     const BufferOptions& buffer_options) noexcept
-    : buffer_sizer_(buffer_options) {}
+    : buffer_sizer_(buffer_options),
+      buffer_memory_(buffer_options.memory_budget()) {}
 
 inline BufferedReader::BufferedReader(BufferedReader&& that) noexcept
     : Reader(static_cast<Reader&&>(that)),
       buffer_sizer_(that.buffer_sizer_),
-      buffer_(std::move(that.buffer_)) {}
+      buffer_(std::move(that.buffer_)),
+      buffer_memory_(std::move(that.buffer_memory_)),
+      stats_(std::exchange(that.stats_, IoStats())) {}
 
 inline BufferedReader& BufferedReader::operator=(
     BufferedReader&& that) noexcept {
   Reader::operator=(static_cast<Reader&&>(that));
   buffer_sizer_ = that.buffer_sizer_;
   buffer_ = std::move(that.buffer_);
+  buffer_memory_ = std::move(that.buffer_memory_);
+  stats_ = std::exchange(that.stats_, IoStats());
   return *this;
 }
 
@@ -209,12 +234,21 @@ inline void BufferedReader::Reset(Closed) {
   Reader::Reset(kClosed);
   buffer_sizer_.Reset();
   buffer_ = ChainBlock();
+  buffer_memory_.Reset();
+  stats_ = IoStats();
 }
 
 inline void BufferedReader::Reset(const BufferOptions& buffer_options) {
   Reader::Reset();
   buffer_sizer_.Reset(buffer_options);
-  buffer_.Clear();
+  if (buffer_memory_.budget() != buffer_options.memory_budget()) {
+    // The buffer must be drawn from the new budget.
+    buffer_ = ChainBlock();
+    buffer_memory_ = MemoryReservation(buffer_options.memory_budget());
+  } else {
+    buffer_.Clear();
+  }
+  stats_ = IoStats();
 }
 
 }  // namespace riegeli
@@ -15,6 +15,7 @@
 #include "riegeli/bytes/buffered_writer.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <array>
 #include <limits>
@@ -27,6 +28,8 @@
 #include "riegeli/base/assert.h"
 #include "riegeli/base/buffer.h"
 #include "riegeli/base/buffering.h"
+#include "riegeli/base/memory_budget.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/base/zeros.h"
 #include "riegeli/bytes/buffer_options.h"
@@ -41,6 +44,10 @@ void BufferedWriter::Done() {
   DoneBehindBuffer(src);
   Writer::Done();
   buffer_ = Buffer();
+  buffer_memory_.Reset();
+  if (stats_.num_ops > 0) {
+    stats_internal::AddToProcessStats(&ProcessStats::buffered_writes, stats_);
+  }
 }
 
 void BufferedWriter::DoneBehindBuffer(absl::string_view src) {
@@ -50,12 +57,23 @@ void BufferedWriter::DoneBehindBuffer(absl::string_view src) {
   FlushBehindBuffer(src, FlushType::kFromObject);
 }
 
+inline bool BufferedWriter::WriteInternalWithStats(absl::string_view src) {
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) return WriteInternal(src);
+  const Position start_pos_before = start_pos();
+  const uint64_t start_ns = stats_internal::Now_ns();
+  const bool write_ok = WriteInternal(src);
+  stats_.time_ns += stats_internal::Now_ns() - start_ns;
+  ++stats_.num_ops;
+  stats_.bytes += start_pos() - start_pos_before;
+  return write_ok;
+}
+
 inline bool BufferedWriter::SyncBuffer() {
   const absl::string_view data(start(), start_to_cursor());
   set_buffer();
   if (data.empty()) return true;
   if (ABSL_PREDICT_FALSE(!ok())) return false;
-  return WriteInternal(data);
+  return WriteInternalWithStats(data);
 }
 
 void BufferedWriter::SetWriteSizeHintImpl(
@@ -73,9 +91,16 @@ bool BufferedWriter::PushSlow(size_t min_length, size_t recommended_length) {
                          std::numeric_limits<Position>::max() - start_pos())) {
     return FailOverflow();
   }
-  const size_t buffer_length =
+  size_t buffer_length =
       buffer_sizer_.BufferLength(start_pos(), min_length, recommended_length);
+  if (buffer_.capacity() < buffer_length) {
+    // `buffer_` will be reallocated.
+    buffer_length =
+        ReserveBufferLength(0, min_length, buffer_length,
+                            buffer_sizer_.buffer_options(), buffer_memory_);
+  }
   buffer_.Reset(buffer_length);
+  buffer_memory_.Resize(buffer_.capacity());
   set_buffer(buffer_.data(),
              UnsignedMin(buffer_.capacity(),
                          SaturatingAdd(buffer_length, buffer_length),
@@ -90,7 +115,7 @@ bool BufferedWriter::FlushBehindBuffer(absl::string_view src,
          "buffer not empty";
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   if (src.empty()) return true;
-  return WriteInternal(src);
+  return WriteInternalWithStats(src);
 }
 
 bool BufferedWriter::SeekBehindBuffer(Position new_pos) {
@@ -134,7 +159,7 @@ bool BufferedWriter::WriteSlow(absl::string_view src) {
                                                         available())) {
     if (ABSL_PREDICT_FALSE(!SyncBuffer())) return false;
     if (ABSL_PREDICT_FALSE(!ok())) return false;
-    return WriteInternal(src);
+    return WriteInternalWithStats(src);
   }
   return Writer::WriteSlow(src);
 }
@@ -22,7 +22,9 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "riegeli/base/buffer.h"
+#include "riegeli/base/memory_budget.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/writer.h"
@@ -41,6 +43,10 @@ class BufferedWriter : public Writer {
  public:
   bool PrefersCopying() const override { return true; }
 
+  // Returns statistics of `WriteInternal()` calls, collected while
+  // `StatsEnabled()`.
+  const IoStats& stats() const { return stats_; }
+
  protected:
   // Creates a closed `BufferedWriter`.
   explicit BufferedWriter(Closed) noexcept : Writer(kClosed) {}
@@ -133,28 +139,39 @@ class BufferedWriter : public Writer {
   // Writes `buffer_` to the destination. Sets buffer pointers to `nullptr`.
   bool SyncBuffer();
 
+  // Calls `WriteInternal()`, updating `stats_` if `StatsEnabled()`.
+  bool WriteInternalWithStats(absl::string_view src);
+
   WriteBufferSizer buffer_sizer_;
   // Contains buffered data, to be written directly after the physical
   // destination position which is `start_pos()`.
   Buffer buffer_;
+  // Memory of `buffer_` drawn from `buffer_options().memory_budget()`.
+  MemoryReservation buffer_memory_;
+  IoStats stats_;
 };
 
 // Implementation details follow.
 
 inline BufferedWriter::BufferedWriter(
     const BufferOptions& buffer_options) noexcept
-    : buffer_sizer_(buffer_options) {}
+    : buffer_sizer_(buffer_options),
+      buffer_memory_(buffer_options.memory_budget()) {}
 
 inline BufferedWriter::BufferedWriter(BufferedWriter&& that) noexcept
     : Writer(static_cast<Writer&&>(that)),
       buffer_sizer_(that.buffer_sizer_),
-      buffer_(std::move(that.buffer_)) {}
+      buffer_(std::move(that.buffer_)),
+      buffer_memory_(std::move(that.buffer_memory_)),
+      stats_(std::exchange(that.stats_, IoStats())) {}
 
 inline BufferedWriter& BufferedWriter::operator=(
     BufferedWriter&& that) noexcept {
   Writer::operator=(static_cast<Writer&&>(that));
   buffer_sizer_ = that.buffer_sizer_;
   buffer_ = std::move(that.buffer_);
+  buffer_memory_ = std::move(that.buffer_memory_);
+  stats_ = std::exchange(that.stats_, IoStats());
   return *this;
 }
 
@@ -162,11 +179,19 @@ inline void BufferedWriter::Reset(Closed) {
   Writer::Reset(kClosed);
   buffer_sizer_.Reset();
   buffer_ = Buffer();
+  buffer_memory_.Reset();
+  stats_ = IoStats();
 }
 
 inline void BufferedWriter::Reset(const BufferOptions& buffer_options) {
   Writer::Reset();
   buffer_sizer_.Reset(buffer_options);
+  if (buffer_memory_.budget() != buffer_options.memory_budget()) {
+    // The buffer must be drawn from the new budget.
+    buffer_ = Buffer();
+    buffer_memory_ = MemoryReservation(buffer_options.memory_budget());
+  }
+  stats_ = IoStats();
 }
 
 }  // namespace riegeli
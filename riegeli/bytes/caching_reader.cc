@@ -0,0 +1,431 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _WIN32
+
+// Make `off_t` 64-bit even on 32-bit systems.
+#undef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+
+#endif
+
+#include "riegeli/bytes/caching_reader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/buffering.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/no_destructor.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/fd_internal.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/writer.h"
+
+namespace riegeli {
+
+ReaderBlockCache::ReaderBlockCache(Options options)
+    : block_size_(options.block_size()),
+      shard_capacity_(options.capacity() / options.num_shards()),
+      num_shards_(options.num_shards()),
+      max_files_(options.max_files()),
+      shards_(new Shard[num_shards_]) {}
+
+ReaderBlockCache& ReaderBlockCache::global() {
+  static NoDestructor<ReaderBlockCache> kStaticReaderBlockCache;
+  return *kStaticReaderBlockCache;
+}
+
+uint64_t ReaderBlockCache::FileId(int fd) {
+#ifndef _WIN32
+  fd_internal::StatInfo stat_info;
+  if (ABSL_PREDICT_FALSE(fd_internal::FStat(fd, &stat_info) < 0)) {
+    return NewFileId();
+  }
+  const FileKey key{IntCast<uint64_t>(stat_info.st_dev),
+                    IntCast<uint64_t>(stat_info.st_ino)};
+  const Position size = IntCast<Position>(stat_info.st_size);
+  const int64_t mtime_sec = IntCast<int64_t>(stat_info.st_mtim.tv_sec);
+  const int64_t mtime_nsec = IntCast<int64_t>(stat_info.st_mtim.tv_nsec);
+  // Blocks of stale or forgotten files are dropped after unlocking.
+  std::vector<uint64_t> dropped_file_ids;
+  uint64_t file_id;
+  {
+    absl::MutexLock l(&files_mutex_);
+    const std::pair<absl::flat_hash_map<FileKey, FileEntry>::iterator, bool>
+        inserted = files_by_key_.try_emplace(key);
+    FileEntry& entry = inserted.first->second;
+    bool new_file_id = inserted.second;
+    if (inserted.second) {
+      files_by_freshness_.push_back(key);
+      entry.by_freshness_iter = std::prev(files_by_freshness_.end());
+    } else {
+      files_by_freshness_.splice(files_by_freshness_.end(),
+                                 files_by_freshness_, entry.by_freshness_iter);
+      if (entry.size != size || entry.mtime_sec != mtime_sec ||
+          entry.mtime_nsec != mtime_nsec) {
+        // The file was modified or replaced.
+        dropped_file_ids.push_back(entry.file_id);
+        new_file_id = true;
+      }
+    }
+    if (new_file_id) {
+      entry.size = size;
+      entry.mtime_sec = mtime_sec;
+      entry.mtime_nsec = mtime_nsec;
+      entry.file_id = NewFileId();
+    }
+    file_id = entry.file_id;
+    if (files_by_key_.size() > max_files_) {
+      const absl::flat_hash_map<FileKey, FileEntry>::iterator oldest =
+          files_by_key_.find(files_by_freshness_.front());
+      dropped_file_ids.push_back(oldest->second.file_id);
+      files_by_key_.erase(oldest);
+      files_by_freshness_.pop_front();
+    }
+  }
+  for (const uint64_t dropped_file_id : dropped_file_ids) {
+    EraseFile(dropped_file_id);
+  }
+  return file_id;
+#else
+  // Inode numbers are not available.
+  return NewFileId();
+#endif
+}
+
+uint64_t ReaderBlockCache::NewFileId() {
+  return next_file_id_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline ReaderBlockCache::Shard& ReaderBlockCache::ShardFor(const Key& key) {
+  // Consecutive blocks of a file go to different shards, so that threads
+  // reading nearby regions rarely contend.
+  return shards_[IntCast<size_t>(
+      (key.file_id * uint64_t{0x9e3779b97f4a7c15} + key.block_index) %
+      num_shards_)];
+}
+
+absl::optional<ChainBlock> ReaderBlockCache::Find(uint64_t file_id,
+                                                  Position block_index) {
+  const Key key{file_id, block_index};
+  Shard& shard = ShardFor(key);
+  absl::MutexLock l(&shard.mutex);
+  const absl::flat_hash_map<Key, Entry>::iterator iter = shard.by_key.find(key);
+  if (iter == shard.by_key.end()) {
+    ++shard.misses;
+    return absl::nullopt;
+  }
+  ++shard.hits;
+  shard.by_freshness.splice(shard.by_freshness.end(), shard.by_freshness,
+                            iter->second.by_freshness_iter);
+  return iter->second.block;
+}
+
+void ReaderBlockCache::Insert(uint64_t file_id, Position block_index,
+                              const ChainBlock& block) {
+  if (ABSL_PREDICT_FALSE(block.size() > shard_capacity_)) return;
+  const Key key{file_id, block_index};
+  Shard& shard = ShardFor(key);
+  // Evicted blocks are released after unlocking.
+  std::vector<ChainBlock> evicted;
+  absl::MutexLock l(&shard.mutex);
+  const std::pair<absl::flat_hash_map<Key, Entry>::iterator, bool> inserted =
+      shard.by_key.try_emplace(key);
+  if (!inserted.second) return;
+  shard.by_freshness.push_back(key);
+  inserted.first->second.block = block;
+  inserted.first->second.by_freshness_iter =
+      std::prev(shard.by_freshness.end());
+  shard.size += block.size();
+  while (shard.size > shard_capacity_) {
+    const absl::flat_hash_map<Key, Entry>::iterator oldest =
+        shard.by_key.find(shard.by_freshness.front());
+    shard.size -= oldest->second.block.size();
+    evicted.push_back(std::move(oldest->second.block));
+    shard.by_key.erase(oldest);
+    shard.by_freshness.pop_front();
+    ++shard.evictions;
+  }
+}
+
+void ReaderBlockCache::EraseFile(uint64_t file_id) {
+  for (size_t i = 0; i < num_shards_; ++i) {
+    Shard& shard = shards_[i];
+    std::vector<ChainBlock> erased;
+    absl::MutexLock l(&shard.mutex);
+    ByFreshness::iterator iter = shard.by_freshness.begin();
+    while (iter != shard.by_freshness.end()) {
+      if (iter->file_id != file_id) {
+        ++iter;
+        continue;
+      }
+      const absl::flat_hash_map<Key, Entry>::iterator entry =
+          shard.by_key.find(*iter);
+      shard.size -= entry->second.block.size();
+      erased.push_back(std::move(entry->second.block));
+      shard.by_key.erase(entry);
+      iter = shard.by_freshness.erase(iter);
+    }
+  }
+}
+
+ReaderBlockCache::Stats ReaderBlockCache::stats() const {
+  Stats stats;
+  for (size_t i = 0; i < num_shards_; ++i) {
+    const Shard& shard = shards_[i];
+    absl::MutexLock l(&shard.mutex);
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.num_blocks += shard.by_key.size();
+    stats.size += shard.size;
+  }
+  return stats;
+}
+
+void CachingReaderBase::Initialize(Reader* src, const Options& options) {
+  RIEGELI_ASSERT(src != nullptr)
+      << "Failed precondition of CachingReader: null Reader pointer";
+  RIEGELI_ASSERT(src->SupportsRandomAccess())
+      << "Failed precondition of CachingReader: "
+         "the original Reader does not support random access";
+  cache_ = options.cache() == nullptr ? &ReaderBlockCache::global()
+                                      : options.cache();
+  file_id_ = options.fd() < 0 ? cache_->NewFileId()
+                              : cache_->FileId(options.fd());
+  set_limit_pos(src->pos());
+  if (ABSL_PREDICT_FALSE(!src->ok())) FailWithoutAnnotation(src->status());
+}
+
+void CachingReaderBase::Done() {
+  PullableReader::Done();
+  block_ = ChainBlock();
+}
+
+absl::Status CachingReaderBase::AnnotateStatusImpl(absl::Status status) {
+  if (is_open()) {
+    Reader& src = *SrcReader();
+    src.Seek(pos());
+    return src.AnnotateStatus(std::move(status));
+  }
+  return status;
+}
+
+bool CachingReaderBase::SupportsNewReader() {
+  Reader* const src = SrcReader();
+  return src != nullptr && src->SupportsNewReader();
+}
+
+inline bool CachingReaderBase::ReadBlock() {
+  RIEGELI_ASSERT_EQ(available(), 0u)
+      << "Failed precondition of CachingReaderBase::ReadBlock(): "
+         "some data available";
+  const size_t block_size = cache_->block_size();
+  const Position block_index = limit_pos() / block_size;
+  const Position block_begin = block_index * block_size;
+  const size_t offset = IntCast<size_t>(limit_pos() - block_begin);
+  absl::optional<ChainBlock> block = cache_->Find(file_id_, block_index);
+  if (block == absl::nullopt) {
+    Reader& src = *SrcReader();
+    block.emplace();
+    if (ABSL_PREDICT_TRUE(src.Seek(block_begin))) {
+      const absl::Span<char> buffer = block->AppendFixedBuffer(block_size);
+      size_t length_read;
+      src.Read(block_size, buffer.data(), &length_read);
+      block->RemoveSuffix(block_size - length_read);
+    }
+    if (ABSL_PREDICT_FALSE(!src.ok())) {
+      set_buffer();
+      return FailWithoutAnnotation(src.status());
+    }
+    if (!block->empty()) cache_->Insert(file_id_, block_index, *block);
+  }
+  set_buffer();
+  block_ = *std::move(block);
+  if (offset >= block_.size()) return false;
+  set_buffer(block_.data(), block_.size(), offset);
+  set_limit_pos(block_begin + block_.size());
+  return true;
+}
+
+bool CachingReaderBase::PullBehindScratch(size_t recommended_length) {
+  RIEGELI_ASSERT_EQ(available(), 0u)
+      << "Failed precondition of PullableReader::PullBehindScratch(): "
+         "enough data available, use Pull() instead";
+  RIEGELI_ASSERT(!scratch_used())
+      << "Failed precondition of PullableReader::PullBehindScratch(): "
+         "scratch used";
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  return ReadBlock();
+}
+
+bool CachingReaderBase::ReadBehindScratch(size_t length, Chain& dest) {
+  RIEGELI_ASSERT_LT(UnsignedMin(available(), kMaxBytesToCopy), length)
+      << "Failed precondition of PullableReader::ReadBehindScratch(Chain&): "
+         "enough data available, use Read(Chain&) instead";
+  RIEGELI_ASSERT_LE(length, std::numeric_limits<size_t>::max() - dest.size())
+      << "Failed precondition of PullableReader::ReadBehindScratch(Chain&): "
+         "Chain size overflow";
+  RIEGELI_ASSERT(!scratch_used())
+      << "Failed precondition of PullableReader::ReadBehindScratch(Chain&): "
+         "scratch used";
+  for (;;) {
+    const size_t length_to_read = UnsignedMin(available(), length);
+    if (length_to_read > 0) {
+      block_.AppendSubstrTo(absl::string_view(cursor(), length_to_read), dest);
+      move_cursor(length_to_read);
+      length -= length_to_read;
+      if (length == 0) return true;
+    }
+    if (ABSL_PREDICT_FALSE(!ok())) return false;
+    if (ABSL_PREDICT_FALSE(!ReadBlock())) return false;
+  }
+}
+
+bool CachingReaderBase::ReadBehindScratch(size_t length, absl::Cord& dest) {
+  RIEGELI_ASSERT_LT(UnsignedMin(available(), kMaxBytesToCopy), length)
+      << "Failed precondition of PullableReader::ReadBehindScratch(Cord&): "
+         "enough data available, use Read(Cord&) instead";
+  RIEGELI_ASSERT_LE(length, std::numeric_limits<size_t>::max() - dest.size())
+      << "Failed precondition of PullableReader::ReadBehindScratch(Cord&): "
+         "Cord size overflow";
+  RIEGELI_ASSERT(!scratch_used())
+      << "Failed precondition of PullableReader::ReadBehindScratch(Cord&): "
+         "scratch used";
+  for (;;) {
+    const size_t length_to_read = UnsignedMin(available(), length);
+    if (length_to_read > 0) {
+      block_.AppendSubstrTo(absl::string_view(cursor(), length_to_read), dest);
+      move_cursor(length_to_read);
+      length -= length_to_read;
+      if (length == 0) return true;
+    }
+    if (ABSL_PREDICT_FALSE(!ok())) return false;
+    if (ABSL_PREDICT_FALSE(!ReadBlock())) return false;
+  }
+}
+
+bool CachingReaderBase::CopyBehindScratch(Position length, Writer& dest) {
+  RIEGELI_ASSERT_LT(UnsignedMin(available(), kMaxBytesToCopy), length)
+      << "Failed precondition of PullableReader::CopyBehindScratch(Writer&): "
+         "enough data available, use Copy(Writer&) instead";
+  RIEGELI_ASSERT(!scratch_used())
+      << "Failed precondition of PullableReader::CopyBehindScratch(Writer&): "
+         "scratch used";
+  for (;;) {
+    const size_t length_to_copy = UnsignedMin(available(), length);
+    if (length_to_copy > 0) {
+      const absl::string_view data(cursor(), length_to_copy);
+      move_cursor(length_to_copy);
+      length -= length_to_copy;
+      if (length_to_copy <= kMaxBytesToCopy) {
+        if (ABSL_PREDICT_FALSE(!dest.Write(data))) return false;
+      } else {
+        Chain chain;
+        block_.AppendSubstrTo(data, chain);
+        if (ABSL_PREDICT_FALSE(!dest.Write(std::move(chain)))) return false;
+      }
+      if (length == 0) return true;
+    }
+    if (ABSL_PREDICT_FALSE(!ok())) return false;
+    if (ABSL_PREDICT_FALSE(!ReadBlock())) return false;
+  }
+}
+
+bool CachingReaderBase::SyncBehindScratch(SyncType sync_type) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  Reader& src = *SrcReader();
+  if (ABSL_PREDICT_FALSE(!src.Seek(pos()))) {
+    if (ABSL_PREDICT_FALSE(!src.ok())) {
+      return FailWithoutAnnotation(src.status());
+    }
+  }
+  if (sync_type == SyncType::kFromObject) return true;
+  if (ABSL_PREDICT_FALSE(!src.Sync(sync_type))) {
+    return FailWithoutAnnotation(src.status());
+  }
+  return true;
+}
+
+bool CachingReaderBase::SeekBehindScratch(Position new_pos) {
+  RIEGELI_ASSERT(new_pos < start_pos() || new_pos > limit_pos())
+      << "Failed precondition of PullableReader::SeekBehindScratch(): "
+         "position in the buffer, use Seek() instead";
+  RIEGELI_ASSERT(!scratch_used())
+      << "Failed precondition of PullableReader::SeekBehindScratch(): "
+         "scratch used";
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  set_buffer();
+  set_limit_pos(new_pos);
+  if (ReadBlock()) return true;
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  const Position block_begin = new_pos - new_pos % cache_->block_size();
+  if (!block_.empty()) {
+    // The source ends in this block.
+    const Position size = block_begin + block_.size();
+    set_limit_pos(UnsignedMin(new_pos, size));
+    return new_pos <= size;
+  }
+  // The source ends before this block, or at its beginning.
+  const absl::optional<Position> size = SizeImpl();
+  if (ABSL_PREDICT_FALSE(size == absl::nullopt)) return false;
+  set_limit_pos(UnsignedMin(new_pos, *size));
+  return new_pos <= *size;
+}
+
+absl::optional<Position> CachingReaderBase::SizeImpl() {
+  if (ABSL_PREDICT_FALSE(!ok())) return absl::nullopt;
+  Reader& src = *SrcReader();
+  const absl::optional<Position> size = src.Size();
+  if (ABSL_PREDICT_FALSE(size == absl::nullopt)) {
+    FailWithoutAnnotation(src.status());
+  }
+  return size;
+}
+
+std::unique_ptr<Reader> CachingReaderBase::NewReaderImpl(Position initial_pos) {
+  if (ABSL_PREDICT_FALSE(!ok())) return nullptr;
+  // `NewReaderImpl()` is thread-safe from this point
+  // if `SrcReader()->SupportsNewReader()`.
+  Reader& src = *SrcReader();
+  std::unique_ptr<Reader> src_reader = src.NewReader(initial_pos);
+  if (ABSL_PREDICT_FALSE(src_reader == nullptr)) {
+    FailWithoutAnnotation(src.status());
+    return nullptr;
+  }
+  std::unique_ptr<CachingReader<std::unique_ptr<Reader>>> reader =
+      std::make_unique<CachingReader<std::unique_ptr<Reader>>>(
+          std::move(src_reader), Options().set_cache(cache_));
+  // Share cached blocks with `*this`.
+  reader->file_id_ = file_id_;
+  return reader;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,561 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BYTES_CACHING_READER_H_
+#define RIEGELI_BYTES_CACHING_READER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/cord.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/dependency.h"
+#include "riegeli/base/object.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/pullable_reader.h"
+#include "riegeli/bytes/reader.h"
+
+namespace riegeli {
+
+class Writer;
+
+// A cache of aligned blocks of files, shared by `CachingReader` objects.
+//
+// Blocks are keyed by a file identifier and a block index. Cached blocks are
+// shared with readers and with `Chain` and `absl::Cord` objects read from them
+// without copying. The cache is divided into shards with separate locks, each
+// evicting its least recently used blocks when over its share of the
+// capacity.
+//
+// Cached data of a file identifier are assumed to never change. `FileId(fd)`
+// gives a new identifier when the file is modified or replaced.
+//
+// `ReaderBlockCache` is thread-safe.
+class ReaderBlockCache {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Maximum total size of cached blocks.
+    //
+    // Default: 64M.
+    Options& set_capacity(size_t capacity) & {
+      capacity_ = capacity;
+      return *this;
+    }
+    Options&& set_capacity(size_t capacity) && {
+      return std::move(set_capacity(capacity));
+    }
+    size_t capacity() const { return capacity_; }
+
+    // Size of a cached block. Blocks are aligned to multiples of the block
+    // size.
+    //
+    // Default: 64K.
+    Options& set_block_size(size_t block_size) & {
+      RIEGELI_ASSERT_GT(block_size, 0u)
+          << "Failed precondition of "
+             "ReaderBlockCache::Options::set_block_size(): "
+             "zero block size";
+      block_size_ = block_size;
+      return *this;
+    }
+    Options&& set_block_size(size_t block_size) && {
+      return std::move(set_block_size(block_size));
+    }
+    size_t block_size() const { return block_size_; }
+
+    // Number of shards with separate locks. More shards reduce contention
+    // between threads, but make eviction less precise.
+    //
+    // Default: 16.
+    Options& set_num_shards(size_t num_shards) & {
+      RIEGELI_ASSERT_GT(num_shards, 0u)
+          << "Failed precondition of "
+             "ReaderBlockCache::Options::set_num_shards(): "
+             "zero shards";
+      num_shards_ = num_shards;
+      return *this;
+    }
+    Options&& set_num_shards(size_t num_shards) && {
+      return std::move(set_num_shards(num_shards));
+    }
+    size_t num_shards() const { return num_shards_; }
+
+    // Maximum number of files remembered by `FileId(fd)`. When more files are
+    // seen, the least recently seen file is forgotten and its blocks are
+    // dropped.
+    //
+    // Default: 1024.
+    Options& set_max_files(size_t max_files) & {
+      RIEGELI_ASSERT_GT(max_files, 0u)
+          << "Failed precondition of "
+             "ReaderBlockCache::Options::set_max_files(): "
+             "zero files";
+      max_files_ = max_files;
+      return *this;
+    }
+    Options&& set_max_files(size_t max_files) && {
+      return std::move(set_max_files(max_files));
+    }
+    size_t max_files() const { return max_files_; }
+
+   private:
+    size_t capacity_ = size_t{64} << 20;
+    size_t block_size_ = size_t{64} << 10;
+    size_t num_shards_ = 16;
+    size_t max_files_ = 1024;
+  };
+
+  // Counters of cache activity, summed over shards.
+  struct Stats {
+    // Number of lookups which found a block.
+    uint64_t hits = 0;
+    // Number of lookups which did not find a block.
+    uint64_t misses = 0;
+    // Number of blocks evicted to make space for other blocks.
+    uint64_t evictions = 0;
+    // Number of cached blocks.
+    size_t num_blocks = 0;
+    // Total size of cached blocks.
+    size_t size = 0;
+  };
+
+  explicit ReaderBlockCache(Options options = Options());
+
+  ReaderBlockCache(const ReaderBlockCache&) = delete;
+  ReaderBlockCache& operator=(const ReaderBlockCache&) = delete;
+
+  // Returns a default process-wide cache with default options.
+  static ReaderBlockCache& global();
+
+  // Returns the size of a cached block.
+  size_t block_size() const { return block_size_; }
+
+  // Returns the identifier of the file open as `fd`.
+  //
+  // The file is identified by its device and inode numbers, from `fstat()` on
+  // `fd`. The same file gives the same identifier while its size and
+  // modification time stay unchanged. Otherwise, e.g. after the file was
+  // modified, or a file with a reused inode number replaced it, blocks cached
+  // under the old identifier are dropped and a new identifier is returned.
+  //
+  // If `fstat()` fails, returns `NewFileId()`.
+  uint64_t FileId(int fd) ABSL_LOCKS_EXCLUDED(files_mutex_);
+
+  // Returns an identifier different from all other identifiers.
+  uint64_t NewFileId();
+
+  // Returns the cached block with the given index, or `absl::nullopt` if it is
+  // not cached.
+  absl::optional<ChainBlock> Find(uint64_t file_id, Position block_index);
+
+  // Caches a block with the given index. If it is already cached, the cached
+  // block is kept.
+  //
+  // A block shorter than `block_size()` marks the end of the file.
+  void Insert(uint64_t file_id, Position block_index, const ChainBlock& block);
+
+  // Drops all cached blocks of the given file.
+  void EraseFile(uint64_t file_id);
+
+  // Returns counters of cache activity.
+  Stats stats() const;
+
+ private:
+  struct Key {
+    friend bool operator==(const Key& a, const Key& b) {
+      return a.file_id == b.file_id && a.block_index == b.block_index;
+    }
+    template <typename HashState>
+    friend HashState AbslHashValue(HashState hash_state, const Key& self) {
+      return HashState::combine(std::move(hash_state), self.file_id,
+                                self.block_index);
+    }
+
+    uint64_t file_id;
+    Position block_index;
+  };
+
+  // Adding or removing elements in `ByFreshness` must not invalidate other
+  // iterators.
+  using ByFreshness = std::list<Key>;
+
+  struct Entry {
+    ChainBlock block;
+    ByFreshness::iterator by_freshness_iter;
+  };
+
+  struct Shard {
+    mutable absl::Mutex mutex;
+    // Total size of cached blocks.
+    size_t size ABSL_GUARDED_BY(mutex) = 0;
+    uint64_t hits ABSL_GUARDED_BY(mutex) = 0;
+    uint64_t misses ABSL_GUARDED_BY(mutex) = 0;
+    uint64_t evictions ABSL_GUARDED_BY(mutex) = 0;
+    // Keys of cached blocks, ordered by their freshness (older to newer).
+    ByFreshness by_freshness ABSL_GUARDED_BY(mutex);
+    // Cached blocks. Each block is associated with the matching
+    // `by_freshness` iterator.
+    absl::flat_hash_map<Key, Entry> by_key ABSL_GUARDED_BY(mutex);
+  };
+
+  struct FileKey {
+    friend bool operator==(const FileKey& a, const FileKey& b) {
+      return a.device == b.device && a.inode == b.inode;
+    }
+    template <typename HashState>
+    friend HashState AbslHashValue(HashState hash_state, const FileKey& self) {
+      return HashState::combine(std::move(hash_state), self.device,
+                                self.inode);
+    }
+
+    uint64_t device;
+    uint64_t inode;
+  };
+
+  // Adding or removing elements in `FilesByFreshness` must not invalidate
+  // other iterators.
+  using FilesByFreshness = std::list<FileKey>;
+
+  struct FileEntry {
+    // The file state when `file_id` was assigned.
+    Position size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t file_id;
+    FilesByFreshness::iterator by_freshness_iter;
+  };
+
+  Shard& ShardFor(const Key& key);
+
+  const size_t block_size_;
+  // Capacity of each shard.
+  const size_t shard_capacity_;
+  const size_t num_shards_;
+  const size_t max_files_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<uint64_t> next_file_id_{0};
+  absl::Mutex files_mutex_;
+  // Keys of remembered files, ordered by their freshness (older to newer).
+  FilesByFreshness files_by_freshness_ ABSL_GUARDED_BY(files_mutex_);
+  // Remembered files. Each file is associated with the matching
+  // `files_by_freshness_` iterator.
+  absl::flat_hash_map<FileKey, FileEntry> files_by_key_
+      ABSL_GUARDED_BY(files_mutex_);
+};
+
+// Template parameter independent part of `CachingReader`.
+class CachingReaderBase : public PullableReader {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // The cache to use. `nullptr` means `ReaderBlockCache::global()`.
+    //
+    // The cache must outlive the `CachingReader`.
+    //
+    // Default: `nullptr`.
+    Options& set_cache(ReaderBlockCache* cache) & {
+      cache_ = cache;
+      return *this;
+    }
+    Options&& set_cache(ReaderBlockCache* cache) && {
+      return std::move(set_cache(cache));
+    }
+    ReaderBlockCache* cache() const { return cache_; }
+
+    // A fd open to the file read by the original `Reader`, e.g.
+    // `FdReaderBase::SrcFd()`. Readers of the same unchanged file share cached
+    // blocks, as determined by `ReaderBlockCache::FileId(fd)`. The fd is used
+    // only during construction.
+    //
+    // If -1, cached blocks are shared only with readers created by
+    // `NewReader()`.
+    //
+    // Default: -1.
+    Options& set_fd(int fd) & {
+      fd_ = fd;
+      return *this;
+    }
+    Options&& set_fd(int fd) && { return std::move(set_fd(fd)); }
+    int fd() const { return fd_; }
+
+   private:
+    ReaderBlockCache* cache_ = nullptr;
+    int fd_ = -1;
+  };
+
+  // Returns the original `Reader`. Unchanged by `Close()`.
+  virtual Reader* SrcReader() = 0;
+  virtual const Reader* SrcReader() const = 0;
+
+  // Returns the cache.
+  ReaderBlockCache* cache() const { return cache_; }
+
+  bool ToleratesReadingAhead() override { return true; }
+  bool SupportsRandomAccess() override { return true; }
+  bool SupportsNewReader() override;
+
+ protected:
+  using PullableReader::PullableReader;
+
+  CachingReaderBase(CachingReaderBase&& that) noexcept;
+  CachingReaderBase& operator=(CachingReaderBase&& that) noexcept;
+
+  void Reset(Closed);
+  void Reset();
+  void Initialize(Reader* src, const Options& options);
+
+  void Done() override;
+  ABSL_ATTRIBUTE_COLD absl::Status AnnotateStatusImpl(
+      absl::Status status) override;
+  bool PullBehindScratch(size_t recommended_length) override;
+  using PullableReader::ReadBehindScratch;
+  bool ReadBehindScratch(size_t length, Chain& dest) override;
+  bool ReadBehindScratch(size_t length, absl::Cord& dest) override;
+  using PullableReader::CopyBehindScratch;
+  bool CopyBehindScratch(Position length, Writer& dest) override;
+  bool SyncBehindScratch(SyncType sync_type) override;
+  bool SeekBehindScratch(Position new_pos) override;
+  absl::optional<Position> SizeImpl() override;
+  std::unique_ptr<Reader> NewReaderImpl(Position initial_pos) override;
+
+ private:
+  // Makes `block_` the block containing `limit_pos()`, and makes the buffer
+  // its data from `limit_pos()`. Returns `false` at the end of the source or
+  // on failure.
+  bool ReadBlock();
+
+  ReaderBlockCache* cache_ = nullptr;
+  uint64_t file_id_ = 0;
+  // The block being read.
+  ChainBlock block_;
+
+  // Invariants if `is_open()` and scratch is not used:
+  //   `start() == (start_to_limit() == 0 ? nullptr : block_.data())`
+  //   `start_to_limit() == 0 || start_to_limit() == block_.size()`
+};
+
+// A `Reader` which reads from another `Reader` through a `ReaderBlockCache`,
+// so that repeated reads of the same region, also by other `CachingReader`
+// objects reading the same file, are served from memory.
+//
+// This suits many small random reads of the same files from many threads,
+// e.g. `RecordReader::Seek()` followed by reading a record. Readers for
+// concurrent use can be created with `NewReader()` if the original `Reader`
+// supports `NewReader()`, or separately with `fd()` open to the same file.
+//
+// Cached blocks are shared with `Chain` and `absl::Cord` objects read from a
+// `CachingReader` without copying.
+//
+// The original `Reader` must support random access. Its position after
+// `Close()` is the position of the `CachingReader`.
+//
+// The `Src` template parameter specifies the type of the object providing and
+// possibly owning the original `Reader`. `Src` must support
+// `Dependency<Reader*, Src>`, e.g. `Reader*` (not owned, default),
+// `std::unique_ptr<Reader>` (owned), `FdReader<>` (owned).
+//
+// By relying on CTAD the template argument can be deduced as the value type of
+// the first constructor argument. This requires C++17.
+//
+// The original `Reader` must not be accessed until the `CachingReader` is
+// closed or no longer used.
+template <typename Src = Reader*>
+class CachingReader : public CachingReaderBase {
+ public:
+  // Creates a closed `CachingReader`.
+  explicit CachingReader(Closed) noexcept : CachingReaderBase(kClosed) {}
+
+  // Will read from the original `Reader` provided by `src`.
+  explicit CachingReader(const Src& src, Options options = Options());
+  explicit CachingReader(Src&& src, Options options = Options());
+
+  // Will read from the original `Reader` provided by a `Src` constructed from
+  // elements of `src_args`. This avoids constructing a temporary `Src` and
+  // moving from it.
+  template <typename... SrcArgs>
+  explicit CachingReader(std::tuple<SrcArgs...> src_args,
+                         Options options = Options());
+
+  CachingReader(CachingReader&& that) noexcept;
+  CachingReader& operator=(CachingReader&& that) noexcept;
+
+  // Makes `*this` equivalent to a newly constructed `CachingReader`. This
+  // avoids constructing a temporary `CachingReader` and moving from it.
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(Closed);
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(const Src& src,
+                                          Options options = Options());
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(Src&& src,
+                                          Options options = Options());
+  template <typename... SrcArgs>
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(std::tuple<SrcArgs...> src_args,
+                                          Options options = Options());
+
+  // Returns the object providing and possibly owning the original `Reader`.
+  // Unchanged by `Close()`.
+  Src& src() { return src_.manager(); }
+  const Src& src() const { return src_.manager(); }
+  Reader* SrcReader() override { return src_.get(); }
+  const Reader* SrcReader() const override { return src_.get(); }
+
+ protected:
+  void Done() override;
+
+ private:
+  // The object providing and possibly owning the original `Reader`.
+  Dependency<Reader*, Src> src_;
+};
+
+// Support CTAD.
+#if __cpp_deduction_guides
+explicit CachingReader(Closed)->CachingReader<DeleteCtad<Closed>>;
+template <typename Src>
+explicit CachingReader(const Src& src, CachingReaderBase::Options options =
+                                           CachingReaderBase::Options())
+    -> CachingReader<std::decay_t<Src>>;
+template <typename Src>
+explicit CachingReader(Src&& src, CachingReaderBase::Options options =
+                                      CachingReaderBase::Options())
+    -> CachingReader<std::decay_t<Src>>;
+template <typename... SrcArgs>
+explicit CachingReader(
+    std::tuple<SrcArgs...> src_args,
+    CachingReaderBase::Options options = CachingReaderBase::Options())
+    -> CachingReader<DeleteCtad<std::tuple<SrcArgs...>>>;
+#endif
+
+// Implementation details follow.
+
+inline CachingReaderBase::CachingReaderBase(CachingReaderBase&& that) noexcept
+    : PullableReader(static_cast<PullableReader&&>(that)),
+      cache_(that.cache_),
+      file_id_(that.file_id_),
+      block_(std::move(that.block_)) {}
+
+inline CachingReaderBase& CachingReaderBase::operator=(
+    CachingReaderBase&& that) noexcept {
+  PullableReader::operator=(static_cast<PullableReader&&>(that));
+  cache_ = that.cache_;
+  file_id_ = that.file_id_;
+  block_ = std::move(that.block_);
+  return *this;
+}
+
+inline void CachingReaderBase::Reset(Closed) {
+  PullableReader::Reset(kClosed);
+  cache_ = nullptr;
+  file_id_ = 0;
+  block_ = ChainBlock();
+}
+
+inline void CachingReaderBase::Reset() {
+  PullableReader::Reset();
+  // `cache_` and `file_id_` will be set by `Initialize()`.
+  block_ = ChainBlock();
+}
+
+template <typename Src>
+inline CachingReader<Src>::CachingReader(const Src& src, Options options)
+    : src_(src) {
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+inline CachingReader<Src>::CachingReader(Src&& src, Options options)
+    : src_(std::move(src)) {
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+template <typename... SrcArgs>
+inline CachingReader<Src>::CachingReader(std::tuple<SrcArgs...> src_args,
+                                         Options options)
+    : src_(std::move(src_args)) {
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+inline CachingReader<Src>::CachingReader(CachingReader&& that) noexcept
+    : CachingReaderBase(static_cast<CachingReaderBase&&>(that)),
+      src_(std::move(that.src_)) {}
+
+template <typename Src>
+inline CachingReader<Src>& CachingReader<Src>::operator=(
+    CachingReader&& that) noexcept {
+  CachingReaderBase::operator=(static_cast<CachingReaderBase&&>(that));
+  src_ = std::move(that.src_);
+  return *this;
+}
+
+template <typename Src>
+inline void CachingReader<Src>::Reset(Closed) {
+  CachingReaderBase::Reset(kClosed);
+  src_.Reset();
+}
+
+template <typename Src>
+inline void CachingReader<Src>::Reset(const Src& src, Options options) {
+  CachingReaderBase::Reset();
+  src_.Reset(src);
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+inline void CachingReader<Src>::Reset(Src&& src, Options options) {
+  CachingReaderBase::Reset();
+  src_.Reset(std::move(src));
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+template <typename... SrcArgs>
+inline void CachingReader<Src>::Reset(std::tuple<SrcArgs...> src_args,
+                                      Options options) {
+  CachingReaderBase::Reset();
+  src_.Reset(std::move(src_args));
+  Initialize(src_.get(), options);
+}
+
+template <typename Src>
+void CachingReader<Src>::Done() {
+  CachingReaderBase::Done();
+  if (src_.is_owning()) {
+    if (ABSL_PREDICT_FALSE(!src_->Close())) {
+      FailWithoutAnnotation(src_->status());
+    }
+  }
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BYTES_CACHING_READER_H_
@@ -0,0 +1,246 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/bytes/caching_reader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/string_reader.h"
+
+namespace riegeli {
+namespace {
+
+constexpr size_t kBlockSize = 1 << 10;
+
+std::string TestData(size_t size) {
+  std::mt19937 random(1);
+  std::string data(size, '\0');
+  for (char& ch : data) ch = static_cast<char>('a' + random() % 26);
+  return data;
+}
+
+ReaderBlockCache::Options CacheOptions() {
+  return ReaderBlockCache::Options()
+      .set_capacity(size_t{1} << 20)
+      .set_block_size(kBlockSize)
+      .set_num_shards(4);
+}
+
+// Reads `length` bytes at `pos`, or fewer at the end of the source.
+std::string ReadAt(Reader& reader, Position pos, size_t length) {
+  EXPECT_TRUE(reader.Seek(pos)) << reader.status();
+  std::string dest;
+  reader.Read(length, dest);
+  EXPECT_TRUE(reader.ok()) << reader.status();
+  return dest;
+}
+
+// Reads ranges at random positions, and checks them against `data`.
+void CheckRandomReads(absl::string_view data, Reader& reader, uint32_t seed) {
+  std::mt19937 random(seed);
+  for (int i = 0; i < 200; ++i) {
+    const Position pos = random() % (data.size() + 1);
+    const size_t length = random() % (3 * kBlockSize);
+    EXPECT_EQ(ReadAt(reader, pos, length), data.substr(pos, length))
+        << "At " << pos << ", length " << length;
+  }
+}
+
+TEST(CachingReaderTest, ReadsSource) {
+  ReaderBlockCache cache(CacheOptions());
+  for (size_t size : {size_t{0}, size_t{1}, kBlockSize - 1, kBlockSize,
+                      10 * kBlockSize, 10 * kBlockSize + 1}) {
+    const std::string data = TestData(size);
+    CachingReader<StringReader<>> reader(
+        std::forward_as_tuple(data),
+        CachingReaderBase::Options().set_cache(&cache));
+    std::string contents;
+    ASSERT_TRUE(ReadAll(reader, contents).ok()) << reader.status();
+    EXPECT_TRUE(contents == data) << "Size: " << size;
+    EXPECT_EQ(reader.Size(), size);
+    CheckRandomReads(data, reader, 1);
+    EXPECT_TRUE(reader.Close()) << reader.status();
+  }
+}
+
+TEST(CachingReaderTest, ReadsChain) {
+  ReaderBlockCache cache(CacheOptions());
+  const std::string data = TestData(10 * kBlockSize + 100);
+  CachingReader<StringReader<>> reader(
+      std::forward_as_tuple(data),
+      CachingReaderBase::Options().set_cache(&cache));
+  ASSERT_TRUE(reader.Seek(100)) << reader.status();
+  Chain dest;
+  ASSERT_TRUE(reader.Read(5 * kBlockSize, dest)) << reader.status();
+  EXPECT_EQ(dest, absl::string_view(data).substr(100, 5 * kBlockSize));
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+void WriteFile(const std::string& filename, absl::string_view data) {
+  FdWriter<> writer(filename);
+  ASSERT_TRUE(writer.Write(data)) << writer.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+}
+
+// Reads the whole file through `cache`, sharing blocks by file identity.
+std::string ReadFileThroughCache(const std::string& filename,
+                                 ReaderBlockCache& cache) {
+  FdReader<> src(filename);
+  EXPECT_TRUE(src.ok()) << src.status();
+  CachingReader<> reader(
+      &src,
+      CachingReaderBase::Options().set_cache(&cache).set_fd(src.SrcFd()));
+  std::string contents;
+  EXPECT_TRUE(ReadAll(reader, contents).ok()) << reader.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  EXPECT_TRUE(src.Close()) << src.status();
+  return contents;
+}
+
+TEST(CachingReaderTest, SharesBlocksOfSameFile) {
+  ReaderBlockCache cache(CacheOptions());
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/caching_reader_shared");
+  const std::string data = TestData(10 * kBlockSize + 100);
+  WriteFile(filename, data);
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == data);
+  const ReaderBlockCache::Stats stats_after_first = cache.stats();
+  EXPECT_EQ(stats_after_first.num_blocks, 11u);
+  EXPECT_EQ(stats_after_first.size, data.size());
+
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == data);
+  const ReaderBlockCache::Stats stats_after_second = cache.stats();
+  EXPECT_EQ(stats_after_second.misses, stats_after_first.misses);
+  EXPECT_GE(stats_after_second.hits, stats_after_first.hits + 11);
+  EXPECT_EQ(stats_after_second.num_blocks, 11u);
+}
+
+TEST(CachingReaderTest, ModifiedFileIsReadAgain) {
+  ReaderBlockCache cache(CacheOptions());
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/caching_reader_modified");
+  const std::string data = TestData(10 * kBlockSize + 100);
+  WriteFile(filename, data);
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == data);
+
+  // Rewriting the file keeps its inode but changes its size.
+  const std::string new_data = TestData(4 * kBlockSize);
+  WriteFile(filename, new_data);
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == new_data);
+  // Blocks of the old contents are dropped.
+  EXPECT_EQ(cache.stats().num_blocks, 4u);
+  EXPECT_EQ(cache.stats().size, new_data.size());
+}
+
+TEST(CachingReaderTest, ReplacedFileIsReadAgain) {
+  ReaderBlockCache cache(CacheOptions());
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/caching_reader_replaced");
+  const std::string new_filename = absl::StrCat(filename, ".new");
+  const std::string data = TestData(10 * kBlockSize + 100);
+  WriteFile(filename, data);
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == data);
+
+  // A file of the same size renamed over the old one has a different inode.
+  const std::string new_data(data.size(), 'x');
+  WriteFile(new_filename, new_data);
+  ASSERT_EQ(std::rename(new_filename.c_str(), filename.c_str()), 0);
+  EXPECT_TRUE(ReadFileThroughCache(filename, cache) == new_data);
+}
+
+TEST(CachingReaderTest, ForgetsLeastRecentlySeenFiles) {
+  ReaderBlockCache cache(ReaderBlockCache::Options()
+                             .set_capacity(size_t{1} << 20)
+                             .set_block_size(kBlockSize)
+                             .set_num_shards(4)
+                             .set_max_files(2));
+  const std::string data = TestData(kBlockSize);
+  for (int i = 0; i < 5; ++i) {
+    const std::string filename =
+        absl::StrCat(testing::TempDir(), "/caching_reader_forget_", i);
+    WriteFile(filename, data);
+    EXPECT_TRUE(ReadFileThroughCache(filename, cache) == data);
+  }
+  // Only blocks of the last two files are kept.
+  EXPECT_EQ(cache.stats().num_blocks, 2u);
+}
+
+TEST(CachingReaderTest, EvictsLeastRecentlyUsed) {
+  ReaderBlockCache cache(ReaderBlockCache::Options()
+                             .set_capacity(4 * kBlockSize)
+                             .set_block_size(kBlockSize)
+                             .set_num_shards(1));
+  const std::string data = TestData(10 * kBlockSize);
+  CachingReader<StringReader<>> reader(
+      std::forward_as_tuple(data),
+      CachingReaderBase::Options().set_cache(&cache));
+  std::string contents;
+  ASSERT_TRUE(ReadAll(reader, contents).ok()) << reader.status();
+  EXPECT_TRUE(contents == data);
+  ReaderBlockCache::Stats stats = cache.stats();
+  EXPECT_LE(stats.size, 4 * kBlockSize);
+  EXPECT_GE(stats.evictions, 6u);
+
+  // The last block is still cached, the first one is not.
+  const uint64_t misses = stats.misses;
+  EXPECT_EQ(ReadAt(reader, 9 * kBlockSize, 1), data.substr(9 * kBlockSize, 1));
+  EXPECT_EQ(cache.stats().misses, misses);
+  EXPECT_EQ(ReadAt(reader, 0, 1), data.substr(0, 1));
+  EXPECT_EQ(cache.stats().misses, misses + 1);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST(CachingReaderTest, ConcurrentNewReaders) {
+  ReaderBlockCache cache(CacheOptions());
+  const std::string data = TestData(100 * kBlockSize + 100);
+  CachingReader<StringReader<>> reader(
+      std::forward_as_tuple(data),
+      CachingReaderBase::Options().set_cache(&cache));
+  ASSERT_TRUE(reader.SupportsNewReader());
+  std::vector<std::thread> threads;
+  for (uint32_t thread_index = 0; thread_index < 8; ++thread_index) {
+    std::unique_ptr<Reader> new_reader = reader.NewReader(0);
+    ASSERT_NE(new_reader, nullptr) << reader.status();
+    threads.emplace_back(
+        [&data, thread_index, new_reader = std::move(new_reader)] {
+          CheckRandomReads(data, *new_reader, thread_index);
+          EXPECT_TRUE(new_reader->Close()) << new_reader->status();
+        });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_GT(cache.stats().hits, 0u);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+}  // namespace
+}  // namespace riegeli
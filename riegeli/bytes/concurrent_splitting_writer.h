@@ -0,0 +1,472 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BYTES_CONCURRENT_SPLITTING_WRITER_H_
+#define RIEGELI_BYTES_CONCURRENT_SPLITTING_WRITER_H_
+
+#include <stddef.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/dependency.h"
+#include "riegeli/base/object.h"
+#include "riegeli/base/parallelism.h"
+#include "riegeli/base/status.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/splitting_writer.h"
+#include "riegeli/bytes/writer.h"
+
+namespace riegeli {
+
+// A `SplittingWriter` which closes full shards in background threads while
+// writing continues into the next shard, so that latency of closing a shard
+// (e.g. finishing compression, flushing, or syncing a file) is not on the
+// critical path.
+//
+// Shards are provided by a function `open_shard(shard_index)`, called with
+// consecutive indices starting from 0.
+//
+// A failure to close a shard in background is reported by failing the
+// `ConcurrentSplittingWriter` when the next shard is opened, when a buffer is
+// pushed, on `Flush()` other than `FlushType::kFromObject`, or on `Close()`.
+//
+// Optionally multiple shards can be kept open, and consecutive stripes of data
+// are written to them in a round-robin fashion. In this case shards do not
+// contain contiguous ranges of data.
+//
+// `Flush()` flushes open shards rather than closing them. Unless
+// `flush_type == FlushType::kFromObject`, it also waits for shards being
+// closed in background.
+//
+// The `Shard` template parameter specifies the type of the object providing and
+// owning the shard `Writer`. `Shard` must support `Dependency<Writer*, Shard>`
+// and must be movable, and a moved-from `Shard` must not refer to an open
+// `Writer`, e.g. `std::unique_ptr<Writer>` (default), `FdWriter<>`.
+template <typename Shard = std::unique_ptr<Writer>>
+class ConcurrentSplittingWriter : public SplittingWriter<Shard> {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Maximum size of a shard. When a shard is full, it is closed and a new
+    // shard is opened.
+    //
+    // Default: `std::numeric_limits<Position>::max()`.
+    Options& set_shard_size(Position shard_size) & {
+      RIEGELI_ASSERT_GT(shard_size, 0u)
+          << "Failed precondition of "
+             "ConcurrentSplittingWriter::Options::set_shard_size(): "
+             "zero shard size";
+      shard_size_ = shard_size;
+      return *this;
+    }
+    Options&& set_shard_size(Position shard_size) && {
+      return std::move(set_shard_size(shard_size));
+    }
+    Position shard_size() const { return shard_size_; }
+
+    // Maximum number of shards being closed in background. When this is
+    // exceeded, writing waits until the oldest shard is closed.
+    //
+    // If 0, shards are closed synchronously.
+    //
+    // Default: 1.
+    Options& set_max_pending_closes(size_t max_pending_closes) & {
+      max_pending_closes_ = max_pending_closes;
+      return *this;
+    }
+    Options&& set_max_pending_closes(size_t max_pending_closes) && {
+      return std::move(set_max_pending_closes(max_pending_closes));
+    }
+    size_t max_pending_closes() const { return max_pending_closes_; }
+
+    // Number of shards kept open at a time. If greater than 1, stripes of
+    // `stripe_size()` bytes are written to open shards in turn.
+    //
+    // Default: 1.
+    Options& set_num_open_shards(size_t num_open_shards) & {
+      RIEGELI_ASSERT_GT(num_open_shards, 0u)
+          << "Failed precondition of "
+             "ConcurrentSplittingWriter::Options::set_num_open_shards(): "
+             "zero open shards";
+      num_open_shards_ = num_open_shards;
+      return *this;
+    }
+    Options&& set_num_open_shards(size_t num_open_shards) && {
+      return std::move(set_num_open_shards(num_open_shards));
+    }
+    size_t num_open_shards() const { return num_open_shards_; }
+
+    // Size of a stripe written to a shard before switching to the next open
+    // shard, if `num_open_shards() > 1`.
+    //
+    // Default: 1M.
+    Options& set_stripe_size(Position stripe_size) & {
+      RIEGELI_ASSERT_GT(stripe_size, 0u)
+          << "Failed precondition of "
+             "ConcurrentSplittingWriter::Options::set_stripe_size(): "
+             "zero stripe size";
+      stripe_size_ = stripe_size;
+      return *this;
+    }
+    Options&& set_stripe_size(Position stripe_size) && {
+      return std::move(set_stripe_size(stripe_size));
+    }
+    Position stripe_size() const { return stripe_size_; }
+
+   private:
+    Position shard_size_ = std::numeric_limits<Position>::max();
+    size_t max_pending_closes_ = 1;
+    size_t num_open_shards_ = 1;
+    Position stripe_size_ = Position{1} << 20;
+  };
+
+  // Opens the shard with the given index.
+  using OpenShardFunction = std::function<Shard(size_t shard_index)>;
+
+  // Creates a closed `ConcurrentSplittingWriter`.
+  explicit ConcurrentSplittingWriter(Closed) noexcept
+      : SplittingWriter<Shard>(kClosed) {}
+
+  // Will write to shards returned by `open_shard`.
+  explicit ConcurrentSplittingWriter(OpenShardFunction open_shard,
+                                     Options options = Options());
+
+  ConcurrentSplittingWriter(ConcurrentSplittingWriter&& that) noexcept;
+  ConcurrentSplittingWriter& operator=(
+      ConcurrentSplittingWriter&& that) noexcept;
+
+  ~ConcurrentSplittingWriter() override { WaitForPendingCloses(); }
+
+  // Makes `*this` equivalent to a newly constructed
+  // `ConcurrentSplittingWriter`. This avoids constructing a temporary
+  // `ConcurrentSplittingWriter` and moving from it.
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(Closed);
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(OpenShardFunction open_shard,
+                                          Options options = Options());
+
+ protected:
+  void Done() override;
+  absl::optional<Position> OpenShardImpl() override;
+  bool CloseShardImpl() override;
+  bool PushBehindScratch(size_t recommended_length) override;
+  bool FlushBehindScratch(FlushType flush_type) override;
+
+ private:
+  // A shard which is open but not current.
+  struct Slot {
+    // `nullptr` if no shard is open in this slot.
+    std::unique_ptr<Dependency<Writer*, Shard>> shard;
+    size_t shard_index = 0;
+    // Remaining size of the shard.
+    Position remaining = 0;
+  };
+
+  // Closes `shard` in background, or synchronously if
+  // `max_pending_closes_ == 0`.
+  bool CloseShardAsync(std::unique_ptr<Dependency<Writer*, Shard>> shard,
+                       size_t shard_index);
+
+  // Collects results of closing shards in background which are finished, and
+  // waits for the oldest ones until at most `max_pending` remain. Fails
+  // `*this` if closing a shard failed.
+  bool CollectPendingCloses(size_t max_pending);
+
+  // Waits for shards being closed in background, ignoring their results.
+  void WaitForPendingCloses();
+
+  OpenShardFunction open_shard_;
+  Position shard_size_ = 0;
+  size_t max_pending_closes_ = 0;
+  Position stripe_size_ = 0;
+  size_t next_shard_index_ = 0;
+  // Invariant if `is_open()`: `!slots_.empty()`
+  std::vector<Slot> slots_;
+  // Index of the slot of the current shard, or of the next shard if no shard
+  // is current.
+  size_t current_slot_ = 0;
+  // Index of the current shard.
+  size_t current_shard_index_ = 0;
+  // Remaining size of the current stripe.
+  Position stripe_remaining_ = 0;
+  // `ShardWriter()->pos()` when the current shard became current.
+  Position current_start_pos_ = 0;
+  // Results of closing shards in background, in the order of shard closing.
+  std::deque<std::future<absl::Status>> pending_closes_;
+};
+
+// Implementation details follow.
+
+template <typename Shard>
+inline ConcurrentSplittingWriter<Shard>::ConcurrentSplittingWriter(
+    OpenShardFunction open_shard, Options options)
+    : open_shard_(std::move(open_shard)),
+      shard_size_(options.shard_size()),
+      max_pending_closes_(options.max_pending_closes()),
+      stripe_size_(options.num_open_shards() > 1
+                       ? options.stripe_size()
+                       : std::numeric_limits<Position>::max()),
+      slots_(options.num_open_shards()),
+      stripe_remaining_(stripe_size_) {}
+
+template <typename Shard>
+inline ConcurrentSplittingWriter<Shard>::ConcurrentSplittingWriter(
+    ConcurrentSplittingWriter&& that) noexcept
+    : SplittingWriter<Shard>(static_cast<SplittingWriter<Shard>&&>(that)),
+      open_shard_(std::move(that.open_shard_)),
+      shard_size_(that.shard_size_),
+      max_pending_closes_(that.max_pending_closes_),
+      stripe_size_(that.stripe_size_),
+      next_shard_index_(that.next_shard_index_),
+      slots_(std::move(that.slots_)),
+      current_slot_(that.current_slot_),
+      current_shard_index_(that.current_shard_index_),
+      stripe_remaining_(that.stripe_remaining_),
+      current_start_pos_(that.current_start_pos_),
+      pending_closes_(std::move(that.pending_closes_)) {}
+
+template <typename Shard>
+inline ConcurrentSplittingWriter<Shard>&
+ConcurrentSplittingWriter<Shard>::operator=(
+    ConcurrentSplittingWriter&& that) noexcept {
+  WaitForPendingCloses();
+  SplittingWriter<Shard>::operator=(
+      static_cast<SplittingWriter<Shard>&&>(that));
+  open_shard_ = std::move(that.open_shard_);
+  shard_size_ = that.shard_size_;
+  max_pending_closes_ = that.max_pending_closes_;
+  stripe_size_ = that.stripe_size_;
+  next_shard_index_ = that.next_shard_index_;
+  slots_ = std::move(that.slots_);
+  current_slot_ = that.current_slot_;
+  current_shard_index_ = that.current_shard_index_;
+  stripe_remaining_ = that.stripe_remaining_;
+  current_start_pos_ = that.current_start_pos_;
+  pending_closes_ = std::move(that.pending_closes_);
+  return *this;
+}
+
+template <typename Shard>
+inline void ConcurrentSplittingWriter<Shard>::Reset(Closed) {
+  WaitForPendingCloses();
+  SplittingWriter<Shard>::Reset(kClosed);
+  open_shard_ = nullptr;
+  shard_size_ = 0;
+  max_pending_closes_ = 0;
+  stripe_size_ = 0;
+  next_shard_index_ = 0;
+  slots_ = std::vector<Slot>();
+  current_slot_ = 0;
+  current_shard_index_ = 0;
+  stripe_remaining_ = 0;
+  current_start_pos_ = 0;
+}
+
+template <typename Shard>
+inline void ConcurrentSplittingWriter<Shard>::Reset(
+    OpenShardFunction open_shard, Options options) {
+  WaitForPendingCloses();
+  SplittingWriter<Shard>::Reset();
+  open_shard_ = std::move(open_shard);
+  shard_size_ = options.shard_size();
+  max_pending_closes_ = options.max_pending_closes();
+  stripe_size_ = options.num_open_shards() > 1
+                     ? options.stripe_size()
+                     : std::numeric_limits<Position>::max();
+  next_shard_index_ = 0;
+  slots_.clear();
+  slots_.resize(options.num_open_shards());
+  current_slot_ = 0;
+  current_shard_index_ = 0;
+  stripe_remaining_ = stripe_size_;
+  current_start_pos_ = 0;
+}
+
+template <typename Shard>
+void ConcurrentSplittingWriter<Shard>::Done() {
+  // Makes the current shard not current. It is closed below with other open
+  // shards.
+  SplittingWriter<Shard>::Done();
+  for (Slot& slot : slots_) {
+    if (slot.shard == nullptr) continue;
+    if (ABSL_PREDICT_TRUE(this->ok())) {
+      CloseShardAsync(std::move(slot.shard), slot.shard_index);
+    } else {
+      (*slot.shard)->Close();
+      slot.shard.reset();
+    }
+  }
+  if (ABSL_PREDICT_TRUE(this->ok())) {
+    CollectPendingCloses(0);
+  } else {
+    WaitForPendingCloses();
+  }
+  open_shard_ = nullptr;
+  slots_ = std::vector<Slot>();
+}
+
+template <typename Shard>
+absl::optional<Position> ConcurrentSplittingWriter<Shard>::OpenShardImpl() {
+  if (ABSL_PREDICT_FALSE(!CollectPendingCloses(pending_closes_.size()))) {
+    return absl::nullopt;
+  }
+  Slot& slot = slots_[current_slot_];
+  if (slot.shard == nullptr) {
+    slot.shard_index = next_shard_index_++;
+    slot.shard = std::make_unique<Dependency<Writer*, Shard>>(
+        open_shard_(slot.shard_index));
+    slot.remaining = shard_size_;
+  }
+  this->shard() = std::move(slot.shard->manager());
+  slot.shard.reset();
+  current_shard_index_ = slot.shard_index;
+  Writer* const shard = this->ShardWriter();
+  if (ABSL_PREDICT_FALSE(!shard->is_open())) {
+    // The shard failed while being opened.
+    this->FailWithoutAnnotation(this->AnnotateOverShard(shard->status()));
+    return absl::nullopt;
+  }
+  current_start_pos_ = shard->pos();
+  return UnsignedMin(slot.remaining, stripe_remaining_);
+}
+
+template <typename Shard>
+bool ConcurrentSplittingWriter<Shard>::CloseShardImpl() {
+  Slot& slot = slots_[current_slot_];
+  Writer* const shard = this->ShardWriter();
+  const Position written =
+      UnsignedMin(SaturatingSub(shard->pos(), current_start_pos_),
+                  slot.remaining, stripe_remaining_);
+  slot.remaining -= written;
+  stripe_remaining_ -= written;
+  if (stripe_remaining_ == 0 || slot.remaining == 0) {
+    // The stripe is complete. A shard closed early by `Flush()` keeps its turn,
+    // so that stripes have a fixed size.
+    current_slot_ = (current_slot_ + 1) % slots_.size();
+    stripe_remaining_ = stripe_size_;
+  }
+  std::unique_ptr<Dependency<Writer*, Shard>> shard_dep =
+      std::make_unique<Dependency<Writer*, Shard>>(std::move(this->shard()));
+  if (slot.remaining > 0) {
+    // Keep the shard open for its next turn.
+    slot.shard = std::move(shard_dep);
+    return true;
+  }
+  return CloseShardAsync(std::move(shard_dep), current_shard_index_);
+}
+
+template <typename Shard>
+bool ConcurrentSplittingWriter<Shard>::PushBehindScratch(
+    size_t recommended_length) {
+  if (!pending_closes_.empty()) {
+    if (ABSL_PREDICT_FALSE(!CollectPendingCloses(pending_closes_.size()))) {
+      return false;
+    }
+  }
+  return SplittingWriter<Shard>::PushBehindScratch(recommended_length);
+}
+
+template <typename Shard>
+bool ConcurrentSplittingWriter<Shard>::FlushBehindScratch(
+    FlushType flush_type) {
+  if (ABSL_PREDICT_FALSE(
+          !SplittingWriter<Shard>::FlushBehindScratch(flush_type))) {
+    return false;
+  }
+  if (flush_type == FlushType::kFromObject) return true;
+  for (Slot& slot : slots_) {
+    if (slot.shard == nullptr) continue;
+    Writer& shard = **slot.shard;
+    if (ABSL_PREDICT_FALSE(!shard.Flush(flush_type))) {
+      return this->FailWithoutAnnotation(
+          Annotate(shard.status(), absl::StrCat("shard ", slot.shard_index)));
+    }
+  }
+  return CollectPendingCloses(0);
+}
+
+template <typename Shard>
+bool ConcurrentSplittingWriter<Shard>::CloseShardAsync(
+    std::unique_ptr<Dependency<Writer*, Shard>> shard, size_t shard_index) {
+  if (max_pending_closes_ == 0) {
+    if (ABSL_PREDICT_FALSE(!(*shard)->Close())) {
+      return this->FailWithoutAnnotation(
+          Annotate((*shard)->status(), absl::StrCat("shard ", shard_index)));
+    }
+    return true;
+  }
+  std::promise<absl::Status>* const close_promise =
+      new std::promise<absl::Status>();
+  pending_closes_.push_back(close_promise->get_future());
+  // Closing may block on I/O, so it must not occupy a thread of
+  // `Executor::global()`.
+  internal::ThreadPool::global().Schedule(
+      [shard = shard.release(), shard_index, close_promise] {
+        absl::Status status;
+        if (ABSL_PREDICT_FALSE(!(*shard)->Close())) {
+          status = Annotate((*shard)->status(),
+                            absl::StrCat("shard ", shard_index));
+        }
+        delete shard;
+        close_promise->set_value(std::move(status));
+        delete close_promise;
+      });
+  return CollectPendingCloses(max_pending_closes_);
+}
+
+template <typename Shard>
+bool ConcurrentSplittingWriter<Shard>::CollectPendingCloses(
+    size_t max_pending) {
+  absl::Status status;
+  while (!pending_closes_.empty()) {
+    if (pending_closes_.size() <= max_pending &&
+        pending_closes_.front().wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready) {
+      break;
+    }
+    status.Update(pending_closes_.front().get());
+    pending_closes_.pop_front();
+  }
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    return this->FailWithoutAnnotation(std::move(status));
+  }
+  return true;
+}
+
+template <typename Shard>
+void ConcurrentSplittingWriter<Shard>::WaitForPendingCloses() {
+  for (std::future<absl::Status>& pending_close : pending_closes_) {
+    pending_close.wait();
+  }
+  pending_closes_.clear();
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BYTES_CONCURRENT_SPLITTING_WRITER_H_
@@ -0,0 +1,241 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/bytes/concurrent_splitting_writer.h"
+
+#include <stddef.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/bytes/writer.h"
+
+namespace riegeli {
+namespace {
+
+constexpr Position kShardSize = 100 << 10;
+constexpr Position kStripeSize = 16 << 10;
+
+// A `StringWriter` which calls `on_close()` after closing, and fails if it
+// returns a failure.
+class ShardWriter : public StringWriter<std::string*> {
+ public:
+  explicit ShardWriter(std::string* dest,
+                       std::function<absl::Status()> on_close = nullptr)
+      : StringWriter(dest), on_close_(std::move(on_close)) {}
+
+ protected:
+  void Done() override {
+    StringWriter::Done();
+    if (on_close_ != nullptr) {
+      absl::Status status = on_close_();
+      if (ABSL_PREDICT_FALSE(!status.ok())) Fail(std::move(status));
+    }
+  }
+
+ private:
+  std::function<absl::Status()> on_close_;
+};
+
+std::string TestData(size_t size) {
+  std::mt19937 random(1);
+  std::string data(size, '\0');
+  for (char& ch : data) ch = static_cast<char>('a' + random() % 26);
+  return data;
+}
+
+// Writes `data` in pieces of random lengths.
+void WriteInPieces(absl::string_view data, Writer& dest) {
+  std::mt19937 random(2);
+  while (!data.empty()) {
+    const size_t length =
+        UnsignedMin(size_t{1} + random() % (size_t{40} << 10), data.size());
+    ASSERT_TRUE(dest.Write(data.substr(0, length))) << dest.status();
+    data.remove_prefix(length);
+  }
+}
+
+// Reassembles data written with `num_open_shards` shards open at a time, by
+// following the order in which stripes are distributed among shards.
+std::string Reassemble(const std::deque<std::string>& shards,
+                       size_t num_open_shards, size_t data_size) {
+  struct Slot {
+    bool open = false;
+    size_t shard_index = 0;
+    size_t pos = 0;
+  };
+  std::vector<Slot> slots(num_open_shards);
+  size_t next_shard_index = 0;
+  std::string data;
+  for (size_t slot_index = 0; data.size() < data_size;
+       slot_index = (slot_index + 1) % num_open_shards) {
+    Slot& slot = slots[slot_index];
+    if (!slot.open) {
+      slot.open = true;
+      slot.shard_index = next_shard_index++;
+      slot.pos = 0;
+    }
+    const std::string& shard = shards[slot.shard_index];
+    const size_t length = UnsignedMin(
+        num_open_shards > 1 ? kStripeSize : kShardSize, kShardSize - slot.pos,
+        data_size - data.size());
+    data.append(shard, slot.pos, length);
+    slot.pos += length;
+    if (slot.pos == kShardSize) slot.open = false;
+  }
+  return data;
+}
+
+class ConcurrentSplittingWriterTest
+    : public testing::TestWithParam<std::tuple<size_t, size_t>> {
+ protected:
+  size_t max_pending_closes() const { return std::get<0>(GetParam()); }
+  size_t num_open_shards() const { return std::get<1>(GetParam()); }
+
+  ConcurrentSplittingWriter<>::Options options() const {
+    return ConcurrentSplittingWriter<>::Options()
+        .set_shard_size(kShardSize)
+        .set_max_pending_closes(max_pending_closes())
+        .set_num_open_shards(num_open_shards())
+        .set_stripe_size(kStripeSize);
+  }
+};
+
+TEST_P(ConcurrentSplittingWriterTest, WritesShards) {
+  const std::string data = TestData(size_t{1} << 20);
+  // `std::deque` keeps elements in place when more shards are added, while
+  // other shards are being closed in background.
+  std::deque<std::string> shards;
+  std::atomic<size_t> num_closed{0};
+  ConcurrentSplittingWriter<> writer(
+      [&](size_t shard_index) -> std::unique_ptr<Writer> {
+        EXPECT_EQ(shard_index, shards.size());
+        shards.emplace_back();
+        return std::make_unique<ShardWriter>(&shards.back(), [&] {
+          num_closed.fetch_add(1, std::memory_order_relaxed);
+          return absl::OkStatus();
+        });
+      },
+      options());
+  WriteInPieces(data, writer);
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_EQ(writer.pos(), data.size());
+  EXPECT_EQ(num_closed.load(std::memory_order_relaxed), shards.size());
+  for (const std::string& shard : shards) {
+    EXPECT_LE(shard.size(), kShardSize);
+  }
+  EXPECT_TRUE(Reassemble(shards, num_open_shards(), data.size()) == data);
+}
+
+TEST_P(ConcurrentSplittingWriterTest, CloseFailureIsReported) {
+  std::deque<std::string> shards;
+  ConcurrentSplittingWriter<> writer(
+      [&](size_t shard_index) -> std::unique_ptr<Writer> {
+        shards.emplace_back();
+        return std::make_unique<ShardWriter>(&shards.back(), [shard_index] {
+          return shard_index == 1 ? absl::DataLossError("Close failed")
+                                  : absl::OkStatus();
+        });
+      },
+      options());
+  // Writing can succeed for a while after the failure, but the failure is
+  // reported at the latest by `Close()`.
+  for (int i = 0; i < 10 && writer.ok(); ++i) {
+    writer.Write(TestData(IntCast<size_t>(kShardSize)));
+  }
+  EXPECT_FALSE(writer.Close());
+  EXPECT_TRUE(absl::IsDataLoss(writer.status())) << writer.status();
+  EXPECT_TRUE(absl::StrContains(writer.status().message(), "shard 1"))
+      << writer.status();
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    MaxPendingClosesAndNumOpenShards, ConcurrentSplittingWriterTest,
+    testing::Combine(testing::Values(size_t{0}, size_t{1}, size_t{4}),
+                     testing::Values(size_t{1}, size_t{3})));
+
+TEST(ConcurrentSplittingWriterTest, ClosesShardsInBackground) {
+  std::deque<std::string> shards;
+  absl::Notification first_shard_may_close;
+  std::atomic<bool> first_shard_closed_late{false};
+  ConcurrentSplittingWriter<> writer(
+      [&](size_t shard_index) -> std::unique_ptr<Writer> {
+        shards.emplace_back();
+        if (shard_index > 0) {
+          return std::make_unique<ShardWriter>(&shards.back());
+        }
+        return std::make_unique<ShardWriter>(&shards.back(), [&] {
+          // Closing the first shard waits until the second shard is written.
+          if (!first_shard_may_close.WaitForNotificationWithTimeout(
+                  absl::Seconds(30))) {
+            first_shard_closed_late.store(true, std::memory_order_relaxed);
+          }
+          return absl::OkStatus();
+        });
+      },
+      ConcurrentSplittingWriter<>::Options().set_shard_size(kShardSize));
+  // The second shard is not full, so it is not closed until `Close()`, which
+  // happens after the first shard is allowed to close.
+  const std::string data = TestData(IntCast<size_t>(2 * kShardSize - 1));
+  ASSERT_TRUE(writer.Write(data)) << writer.status();
+  // The second shard was written while the first one was being closed.
+  first_shard_may_close.Notify();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_FALSE(first_shard_closed_late.load(std::memory_order_relaxed));
+  ASSERT_EQ(shards.size(), 2u);
+  EXPECT_TRUE(shards[0] + shards[1] == data);
+}
+
+TEST(ConcurrentSplittingWriterTest, FlushWaitsForPendingCloses) {
+  std::deque<std::string> shards;
+  std::atomic<size_t> num_closed{0};
+  ConcurrentSplittingWriter<> writer(
+      [&](size_t shard_index) -> std::unique_ptr<Writer> {
+        shards.emplace_back();
+        return std::make_unique<ShardWriter>(&shards.back(), [&] {
+          absl::SleepFor(absl::Milliseconds(10));
+          num_closed.fetch_add(1, std::memory_order_relaxed);
+          return absl::OkStatus();
+        });
+      },
+      ConcurrentSplittingWriter<>::Options()
+          .set_shard_size(kShardSize)
+          .set_max_pending_closes(4));
+  ASSERT_TRUE(writer.Write(TestData(IntCast<size_t>(3 * kShardSize + 1))))
+      << writer.status();
+  ASSERT_TRUE(writer.Flush()) << writer.status();
+  EXPECT_EQ(num_closed.load(std::memory_order_relaxed), 3u);
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_EQ(num_closed.load(std::memory_order_relaxed), 4u);
+}
+
+}  // namespace
+}  // namespace riegeli
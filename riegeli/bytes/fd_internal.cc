@@ -12,8 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef _WIN32
+
+// Make `statx()`, `O_DIRECT`, and `sync_file_range()` available.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+// Make `off_t` 64-bit even on 32-bit systems.
+#undef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+
+#endif
+
 #include "riegeli/bytes/fd_internal.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+#include <stddef.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
 #include <string>
 #include <utility>
 
@@ -49,5 +70,70 @@ std::string ResolveFilename(int fd,
   }
 }
 
+#ifndef _WIN32
+
+bool SetUpDirectIo(int fd, bool requested, size_t& alignment,
+                   bool& flags_changed) {
+  alignment = 0;
+  flags_changed = false;
+#ifdef O_DIRECT
+  const int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) return false;
+  if ((flags & O_DIRECT) == 0) {
+    if (!requested) return true;
+    if (fcntl(fd, F_SETFL, flags | O_DIRECT) < 0) return false;
+    flags_changed = true;
+  }
+  // 4096 covers logical block sizes of practically all devices, and is used if
+  // the actual requirement cannot be determined.
+  alignment = 4096;
+#ifdef STATX_DIOALIGN
+  struct statx statx_info;
+  if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &statx_info) == 0 &&
+      (statx_info.stx_mask & STATX_DIOALIGN) != 0 &&
+      statx_info.stx_dio_offset_align > 0) {
+    alignment = statx_info.stx_dio_offset_align;
+    if (statx_info.stx_dio_mem_align > alignment) {
+      alignment = statx_info.stx_dio_mem_align;
+    }
+  }
+#endif
+#elif defined(F_NOCACHE)
+  // Bypasses the page cache without alignment requirements.
+  if (requested) {
+    if (fcntl(fd, F_NOCACHE, 1) < 0) return false;
+    flags_changed = true;
+  }
+#endif
+  return true;
+}
+
+bool RestoreDirectIo(int fd) {
+#ifdef O_DIRECT
+  const int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) return false;
+  if ((flags & O_DIRECT) != 0) {
+    if (fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0) return false;
+  }
+#elif defined(F_NOCACHE)
+  if (fcntl(fd, F_NOCACHE, 0) < 0) return false;
+#endif
+  return true;
+}
+
+void DropPageCache(int fd, Offset offset, Offset length) {
+#ifdef POSIX_FADV_DONTNEED
+  posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+#endif
+}
+
+void StartWriteback(int fd, Offset offset, Offset length) {
+#ifdef SYNC_FILE_RANGE_WRITE
+  sync_file_range(fd, offset, length, SYNC_FILE_RANGE_WRITE);
+#endif
+}
+
+#endif
+
 }  // namespace fd_internal
 }  // namespace riegeli
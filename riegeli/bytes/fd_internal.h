@@ -19,6 +19,8 @@
 // of `off_t` depends on `_FILE_OFFSET_BITS` which can reliably be set only
 // in a standalone compilation unit.
 
+#include <stddef.h>
+
 #include <string>
 
 #ifdef _WIN32
@@ -61,6 +63,45 @@ inline int FStat(int fd, StatInfo* stat_info) { return fstat(fd, stat_info); }
 
 RIEGELI_INLINE_CONSTEXPR(absl::string_view, kFStatFunctionName, "fstat()");
 
+// Makes transfers through `fd` bypass the page cache if `requested` and if this
+// is supported, and reports how transfers must be aligned.
+//
+// On success returns `true` and sets `alignment` to the required alignment of
+// file offsets, lengths, and memory addresses of transfers (a power of 2), or
+// to 0 if transfers do not need to be aligned. Direct I/O is in effect also if
+// `fd` was already opened with `O_DIRECT`, even if not `requested`.
+// `flags_changed` is set to `true` if file status flags of `fd` were changed,
+// which should then be reverted with `RestoreDirectIo()` when `fd` is no longer
+// used for direct I/O.
+//
+// On failure returns `false` with `errno` set.
+bool SetUpDirectIo(int fd, bool requested, size_t& alignment,
+                   bool& flags_changed);
+
+// Reverts changes of file status flags of `fd` made by `SetUpDirectIo()`.
+//
+// On failure returns `false` with `errno` set.
+bool RestoreDirectIo(int fd);
+
+RIEGELI_INLINE_CONSTEXPR(absl::string_view, kSetUpDirectIoFunctionName,
+                         "fcntl()");
+
+// Advises the kernel to drop cached pages of the given range of `fd`. This
+// does not wait for writeback: dirty pages, including pages being written
+// back, are skipped and stay cached. To drop written pages, call `fdatasync()`
+// first, or `StartWriteback()` early enough for writeback to complete.
+//
+// A `length` of 0 means the rest of the file starting at `offset`.
+//
+// Errors are ignored because this is only a hint.
+void DropPageCache(int fd, Offset offset, Offset length);
+
+// Starts writeback of dirty pages of the given range of `fd`, without waiting
+// for it to complete.
+//
+// Errors are ignored because a later sync reports them.
+void StartWriteback(int fd, Offset offset, Offset length);
+
 #else
 
 using Offset = __int64;
@@ -46,6 +46,7 @@
 #endif
 
 #include <cerrno>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <string>
@@ -150,7 +151,21 @@ void FdReaderBase::InitializePos(int src,
   RIEGELI_ASSERT_EQ(random_access_status_, absl::OkStatus())
       << "Failed precondition of FdReaderBase::InitializePos(): "
          "random_access_status_ not reset";
-#ifdef _WIN32
+#ifndef _WIN32
+  if (ABSL_PREDICT_FALSE(!fd_internal::SetUpDirectIo(
+          src, direct_io_, direct_io_alignment_, direct_io_flags_changed_))) {
+    FailOperation(fd_internal::kSetUpDirectIoFunctionName);
+    return;
+  }
+  direct_io_ = direct_io_alignment_ > 0;
+  if (direct_io_) {
+    // `direct_io_buffer_` is aligned to `kDirectIoBufferAlignment`. Aligning
+    // reads to at least that much too avoids partial pages.
+    direct_io_alignment_ =
+        UnsignedMax(direct_io_alignment_, kDirectIoBufferAlignment);
+  }
+#else
+  direct_io_ = false;
   RIEGELI_ASSERT(original_mode_ == absl::nullopt)
       << "Failed precondition of FdWriterBase::InitializePos(): "
          "original_mode_ not reset";
@@ -222,6 +237,14 @@ void FdReaderBase::InitializePos(int src,
       // `supports_random_access_` is left as `false`.
       random_access_status_ =
           FailedOperationStatus(fd_internal::kLSeekFunctionName);
+      if (ABSL_PREDICT_FALSE(direct_io_)) {
+#ifndef _WIN32
+        // Do not leave the fd with direct I/O which is not going to be used.
+        RestoreDirectIo(src);
+#endif
+        Fail(absl::InvalidArgumentError(
+            "FdReaderBase::Options::direct_io() requires random access"));
+      }
       return;
     }
     set_limit_pos(IntCast<Position>(file_pos));
@@ -261,11 +284,37 @@ void FdReaderBase::InitializePos(int src,
       }
     }
   }
+  if (ABSL_PREDICT_FALSE(direct_io_ && !supports_random_access_)) {
+#ifndef _WIN32
+    // Do not leave the fd with direct I/O which is not going to be used.
+    RestoreDirectIo(src);
+#endif
+    Fail(absl::InvalidArgumentError(
+        "FdReaderBase::Options::direct_io() requires random access"));
+    return;
+  }
   BeginRun();
 }
 
 void FdReaderBase::Done() {
   BufferedReader::Done();
+#ifndef _WIN32
+  if (direct_io_ && !has_independent_pos_ && ABSL_PREDICT_TRUE(ok())) {
+    // `pread()` does not move the fd position.
+    if (ABSL_PREDICT_FALSE(
+            fd_internal::LSeek(SrcFd(),
+                               IntCast<fd_internal::Offset>(limit_pos()),
+                               SEEK_SET) < 0)) {
+      FailOperation(fd_internal::kLSeekFunctionName);
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!RestoreDirectIo(SrcFd())) &&
+      ABSL_PREDICT_TRUE(ok())) {
+    FailOperation(fd_internal::kSetUpDirectIoFunctionName);
+  }
+  direct_io_buffer_ = AlignedBuffer<kDirectIoBufferAlignment>();
+  direct_io_buffer_size_ = 0;
+#endif
 #ifdef _WIN32
   if (original_mode_ != absl::nullopt) {
     const int src = SrcFd();
@@ -320,6 +369,9 @@ bool FdReaderBase::ReadInternal(size_t min_length, size_t max_length,
          "max_length < min_length";
   RIEGELI_ASSERT(ok())
       << "Failed precondition of BufferedReader::ReadInternal(): " << status();
+#ifndef _WIN32
+  if (direct_io_) return ReadDirect(min_length, max_length, dest);
+#endif
   const int src = SrcFd();
   for (;;) {
     Position max_pos;
@@ -343,6 +395,11 @@ bool FdReaderBase::ReadInternal(size_t min_length, size_t max_length,
       if (errno == EINTR) goto again;
       return FailOperation(has_independent_pos_ ? "pread()" : "read()");
     }
+    if (drop_page_cache_ && supports_random_access_ && length_read > 0) {
+      fd_internal::DropPageCache(src,
+                                 IntCast<fd_internal::Offset>(limit_pos()),
+                                 IntCast<fd_internal::Offset>(length_read));
+    }
 #else
     DWORD length_read;
     if (has_independent_pos_) {
@@ -392,6 +449,83 @@ bool FdReaderBase::ReadInternal(size_t min_length, size_t max_length,
   }
 }
 
+#ifndef _WIN32
+
+bool FdReaderBase::ReadDirect(size_t min_length, size_t max_length,
+                              char* dest) {
+  RIEGELI_ASSERT_GT(min_length, 0u)
+      << "Failed precondition of FdReaderBase::ReadDirect(): "
+         "nothing to read";
+  RIEGELI_ASSERT_GE(max_length, min_length)
+      << "Failed precondition of FdReaderBase::ReadDirect(): "
+         "max_length < min_length";
+  RIEGELI_ASSERT(direct_io_)
+      << "Failed precondition of FdReaderBase::ReadDirect(): "
+         "direct I/O not in effect";
+  const int src = SrcFd();
+  for (;;) {
+    if (limit_pos() >= direct_io_buffer_pos_ &&
+        limit_pos() - direct_io_buffer_pos_ < direct_io_buffer_size_) {
+      // Copy data remaining from the last aligned read.
+      const size_t offset =
+          IntCast<size_t>(limit_pos() - direct_io_buffer_pos_);
+      const size_t length =
+          UnsignedMin(direct_io_buffer_size_ - offset, max_length);
+      std::memcpy(dest, direct_io_buffer_.data() + offset, length);
+      move_limit_pos(length);
+      if (length >= min_length) return true;
+      dest += length;
+      min_length -= length;
+      max_length -= length;
+    }
+    if (exact_size() != absl::nullopt) {
+      if (ABSL_PREDICT_FALSE(limit_pos() >= *exact_size())) return false;
+    } else {
+      if (ABSL_PREDICT_FALSE(
+              limit_pos() >=
+              Position{std::numeric_limits<fd_internal::Offset>::max()})) {
+        return FailOverflow();
+      }
+    }
+    // Read whole aligned blocks enclosing the requested range, as much as fits
+    // in the buffer.
+    const Position block_pos = limit_pos() - limit_pos() % direct_io_alignment_;
+    const size_t skip = IntCast<size_t>(limit_pos() - block_pos);
+    // One more block than needed for `max_buffer_size()` covers `skip`.
+    const size_t buffer_size =
+        (buffer_options().max_buffer_size() / direct_io_alignment_ + 2) *
+        direct_io_alignment_;
+    direct_io_buffer_.Reset(buffer_size);
+    const size_t length_to_read =
+        (UnsignedMin(skip + UnsignedMin(max_length, buffer_size), buffer_size) +
+         direct_io_alignment_ - 1) /
+        direct_io_alignment_ * direct_io_alignment_;
+  again:
+    const ssize_t length_read =
+        pread(src, direct_io_buffer_.data(), length_to_read,
+              IntCast<fd_internal::Offset>(block_pos));
+    if (ABSL_PREDICT_FALSE(length_read < 0)) {
+      if (errno == EINTR) goto again;
+      direct_io_buffer_size_ = 0;
+      return FailOperation("pread()");
+    }
+    direct_io_buffer_pos_ = block_pos;
+    direct_io_buffer_size_ = IntCast<size_t>(length_read);
+    if (ABSL_PREDICT_FALSE(direct_io_buffer_size_ <= skip)) {
+      if (!growing_source_) set_exact_size(limit_pos());
+      return false;
+    }
+  }
+}
+
+inline bool FdReaderBase::RestoreDirectIo(int src) {
+  if (!direct_io_flags_changed_) return true;
+  direct_io_flags_changed_ = false;
+  return fd_internal::RestoreDirectIo(src);
+}
+
+#endif
+
 inline bool FdReaderBase::SeekInternal(int src, Position new_pos) {
   RIEGELI_ASSERT_EQ(available(), 0u)
       << "Failed precondition of FdReaderBase::SeekInternal(): "
@@ -489,6 +623,8 @@ std::unique_ptr<Reader> FdReaderBase::NewReaderImpl(Position initial_pos) {
                    .set_assumed_filename(filename())
                    .set_independent_pos(initial_pos)
                    .set_growing_source(growing_source_)
+                   .set_direct_io(direct_io_)
+                   .set_drop_page_cache(drop_page_cache_)
                    .set_buffer_options(buffer_options()));
   reader->set_exact_size(exact_size());
   ShareBufferTo(*reader);
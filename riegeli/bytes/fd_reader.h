@@ -29,6 +29,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "riegeli/base/aligned_buffer.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/dependency.h"
 #include "riegeli/base/object.h"
@@ -186,6 +187,45 @@ class FdReaderBase : public BufferedReader {
     }
     bool growing_source() const { return growing_source_; }
 
+    // If `true`, the file is read with direct I/O (`O_DIRECT`), bypassing the
+    // page cache, so that large scans do not evict other cached data. Reads are
+    // done in blocks aligned to the logical block size of the file system,
+    // through a buffer aligned accordingly. Random access is required.
+    //
+    // If `FdReader` reads from an already open fd, `O_DIRECT` is set on it.
+    // Direct I/O is also used if the fd was opened with `O_DIRECT`.
+    //
+    // Where `O_DIRECT` is not available, `F_NOCACHE` is used if available,
+    // otherwise `set_direct_io()` has no effect.
+    //
+    // Default: `false`.
+    Options& set_direct_io(bool direct_io) & {
+      direct_io_ = direct_io;
+      return *this;
+    }
+    Options&& set_direct_io(bool direct_io) && {
+      return std::move(set_direct_io(direct_io));
+    }
+    bool direct_io() const { return direct_io_; }
+
+    // If `true`, data are read through the page cache as usual, but the
+    // kernel is advised to drop them from the page cache after they are read
+    // (`posix_fadvise(POSIX_FADV_DONTNEED)`). This is a softer alternative to
+    // `set_direct_io()`, without alignment requirements.
+    //
+    // This has no effect if random access is not supported, or if
+    // `posix_fadvise()` is not available.
+    //
+    // Default: `false`.
+    Options& set_drop_page_cache(bool drop_page_cache) & {
+      drop_page_cache_ = drop_page_cache;
+      return *this;
+    }
+    Options&& set_drop_page_cache(bool drop_page_cache) && {
+      return std::move(set_drop_page_cache(drop_page_cache));
+    }
+    bool drop_page_cache() const { return drop_page_cache_; }
+
    private:
     absl::optional<std::string> assumed_filename_;
 #ifndef _WIN32
@@ -196,6 +236,8 @@ class FdReaderBase : public BufferedReader {
     absl::optional<Position> assumed_pos_;
     absl::optional<Position> independent_pos_;
     bool growing_source_ = false;
+    bool direct_io_ = false;
+    bool drop_page_cache_ = false;
   };
 
   // Returns the fd being read from. If the fd is owned then changed to -1 by
@@ -222,13 +264,15 @@ class FdReaderBase : public BufferedReader {
   explicit FdReaderBase(Closed) noexcept : BufferedReader(kClosed) {}
 
   explicit FdReaderBase(const BufferOptions& buffer_options,
-                        bool growing_source);
+                        bool growing_source, bool direct_io,
+                        bool drop_page_cache);
 
   FdReaderBase(FdReaderBase&& that) noexcept;
   FdReaderBase& operator=(FdReaderBase&& that) noexcept;
 
   void Reset(Closed);
-  void Reset(const BufferOptions& buffer_options, bool growing_source);
+  void Reset(const BufferOptions& buffer_options, bool growing_source,
+             bool direct_io, bool drop_page_cache);
   void Initialize(int src,
 #ifdef _WIN32
                   int mode,
@@ -259,15 +303,37 @@ class FdReaderBase : public BufferedReader {
   absl::Status FailedOperationStatus(absl::string_view operation);
 
   bool SeekInternal(int src, Position new_pos);
+#ifndef _WIN32
+  bool ReadDirect(size_t min_length, size_t max_length, char* dest);
+  // Reverts file status flags changed for direct I/O, if any.
+  bool RestoreDirectIo(int src);
+#endif
+
+  // Alignment of `direct_io_buffer_`. File offsets and lengths are aligned to
+  // `direct_io_alignment_`, which is at least `kDirectIoBufferAlignment`.
+  static constexpr size_t kDirectIoBufferAlignment = 4096;
 
   std::string filename_;
   bool has_independent_pos_ = false;
   bool growing_source_ = false;
+  // If `true`, direct I/O is requested. After initialization, if `true`, reads
+  // must be aligned to `direct_io_alignment_`.
+  bool direct_io_ = false;
+  bool drop_page_cache_ = false;
   bool supports_random_access_ = false;
   absl::Status random_access_status_;
 #ifdef _WIN32
   absl::optional<int> original_mode_;
 #endif
+  size_t direct_io_alignment_ = 0;
+  // If `true`, `O_DIRECT` or `F_NOCACHE` was set on the fd by this `FdReader`
+  // and is cleared in `Done()`.
+  bool direct_io_flags_changed_ = false;
+  // Aligned blocks of the file starting at `direct_io_buffer_pos_`, of which
+  // `direct_io_buffer_size_` bytes are valid.
+  AlignedBuffer<kDirectIoBufferAlignment> direct_io_buffer_;
+  Position direct_io_buffer_pos_ = 0;
+  size_t direct_io_buffer_size_ = 0;
 
   // Invariant: `limit_pos() <= std::numeric_limits<fd_internal::Offset>::max()`
 };
@@ -416,22 +482,32 @@ explicit FdReader(std::tuple<SrcArgs...> src_args,
 // Implementation details follow.
 
 inline FdReaderBase::FdReaderBase(const BufferOptions& buffer_options,
-                                  bool growing_source)
-    : BufferedReader(buffer_options), growing_source_(growing_source) {}
+                                  bool growing_source, bool direct_io,
+                                  bool drop_page_cache)
+    : BufferedReader(buffer_options),
+      growing_source_(growing_source),
+      direct_io_(direct_io),
+      drop_page_cache_(drop_page_cache) {}
 
 inline FdReaderBase::FdReaderBase(FdReaderBase&& that) noexcept
     : BufferedReader(static_cast<BufferedReader&&>(that)),
       filename_(std::exchange(that.filename_, std::string())),
       has_independent_pos_(that.has_independent_pos_),
       growing_source_(that.growing_source_),
+      direct_io_(that.direct_io_),
+      drop_page_cache_(that.drop_page_cache_),
       supports_random_access_(
           std::exchange(that.supports_random_access_, false)),
-      random_access_status_(std::move(that.random_access_status_))
+      random_access_status_(std::move(that.random_access_status_)),
 #ifdef _WIN32
-      ,
-      original_mode_(that.original_mode_)
+      original_mode_(that.original_mode_),
 #endif
-{
+      direct_io_alignment_(that.direct_io_alignment_),
+      direct_io_flags_changed_(
+          std::exchange(that.direct_io_flags_changed_, false)),
+      direct_io_buffer_(std::move(that.direct_io_buffer_)),
+      direct_io_buffer_pos_(that.direct_io_buffer_pos_),
+      direct_io_buffer_size_(std::exchange(that.direct_io_buffer_size_, 0)) {
 }
 
 inline FdReaderBase& FdReaderBase::operator=(FdReaderBase&& that) noexcept {
@@ -439,11 +515,19 @@ inline FdReaderBase& FdReaderBase::operator=(FdReaderBase&& that) noexcept {
   filename_ = std::exchange(that.filename_, std::string());
   has_independent_pos_ = that.has_independent_pos_;
   growing_source_ = that.growing_source_;
+  direct_io_ = that.direct_io_;
+  drop_page_cache_ = that.drop_page_cache_;
   supports_random_access_ = std::exchange(that.supports_random_access_, false);
   random_access_status_ = std::move(that.random_access_status_);
 #ifdef _WIN32
   original_mode_ = that.original_mode_;
 #endif
+  direct_io_alignment_ = that.direct_io_alignment_;
+  direct_io_flags_changed_ =
+      std::exchange(that.direct_io_flags_changed_, false);
+  direct_io_buffer_ = std::move(that.direct_io_buffer_);
+  direct_io_buffer_pos_ = that.direct_io_buffer_pos_;
+  direct_io_buffer_size_ = std::exchange(that.direct_io_buffer_size_, 0);
   return *this;
 }
 
@@ -452,29 +536,44 @@ inline void FdReaderBase::Reset(Closed) {
   filename_ = std::string();
   has_independent_pos_ = false;
   growing_source_ = false;
+  direct_io_ = false;
+  drop_page_cache_ = false;
   supports_random_access_ = false;
   random_access_status_ = absl::OkStatus();
 #ifdef _WIN32
   original_mode_ = absl::nullopt;
 #endif
+  direct_io_alignment_ = 0;
+  direct_io_flags_changed_ = false;
+  direct_io_buffer_ = AlignedBuffer<kDirectIoBufferAlignment>();
+  direct_io_buffer_pos_ = 0;
+  direct_io_buffer_size_ = 0;
 }
 
 inline void FdReaderBase::Reset(const BufferOptions& buffer_options,
-                                bool growing_source) {
+                                bool growing_source, bool direct_io,
+                                bool drop_page_cache) {
   BufferedReader::Reset(buffer_options);
   // `filename_` will be set by `Initialize()` or `OpenFd()`.
   has_independent_pos_ = false;
   growing_source_ = growing_source;
+  direct_io_ = direct_io;
+  drop_page_cache_ = drop_page_cache;
   supports_random_access_ = false;
   random_access_status_ = absl::OkStatus();
 #ifdef _WIN32
   original_mode_ = absl::nullopt;
 #endif
+  direct_io_alignment_ = 0;
+  direct_io_flags_changed_ = false;
+  direct_io_buffer_pos_ = 0;
+  direct_io_buffer_size_ = 0;
 }
 
 template <typename Src>
 inline FdReader<Src>::FdReader(const Src& src, Options options)
-    : FdReaderBase(options.buffer_options(), options.growing_source()),
+    : FdReaderBase(options.buffer_options(), options.growing_source(),
+                   options.direct_io(), options.drop_page_cache()),
       src_(src) {
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -486,7 +585,8 @@ inline FdReader<Src>::FdReader(const Src& src, Options options)
 
 template <typename Src>
 inline FdReader<Src>::FdReader(Src&& src, Options options)
-    : FdReaderBase(options.buffer_options(), options.growing_source()),
+    : FdReaderBase(options.buffer_options(), options.growing_source(),
+                   options.direct_io(), options.drop_page_cache()),
       src_(std::move(src)) {
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -503,7 +603,8 @@ inline FdReader<Src>::FdReader(int src, Options options)
 template <typename Src>
 template <typename... SrcArgs>
 inline FdReader<Src>::FdReader(std::tuple<SrcArgs...> src_args, Options options)
-    : FdReaderBase(options.buffer_options(), options.growing_source()),
+    : FdReaderBase(options.buffer_options(), options.growing_source(),
+                   options.direct_io(), options.drop_page_cache()),
       src_(std::move(src_args)) {
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -517,7 +618,8 @@ template <typename Src>
 template <typename DependentSrc,
           std::enable_if_t<std::is_same<DependentSrc, OwnedFd>::value, int>>
 inline FdReader<Src>::FdReader(absl::string_view filename, Options options)
-    : FdReaderBase(options.buffer_options(), options.growing_source()) {
+    : FdReaderBase(options.buffer_options(), options.growing_source(),
+                   options.direct_io(), options.drop_page_cache()) {
   Initialize(filename, std::move(options));
 }
 
@@ -541,7 +643,8 @@ inline void FdReader<Src>::Reset(Closed) {
 
 template <typename Src>
 inline void FdReader<Src>::Reset(const Src& src, Options options) {
-  FdReaderBase::Reset(options.buffer_options(), options.growing_source());
+  FdReaderBase::Reset(options.buffer_options(), options.growing_source(),
+                      options.direct_io(), options.drop_page_cache());
   src_.Reset(src);
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -553,7 +656,8 @@ inline void FdReader<Src>::Reset(const Src& src, Options options) {
 
 template <typename Src>
 inline void FdReader<Src>::Reset(Src&& src, Options options) {
-  FdReaderBase::Reset(options.buffer_options(), options.growing_source());
+  FdReaderBase::Reset(options.buffer_options(), options.growing_source(),
+                      options.direct_io(), options.drop_page_cache());
   src_.Reset(std::move(src));
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -572,7 +676,8 @@ template <typename Src>
 template <typename... SrcArgs>
 inline void FdReader<Src>::Reset(std::tuple<SrcArgs...> src_args,
                                  Options options) {
-  FdReaderBase::Reset(options.buffer_options(), options.growing_source());
+  FdReaderBase::Reset(options.buffer_options(), options.growing_source(),
+                      options.direct_io(), options.drop_page_cache());
   src_.Reset(std::move(src_args));
   Initialize(src_.get(),
 #ifdef _WIN32
@@ -586,7 +691,8 @@ template <typename Src>
 template <typename DependentSrc,
           std::enable_if_t<std::is_same<DependentSrc, OwnedFd>::value, int>>
 inline void FdReader<Src>::Reset(absl::string_view filename, Options options) {
-  FdReaderBase::Reset(options.buffer_options(), options.growing_source());
+  FdReaderBase::Reset(options.buffer_options(), options.growing_source(),
+                      options.direct_io(), options.drop_page_cache());
   Initialize(filename, std::move(options));
 }
 
@@ -46,6 +46,7 @@
 #endif
 
 #include <cerrno>
+#include <cstring>
 #include <limits>
 #include <string>
 #include <utility>
@@ -179,7 +180,40 @@ void FdWriterBase::InitializePos(int dest, int mode,
         absl::UnimplementedError("Mode does not include O_RDWR"));
     read_mode_status_ = *status;
   }
+  if (ABSL_PREDICT_FALSE(!fd_internal::SetUpDirectIo(
+          dest, direct_io_, direct_io_alignment_, direct_io_flags_changed_))) {
+    FailOperation(fd_internal::kSetUpDirectIoFunctionName);
+    return;
+  }
+  direct_io_ = direct_io_alignment_ > 0;
+  if (direct_io_) {
+    // `direct_io_buffer_` is aligned to `kDirectIoBufferAlignment`. Aligning
+    // writes to at least that much too avoids partial pages.
+    direct_io_alignment_ =
+        UnsignedMax(direct_io_alignment_, kDirectIoBufferAlignment);
+    if (ABSL_PREDICT_FALSE((mode & O_APPEND) != 0)) {
+      // Do not leave the fd with direct I/O which is not going to be used.
+      RestoreDirectIo(dest);
+      Fail(absl::InvalidArgumentError(
+          "FdWriterBase::Options::direct_io() "
+          "is incompatible with append mode"));
+      return;
+    }
+    if (ABSL_PREDICT_FALSE(assumed_pos != absl::nullopt)) {
+      RestoreDirectIo(dest);
+      Fail(absl::InvalidArgumentError(
+          "FdWriterBase::Options::direct_io() requires random access"));
+      return;
+    }
+    fd_internal::StatInfo stat_info;
+    if (ABSL_PREDICT_FALSE(fd_internal::FStat(dest, &stat_info) < 0)) {
+      FailOperation(fd_internal::kFStatFunctionName);
+      return;
+    }
+    direct_io_file_size_ = IntCast<Position>(stat_info.st_size);
+  }
 #else
+  direct_io_ = false;
   RIEGELI_ASSERT(original_mode_ == absl::nullopt)
       << "Failed precondition of FdWriterBase::InitializePos(): "
          "original_mode_ not reset";
@@ -276,6 +310,14 @@ void FdWriterBase::InitializePos(int dest, int mode,
       random_access_status_ =
           FailedOperationStatus(fd_internal::kLSeekFunctionName);
       read_mode_status_.Update(random_access_status_);
+      if (ABSL_PREDICT_FALSE(direct_io_)) {
+#ifndef _WIN32
+        // Do not leave the fd with direct I/O which is not going to be used.
+        RestoreDirectIo(dest);
+#endif
+        Fail(absl::InvalidArgumentError(
+            "FdWriterBase::Options::direct_io() requires random access"));
+      }
       return;
     }
     set_start_pos(IntCast<Position>(file_pos));
@@ -304,6 +346,15 @@ void FdWriterBase::InitializePos(int dest, int mode,
 
 void FdWriterBase::Done() {
   BufferedWriter::Done();
+#ifndef _WIN32
+  if (direct_io_ && ABSL_PREDICT_TRUE(ok())) WriteDirectTail();
+  if (ABSL_PREDICT_FALSE(!RestoreDirectIo(DestFd())) &&
+      ABSL_PREDICT_TRUE(ok())) {
+    FailOperation(fd_internal::kSetUpDirectIoFunctionName);
+  }
+  direct_io_buffer_ = AlignedBuffer<kDirectIoBufferAlignment>();
+  direct_io_buffered_ = 0;
+#endif
 #ifdef _WIN32
   if (original_mode_ != absl::nullopt) {
     const int dest = DestFd();
@@ -519,6 +570,9 @@ bool FdWriterBase::WriteInternal(absl::string_view src) {
               start_pos())) {
     return FailOverflow();
   }
+#ifndef _WIN32
+  if (direct_io_) return WriteDirect(src);
+#endif
   do {
 #ifndef _WIN32
   again:
@@ -532,6 +586,18 @@ bool FdWriterBase::WriteInternal(absl::string_view src) {
       if (errno == EINTR) goto again;
       return FailOperation(has_independent_pos_ ? "pwrite()" : "write()");
     }
+    // These fail harmlessly if the fd does not support random access. A length
+    // of 0 would mean the rest of the file, hence it is skipped.
+    if (write_behind_ && length_written > 0) {
+      fd_internal::StartWriteback(dest,
+                                  IntCast<fd_internal::Offset>(start_pos()),
+                                  IntCast<fd_internal::Offset>(length_written));
+    }
+    if (drop_page_cache_ && length_written > 0) {
+      fd_internal::DropPageCache(dest,
+                                 IntCast<fd_internal::Offset>(start_pos()),
+                                 IntCast<fd_internal::Offset>(length_written));
+    }
 #else
     DWORD length_written;
     if (has_independent_pos_) {
@@ -580,8 +646,181 @@ bool FdWriterBase::WriteInternal(absl::string_view src) {
   return true;
 }
 
+#ifndef _WIN32
+
+bool FdWriterBase::WriteDirect(absl::string_view src) {
+  RIEGELI_ASSERT(!src.empty())
+      << "Failed precondition of FdWriterBase::WriteDirect(): "
+         "nothing to write";
+  RIEGELI_ASSERT(direct_io_)
+      << "Failed precondition of FdWriterBase::WriteDirect(): "
+         "direct I/O not in effect";
+  const int dest = DestFd();
+  direct_io_tail_written_ = false;
+  // Two blocks more than `max_buffer_size()` leave space for a partial block
+  // before the data, and for merging the last block in `WriteDirectTail()`.
+  direct_io_buffer_.Reset(
+      (buffer_options().max_buffer_size() / direct_io_alignment_ + 2) *
+      direct_io_alignment_);
+  if (direct_io_buffer_pos_ + direct_io_buffered_ != start_pos()) {
+    // Load the beginning of the block enclosing `start_pos()`, which will be
+    // rewritten.
+    direct_io_buffer_pos_ = start_pos() - start_pos() % direct_io_alignment_;
+    direct_io_buffered_ = IntCast<size_t>(start_pos() - direct_io_buffer_pos_);
+    if (direct_io_buffered_ > 0) {
+      size_t length_read = 0;
+      if (ABSL_PREDICT_FALSE(!PreadDirect(dest, direct_io_buffer_.data(),
+                                          direct_io_buffer_pos_,
+                                          length_read))) {
+        direct_io_buffered_ = 0;
+        return false;
+      }
+      if (length_read < direct_io_buffered_) {
+        // The file ends before `start_pos()`. This can happen only if the file
+        // was truncated externally.
+        std::memset(direct_io_buffer_.data() + length_read, 0,
+                    direct_io_buffered_ - length_read);
+      }
+    }
+  }
+  do {
+    const size_t length =
+        UnsignedMin(src.size(), direct_io_buffer_.capacity() -
+                                    direct_io_alignment_ - direct_io_buffered_);
+    std::memcpy(direct_io_buffer_.data() + direct_io_buffered_, src.data(),
+                length);
+    direct_io_buffered_ += length;
+    move_start_pos(length);
+    src.remove_prefix(length);
+    const size_t length_to_write =
+        direct_io_buffered_ - direct_io_buffered_ % direct_io_alignment_;
+    if (length_to_write > 0) {
+      if (ABSL_PREDICT_FALSE(!PwriteDirect(dest, direct_io_buffer_.data(),
+                                           length_to_write,
+                                           direct_io_buffer_pos_))) {
+        return false;
+      }
+      direct_io_buffered_ -= length_to_write;
+      std::memmove(direct_io_buffer_.data(),
+                   direct_io_buffer_.data() + length_to_write,
+                   direct_io_buffered_);
+      direct_io_buffer_pos_ += length_to_write;
+      direct_io_file_size_ =
+          UnsignedMax(direct_io_file_size_, direct_io_buffer_pos_);
+    }
+  } while (!src.empty());
+  return true;
+}
+
+bool FdWriterBase::WriteDirectTail() {
+  RIEGELI_ASSERT(ok())
+      << "Failed precondition of FdWriterBase::WriteDirectTail(): "
+      << status();
+  if (!direct_io_ ||
+      direct_io_buffer_pos_ + direct_io_buffered_ != start_pos() ||
+      direct_io_buffered_ == 0 || direct_io_tail_written_) {
+    return true;
+  }
+  const int dest = DestFd();
+  char* const block = direct_io_buffer_.data();
+  std::memset(block + direct_io_buffered_, 0,
+              direct_io_alignment_ - direct_io_buffered_);
+  if (direct_io_file_size_ > start_pos()) {
+    // Preserve existing data after `start_pos()` in the same block.
+    char* const old_block = block + direct_io_alignment_;
+    size_t length_read = 0;
+    if (ABSL_PREDICT_FALSE(!PreadDirect(dest, old_block, direct_io_buffer_pos_,
+                                        length_read))) {
+      return false;
+    }
+    if (length_read > direct_io_buffered_) {
+      std::memcpy(block + direct_io_buffered_, old_block + direct_io_buffered_,
+                  length_read - direct_io_buffered_);
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!PwriteDirect(dest, block, direct_io_alignment_,
+                                       direct_io_buffer_pos_))) {
+    return false;
+  }
+  // Remove the padding.
+  const Position new_size = UnsignedMax(direct_io_file_size_, start_pos());
+  if (direct_io_buffer_pos_ + direct_io_alignment_ > new_size) {
+  again_ftruncate:
+    if (ABSL_PREDICT_FALSE(
+            ftruncate(dest, IntCast<fd_internal::Offset>(new_size)) < 0)) {
+      if (errno == EINTR) goto again_ftruncate;
+      return FailOperation("ftruncate()");
+    }
+  }
+  direct_io_file_size_ = new_size;
+  if (!has_independent_pos_) {
+    // `pwrite()` does not move the fd position.
+    if (ABSL_PREDICT_FALSE(
+            fd_internal::LSeek(dest, IntCast<fd_internal::Offset>(start_pos()),
+                               SEEK_SET) < 0)) {
+      return FailOperation(fd_internal::kLSeekFunctionName);
+    }
+  }
+  direct_io_tail_written_ = true;
+  return true;
+}
+
+inline bool FdWriterBase::RestoreDirectIo(int dest) {
+  if (!direct_io_flags_changed_) return true;
+  direct_io_flags_changed_ = false;
+  return fd_internal::RestoreDirectIo(dest);
+}
+
+inline bool FdWriterBase::PreadDirect(int dest, char* block, Position pos,
+                                      size_t& length_read) {
+again:
+  const ssize_t result = pread(dest, block, direct_io_alignment_,
+                               IntCast<fd_internal::Offset>(pos));
+  if (ABSL_PREDICT_FALSE(result < 0)) {
+    if (errno == EINTR) goto again;
+    if (errno == EBADF) {
+      return Fail(absl::InvalidArgumentError(
+          "FdWriterBase::Options::direct_io() requires O_RDWR "
+          "for writing a partial block"));
+    }
+    return FailOperation("pread()");
+  }
+  length_read = IntCast<size_t>(result);
+  return true;
+}
+
+inline bool FdWriterBase::PwriteDirect(int dest, const char* src,
+                                       size_t length, Position pos) {
+  while (length > 0) {
+    const ssize_t length_written =
+        pwrite(dest, src,
+               UnsignedMin(length, size_t{std::numeric_limits<ssize_t>::max()} /
+                                       direct_io_alignment_ *
+                                       direct_io_alignment_),
+               IntCast<fd_internal::Offset>(pos));
+    if (ABSL_PREDICT_FALSE(length_written < 0)) {
+      if (errno == EINTR) continue;
+      return FailOperation("pwrite()");
+    }
+    RIEGELI_ASSERT_GT(length_written, 0) << "pwrite() returned 0";
+    src += length_written;
+    length -= IntCast<size_t>(length_written);
+    pos += IntCast<Position>(length_written);
+  }
+  return true;
+}
+
+#endif
+
 bool FdWriterBase::FlushImpl(FlushType flush_type) {
   if (ABSL_PREDICT_FALSE(!BufferedWriter::FlushImpl(flush_type))) return false;
+#ifndef _WIN32
+  // The partial last block stays buffered unless data must be visible outside
+  // the process, to avoid padding it and truncating the file on every flush.
+  if (flush_type != FlushType::kFromObject) {
+    if (ABSL_PREDICT_FALSE(!WriteDirectTail())) return false;
+  }
+#endif
   switch (flush_type) {
     case FlushType::kFromObject:
     case FlushType::kFromProcess:
@@ -589,8 +828,21 @@ bool FdWriterBase::FlushImpl(FlushType flush_type) {
     case FlushType::kFromMachine: {
       const int dest = DestFd();
 #ifndef _WIN32
-      if (ABSL_PREDICT_FALSE(fsync(dest) < 0)) {
-        return FailOperation("fsync()");
+#ifndef __APPLE__
+      if (data_sync_) {
+        if (ABSL_PREDICT_FALSE(fdatasync(dest) < 0)) {
+          return FailOperation("fdatasync()");
+        }
+      } else
+#endif
+      {
+        if (ABSL_PREDICT_FALSE(fsync(dest) < 0)) {
+          return FailOperation("fsync()");
+        }
+      }
+      if (drop_page_cache_) {
+        // Pages written back by `fsync()` can be dropped now.
+        fd_internal::DropPageCache(dest, 0, 0);
       }
 #else
       if (ABSL_PREDICT_FALSE(_commit(dest) < 0)) {
@@ -642,6 +894,9 @@ bool FdWriterBase::SeekBehindBuffer(Position new_pos) {
     return false;
   }
   if (ABSL_PREDICT_FALSE(!ok())) return false;
+#ifndef _WIN32
+  if (ABSL_PREDICT_FALSE(!WriteDirectTail())) return false;
+#endif
   read_mode_ = false;
   const int dest = DestFd();
   if (new_pos > start_pos()) {
@@ -668,6 +923,9 @@ absl::optional<Position> FdWriterBase::SizeBehindBuffer() {
     return absl::nullopt;
   }
   if (ABSL_PREDICT_FALSE(!ok())) return absl::nullopt;
+#ifndef _WIN32
+  if (ABSL_PREDICT_FALSE(!WriteDirectTail())) return absl::nullopt;
+#endif
   const int dest = DestFd();
   fd_internal::StatInfo stat_info;
   if (ABSL_PREDICT_FALSE(fd_internal::FStat(dest, &stat_info) < 0)) {
@@ -682,6 +940,9 @@ bool FdWriterBase::TruncateBehindBuffer(Position new_size) {
       << "Failed precondition of BufferedWriter::TruncateBehindBuffer(): "
          "buffer not empty";
   if (ABSL_PREDICT_FALSE(!ok())) return false;
+#ifndef _WIN32
+  if (ABSL_PREDICT_FALSE(!WriteDirectTail())) return false;
+#endif
   read_mode_ = false;
   const int dest = DestFd();
   if (new_size >= start_pos()) {
@@ -703,6 +964,7 @@ again:
     if (errno == EINTR) goto again;
     return FailOperation("ftruncate()");
   }
+  direct_io_file_size_ = new_size;
 #else
   if (ABSL_PREDICT_FALSE(
           _chsize_s(dest, IntCast<fd_internal::Offset>(new_size)) != 0)) {
@@ -721,7 +983,11 @@ Reader* FdWriterBase::ReadModeBehindBuffer(Position initial_pos) {
     return nullptr;
   }
   if (ABSL_PREDICT_FALSE(!ok())) return nullptr;
+#ifndef _WIN32
+  if (ABSL_PREDICT_FALSE(!WriteDirectTail())) return nullptr;
+#endif
   const int dest = DestFd();
+  // If the fd uses `O_DIRECT`, `FdReader` uses direct I/O too.
   FdReader<UnownedFd>* const reader = associated_reader_.ResetReader(
       dest, FdReaderBase::Options()
                 .set_assumed_filename(filename())
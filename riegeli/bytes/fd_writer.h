@@ -29,6 +29,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "riegeli/base/aligned_buffer.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/dependency.h"
 #include "riegeli/base/object.h"
@@ -303,6 +304,88 @@ class FdWriterBase : public BufferedWriter {
       return independent_pos_;
     }
 
+    // If `true`, the file is written with direct I/O (`O_DIRECT`), bypassing
+    // the page cache, so that bulk writes do not evict other cached data.
+    // Writes are done in whole blocks aligned to the logical block size of the
+    // file system, through a buffer aligned accordingly. A partial last block
+    // is kept buffered until `Close()` or `Flush()` with a `FlushType` other
+    // than `FlushType::kFromObject`, when it is written padded, and the file
+    // is then truncated to its actual size.
+    //
+    // Direct I/O requires random access and excludes append mode. Writing
+    // starting from a position which is not block-aligned requires reading the
+    // enclosing block, which requires `O_RDWR`.
+    //
+    // If `FdWriter` writes to an already open fd, `O_DIRECT` is set on it.
+    // Direct I/O is also used if the fd was opened with `O_DIRECT`.
+    //
+    // Where `O_DIRECT` is not available, `F_NOCACHE` is used if available,
+    // otherwise `set_direct_io()` has no effect.
+    //
+    // Default: `false`.
+    Options& set_direct_io(bool direct_io) & {
+      direct_io_ = direct_io;
+      return *this;
+    }
+    Options&& set_direct_io(bool direct_io) && {
+      return std::move(set_direct_io(direct_io));
+    }
+    bool direct_io() const { return direct_io_; }
+
+    // If `true`, data are written through the page cache as usual, but the
+    // kernel is advised to drop them from the page cache
+    // (`posix_fadvise(POSIX_FADV_DONTNEED)`). This is a softer alternative to
+    // `set_direct_io()`, without alignment requirements.
+    //
+    // Dirty pages are not dropped while they have not been written back, they
+    // are skipped. Hence this is most effective together with
+    // `Flush(FlushType::kFromMachine)`, which drops pages it has written back.
+    //
+    // This has no effect if `posix_fadvise()` is not available.
+    //
+    // Default: `false`.
+    Options& set_drop_page_cache(bool drop_page_cache) & {
+      drop_page_cache_ = drop_page_cache;
+      return *this;
+    }
+    Options&& set_drop_page_cache(bool drop_page_cache) && {
+      return std::move(set_drop_page_cache(drop_page_cache));
+    }
+    bool drop_page_cache() const { return drop_page_cache_; }
+
+    // If `true`, `Flush(FlushType::kFromMachine)` uses `fdatasync()` instead of
+    // `fsync()`. This skips writing back metadata not needed for reading the
+    // data, e.g. the modification time.
+    //
+    // This has no effect if `fdatasync()` is not available.
+    //
+    // Default: `false`.
+    Options& set_data_sync(bool data_sync) & {
+      data_sync_ = data_sync;
+      return *this;
+    }
+    Options&& set_data_sync(bool data_sync) && {
+      return std::move(set_data_sync(data_sync));
+    }
+    bool data_sync() const { return data_sync_; }
+
+    // If `true`, writeback of written data is started right after each write
+    // (`sync_file_range(SYNC_FILE_RANGE_WRITE)`), without waiting for it. This
+    // spreads disk writes over time and makes a later
+    // `Flush(FlushType::kFromMachine)` faster.
+    //
+    // This has no effect if `sync_file_range()` is not available.
+    //
+    // Default: `false`.
+    Options& set_write_behind(bool write_behind) & {
+      write_behind_ = write_behind;
+      return *this;
+    }
+    Options&& set_write_behind(bool write_behind) && {
+      return std::move(set_write_behind(write_behind));
+    }
+    bool write_behind() const { return write_behind_; }
+
    private:
     absl::optional<std::string> assumed_filename_;
 #ifndef _WIN32
@@ -314,6 +397,10 @@ class FdWriterBase : public BufferedWriter {
 #endif
     absl::optional<Position> assumed_pos_;
     absl::optional<Position> independent_pos_;
+    bool direct_io_ = false;
+    bool drop_page_cache_ = false;
+    bool data_sync_ = false;
+    bool write_behind_ = false;
   };
 
   // Returns the fd being written to. If the fd is owned then changed to -1 by
@@ -330,13 +417,16 @@ class FdWriterBase : public BufferedWriter {
  protected:
   explicit FdWriterBase(Closed) noexcept : BufferedWriter(kClosed) {}
 
-  explicit FdWriterBase(const BufferOptions& buffer_options);
+  explicit FdWriterBase(const BufferOptions& buffer_options, bool direct_io,
+                        bool drop_page_cache, bool data_sync,
+                        bool write_behind);
 
   FdWriterBase(FdWriterBase&& that) noexcept;
   FdWriterBase& operator=(FdWriterBase&& that) noexcept;
 
   void Reset(Closed);
-  void Reset(const BufferOptions& buffer_options);
+  void Reset(const BufferOptions& buffer_options, bool direct_io,
+             bool drop_page_cache, bool data_sync, bool write_behind);
   void Initialize(int dest, absl::optional<std::string>&& assumed_filename,
 #ifdef _WIN32
                   int mode,
@@ -384,9 +474,30 @@ class FdWriterBase : public BufferedWriter {
 
   bool WriteMode();
   bool SeekInternal(int dest, Position new_pos);
+#ifndef _WIN32
+  bool WriteDirect(absl::string_view src);
+  // Writes the partial last block buffered for direct I/O, if any and if it
+  // changed since it was last written.
+  bool WriteDirectTail();
+  // Reverts file status flags changed for direct I/O, if any.
+  bool RestoreDirectIo(int dest);
+  // Reads the aligned block at `pos`, which may be partial at the end of file.
+  bool PreadDirect(int dest, char* block, Position pos, size_t& length_read);
+  bool PwriteDirect(int dest, const char* src, size_t length, Position pos);
+#endif
+
+  // Alignment of `direct_io_buffer_`. File offsets and lengths are aligned to
+  // `direct_io_alignment_`, which is at least `kDirectIoBufferAlignment`.
+  static constexpr size_t kDirectIoBufferAlignment = 4096;
 
   std::string filename_;
   bool has_independent_pos_ = false;
+  // If `true`, direct I/O is requested. After initialization, if `true`, writes
+  // must be aligned to `direct_io_alignment_`.
+  bool direct_io_ = false;
+  bool drop_page_cache_ = false;
+  bool data_sync_ = false;
+  bool write_behind_ = false;
   // Invariant except on Windows:
   //   if `supports_read_mode_ == LazyBoolState::kUnknown` then
   //       `supports_random_access_ == LazyBoolState::kUnknown`
@@ -408,6 +519,26 @@ class FdWriterBase : public BufferedWriter {
   AssociatedReader<FdReader<UnownedFd>> associated_reader_;
   bool read_mode_ = false;
 
+  size_t direct_io_alignment_ = 0;
+  // If `true`, `O_DIRECT` or `F_NOCACHE` was set on the fd by this `FdWriter`
+  // and is cleared in `Done()`.
+  bool direct_io_flags_changed_ = false;
+  // Data to be written at `direct_io_buffer_pos_`, which is aligned. Whole
+  // blocks are written eagerly, so `direct_io_buffered_` is smaller than
+  // `direct_io_alignment_` between writes.
+  //
+  // Buffered data are valid only if
+  // `direct_io_buffer_pos_ + direct_io_buffered_ == start_pos()`, otherwise the
+  // block enclosing `start_pos()` is read again before writing.
+  AlignedBuffer<kDirectIoBufferAlignment> direct_io_buffer_;
+  Position direct_io_buffer_pos_ = 0;
+  size_t direct_io_buffered_ = 0;
+  // If `true`, the partial last block in `direct_io_buffer_` has been written
+  // with `WriteDirectTail()` and did not change since then.
+  bool direct_io_tail_written_ = false;
+  // The file size, as far as it matters for padding the last block.
+  Position direct_io_file_size_ = 0;
+
   // Invariant: `start_pos() <= std::numeric_limits<off_t>::max()`
 };
 
@@ -573,13 +704,23 @@ explicit FdWriter(std::tuple<DestArgs...> dest_args,
 
 // Implementation details follow.
 
-inline FdWriterBase::FdWriterBase(const BufferOptions& buffer_options)
-    : BufferedWriter(buffer_options) {}
+inline FdWriterBase::FdWriterBase(const BufferOptions& buffer_options,
+                                  bool direct_io, bool drop_page_cache,
+                                  bool data_sync, bool write_behind)
+    : BufferedWriter(buffer_options),
+      direct_io_(direct_io),
+      drop_page_cache_(drop_page_cache),
+      data_sync_(data_sync),
+      write_behind_(write_behind) {}
 
 inline FdWriterBase::FdWriterBase(FdWriterBase&& that) noexcept
     : BufferedWriter(static_cast<BufferedWriter&&>(that)),
       filename_(std::exchange(that.filename_, std::string())),
       has_independent_pos_(that.has_independent_pos_),
+      direct_io_(that.direct_io_),
+      drop_page_cache_(that.drop_page_cache_),
+      data_sync_(that.data_sync_),
+      write_behind_(that.write_behind_),
       supports_random_access_(
           std::exchange(that.supports_random_access_, LazyBoolState::kUnknown)),
       supports_read_mode_(
@@ -590,13 +731,25 @@ inline FdWriterBase::FdWriterBase(FdWriterBase&& that) noexcept
       original_mode_(that.original_mode_),
 #endif
       associated_reader_(std::move(that.associated_reader_)),
-      read_mode_(that.read_mode_) {
+      read_mode_(that.read_mode_),
+      direct_io_alignment_(that.direct_io_alignment_),
+      direct_io_flags_changed_(
+          std::exchange(that.direct_io_flags_changed_, false)),
+      direct_io_buffer_(std::move(that.direct_io_buffer_)),
+      direct_io_buffer_pos_(that.direct_io_buffer_pos_),
+      direct_io_buffered_(std::exchange(that.direct_io_buffered_, 0)),
+      direct_io_tail_written_(that.direct_io_tail_written_),
+      direct_io_file_size_(that.direct_io_file_size_) {
 }
 
 inline FdWriterBase& FdWriterBase::operator=(FdWriterBase&& that) noexcept {
   BufferedWriter::operator=(static_cast<BufferedWriter&&>(that));
   filename_ = std::exchange(that.filename_, std::string());
   has_independent_pos_ = that.has_independent_pos_;
+  direct_io_ = that.direct_io_;
+  drop_page_cache_ = that.drop_page_cache_;
+  data_sync_ = that.data_sync_;
+  write_behind_ = that.write_behind_;
   supports_random_access_ =
       std::exchange(that.supports_random_access_, LazyBoolState::kUnknown),
   supports_read_mode_ =
@@ -608,6 +761,14 @@ inline FdWriterBase& FdWriterBase::operator=(FdWriterBase&& that) noexcept {
 #endif
   associated_reader_ = std::move(that.associated_reader_);
   read_mode_ = that.read_mode_;
+  direct_io_alignment_ = that.direct_io_alignment_;
+  direct_io_flags_changed_ =
+      std::exchange(that.direct_io_flags_changed_, false);
+  direct_io_buffer_ = std::move(that.direct_io_buffer_);
+  direct_io_buffer_pos_ = that.direct_io_buffer_pos_;
+  direct_io_buffered_ = std::exchange(that.direct_io_buffered_, 0);
+  direct_io_tail_written_ = that.direct_io_tail_written_;
+  direct_io_file_size_ = that.direct_io_file_size_;
   return *this;
 }
 
@@ -615,6 +776,10 @@ inline void FdWriterBase::Reset(Closed) {
   BufferedWriter::Reset(kClosed);
   filename_ = std::string();
   has_independent_pos_ = false;
+  direct_io_ = false;
+  drop_page_cache_ = false;
+  data_sync_ = false;
+  write_behind_ = false;
   supports_random_access_ = LazyBoolState::kUnknown;
   supports_read_mode_ = LazyBoolState::kUnknown;
   random_access_status_ = absl::OkStatus();
@@ -624,12 +789,25 @@ inline void FdWriterBase::Reset(Closed) {
 #endif
   associated_reader_.Reset();
   read_mode_ = false;
+  direct_io_alignment_ = 0;
+  direct_io_flags_changed_ = false;
+  direct_io_buffer_ = AlignedBuffer<kDirectIoBufferAlignment>();
+  direct_io_buffer_pos_ = 0;
+  direct_io_buffered_ = 0;
+  direct_io_tail_written_ = false;
+  direct_io_file_size_ = 0;
 }
 
-inline void FdWriterBase::Reset(const BufferOptions& buffer_options) {
+inline void FdWriterBase::Reset(const BufferOptions& buffer_options,
+                                bool direct_io, bool drop_page_cache,
+                                bool data_sync, bool write_behind) {
   BufferedWriter::Reset(buffer_options);
   // `filename_` will be set by `Initialize()` or `OpenFd()`.
   has_independent_pos_ = false;
+  direct_io_ = direct_io;
+  drop_page_cache_ = drop_page_cache;
+  data_sync_ = data_sync;
+  write_behind_ = write_behind;
   supports_random_access_ = LazyBoolState::kUnknown;
   supports_read_mode_ = LazyBoolState::kUnknown;
   random_access_status_ = absl::OkStatus();
@@ -639,11 +817,19 @@ inline void FdWriterBase::Reset(const BufferOptions& buffer_options) {
 #endif
   associated_reader_.Reset();
   read_mode_ = false;
+  direct_io_alignment_ = 0;
+  direct_io_flags_changed_ = false;
+  direct_io_buffer_pos_ = 0;
+  direct_io_buffered_ = 0;
+  direct_io_tail_written_ = false;
+  direct_io_file_size_ = 0;
 }
 
 template <typename Dest>
 inline FdWriter<Dest>::FdWriter(const Dest& dest, Options options)
-    : FdWriterBase(options.buffer_options()), dest_(dest) {
+    : FdWriterBase(options.buffer_options(), options.direct_io(),
+                   options.drop_page_cache(), options.data_sync(),
+                   options.write_behind()), dest_(dest) {
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
              options.mode(),
@@ -653,7 +839,9 @@ inline FdWriter<Dest>::FdWriter(const Dest& dest, Options options)
 
 template <typename Dest>
 inline FdWriter<Dest>::FdWriter(Dest&& dest, Options options)
-    : FdWriterBase(options.buffer_options()), dest_(std::move(dest)) {
+    : FdWriterBase(options.buffer_options(), options.direct_io(),
+                   options.drop_page_cache(), options.data_sync(),
+                   options.write_behind()), dest_(std::move(dest)) {
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
              options.mode(),
@@ -669,7 +857,9 @@ template <typename Dest>
 template <typename... DestArgs>
 inline FdWriter<Dest>::FdWriter(std::tuple<DestArgs...> dest_args,
                                 Options options)
-    : FdWriterBase(options.buffer_options()), dest_(std::move(dest_args)) {
+    : FdWriterBase(options.buffer_options(), options.direct_io(),
+                   options.drop_page_cache(), options.data_sync(),
+                   options.write_behind()), dest_(std::move(dest_args)) {
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
              options.mode(),
@@ -681,7 +871,9 @@ template <typename Dest>
 template <typename DependentDest,
           std::enable_if_t<std::is_same<DependentDest, OwnedFd>::value, int>>
 inline FdWriter<Dest>::FdWriter(absl::string_view filename, Options options)
-    : FdWriterBase(options.buffer_options()) {
+    : FdWriterBase(options.buffer_options(), options.direct_io(),
+                   options.drop_page_cache(), options.data_sync(),
+                   options.write_behind()) {
   Initialize(filename, std::move(options));
 }
 
@@ -705,7 +897,9 @@ inline void FdWriter<Dest>::Reset(Closed) {
 
 template <typename Dest>
 inline void FdWriter<Dest>::Reset(const Dest& dest, Options options) {
-  FdWriterBase::Reset(options.buffer_options());
+  FdWriterBase::Reset(options.buffer_options(), options.direct_io(),
+                      options.drop_page_cache(), options.data_sync(),
+                      options.write_behind());
   dest_.Reset(dest);
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
@@ -716,7 +910,9 @@ inline void FdWriter<Dest>::Reset(const Dest& dest, Options options) {
 
 template <typename Dest>
 inline void FdWriter<Dest>::Reset(Dest&& dest, Options options) {
-  FdWriterBase::Reset(options.buffer_options());
+  FdWriterBase::Reset(options.buffer_options(), options.direct_io(),
+                      options.drop_page_cache(), options.data_sync(),
+                      options.write_behind());
   dest_.Reset(std::move(dest));
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
@@ -734,7 +930,9 @@ template <typename Dest>
 template <typename... DestArgs>
 inline void FdWriter<Dest>::Reset(std::tuple<DestArgs...> dest_args,
                                   Options options) {
-  FdWriterBase::Reset(options.buffer_options());
+  FdWriterBase::Reset(options.buffer_options(), options.direct_io(),
+                      options.drop_page_cache(), options.data_sync(),
+                      options.write_behind());
   dest_.Reset(std::move(dest_args));
   Initialize(dest_.get(), std::move(options.assumed_filename()),
 #ifdef _WIN32
@@ -747,7 +945,9 @@ template <typename Dest>
 template <typename DependentDest,
           std::enable_if_t<std::is_same<DependentDest, OwnedFd>::value, int>>
 inline void FdWriter<Dest>::Reset(absl::string_view filename, Options options) {
-  FdWriterBase::Reset(options.buffer_options());
+  FdWriterBase::Reset(options.buffer_options(), options.direct_io(),
+                      options.drop_page_cache(), options.data_sync(),
+                      options.write_behind());
   Initialize(filename, std::move(options));
 }
 
@@ -0,0 +1,160 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/bytes/file_watcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace riegeli {
+
+FileWatcher::FileWatcher(absl::string_view filename, Options options)
+    : options_(std::move(options)) {
+#ifdef __linux__
+  if (!options_.use_inotify()) return;
+  const int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ABSL_PREDICT_FALSE(inotify_fd < 0)) return;
+  // `IN_MODIFY` covers appends, `IN_ATTRIB` covers truncation on some file
+  // systems, and `IN_MOVE_SELF` and `IN_DELETE_SELF` let the caller notice
+  // that the file is gone.
+  if (ABSL_PREDICT_FALSE(
+          inotify_add_watch(inotify_fd, std::string(filename).c_str(),
+                            IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                                IN_MOVE_SELF | IN_DELETE_SELF) < 0)) {
+    close(inotify_fd);
+    return;
+  }
+  const int cancel_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ABSL_PREDICT_FALSE(cancel_fd < 0)) {
+    close(inotify_fd);
+    return;
+  }
+  inotify_fd_ = inotify_fd;
+  cancel_fd_ = cancel_fd;
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+  if (inotify_fd_ >= 0) close(inotify_fd_);
+  if (cancel_fd_ >= 0) close(cancel_fd_);
+#endif
+}
+
+bool FileWatcher::Wait(absl::Time deadline) {
+  const absl::Time poll_deadline =
+      std::min(absl::Now() + options_.poll_interval(), deadline);
+  if (inotify_fd_ < 0) {
+    if (AwaitCancelled(poll_deadline)) return false;
+    return poll_deadline < deadline;
+  }
+  if (!AwaitNotification(poll_deadline)) {
+    // Timed out or cancelled. Even without a notification, the file might
+    // have been modified in a way which is not reported, so the caller should
+    // check it unless `deadline` passed.
+    {
+      absl::MutexLock lock(&mutex_);
+      if (cancelled_) return false;
+    }
+    return poll_deadline < deadline;
+  }
+  if (options_.coalesce_delay() > absl::ZeroDuration()) {
+    const absl::Time coalesce_deadline =
+        std::min(absl::Now() + options_.coalesce_delay(), deadline);
+    if (AwaitCancelled(coalesce_deadline)) return false;
+  }
+  DrainNotifications();
+  return true;
+}
+
+void FileWatcher::Cancel() {
+  {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+  }
+#ifdef __linux__
+  if (cancel_fd_ >= 0) {
+    const uint64_t one = 1;
+    // Failure can only mean that the counter is already signalled.
+    const ssize_t result = write(cancel_fd_, &one, sizeof(one));
+    static_cast<void>(result);
+  }
+#endif
+}
+
+void FileWatcher::DrainNotifications() {
+#ifdef __linux__
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (read(inotify_fd_, buffer, sizeof(buffer)) > 0) {
+  }
+#endif
+}
+
+bool FileWatcher::AwaitNotification(absl::Time deadline) {
+#ifdef __linux__
+  for (;;) {
+    struct pollfd fds[2];
+    fds[0].fd = inotify_fd_;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = cancel_fd_;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    const absl::Duration remaining = deadline - absl::Now();
+    const int timeout_ms =
+        deadline == absl::InfiniteFuture()
+            ? -1
+            : remaining <= absl::ZeroDuration()
+                  ? 0
+                  : static_cast<int>(std::min(
+                        absl::ToInt64Milliseconds(absl::Ceil(
+                            remaining, absl::Milliseconds(1))),
+                        int64_t{1} << 30));
+    const int result = poll(fds, 2, timeout_ms);
+    if (ABSL_PREDICT_FALSE(result < 0)) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (result == 0) return false;
+    if ((fds[1].revents & POLLIN) != 0) return false;
+    return (fds[0].revents & POLLIN) != 0;
+  }
+#else
+  return false;
+#endif
+}
+
+bool FileWatcher::AwaitCancelled(absl::Time deadline) {
+  absl::MutexLock lock(&mutex_);
+  return mutex_.AwaitWithDeadline(absl::Condition(&cancelled_), deadline);
+}
+
+}  // namespace riegeli
@@ -0,0 +1,135 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BYTES_FILE_WATCHER_H_
+#define RIEGELI_BYTES_FILE_WATCHER_H_
+
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace riegeli {
+
+// `FileWatcher` waits until a file might have been modified, e.g. to continue
+// reading a file which is being appended to by another process.
+//
+// On Linux, modifications are observed with `inotify`. Elsewhere, or if
+// `inotify` is not available for the file, `FileWatcher` falls back to
+// polling: `Wait()` returns after `Options::poll_interval()`, and the caller
+// checks the file again.
+//
+// `Wait()` can return also when the file was not modified. Callers should
+// check whether there is new data and wait again if not.
+class FileWatcher {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // The maximum time `Wait()` waits without a notification. This bounds the
+    // latency of noticing a modification when notifications are not
+    // available, e.g. on some network file systems, or when polling is forced
+    // with `set_use_inotify(false)`.
+    //
+    // Default: `absl::Seconds(1)`.
+    Options& set_poll_interval(absl::Duration poll_interval) & {
+      poll_interval_ = poll_interval;
+      return *this;
+    }
+    Options&& set_poll_interval(absl::Duration poll_interval) && {
+      return std::move(set_poll_interval(poll_interval));
+    }
+    absl::Duration poll_interval() const { return poll_interval_; }
+
+    // After a notification, `Wait()` waits `coalesce_delay` more before
+    // returning, so that a burst of small appends causes one wakeup instead of
+    // many. This trades latency for fewer wakeups.
+    //
+    // Default: `absl::ZeroDuration()`.
+    Options& set_coalesce_delay(absl::Duration coalesce_delay) & {
+      coalesce_delay_ = coalesce_delay;
+      return *this;
+    }
+    Options&& set_coalesce_delay(absl::Duration coalesce_delay) && {
+      return std::move(set_coalesce_delay(coalesce_delay));
+    }
+    absl::Duration coalesce_delay() const { return coalesce_delay_; }
+
+    // If `false`, `inotify` is not used even if available.
+    //
+    // Default: `true`.
+    Options& set_use_inotify(bool use_inotify) & {
+      use_inotify_ = use_inotify;
+      return *this;
+    }
+    Options&& set_use_inotify(bool use_inotify) && {
+      return std::move(set_use_inotify(use_inotify));
+    }
+    bool use_inotify() const { return use_inotify_; }
+
+   private:
+    absl::Duration poll_interval_ = absl::Seconds(1);
+    absl::Duration coalesce_delay_ = absl::ZeroDuration();
+    bool use_inotify_ = true;
+  };
+
+  // Will watch the file named `filename`.
+  explicit FileWatcher(absl::string_view filename, Options options = Options());
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  ~FileWatcher();
+
+  // Waits until the file might have been modified since the previous `Wait()`
+  // or since construction, until `Options::poll_interval()` passes, or until
+  // `deadline`.
+  //
+  // Return values:
+  //  * `true`  - the file might have been modified
+  //  * `false` - `deadline` passed, or `Cancel()` was called
+  bool Wait(absl::Time deadline = absl::InfiniteFuture());
+
+  // Makes a current and all future `Wait()` calls return `false` immediately.
+  //
+  // `Cancel()` may be called concurrently with `Wait()`.
+  void Cancel();
+
+  // Returns `true` if modifications are observed with notifications rather
+  // than with polling.
+  bool notifications() const { return inotify_fd_ >= 0; }
+
+ private:
+  // Discards pending notifications.
+  void DrainNotifications();
+  // Waits until `deadline` for a notification or for `Cancel()`. Returns
+  // `true` on a notification.
+  bool AwaitNotification(absl::Time deadline);
+  bool AwaitCancelled(absl::Time deadline) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Options options_;
+  // `inotify` descriptor, or -1 if polling.
+  int inotify_fd_ = -1;
+  // Descriptor signalled by `Cancel()` if `inotify_fd_ >= 0`, or -1.
+  int cancel_fd_ = -1;
+  absl::Mutex mutex_;
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BYTES_FILE_WATCHER_H_
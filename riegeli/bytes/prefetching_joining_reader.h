@@ -0,0 +1,295 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_BYTES_PREFETCHING_JOINING_READER_H_
+#define RIEGELI_BYTES_PREFETCHING_JOINING_READER_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/dependency.h"
+#include "riegeli/base/object.h"
+#include "riegeli/base/parallelism.h"
+#include "riegeli/bytes/joining_reader.h"
+#include "riegeli/bytes/reader.h"
+
+namespace riegeli {
+
+// A `JoiningReader` which opens the next shards ahead of time in background
+// threads, and pulls the beginning of their data, while the current shard is
+// being read. This hides the latency of opening shards on slow storage.
+//
+// Shards are provided by a function `open_shard(shard_index)`, called with
+// consecutive indices starting from 0, which returns `absl::nullopt` if there
+// is no shard with that index. It is called in background threads, possibly
+// concurrently for different indices, so it must be thread-safe. It can be
+// called for a few indices after the last shard, and must keep returning
+// `absl::nullopt` for them.
+//
+// Failure to open a shard should be reported by returning a failed shard
+// `Reader`, which makes the `PrefetchingJoiningReader` fail when it reaches
+// that shard.
+//
+// The `Shard` template parameter specifies the type of the object providing and
+// possibly owning the shard `Reader`. `Shard` must support
+// `Dependency<Reader*, Shard>` and must be movable, e.g.
+// `std::unique_ptr<Reader>` (owned, default), `FdReader<>` (owned).
+template <typename Shard = std::unique_ptr<Reader>>
+class PrefetchingJoiningReader : public JoiningReader<Shard> {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Maximum number of shards being opened or already opened ahead of the
+    // current shard.
+    //
+    // Memory used by prefetching is bounded by `lookahead()` times the memory
+    // of an open shard with `prefetch_size()` bytes pulled.
+    //
+    // Default: 1.
+    Options& set_lookahead(size_t lookahead) & {
+      RIEGELI_ASSERT_GT(lookahead, 0u)
+          << "Failed precondition of "
+             "PrefetchingJoiningReader::Options::set_lookahead(): "
+             "zero lookahead";
+      lookahead_ = lookahead;
+      return *this;
+    }
+    Options&& set_lookahead(size_t lookahead) && {
+      return std::move(set_lookahead(lookahead));
+    }
+    size_t lookahead() const { return lookahead_; }
+
+    // Recommended length of data pulled from a shard opened ahead of time.
+    // The shard might buffer less or more, depending on its buffer size.
+    //
+    // If 0, shards are opened ahead of time but no data are pulled.
+    //
+    // Default: 64K.
+    Options& set_prefetch_size(size_t prefetch_size) & {
+      prefetch_size_ = prefetch_size;
+      return *this;
+    }
+    Options&& set_prefetch_size(size_t prefetch_size) && {
+      return std::move(set_prefetch_size(prefetch_size));
+    }
+    size_t prefetch_size() const { return prefetch_size_; }
+
+   private:
+    size_t lookahead_ = 1;
+    size_t prefetch_size_ = size_t{64} << 10;
+  };
+
+  // Opens the shard with the given index, or returns `absl::nullopt` if there
+  // is no such shard.
+  using OpenShardFunction =
+      std::function<absl::optional<Shard>(size_t shard_index)>;
+
+  // Creates a closed `PrefetchingJoiningReader`.
+  explicit PrefetchingJoiningReader(Closed) noexcept
+      : JoiningReader<Shard>(kClosed) {}
+
+  // Will read from shards returned by `open_shard`.
+  explicit PrefetchingJoiningReader(OpenShardFunction open_shard,
+                                    Options options = Options());
+
+  PrefetchingJoiningReader(PrefetchingJoiningReader&& that) noexcept;
+  PrefetchingJoiningReader& operator=(PrefetchingJoiningReader&& that) noexcept;
+
+  ~PrefetchingJoiningReader() override { CancelPendingShards(); }
+
+  // Makes `*this` equivalent to a newly constructed `PrefetchingJoiningReader`.
+  // This avoids constructing a temporary `PrefetchingJoiningReader` and moving
+  // from it.
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(Closed);
+  ABSL_ATTRIBUTE_REINITIALIZES void Reset(OpenShardFunction open_shard,
+                                          Options options = Options());
+
+ protected:
+  void Done() override;
+  bool OpenShardImpl() override;
+
+ private:
+  // State shared with background tasks, which must not refer to `*this`
+  // because `*this` can be moved.
+  struct SharedState {
+    explicit SharedState(OpenShardFunction open_shard)
+        : open_shard(std::move(open_shard)) {}
+
+    const OpenShardFunction open_shard;
+    std::atomic<bool> cancelled{false};
+  };
+
+  // Schedules opening shards until `lookahead_` shards are pending.
+  void ScheduleShards();
+
+  // Stops background tasks from doing more work, and waits for them, so that
+  // no shard is being opened or read after this returns. Shards opened ahead
+  // of time are closed.
+  void CancelPendingShards();
+
+  std::shared_ptr<SharedState> state_;
+  size_t lookahead_ = 0;
+  size_t prefetch_size_ = 0;
+  // Index of the next shard to be scheduled for opening.
+  size_t next_shard_index_ = 0;
+  // If `true`, the end of shards was reached, and no more shards are
+  // scheduled.
+  bool exhausted_ = false;
+  // Shards being opened in background, in the order of their indices.
+  std::deque<std::future<absl::optional<Shard>>> pending_shards_;
+};
+
+// Implementation details follow.
+
+template <typename Shard>
+inline PrefetchingJoiningReader<Shard>::PrefetchingJoiningReader(
+    OpenShardFunction open_shard, Options options)
+    : state_(std::make_shared<SharedState>(std::move(open_shard))),
+      lookahead_(options.lookahead()),
+      prefetch_size_(options.prefetch_size()) {
+  ScheduleShards();
+}
+
+template <typename Shard>
+inline PrefetchingJoiningReader<Shard>::PrefetchingJoiningReader(
+    PrefetchingJoiningReader&& that) noexcept
+    : JoiningReader<Shard>(static_cast<JoiningReader<Shard>&&>(that)),
+      state_(std::move(that.state_)),
+      lookahead_(that.lookahead_),
+      prefetch_size_(that.prefetch_size_),
+      next_shard_index_(that.next_shard_index_),
+      exhausted_(that.exhausted_),
+      pending_shards_(std::move(that.pending_shards_)) {}
+
+template <typename Shard>
+inline PrefetchingJoiningReader<Shard>&
+PrefetchingJoiningReader<Shard>::operator=(
+    PrefetchingJoiningReader&& that) noexcept {
+  CancelPendingShards();
+  JoiningReader<Shard>::operator=(static_cast<JoiningReader<Shard>&&>(that));
+  state_ = std::move(that.state_);
+  lookahead_ = that.lookahead_;
+  prefetch_size_ = that.prefetch_size_;
+  next_shard_index_ = that.next_shard_index_;
+  exhausted_ = that.exhausted_;
+  pending_shards_ = std::move(that.pending_shards_);
+  return *this;
+}
+
+template <typename Shard>
+inline void PrefetchingJoiningReader<Shard>::Reset(Closed) {
+  CancelPendingShards();
+  JoiningReader<Shard>::Reset(kClosed);
+  state_.reset();
+  lookahead_ = 0;
+  prefetch_size_ = 0;
+  next_shard_index_ = 0;
+  exhausted_ = false;
+}
+
+template <typename Shard>
+inline void PrefetchingJoiningReader<Shard>::Reset(
+    OpenShardFunction open_shard, Options options) {
+  CancelPendingShards();
+  JoiningReader<Shard>::Reset();
+  state_ = std::make_shared<SharedState>(std::move(open_shard));
+  lookahead_ = options.lookahead();
+  prefetch_size_ = options.prefetch_size();
+  next_shard_index_ = 0;
+  exhausted_ = false;
+  ScheduleShards();
+}
+
+template <typename Shard>
+void PrefetchingJoiningReader<Shard>::Done() {
+  JoiningReader<Shard>::Done();
+  CancelPendingShards();
+}
+
+template <typename Shard>
+bool PrefetchingJoiningReader<Shard>::OpenShardImpl() {
+  if (exhausted_) return false;
+  ScheduleShards();
+  absl::optional<Shard> shard = pending_shards_.front().get();
+  pending_shards_.pop_front();
+  if (shard == absl::nullopt) {
+    exhausted_ = true;
+    // Remaining pending shards are after the end.
+    CancelPendingShards();
+    return false;
+  }
+  this->shard() = std::move(*shard);
+  ScheduleShards();
+  Reader* const reader = this->ShardReader();
+  if (ABSL_PREDICT_FALSE(!reader->is_open())) {
+    // The shard failed while being opened.
+    return this->FailWithoutAnnotation(
+        this->AnnotateOverShard(reader->status()));
+  }
+  return true;
+}
+
+template <typename Shard>
+void PrefetchingJoiningReader<Shard>::ScheduleShards() {
+  while (!exhausted_ && pending_shards_.size() < lookahead_) {
+    std::promise<absl::optional<Shard>>* const shard_promise =
+        new std::promise<absl::optional<Shard>>();
+    pending_shards_.push_back(shard_promise->get_future());
+    // The shard is opened in a thread which may block on I/O, so it must not
+    // occupy a thread of `Executor::global()`.
+    internal::ThreadPool::global().Schedule(
+        [state = state_, shard_index = next_shard_index_++,
+         prefetch_size = prefetch_size_, shard_promise] {
+          absl::optional<Shard> shard;
+          if (!state->cancelled.load(std::memory_order_relaxed)) {
+            shard = state->open_shard(shard_index);
+          }
+          if (shard != absl::nullopt && prefetch_size > 0 &&
+              !state->cancelled.load(std::memory_order_relaxed)) {
+            Dependency<Reader*, Shard> reader(std::move(*shard));
+            if (reader->ok()) reader->Pull(1, prefetch_size);
+            shard = std::move(reader.manager());
+          }
+          shard_promise->set_value(std::move(shard));
+          delete shard_promise;
+        });
+  }
+}
+
+template <typename Shard>
+void PrefetchingJoiningReader<Shard>::CancelPendingShards() {
+  if (pending_shards_.empty()) return;
+  state_->cancelled.store(true, std::memory_order_relaxed);
+  for (std::future<absl::optional<Shard>>& pending_shard : pending_shards_) {
+    pending_shard.wait();
+  }
+  pending_shards_.clear();
+  exhausted_ = true;
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_BYTES_PREFETCHING_JOINING_READER_H_
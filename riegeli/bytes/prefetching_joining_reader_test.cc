@@ -0,0 +1,166 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/bytes/prefetching_joining_reader.h"
+
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/string_reader.h"
+
+namespace riegeli {
+namespace {
+
+std::vector<std::string> TestShards(size_t num_shards) {
+  std::mt19937 random(1);
+  std::vector<std::string> shards;
+  for (size_t i = 0; i < num_shards; ++i) {
+    std::string shard(random() % (size_t{200} << 10), '\0');
+    for (char& ch : shard) ch = static_cast<char>('a' + random() % 26);
+    shards.push_back(std::move(shard));
+  }
+  return shards;
+}
+
+// Returns a function opening `shards`, which must outlive it.
+PrefetchingJoiningReader<>::OpenShardFunction OpenShards(
+    const std::vector<std::string>& shards) {
+  return [&shards](
+             size_t shard_index) -> absl::optional<std::unique_ptr<Reader>> {
+    if (shard_index >= shards.size()) return absl::nullopt;
+    return std::make_unique<StringReader<>>(shards[shard_index]);
+  };
+}
+
+std::string Concatenate(const std::vector<std::string>& shards) {
+  std::string joined;
+  for (const std::string& shard : shards) joined.append(shard);
+  return joined;
+}
+
+class PrefetchingJoiningReaderTest
+    : public testing::TestWithParam<std::tuple<size_t, size_t>> {
+ protected:
+  PrefetchingJoiningReader<>::Options options() const {
+    return PrefetchingJoiningReader<>::Options()
+        .set_lookahead(std::get<0>(GetParam()))
+        .set_prefetch_size(std::get<1>(GetParam()));
+  }
+};
+
+TEST_P(PrefetchingJoiningReaderTest, JoinsShards) {
+  for (size_t num_shards : {0, 1, 2, 5, 20}) {
+    const std::vector<std::string> shards = TestShards(num_shards);
+    PrefetchingJoiningReader<> reader(OpenShards(shards), options());
+    std::string joined;
+    ASSERT_TRUE(ReadAll(reader, joined).ok()) << reader.status();
+    EXPECT_TRUE(joined == Concatenate(shards)) << "Shards: " << num_shards;
+    EXPECT_TRUE(reader.Close()) << reader.status();
+  }
+}
+
+TEST_P(PrefetchingJoiningReaderTest, CloseBeforeEnd) {
+  const std::vector<std::string> shards = TestShards(20);
+  std::atomic<size_t> num_opened{0};
+  PrefetchingJoiningReader<> reader(
+      [&](size_t shard_index) -> absl::optional<std::unique_ptr<Reader>> {
+        num_opened.fetch_add(1, std::memory_order_relaxed);
+        return OpenShards(shards)(shard_index);
+      },
+      options());
+  std::string prefix;
+  ASSERT_TRUE(reader.Read(1000, prefix)) << reader.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  // Shards opened ahead of time are bounded by the lookahead, and no shards
+  // are opened after closing.
+  const size_t num_opened_at_close = num_opened.load(std::memory_order_relaxed);
+  EXPECT_LE(num_opened_at_close, 2 + std::get<0>(GetParam()));
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_EQ(num_opened.load(std::memory_order_relaxed), num_opened_at_close);
+}
+
+TEST_P(PrefetchingJoiningReaderTest, MoveWhileReading) {
+  const std::vector<std::string> shards = TestShards(10);
+  const std::string expected = Concatenate(shards);
+  PrefetchingJoiningReader<> reader(OpenShards(shards), options());
+  std::string joined;
+  ASSERT_TRUE(reader.Read(expected.size() / 3, joined)) << reader.status();
+  PrefetchingJoiningReader<> moved = std::move(reader);
+  std::string rest;
+  ASSERT_TRUE(ReadAll(moved, rest).ok()) << moved.status();
+  joined.append(rest);
+  EXPECT_TRUE(joined == expected);
+  EXPECT_TRUE(moved.Close()) << moved.status();
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    LookaheadAndPrefetchSize, PrefetchingJoiningReaderTest,
+    testing::Combine(testing::Values(size_t{1}, size_t{4}),
+                     testing::Values(size_t{0}, size_t{64} << 10)));
+
+TEST(PrefetchingJoiningReaderTest, OpensShardsAhead) {
+  const std::vector<std::string> shards = TestShards(3);
+  absl::Notification second_shard_opened;
+  PrefetchingJoiningReader<> reader(
+      [&](size_t shard_index) -> absl::optional<std::unique_ptr<Reader>> {
+        if (shard_index == 1) second_shard_opened.Notify();
+        return OpenShards(shards)(shard_index);
+      },
+      PrefetchingJoiningReader<>::Options().set_lookahead(2));
+  // The second shard is opened before anything is read.
+  EXPECT_TRUE(
+      second_shard_opened.WaitForNotificationWithTimeout(absl::Seconds(30)));
+  std::string joined;
+  ASSERT_TRUE(ReadAll(reader, joined).ok()) << reader.status();
+  EXPECT_TRUE(joined == Concatenate(shards));
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST(PrefetchingJoiningReaderTest, FailedShard) {
+  const std::vector<std::string> shards = TestShards(3);
+  PrefetchingJoiningReader<> reader(
+      [&](size_t shard_index) -> absl::optional<std::unique_ptr<Reader>> {
+        if (shard_index == 1) {
+          std::unique_ptr<Reader> shard =
+              std::make_unique<StringReader<>>(absl::string_view());
+          shard->Fail(absl::DataLossError("Shard is corrupted"));
+          return shard;
+        }
+        return OpenShards(shards)(shard_index);
+      });
+  std::string joined;
+  EXPECT_FALSE(ReadAll(reader, joined).ok());
+  EXPECT_TRUE(absl::IsDataLoss(reader.status())) << reader.status();
+  // Data before the failed shard were read.
+  EXPECT_TRUE(joined == shards[0]);
+  EXPECT_FALSE(reader.Close());
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,80 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of small reads and writes, which are served from the buffer of a
+// `Reader` or `Writer` in the fast path.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/bytes/chain_reader.h"
+#include "riegeli/bytes/chain_writer.h"
+#include "riegeli/bytes/string_writer.h"
+
+namespace riegeli {
+namespace {
+
+constexpr size_t kTotalSize = size_t{1} << 20;
+
+// Reads `kTotalSize` bytes from a `ChainReader` in pieces of `state.range(0)`
+// bytes.
+void BM_ChainReaderSmallReads(benchmark::State& state) {
+  const size_t length = static_cast<size_t>(state.range(0));
+  Chain src;
+  // Blocks of moderate size, so that some reads cross block boundaries.
+  for (size_t i = 0; i < kTotalSize; i += 4096) {
+    src.Append(std::string(4096, 'a'));
+  }
+  for (auto _ : state) {
+    ChainReader<> reader(&src);
+    absl::string_view piece;
+    while (reader.Read(length, piece)) benchmark::DoNotOptimize(piece);
+    reader.Close();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kTotalSize));
+}
+BENCHMARK(BM_ChainReaderSmallReads)->Arg(1)->Arg(8)->Arg(64);
+
+// Writes `kTotalSize` bytes to a `Writer` in pieces of `state.range(0)` bytes.
+template <typename WriterType, typename DestType>
+void BM_SmallWrites(benchmark::State& state) {
+  const std::string piece(static_cast<size_t>(state.range(0)), 'a');
+  const size_t num_pieces = kTotalSize / piece.size();
+  for (auto _ : state) {
+    DestType dest;
+    WriterType writer(&dest);
+    for (size_t i = 0; i < num_pieces; ++i) writer.Write(piece);
+    writer.Close();
+    benchmark::DoNotOptimize(dest);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(num_pieces * piece.size()));
+}
+BENCHMARK_TEMPLATE(BM_SmallWrites, ChainWriter<>, Chain)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(64);
+BENCHMARK_TEMPLATE(BM_SmallWrites, StringWriter<>, std::string)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(64);
+
+}  // namespace
+}  // namespace riegeli
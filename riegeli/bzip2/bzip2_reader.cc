@@ -17,6 +17,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <cstring>
+#include <functional>
+#include <future>
 #include <limits>
 #include <memory>
 #include <string>
@@ -29,13 +32,79 @@
 #include "bzlib.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffered_reader.h"
+#include "riegeli/bytes/chain_reader.h"
 #include "riegeli/bytes/reader.h"
 
 namespace riegeli {
 
+namespace {
+
+// A stream header followed by a block header: "BZh", a block size digit, and
+// the block magic. Streams are byte-aligned, but blocks are not, so this is
+// how the beginning of a non-empty stream can be located cheaply.
+constexpr size_t kStreamHeaderSize = 10;
+
+// The preferred minimum size of compressed data decompressed in background at
+// once. Smaller streams are grouped together.
+constexpr size_t kMinSegmentSize = size_t{256} << 10;
+
+// The maximum size of compressed data scanned for a stream boundary. If no
+// boundary is found, the stream is decompressed in the calling thread.
+constexpr size_t kMaxSegmentSize = size_t{16} << 20;
+
+// The initial size of compressed data scanned for a stream boundary.
+constexpr size_t kInitialScanSize = size_t{64} << 10;
+
+inline bool IsStreamHeader(const char* src) {
+  return src[0] == 'B' && src[1] == 'Z' && src[2] == 'h' && src[3] >= '1' &&
+         src[3] <= '9' &&
+         std::memcmp(src + 4, "\x31\x41\x59\x26\x53\x59", 6) == 0;
+}
+
+absl::Status BzlibError(absl::StatusCode code, absl::string_view operation,
+                        int bzlib_code) {
+  std::string message = absl::StrCat(operation, " failed");
+  const char* details = nullptr;
+  switch (bzlib_code) {
+    case BZ_SEQUENCE_ERROR:
+      details = "sequence error";
+      break;
+    case BZ_PARAM_ERROR:
+      details = "parameter error";
+      break;
+    case BZ_MEM_ERROR:
+      details = "memory error";
+      break;
+    case BZ_DATA_ERROR:
+      details = "data error";
+      break;
+    case BZ_DATA_ERROR_MAGIC:
+      details = "data error (magic)";
+      break;
+    case BZ_IO_ERROR:
+      details = "I/O error";
+      break;
+    case BZ_UNEXPECTED_EOF:
+      details = "unexpected EOF";
+      break;
+    case BZ_OUTBUFF_FULL:
+      details = "output buffer full";
+      break;
+    case BZ_CONFIG_ERROR:
+      details = "config error";
+      break;
+  }
+  if (details != nullptr) absl::StrAppend(&message, ": ", details);
+  return absl::Status(code, message);
+}
+
+}  // namespace
+
 void Bzip2ReaderBase::Initialize(Reader* src) {
   RIEGELI_ASSERT(src != nullptr)
       << "Failed precondition of Bzip2Reader: null Reader pointer";
@@ -65,6 +134,8 @@ void Bzip2ReaderBase::Done() {
   }
   BufferedReader::Done();
   decompressor_.reset();
+  pending_streams_.clear();
+  decompressed_.Reset(std::forward_as_tuple());
 }
 
 inline bool Bzip2ReaderBase::FailOperation(absl::StatusCode code,
@@ -76,39 +147,7 @@ inline bool Bzip2ReaderBase::FailOperation(absl::StatusCode code,
   RIEGELI_ASSERT(is_open())
       << "Failed precondition of Bzip2ReaderBase::FailOperation(): "
          "Object closed";
-  std::string message = absl::StrCat(operation, " failed");
-  const char* details = nullptr;
-  switch (bzlib_code) {
-    case BZ_SEQUENCE_ERROR:
-      details = "sequence error";
-      break;
-    case BZ_PARAM_ERROR:
-      details = "parameter error";
-      break;
-    case BZ_MEM_ERROR:
-      details = "memory error";
-      break;
-    case BZ_DATA_ERROR:
-      details = "data error";
-      break;
-    case BZ_DATA_ERROR_MAGIC:
-      details = "data error (magic)";
-      break;
-    case BZ_IO_ERROR:
-      details = "I/O error";
-      break;
-    case BZ_UNEXPECTED_EOF:
-      details = "unexpected EOF";
-      break;
-    case BZ_OUTBUFF_FULL:
-      details = "output buffer full";
-      break;
-    case BZ_CONFIG_ERROR:
-      details = "config error";
-      break;
-  }
-  if (details != nullptr) absl::StrAppend(&message, ": ", details);
-  return Fail(absl::Status(code, message));
+  return Fail(BzlibError(code, operation, bzlib_code));
 }
 
 absl::Status Bzip2ReaderBase::AnnotateStatusImpl(absl::Status status) {
@@ -152,6 +191,17 @@ bool Bzip2ReaderBase::ReadInternal(size_t min_length, size_t max_length,
          "max_length < min_length";
   RIEGELI_ASSERT(ok())
       << "Failed precondition of BufferedReader::ReadInternal(): " << status();
+  // If `sequential_`, data decompressed in background precede the stream to
+  // be decompressed with `ReadSequential()`, so they are read first.
+  if (parallelism_ > 0 && (!sequential_ || !pending_streams_.empty() ||
+                           decompressed_.Pull())) {
+    return ReadParallel(min_length, max_length, dest);
+  }
+  return ReadSequential(min_length, max_length, dest);
+}
+
+inline bool Bzip2ReaderBase::ReadSequential(size_t min_length,
+                                            size_t max_length, char* dest) {
   if (ABSL_PREDICT_FALSE(decompressor_ == nullptr)) return false;
   Reader& src = *SrcReader();
   truncated_ = false;
@@ -210,6 +260,14 @@ bool Bzip2ReaderBase::ReadInternal(size_t min_length, size_t max_length,
             break;
           }
           stream_had_data_ = false;
+          if (sequential_) {
+            // The stream whose end was not located cheaply has ended.
+            sequential_ = false;
+            move_limit_pos(length_read);
+            if (length_read >= min_length) return true;
+            return ReadParallel(min_length - length_read,
+                                max_length - length_read, dest + length_read);
+          }
           if (length_read >= min_length) break;
           continue;
         }
@@ -230,6 +288,195 @@ bool Bzip2ReaderBase::ReadInternal(size_t min_length, size_t max_length,
   }
 }
 
+bool Bzip2ReaderBase::ReadParallel(size_t min_length, size_t max_length,
+                                   char* dest) {
+  max_length = UnsignedMin(max_length,
+                           std::numeric_limits<Position>::max() - limit_pos());
+  size_t length_read = 0;
+  for (;;) {
+    size_t length;
+    decompressed_.Read(max_length - length_read, dest + length_read, &length);
+    length_read += length;
+    move_limit_pos(length);
+    if (length_read >= min_length) return true;
+    if (ABSL_PREDICT_FALSE(length_read == max_length)) return FailOverflow();
+    if (ABSL_PREDICT_FALSE(!NextStreams())) {
+      if (sequential_ && ok()) {
+        return ReadSequential(min_length - length_read,
+                              max_length - length_read, dest + length_read);
+      }
+      return false;
+    }
+  }
+}
+
+inline bool Bzip2ReaderBase::NextStreams() {
+  Reader& src = *SrcReader();
+  truncated_ = false;
+  while (!sequential_ &&
+         pending_streams_.size() < IntCast<size_t>(parallelism_)) {
+    std::string compressed;
+    if (!ReadSegment(compressed)) {
+      if (ABSL_PREDICT_FALSE(!src.ok())) {
+        // Return data decompressed before the failure first.
+        if (!pending_streams_.empty()) break;
+        return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+      }
+      // No stream boundary was found nearby. Decompress the current stream
+      // with `ReadSequential()` after pending streams.
+      sequential_ = true;
+      break;
+    }
+    if (compressed.empty()) break;
+    std::shared_ptr<const std::string> shared_compressed =
+        std::make_shared<const std::string>(std::move(compressed));
+    std::promise<DecompressedStreams>* const streams_promise =
+        new std::promise<DecompressedStreams>();
+    pending_streams_.push_back(
+        PendingStreams{shared_compressed, streams_promise->get_future()});
+    Executor& executor = executor_ != nullptr ? *executor_ : Executor::global();
+    executor.Schedule(
+        [streams_promise, compressed = std::move(shared_compressed)] {
+          DecompressedStreams streams;
+          streams.status = DecompressStreams(*compressed, streams.data);
+          streams_promise->set_value(std::move(streams));
+          delete streams_promise;
+        });
+  }
+  if (pending_streams_.empty()) return false;
+  PendingStreams pending = std::move(pending_streams_.front());
+  pending_streams_.pop_front();
+  DecompressedStreams streams = pending.decompressed.get();
+  if (ABSL_PREDICT_FALSE(absl::IsDataLoss(streams.status))) {
+    // The last stream continues past `pending.compressed`, which means that
+    // what looked like a stream header was a part of compressed data. Merge
+    // following compressed data until streams end.
+    std::string merged = *pending.compressed;
+    do {
+      if (!pending_streams_.empty()) {
+        merged.append(*pending_streams_.front().compressed);
+        pending_streams_.pop_front();
+      } else {
+        const size_t merged_size = merged.size();
+        if (!ReadSegment(merged) && src.ok()) {
+          src.ReadAndAppend(kMaxSegmentSize, merged);
+        }
+        if (ABSL_PREDICT_FALSE(merged.size() == merged_size)) {
+          if (ABSL_PREDICT_FALSE(!src.ok())) {
+            return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+          }
+          // Keep the incomplete streams in case the source grows.
+          truncated_ = true;
+          std::promise<DecompressedStreams> streams_promise;
+          streams_promise.set_value(std::move(streams));
+          pending_streams_.push_front(
+              PendingStreams{std::make_shared<const std::string>(
+                                 std::move(merged)),
+                             streams_promise.get_future()});
+          return false;
+        }
+      }
+      streams.data.Clear();
+      streams.status = DecompressStreams(merged, streams.data);
+    } while (absl::IsDataLoss(streams.status));
+  }
+  if (ABSL_PREDICT_FALSE(!streams.status.ok())) {
+    return Fail(std::move(streams.status));
+  }
+  decompressed_.Reset(std::move(streams.data));
+  return true;
+}
+
+bool Bzip2ReaderBase::ReadSegment(std::string& compressed) {
+  Reader& src = *SrcReader();
+  // Offset in `src` where a stream header is searched for next.
+  size_t scan_pos = 1;
+  // Offset in `src` of the last stream header found, or 0 if none.
+  size_t boundary = 0;
+  for (size_t scan_size = kInitialScanSize;;
+       scan_size = UnsignedMin(scan_size * 2, kMaxSegmentSize)) {
+    const bool pulled = src.Pull(scan_size);
+    if (ABSL_PREDICT_FALSE(!pulled && !src.ok())) return false;
+    const absl::string_view window(src.cursor(), src.available());
+    while (scan_pos + kStreamHeaderSize <= window.size()) {
+      const size_t found = window.find("BZh", scan_pos);
+      if (found == absl::string_view::npos ||
+          found + kStreamHeaderSize > window.size()) {
+        scan_pos = window.size() - (kStreamHeaderSize - 1);
+        break;
+      }
+      scan_pos = found + 1;
+      if (IsStreamHeader(window.data() + found)) {
+        boundary = found;
+        if (boundary >= kMinSegmentSize) break;
+      }
+    }
+    if (boundary >= kMinSegmentSize) break;
+    if (!pulled) {
+      // The source ends. Take the remaining data.
+      boundary = window.size();
+      break;
+    }
+    if (window.size() >= kMaxSegmentSize) {
+      if (boundary == 0) return false;
+      break;
+    }
+  }
+  src.ReadAndAppend(boundary, compressed);
+  return true;
+}
+
+absl::Status Bzip2ReaderBase::DecompressStreams(absl::string_view compressed,
+                                                Chain& dest) {
+  std::unique_ptr<bz_stream, BZStreamDeleter> decompressor(new bz_stream());
+  int bzlib_code = BZ2_bzDecompressInit(decompressor.get(), 0, 0);
+  if (ABSL_PREDICT_FALSE(bzlib_code != BZ_OK)) {
+    delete decompressor.release();  // Skip `BZ2_bzDecompressEnd()`.
+    return BzlibError(absl::StatusCode::kInternal, "BZ2_bzDecompressInit()",
+                      bzlib_code);
+  }
+  const char* const limit = compressed.data() + compressed.size();
+  decompressor->next_in = const_cast<char*>(compressed.data());
+  for (;;) {
+    const absl::Span<char> buffer = dest.AppendBuffer(1, compressed.size());
+    decompressor->next_out = buffer.data();
+    decompressor->avail_out = SaturatingIntCast<unsigned int>(buffer.size());
+    decompressor->avail_in = SaturatingIntCast<unsigned int>(
+        PtrDistance(decompressor->next_in, limit));
+    bzlib_code = BZ2_bzDecompress(decompressor.get());
+    dest.RemoveSuffix(decompressor->avail_out);
+    switch (bzlib_code) {
+      case BZ_OK:
+        if (decompressor->avail_out == 0 || decompressor->next_in != limit) {
+          continue;
+        }
+        return absl::DataLossError("Truncated bzip2-compressed stream");
+      case BZ_STREAM_END:
+        if (decompressor->next_in == limit) return absl::OkStatus();
+        bzlib_code = BZ2_bzDecompressEnd(decompressor.get());
+        if (ABSL_PREDICT_FALSE(bzlib_code != BZ_OK)) {
+          delete decompressor.release();  // Skip `BZ2_bzDecompressEnd()`.
+          return BzlibError(absl::StatusCode::kInternal,
+                            "BZ2_bzDecompressEnd()", bzlib_code);
+        }
+        bzlib_code = BZ2_bzDecompressInit(decompressor.get(), 0, 0);
+        if (ABSL_PREDICT_FALSE(bzlib_code != BZ_OK)) {
+          delete decompressor.release();  // Skip `BZ2_bzDecompressEnd()`.
+          return BzlibError(absl::StatusCode::kInternal,
+                            "BZ2_bzDecompressInit()", bzlib_code);
+        }
+        continue;
+      case BZ_DATA_ERROR:
+      case BZ_DATA_ERROR_MAGIC:
+        return BzlibError(absl::StatusCode::kInvalidArgument,
+                          "BZ2_bzDecompress()", bzlib_code);
+      default:
+        return BzlibError(absl::StatusCode::kInternal, "BZ2_bzDecompress()",
+                          bzlib_code);
+    }
+  }
+}
+
 bool Bzip2ReaderBase::ToleratesReadingAhead() {
   Reader* const src = SrcReader();
   return src != nullptr && src->ToleratesReadingAhead();
@@ -256,6 +503,9 @@ bool Bzip2ReaderBase::SeekBehindBuffer(Position new_pos) {
     set_buffer();
     set_limit_pos(0);
     decompressor_.reset();
+    sequential_ = false;
+    pending_streams_.clear();
+    decompressed_.Reset(std::forward_as_tuple());
     if (ABSL_PREDICT_FALSE(!src.Seek(initial_compressed_pos_))) {
       return FailWithoutAnnotation(AnnotateOverSrc(src.StatusOrAnnotate(
           absl::DataLossError("Bzip2-compressed stream got truncated"))));
@@ -288,6 +538,8 @@ std::unique_ptr<Reader> Bzip2ReaderBase::NewReaderImpl(Position initial_pos) {
           std::move(compressed_reader),
           Bzip2ReaderBase::Options()
               .set_concatenate(concatenate_)
+              .set_parallelism(parallelism_)
+              .set_executor(executor_)
               .set_buffer_options(buffer_options()));
   reader->Seek(initial_pos);
   return reader;
@@ -17,7 +17,10 @@
 
 #include <stddef.h>
 
+#include <deque>
+#include <future>
 #include <memory>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -28,11 +31,14 @@
 #include "absl/strings/string_view.h"
 #include "bzlib.h"
 #include "riegeli/base/assert.h"
+#include "riegeli/base/chain.h"
 #include "riegeli/base/dependency.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/buffered_reader.h"
+#include "riegeli/bytes/chain_reader.h"
 #include "riegeli/bytes/reader.h"
 
 namespace riegeli {
@@ -60,8 +66,51 @@ class Bzip2ReaderBase : public BufferedReader {
     }
     bool concatenate() const { return concatenate_; }
 
+    // Maximum number of groups of concatenated compressed streams being
+    // decompressed ahead in background, if `concatenate()` is `true`.
+    //
+    // Stream boundaries are located by scanning for stream headers, which are
+    // byte-aligned. This is effective for files consisting of many streams,
+    // e.g. written by `pbzip2` or `lbzip2`. Where no stream boundary is found
+    // nearby, data are decompressed in the calling thread.
+    //
+    // If `parallelism()` is 0 or `concatenate()` is `false`, streams are
+    // decompressed in the calling thread when needed.
+    //
+    // Default: 0.
+    Options& set_parallelism(int parallelism) & {
+      RIEGELI_ASSERT_GE(parallelism, 0)
+          << "Failed precondition of "
+             "Bzip2ReaderBase::Options::set_parallelism(): "
+             "negative parallelism";
+      parallelism_ = parallelism;
+      return *this;
+    }
+    Options&& set_parallelism(int parallelism) && {
+      return std::move(set_parallelism(parallelism));
+    }
+    int parallelism() const { return parallelism_; }
+
+    // `Executor` which decompresses streams in background if
+    // `parallelism() > 0`. It is not owned and must outlive the `Bzip2Reader`
+    // and readers returned by `NewReader()`.
+    //
+    // `nullptr` means `Executor::global()`.
+    //
+    // Default: `nullptr`.
+    Options& set_executor(Executor* executor) & {
+      executor_ = executor;
+      return *this;
+    }
+    Options&& set_executor(Executor* executor) && {
+      return std::move(set_executor(executor));
+    }
+    Executor* executor() const { return executor_; }
+
    private:
     bool concatenate_ = false;
+    int parallelism_ = 0;
+    Executor* executor_ = nullptr;
   };
 
   // Returns the compressed `Reader`. Unchanged by `Close()`.
@@ -88,13 +137,15 @@ class Bzip2ReaderBase : public BufferedReader {
   explicit Bzip2ReaderBase(Closed) noexcept : BufferedReader(kClosed) {}
 
   explicit Bzip2ReaderBase(const BufferOptions& buffer_options,
-                           bool concatenate);
+                           bool concatenate, int parallelism,
+                           Executor* executor);
 
   Bzip2ReaderBase(Bzip2ReaderBase&& that) noexcept;
   Bzip2ReaderBase& operator=(Bzip2ReaderBase&& that) noexcept;
 
   void Reset(Closed);
-  void Reset(const BufferOptions& buffer_options, bool concatenate);
+  void Reset(const BufferOptions& buffer_options, bool concatenate,
+             int parallelism, Executor* executor);
   void Initialize(Reader* src);
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateOverSrc(absl::Status status);
 
@@ -116,11 +167,46 @@ class Bzip2ReaderBase : public BufferedReader {
     }
   };
 
+  // The result of decompressing streams in background.
+  struct DecompressedStreams {
+    absl::Status status;
+    Chain data;
+  };
+
+  // Streams being decompressed in background.
+  struct PendingStreams {
+    // Kept in case the streams turn out to continue past `compressed`.
+    std::shared_ptr<const std::string> compressed;
+    std::future<DecompressedStreams> decompressed;
+  };
+
   void InitializeDecompressor();
   ABSL_ATTRIBUTE_COLD bool FailOperation(absl::StatusCode code,
                                          absl::string_view operation,
                                          int bzlib_code);
 
+  // Implementation of `ReadInternal()` using `decompressor_`.
+  bool ReadSequential(size_t min_length, size_t max_length, char* dest);
+  // Implementation of `ReadInternal()` if `parallelism_ > 0`.
+  bool ReadParallel(size_t min_length, size_t max_length, char* dest);
+  // Replaces `decompressed_` with data of the next group of streams.
+  //
+  // Returns `false` at the end of the source, on failure, or if data should
+  // be decompressed with `ReadSequential()` because `sequential_` is `true`.
+  bool NextStreams();
+  // Appends compressed data from the source to `compressed`, from the current
+  // stream boundary to a further stream boundary, or to the end of the source.
+  // Nothing is appended at the end of the source.
+  //
+  // Returns `false` if the source failed, or if no stream boundary was found
+  // within `kMaxSegmentSize` bytes; then the source is not consumed.
+  bool ReadSegment(std::string& compressed);
+  // Decompresses `compressed`, which is expected to consist of complete
+  // concatenated streams, appending to `dest`. Returns `absl::DataLossError()`
+  // if the last stream is incomplete.
+  static absl::Status DecompressStreams(absl::string_view compressed,
+                                        Chain& dest);
+
   bool concatenate_ = false;
   // If `true`, the source is truncated (without a clean end of the compressed
   // stream) at the current position. If the source does not grow, `Close()`
@@ -132,6 +218,19 @@ class Bzip2ReaderBase : public BufferedReader {
   bool stream_had_data_ = false;
   Position initial_compressed_pos_ = 0;
   std::unique_ptr<bz_stream, BZStreamDeleter> decompressor_;
+  // 0 unless `concatenate_`.
+  int parallelism_ = 0;
+  // `nullptr` means `Executor::global()`.
+  Executor* executor_ = nullptr;
+  // If `true`, the stream following `pending_streams_` is decompressed by
+  // `decompressor_` despite `parallelism_ > 0`, because its end was not
+  // located cheaply. This begins after `pending_streams_` and `decompressed_`
+  // are exhausted, and `ReadParallel()` is resumed at the end of the stream.
+  bool sequential_ = false;
+  // Streams being decompressed in background, in the order of their positions.
+  std::deque<PendingStreams> pending_streams_;
+  // Decompressed data not read yet, if `parallelism_ > 0`.
+  ChainReader<Chain> decompressed_{std::forward_as_tuple()};
 };
 
 // A `Reader` which decompresses data with Bzip2 after getting it from another
@@ -221,8 +320,12 @@ bool RecognizeBzip2(Reader& src);
 // Implementation details follow.
 
 inline Bzip2ReaderBase::Bzip2ReaderBase(const BufferOptions& buffer_options,
-                                        bool concatenate)
-    : BufferedReader(buffer_options), concatenate_(concatenate) {}
+                                        bool concatenate, int parallelism,
+                                        Executor* executor)
+    : BufferedReader(buffer_options),
+      concatenate_(concatenate),
+      parallelism_(concatenate ? parallelism : 0),
+      executor_(executor) {}
 
 inline Bzip2ReaderBase::Bzip2ReaderBase(Bzip2ReaderBase&& that) noexcept
     : BufferedReader(static_cast<BufferedReader&&>(that)),
@@ -230,7 +333,12 @@ inline Bzip2ReaderBase::Bzip2ReaderBase(Bzip2ReaderBase&& that) noexcept
       truncated_(that.truncated_),
       stream_had_data_(that.stream_had_data_),
       initial_compressed_pos_(that.initial_compressed_pos_),
-      decompressor_(std::move(that.decompressor_)) {}
+      decompressor_(std::move(that.decompressor_)),
+      parallelism_(that.parallelism_),
+      executor_(that.executor_),
+      sequential_(that.sequential_),
+      pending_streams_(std::move(that.pending_streams_)),
+      decompressed_(std::move(that.decompressed_)) {}
 
 inline Bzip2ReaderBase& Bzip2ReaderBase::operator=(
     Bzip2ReaderBase&& that) noexcept {
@@ -240,6 +348,11 @@ inline Bzip2ReaderBase& Bzip2ReaderBase::operator=(
   stream_had_data_ = that.stream_had_data_;
   initial_compressed_pos_ = that.initial_compressed_pos_;
   decompressor_ = std::move(that.decompressor_);
+  parallelism_ = that.parallelism_;
+  executor_ = that.executor_;
+  sequential_ = that.sequential_;
+  pending_streams_ = std::move(that.pending_streams_);
+  decompressed_ = std::move(that.decompressed_);
   return *this;
 }
 
@@ -250,28 +363,41 @@ inline void Bzip2ReaderBase::Reset(Closed) {
   stream_had_data_ = false;
   initial_compressed_pos_ = 0;
   decompressor_.reset();
+  parallelism_ = 0;
+  executor_ = nullptr;
+  sequential_ = false;
+  pending_streams_.clear();
+  decompressed_.Reset(std::forward_as_tuple());
 }
 
 inline void Bzip2ReaderBase::Reset(const BufferOptions& buffer_options,
-                                   bool concatenate) {
+                                   bool concatenate, int parallelism,
+                                   Executor* executor) {
   BufferedReader::Reset(buffer_options);
   concatenate_ = concatenate;
   truncated_ = false;
   stream_had_data_ = false;
   initial_compressed_pos_ = 0;
   decompressor_.reset();
+  parallelism_ = concatenate ? parallelism : 0;
+  executor_ = executor;
+  sequential_ = false;
+  pending_streams_.clear();
+  decompressed_.Reset(std::forward_as_tuple());
 }
 
 template <typename Src>
 inline Bzip2Reader<Src>::Bzip2Reader(const Src& src, Options options)
-    : Bzip2ReaderBase(options.buffer_options(), options.concatenate()),
+    : Bzip2ReaderBase(options.buffer_options(), options.concatenate(),
+                      options.parallelism(), options.executor()),
       src_(src) {
   Initialize(src_.get());
 }
 
 template <typename Src>
 inline Bzip2Reader<Src>::Bzip2Reader(Src&& src, Options options)
-    : Bzip2ReaderBase(options.buffer_options(), options.concatenate()),
+    : Bzip2ReaderBase(options.buffer_options(), options.concatenate(),
+                      options.parallelism(), options.executor()),
       src_(std::move(src)) {
   Initialize(src_.get());
 }
@@ -280,7 +406,8 @@ template <typename Src>
 template <typename... SrcArgs>
 inline Bzip2Reader<Src>::Bzip2Reader(std::tuple<SrcArgs...> src_args,
                                      Options options)
-    : Bzip2ReaderBase(options.buffer_options(), options.concatenate()),
+    : Bzip2ReaderBase(options.buffer_options(), options.concatenate(),
+                      options.parallelism(), options.executor()),
       src_(std::move(src_args)) {
   Initialize(src_.get());
 }
@@ -306,14 +433,16 @@ inline void Bzip2Reader<Src>::Reset(Closed) {
 
 template <typename Src>
 inline void Bzip2Reader<Src>::Reset(const Src& src, Options options) {
-  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate());
+  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate(),
+                         options.parallelism(), options.executor());
   src_.Reset(src);
   Initialize(src_.get());
 }
 
 template <typename Src>
 inline void Bzip2Reader<Src>::Reset(Src&& src, Options options) {
-  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate());
+  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate(),
+                         options.parallelism(), options.executor());
   src_.Reset(std::move(src));
   Initialize(src_.get());
 }
@@ -322,7 +451,8 @@ template <typename Src>
 template <typename... SrcArgs>
 inline void Bzip2Reader<Src>::Reset(std::tuple<SrcArgs...> src_args,
                                     Options options) {
-  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate());
+  Bzip2ReaderBase::Reset(options.buffer_options(), options.concatenate(),
+                         options.parallelism(), options.executor());
   src_.Reset(std::move(src_args));
   Initialize(src_.get());
 }
@@ -0,0 +1,166 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/bzip2/bzip2_reader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/bzip2/bzip2_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Returns data which are compressible if `compressible`, or random otherwise.
+std::string TestData(size_t size, bool compressible, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    data.push_back(static_cast<char>(compressible ? 'a' + random() % 4
+                                                  : random()));
+  }
+  return data;
+}
+
+// Appends `data` compressed as a separate stream to `compressed`.
+void AppendStream(absl::string_view data, std::string& compressed) {
+  Bzip2Writer<StringWriter<>> writer(
+      std::forward_as_tuple(&compressed, StringWriterBase::Options().set_append(
+                                             true)),
+      Bzip2WriterBase::Options().set_compression_level(1));
+  ASSERT_TRUE(writer.Write(data)) << writer.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+}
+
+template <typename Src>
+std::string Decompress(Src&& src, int parallelism, size_t read_size) {
+  Bzip2Reader<std::decay_t<Src>> reader(
+      std::forward<Src>(src), Bzip2ReaderBase::Options()
+                                  .set_concatenate(true)
+                                  .set_parallelism(parallelism));
+  std::string decompressed;
+  std::string fragment;
+  while (reader.Read(read_size, fragment)) decompressed.append(fragment);
+  decompressed.append(fragment);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  return decompressed;
+}
+
+TEST(Bzip2ReaderTest, ConcatenatedStreams) {
+  std::string data;
+  std::string compressed;
+  for (uint32_t i = 0; i < 12; ++i) {
+    const std::string stream_data = TestData(100000 + i * 1000, true, i);
+    AppendStream(stream_data, compressed);
+    data.append(stream_data);
+  }
+  for (const int parallelism : {0, 1, 4}) {
+    for (const size_t read_size : {size_t{1000}, size_t{1} << 20}) {
+      EXPECT_EQ(Decompress(StringReader<>(compressed), parallelism, read_size),
+                data)
+          << "parallelism " << parallelism << ", read size " << read_size;
+    }
+  }
+}
+
+// A stream whose compressed size exceeds the distance at which stream
+// boundaries are searched for is decompressed in the calling thread, after
+// streams queued for decompression in background.
+//
+// The source is a file, so that stream boundaries are searched for in a
+// limited window rather than in the whole source.
+TEST(Bzip2ReaderTest, ConcatenatedStreamsWithoutNearbyBoundary) {
+  std::string data;
+  std::string compressed;
+  uint32_t seed = 0;
+  const auto append_stream = [&](size_t size, bool compressible) {
+    const std::string stream_data = TestData(size, compressible, ++seed);
+    AppendStream(stream_data, compressed);
+    data.append(stream_data);
+  };
+  // Streams of incompressible data larger than the minimum segment size.
+  for (int i = 0; i < 4; ++i) append_stream(300 << 10, false);
+  // A stream larger than the maximum segment size.
+  append_stream(17 << 20, false);
+  for (int i = 0; i < 4; ++i) append_stream(300 << 10, false);
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/concatenated.bz2");
+  FdWriter<> file_writer(filename);
+  ASSERT_TRUE(file_writer.Write(compressed)) << file_writer.status();
+  ASSERT_TRUE(file_writer.Close()) << file_writer.status();
+  for (const int parallelism : {0, 4}) {
+    for (const size_t read_size : {size_t{1000}, size_t{1} << 20}) {
+      const std::string decompressed =
+          Decompress(FdReader<>(filename), parallelism, read_size);
+      EXPECT_EQ(decompressed.size(), data.size());
+      EXPECT_TRUE(decompressed == data)
+          << "parallelism " << parallelism << ", read size " << read_size;
+    }
+  }
+}
+
+TEST(Bzip2ReaderTest, SeekBackwardsWithParallelism) {
+  std::string data;
+  std::string compressed;
+  for (uint32_t i = 0; i < 8; ++i) {
+    const std::string stream_data = TestData(100000, true, i);
+    AppendStream(stream_data, compressed);
+    data.append(stream_data);
+  }
+  Bzip2Reader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      Bzip2ReaderBase::Options().set_concatenate(true).set_parallelism(3));
+  std::string fragment;
+  ASSERT_TRUE(reader.Seek(500000)) << reader.status();
+  ASSERT_TRUE(reader.Read(1000, fragment)) << reader.status();
+  EXPECT_EQ(fragment, absl::string_view(data).substr(500000, 1000));
+  ASSERT_TRUE(reader.Seek(1000)) << reader.status();
+  ASSERT_TRUE(reader.Read(1000, fragment)) << reader.status();
+  EXPECT_EQ(fragment, absl::string_view(data).substr(1000, 1000));
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST(Bzip2ReaderTest, TruncatedStreamFails) {
+  std::string compressed;
+  AppendStream(TestData(100000, true, 1), compressed);
+  AppendStream(TestData(100000, true, 2), compressed);
+  compressed.resize(compressed.size() - 10);
+  for (const int parallelism : {0, 2}) {
+    Bzip2Reader<StringReader<>> reader(
+        std::forward_as_tuple(compressed), Bzip2ReaderBase::Options()
+                                               .set_concatenate(true)
+                                               .set_parallelism(parallelism));
+    std::string decompressed;
+    ReadAll(reader, decompressed).IgnoreError();
+    EXPECT_FALSE(reader.Close()) << "parallelism " << parallelism;
+  }
+}
+
+}  // namespace
+}  // namespace riegeli
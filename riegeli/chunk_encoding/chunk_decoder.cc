@@ -24,6 +24,7 @@
 #include "absl/base/optimization.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/message_lite.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
@@ -161,21 +162,38 @@ inline bool ChunkDecoder::Parse(const ChunkHeader& header, Reader& src,
 
 bool ChunkDecoder::ReadRecord(google::protobuf::MessageLite& record) {
   if (ABSL_PREDICT_FALSE(!ok() || index() == num_records())) return false;
+  return ParseRecord(record);
+}
+
+bool ChunkDecoder::ReadRecord(const google::protobuf::MessageLite& prototype,
+                              google::protobuf::Arena* arena,
+                              google::protobuf::MessageLite*& record) {
+  if (ABSL_PREDICT_FALSE(!ok() || index() == num_records())) return false;
+  google::protobuf::MessageLite* const message = prototype.New(arena);
+  if (ABSL_PREDICT_FALSE(!ParseRecord(*message))) {
+    if (arena == nullptr) delete message;
+    return false;
+  }
+  record = message;
+  return true;
+}
+
+inline bool ChunkDecoder::ParseRecord(google::protobuf::MessageLite& record) {
   const size_t start = IntCast<size_t>(values_reader_.pos());
   const size_t limit = limits_[IntCast<size_t>(index_)];
   RIEGELI_ASSERT_LE(start, limit)
       << "Failed invariant of ChunkDecoder: record end positions not sorted";
-  {
-    absl::Status status =
-        ParseFromReaderWithLength(values_reader_, limit - start, record);
-    if (ABSL_PREDICT_FALSE(!status.ok())) {
-      if (!values_reader_.Seek(limit)) {
-        RIEGELI_ASSERT_UNREACHABLE()
-            << "Seeking record values failed: " << values_reader_.status();
-      }
-      recoverable_ = true;
-      return Fail(std::move(status));
-    }
+  // Parsing directly from blocks of the `Chain` avoids going through
+  // `values_reader_` when the record spans block boundaries.
+  absl::Status status =
+      ParseFromChain(values_reader_.src(), start, limit - start, record);
+  if (!values_reader_.Seek(limit)) {
+    RIEGELI_ASSERT_UNREACHABLE()
+        << "Seeking record values failed: " << values_reader_.status();
+  }
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    recoverable_ = true;
+    return Fail(std::move(status));
   }
   ++index_;
   return true;
@@ -28,6 +28,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/message_lite.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
@@ -113,6 +114,18 @@ class ChunkDecoder : public Object {
   bool ReadRecord(Chain& record);
   bool ReadRecord(absl::Cord& record);
 
+  // Like `ReadRecord(google::protobuf::MessageLite&)`, but parses into a new
+  // message of the same type as `prototype`, allocated on `arena`, or on the
+  // heap and owned by the caller if `arena == nullptr`.
+  //
+  // Return values:
+  //  * `true`                 - success (`record` is set, `ok()`)
+  //  * `false` (when `ok()`)  - chunk ends
+  //  * `false` (when `!ok()`) - failure
+  bool ReadRecord(const google::protobuf::MessageLite& prototype,
+                  google::protobuf::Arena* arena,
+                  google::protobuf::MessageLite*& record);
+
   // If `!ok()` and the failure was caused by an unparsable message, then
   // `Recover()` allows reading again by skipping the unparsable message.
   //
@@ -142,6 +155,10 @@ class ChunkDecoder : public Object {
 
  private:
   bool Parse(const ChunkHeader& header, Reader& src, Chain& dest);
+  // Parses the record at `index_` and skips it.
+  //
+  // Precondition: `ok() && index() < num_records()`
+  bool ParseRecord(google::protobuf::MessageLite& record);
 
   FieldProjection field_projection_;
   // Invariants if `ok()`:
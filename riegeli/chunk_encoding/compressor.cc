@@ -26,8 +26,10 @@
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/brotli/brotli_writer.h"
+#include "riegeli/bytes/buffered_writer.h"
 #include "riegeli/bytes/chain_writer.h"
 #include "riegeli/bytes/writer.h"
 #include "riegeli/chunk_encoding/compressor_options.h"
@@ -68,7 +70,8 @@ inline void Compressor::Initialize() {
           std::forward_as_tuple(&compressed_),
           BrotliWriterBase::Options()
               .set_compression_level(compressor_options_.compression_level())
-              .set_window_log(compressor_options_.brotli_window_log()));
+              .set_window_log(compressor_options_.brotli_window_log())
+              .set_memory_budget(compressor_options_.memory_budget()));
       return;
     case CompressionType::kZstd:
       writer_ = std::make_unique<ZstdWriter<ChainWriter<>>>(
@@ -76,7 +79,8 @@ inline void Compressor::Initialize() {
           ZstdWriterBase::Options()
               .set_compression_level(compressor_options_.compression_level())
               .set_window_log(compressor_options_.zstd_window_log())
-              .set_pledged_size(tuning_options_.pledged_size()));
+              .set_pledged_size(tuning_options_.pledged_size())
+              .set_memory_budget(compressor_options_.memory_budget()));
       return;
     case CompressionType::kSnappy:
       writer_ = std::make_unique<SnappyWriter<ChainWriter<>>>(
@@ -94,10 +98,39 @@ inline void Compressor::SetWriteSizeHint() {
                                 : tuning_options_.size_hint());
 }
 
+inline bool Compressor::CloseWriter() {
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) {
+    if (ABSL_PREDICT_FALSE(!writer_->Close())) return Fail(writer_->status());
+    return true;
+  }
+  CodecStats stats;
+  stats.bytes_in = IntCast<uint64_t>(writer_->pos());
+  switch (compressor_options_.compression_type()) {
+    case CompressionType::kBrotli:
+    case CompressionType::kZstd:
+      // Compression happens in `BufferedWriter::WriteInternal()`.
+      stats.time_ns =
+          static_cast<const BufferedWriter&>(*writer_).stats().time_ns;
+      break;
+    case CompressionType::kNone:
+    case CompressionType::kSnappy:
+      // No compression, or compression happens in `Close()`.
+      break;
+  }
+  const uint64_t start_ns = stats_internal::Now_ns();
+  const bool close_ok = writer_->Close();
+  stats.time_ns += stats_internal::Now_ns() - start_ns;
+  if (ABSL_PREDICT_FALSE(!close_ok)) return Fail(writer_->status());
+  stats.bytes_out = compressed_.size();
+  stats_ += stats;
+  stats_internal::AddToProcessStats(&ProcessStats::compression, stats);
+  return true;
+}
+
 bool Compressor::EncodeAndClose(Writer& dest) {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   const Position uncompressed_size = writer().pos();
-  if (ABSL_PREDICT_FALSE(!writer().Close())) return Fail(writer().status());
+  if (ABSL_PREDICT_FALSE(!CloseWriter())) return false;
   if (compressor_options_.compression_type() != CompressionType::kNone) {
     if (ABSL_PREDICT_FALSE(
             !WriteVarint64(IntCast<uint64_t>(uncompressed_size), dest))) {
@@ -113,7 +146,7 @@ bool Compressor::EncodeAndClose(Writer& dest) {
 bool Compressor::LengthPrefixedEncodeAndClose(Writer& dest) {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   const Position uncompressed_size = writer().pos();
-  if (ABSL_PREDICT_FALSE(!writer().Close())) return Fail(writer().status());
+  if (ABSL_PREDICT_FALSE(!CloseWriter())) return false;
   uint64_t compressed_size = compressed_.size();
   if (compressor_options_.compression_type() != CompressionType::kNone) {
     compressed_size += LengthVarint64(IntCast<uint64_t>(uncompressed_size));
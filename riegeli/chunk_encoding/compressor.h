@@ -23,6 +23,7 @@
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/writer.h"
 #include "riegeli/chunk_encoding/compressor_options.h"
@@ -112,14 +113,21 @@ class Compressor : public Object {
   // size.
   bool LengthPrefixedEncodeAndClose(Writer& dest);
 
+  // Returns statistics of compression by `{,LengthPrefixed}EncodeAndClose()`
+  // calls so far, collected while `StatsEnabled()`. Unchanged by `Clear()`.
+  const CodecStats& stats() const { return stats_; }
+
  private:
   void Initialize();
   void SetWriteSizeHint();
+  // Closes `writer()`, updating `stats_` if `StatsEnabled()`.
+  bool CloseWriter();
 
   CompressorOptions compressor_options_;
   TuningOptions tuning_options_;
   Chain compressed_;
   std::unique_ptr<Writer> writer_;
+  CodecStats stats_;
 };
 
 // Implementation details follow.
@@ -28,6 +28,8 @@
 
 namespace riegeli {
 
+class MemoryBudget;
+
 class CompressorOptions {
  public:
   CompressorOptions() noexcept {}
@@ -172,6 +174,22 @@ class CompressorOptions {
   }
   absl::optional<int> window_log() const { return window_log_; }
 
+  // `MemoryBudget` from which buffers of the compressor are drawn, see
+  // `BufferOptions::set_memory_budget()`. It is not owned and must outlive
+  // the compressor.
+  //
+  // `nullptr` means that the buffers are not limited by a budget.
+  //
+  // Default: `nullptr`.
+  CompressorOptions& set_memory_budget(MemoryBudget* memory_budget) & {
+    memory_budget_ = memory_budget;
+    return *this;
+  }
+  CompressorOptions&& set_memory_budget(MemoryBudget* memory_budget) && {
+    return std::move(set_memory_budget(memory_budget));
+  }
+  MemoryBudget* memory_budget() const { return memory_budget_; }
+
   // Returns `window_log()` translated for `BrotliWriter`.
   //
   // Precondition: `compression_type() == CompressionType::kBrotli`
@@ -186,6 +204,7 @@ class CompressorOptions {
   CompressionType compression_type_ = CompressionType::kBrotli;
   int compression_level_ = kDefaultBrotli;
   absl::optional<int> window_log_;
+  MemoryBudget* memory_budget_ = nullptr;
 };
 
 }  // namespace riegeli
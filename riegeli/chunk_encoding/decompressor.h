@@ -32,6 +32,8 @@
 #include "riegeli/base/chain.h"
 #include "riegeli/base/dependency.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
+#include "riegeli/base/types.h"
 #include "riegeli/brotli/brotli_reader.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/chunk_encoding/constants.h"
@@ -108,16 +110,24 @@ class Decompressor : public Object {
   // `Decompressor` if not.
   void VerifyEnd();
 
+  // Returns statistics of decompression, collected while `StatsEnabled()`.
+  // They are complete after `Close()`.
+  const CodecStats& stats() const { return stats_; }
+
  protected:
   void Done() override;
 
  private:
   template <typename SrcInit>
   void Initialize(SrcInit&& src_init, CompressionType compression_type);
+  void UpdateStats();
 
   AnyDependency<Reader*, Src, BrotliReader<Src>, ZstdReader<Src>,
                 SnappyReader<Src>>
       decompressed_;
+  CompressionType compression_type_ = CompressionType::kNone;
+  Position initial_compressed_pos_ = 0;
+  CodecStats stats_;
 };
 
 // Implementation details follow.
@@ -145,6 +155,9 @@ template <typename Src>
 inline void Decompressor<Src>::Reset(Closed) {
   Object::Reset(kClosed);
   decompressed_.Reset();
+  compression_type_ = CompressionType::kNone;
+  initial_compressed_pos_ = 0;
+  stats_ = CodecStats();
 }
 
 template <typename Src>
@@ -173,12 +186,16 @@ template <typename Src>
 template <typename SrcInit>
 void Decompressor<Src>::Initialize(SrcInit&& src_init,
                                    CompressionType compression_type) {
+  compression_type_ = compression_type;
+  stats_ = CodecStats();
   if (compression_type == CompressionType::kNone) {
     decompressed_.Reset(absl::in_place_type<Src>,
                         std::forward<SrcInit>(src_init));
+    initial_compressed_pos_ = decompressed_->pos();
     return;
   }
   Dependency<Reader*, Src> compressed_reader(std::forward<SrcInit>(src_init));
+  initial_compressed_pos_ = compressed_reader->pos();
   uint64_t uncompressed_size;
   if (ABSL_PREDICT_FALSE(
           !ReadVarint64(*compressed_reader, uncompressed_size))) {
@@ -197,10 +214,17 @@ void Decompressor<Src>::Initialize(SrcInit&& src_init,
       decompressed_.template Emplace<ZstdReader<Src>>(
           std::move(compressed_reader.manager()));
       return;
-    case CompressionType::kSnappy:
+    case CompressionType::kSnappy: {
+      // `SnappyReader` decompresses everything in its constructor.
+      const bool stats_enabled = StatsEnabled();
+      const uint64_t start_ns = stats_enabled ? stats_internal::Now_ns() : 0;
       decompressed_.template Emplace<SnappyReader<Src>>(
           std::move(compressed_reader.manager()));
+      if (ABSL_PREDICT_FALSE(stats_enabled)) {
+        stats_.time_ns += stats_internal::Now_ns() - start_ns;
+      }
       return;
+    }
   }
   Fail(absl::UnimplementedError(absl::StrCat(
       "Unknown compression type: ", static_cast<unsigned>(compression_type))));
@@ -215,11 +239,49 @@ inline Reader& Decompressor<Src>::reader() {
 
 template <typename Src>
 void Decompressor<Src>::Done() {
+  if (ABSL_PREDICT_FALSE(StatsEnabled()) && ABSL_PREDICT_TRUE(ok())) {
+    UpdateStats();
+  }
   if (ABSL_PREDICT_FALSE(!decompressed_->Close())) {
     Fail(decompressed_->status());
   }
 }
 
+template <typename Src>
+void Decompressor<Src>::UpdateStats() {
+  const Reader* compressed_reader = nullptr;
+  Position decompressed_pos = decompressed_->pos();
+  switch (compression_type_) {
+    case CompressionType::kNone:
+      compressed_reader = decompressed_.get();
+      decompressed_pos -= initial_compressed_pos_;
+      break;
+    case CompressionType::kBrotli: {
+      const BrotliReaderBase& brotli_reader =
+          static_cast<const BrotliReaderBase&>(*decompressed_);
+      compressed_reader = brotli_reader.SrcReader();
+      stats_.time_ns += brotli_reader.stats().time_ns;
+      break;
+    }
+    case CompressionType::kZstd: {
+      // Decompression happens in `BufferedReader::ReadInternal()`.
+      const ZstdReaderBase& zstd_reader =
+          static_cast<const ZstdReaderBase&>(*decompressed_);
+      compressed_reader = zstd_reader.SrcReader();
+      stats_.time_ns += zstd_reader.stats().time_ns;
+      break;
+    }
+    case CompressionType::kSnappy:
+      compressed_reader =
+          static_cast<const SnappyReaderBase&>(*decompressed_).SrcReader();
+      break;
+  }
+  if (ABSL_PREDICT_FALSE(compressed_reader == nullptr)) return;
+  stats_.bytes_in = compressed_reader->pos() - initial_compressed_pos_;
+  stats_.bytes_out = decompressed_pos;
+  stats_internal::AddToProcessStats(&ProcessStats::decompression, stats_);
+}
+
 template <typename Src>
 inline bool Decompressor<Src>::VerifyEndAndClose() {
   VerifyEnd();
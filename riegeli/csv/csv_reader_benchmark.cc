@@ -0,0 +1,65 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of `CsvReader` reading plain and quoted fields.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/csv/csv_reader.h"
+
+namespace riegeli {
+namespace {
+
+// Returns about 1 MiB of records of 8 fields of 16 characters. If `quoted`,
+// fields are quoted and contain escaped quotes and field separators.
+std::string Records(bool quoted) {
+  const std::string field =
+      quoted ? absl::StrCat("\"", std::string(5, 'a'), "\"\",",
+                            std::string(8, 'a'), "\"")
+             : std::string(16, 'a');
+  std::string record;
+  for (int i = 0; i < 8; ++i) {
+    if (i > 0) record.push_back(',');
+    record.append(field);
+  }
+  record.push_back('\n');
+  std::string records;
+  while (records.size() < (size_t{1} << 20)) records.append(record);
+  return records;
+}
+
+// Reads all records, plain if `state.range(0)` is 0, quoted otherwise.
+void BM_CsvReader(benchmark::State& state) {
+  const std::string src = Records(state.range(0) != 0);
+  std::vector<std::string> record;
+  for (auto _ : state) {
+    CsvReader<StringReader<>> reader(std::forward_as_tuple(src));
+    while (reader.ReadRecord(record)) benchmark::DoNotOptimize(record);
+    reader.Close();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(src.size()));
+}
+BENCHMARK(BM_CsvReader)->ArgName("quoted")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace riegeli
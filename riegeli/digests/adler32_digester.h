@@ -0,0 +1,75 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_ADLER32_DIGESTER_H_
+#define RIEGELI_DIGESTS_ADLER32_DIGESTER_H_
+
+#include <stdint.h>
+
+#include "absl/strings/string_view.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/types.h"
+#include "zconf.h"
+#include "zlib.h"
+
+namespace riegeli {
+
+// A Digester computing Adler32 checksums, as used by zlib, for
+// `DigestingReader` and `DigestingWriter`.
+//
+// `Adler32Digester` is combinable: checksums of consecutive parts of data,
+// computed independently, e.g. concurrently, can be combined with `Combine()`
+// into the checksum of the whole data.
+class Adler32Digester {
+ public:
+  Adler32Digester() = default;
+
+  Adler32Digester(const Adler32Digester& that) = default;
+  Adler32Digester& operator=(const Adler32Digester& that) = default;
+
+  void Write(absl::string_view src);
+
+  uint32_t Digest() const { return adler_; }
+
+  // Given `adler` of some data and `that_adler` of `that_length` bytes of data
+  // following them, returns the checksum of the concatenation.
+  static uint32_t Combine(uint32_t adler, uint32_t that_adler,
+                          Position that_length);
+
+ private:
+  // The modulus of Adler32 sums.
+  static constexpr uint32_t kModulus = 65521;
+
+  uint32_t adler_ = 1;
+};
+
+// Implementation details follow.
+
+inline void Adler32Digester::Write(absl::string_view src) {
+  adler_ = IntCast<uint32_t>(
+      adler32_z(adler_, reinterpret_cast<const Bytef*>(src.data()),
+                src.size()));
+}
+
+inline uint32_t Adler32Digester::Combine(uint32_t adler, uint32_t that_adler,
+                                         Position that_length) {
+  // The result depends on `that_length` only modulo `kModulus`, which fits in
+  // `z_off_t`.
+  return IntCast<uint32_t>(adler32_combine(
+      adler, that_adler, IntCast<z_off_t>(that_length % kModulus)));
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_ADLER32_DIGESTER_H_
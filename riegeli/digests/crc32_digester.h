@@ -0,0 +1,82 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_CRC32_DIGESTER_H_
+#define RIEGELI_DIGESTS_CRC32_DIGESTER_H_
+
+#include <stdint.h>
+
+#include "absl/strings/string_view.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/types.h"
+#include "riegeli/digests/crc_internal.h"
+#include "zconf.h"
+#include "zlib.h"
+
+namespace riegeli {
+
+// A Digester computing CRC32 checksums, as used by zlib and gzip, for
+// `DigestingReader` and `DigestingWriter`.
+//
+// Checksums are computed by zlib, which uses hardware acceleration where the
+// zlib build supports it.
+//
+// `Crc32Digester` is combinable: checksums of consecutive parts of data,
+// computed independently, e.g. concurrently, can be combined with `Combine()`
+// into the checksum of the whole data.
+class Crc32Digester {
+ public:
+  Crc32Digester() = default;
+
+  Crc32Digester(const Crc32Digester& that) = default;
+  Crc32Digester& operator=(const Crc32Digester& that) = default;
+
+  void Write(absl::string_view src);
+  void WriteZeros(Position length);
+
+  uint32_t Digest() const { return crc_; }
+
+  // Given `crc` of some data and `that_crc` of `that_length` bytes of data
+  // following them, returns the checksum of the concatenation.
+  static uint32_t Combine(uint32_t crc, uint32_t that_crc,
+                          Position that_length);
+
+ private:
+  uint32_t crc_ = 0;
+};
+
+// Implementation details follow.
+
+inline void Crc32Digester::Write(absl::string_view src) {
+  crc_ = IntCast<uint32_t>(
+      crc32_z(crc_, reinterpret_cast<const Bytef*>(src.data()), src.size()));
+}
+
+inline void Crc32Digester::WriteZeros(Position length) {
+  if (length == 0) return;
+  // Advance the CRC register, i.e. the checksum with the final xor undone,
+  // over zeros, and apply the final xor again.
+  crc_ = crc_internal::CrcCombine(crc_internal::kCrc32Polynomial,
+                                  crc_ ^ 0xffffffff, 0xffffffff, length);
+}
+
+inline uint32_t Crc32Digester::Combine(uint32_t crc, uint32_t that_crc,
+                                       Position that_length) {
+  return crc_internal::CrcCombine(crc_internal::kCrc32Polynomial, crc,
+                                  that_crc, that_length);
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_CRC32_DIGESTER_H_
@@ -20,11 +20,17 @@
 #include "absl/strings/string_view.h"
 #include "crc32c/crc32c.h"
 #include "riegeli/base/arithmetic.h"
+#include "riegeli/base/types.h"
+#include "riegeli/digests/crc_internal.h"
 
 namespace riegeli {
 
 // A Digester computing CRC32C checksums, for `DigestingReader` and
 // `DigestingWriter`.
+//
+// `Crc32cDigester` is combinable: checksums of consecutive parts of data,
+// computed independently, e.g. concurrently, can be combined with `Combine()`
+// into the checksum of the whole data.
 class Crc32cDigester {
  public:
   Crc32cDigester() = default;
@@ -33,9 +39,15 @@ class Crc32cDigester {
   Crc32cDigester& operator=(const Crc32cDigester& that) = default;
 
   void Write(absl::string_view src);
+  void WriteZeros(Position length);
 
   uint32_t Digest() const { return crc_; }
 
+  // Given `crc` of some data and `that_crc` of `that_length` bytes of data
+  // following them, returns the checksum of the concatenation.
+  static uint32_t Combine(uint32_t crc, uint32_t that_crc,
+                          Position that_length);
+
  private:
   uint32_t crc_ = 0;
 };
@@ -47,6 +59,20 @@ inline void Crc32cDigester::Write(absl::string_view src) {
                         src.size());
 }
 
+inline void Crc32cDigester::WriteZeros(Position length) {
+  if (length == 0) return;
+  // Advance the CRC register, i.e. the checksum with the final xor undone,
+  // over zeros, and apply the final xor again.
+  crc_ = crc_internal::CrcCombine(crc_internal::kCrc32cPolynomial,
+                                  crc_ ^ 0xffffffff, 0xffffffff, length);
+}
+
+inline uint32_t Crc32cDigester::Combine(uint32_t crc, uint32_t that_crc,
+                                        Position that_length) {
+  return crc_internal::CrcCombine(crc_internal::kCrc32cPolynomial, crc,
+                                  that_crc, that_length);
+}
+
 }  // namespace riegeli
 
 #endif  // RIEGELI_DIGESTS_CRC32C_DIGESTER_H_
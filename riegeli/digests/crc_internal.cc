@@ -0,0 +1,74 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/digests/crc_internal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "riegeli/base/types.h"
+
+namespace riegeli {
+namespace crc_internal {
+
+namespace {
+
+// Operators on CRC states are 32x32 matrices over GF(2), stored as columns.
+
+inline uint32_t MatrixTimes(const uint32_t* matrix, uint32_t vector) {
+  uint32_t sum = 0;
+  for (; vector != 0; vector >>= 1, ++matrix) {
+    if ((vector & 1) != 0) sum ^= *matrix;
+  }
+  return sum;
+}
+
+inline void MatrixSquare(const uint32_t* matrix, uint32_t* square) {
+  for (size_t i = 0; i < 32; ++i) square[i] = MatrixTimes(matrix, matrix[i]);
+}
+
+}  // namespace
+
+uint32_t CrcCombine(uint32_t polynomial, uint32_t crc, uint32_t that_crc,
+                    Position that_length) {
+  // This is the algorithm of `crc32_combine()` from zlib: `crc` is advanced
+  // over `that_length` zero bytes by applying powers of the operator which
+  // advances it over one zero bit, then `that_crc` is added.
+  if (that_length == 0) return crc;
+  uint32_t odd[32];
+  uint32_t even[32];
+  // The operator for one zero bit.
+  odd[0] = polynomial;
+  for (size_t i = 1; i < 32; ++i) odd[i] = uint32_t{1} << (i - 1);
+  // The operator for two zero bits.
+  MatrixSquare(odd, even);
+  // The operator for four zero bits.
+  MatrixSquare(even, odd);
+  // Apply operators for powers of two zero bytes selected by bits of
+  // `that_length`, starting from one zero byte.
+  for (;;) {
+    MatrixSquare(odd, even);
+    if ((that_length & 1) != 0) crc = MatrixTimes(even, crc);
+    that_length >>= 1;
+    if (that_length == 0) break;
+    MatrixSquare(even, odd);
+    if ((that_length & 1) != 0) crc = MatrixTimes(odd, crc);
+    that_length >>= 1;
+    if (that_length == 0) break;
+  }
+  return crc ^ that_crc;
+}
+
+}  // namespace crc_internal
+}  // namespace riegeli
@@ -0,0 +1,43 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_CRC_INTERNAL_H_
+#define RIEGELI_DIGESTS_CRC_INTERNAL_H_
+
+#include <stdint.h>
+
+#include "riegeli/base/types.h"
+
+namespace riegeli {
+namespace crc_internal {
+
+// Reflected CRC-32 polynomial used by zlib and gzip.
+constexpr uint32_t kCrc32Polynomial = 0xedb88320;
+
+// Reflected CRC-32C (Castagnoli) polynomial.
+constexpr uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+// Given `crc` of some data and `that_crc` of `that_length` bytes of data
+// following them, returns the CRC of the concatenation, for a reflected 32-bit
+// CRC with the given polynomial, with the initial value and the final xor both
+// all ones.
+//
+// This takes O(log(that_length)) time, independently of the length of data.
+uint32_t CrcCombine(uint32_t polynomial, uint32_t crc, uint32_t that_crc,
+                    Position that_length);
+
+}  // namespace crc_internal
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_CRC_INTERNAL_H_
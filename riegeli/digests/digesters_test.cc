@@ -0,0 +1,229 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <string>
+#include <tuple>
+
+#include "absl/numeric/int128.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/digests/adler32_digester.h"
+#include "riegeli/digests/crc32_digester.h"
+#include "riegeli/digests/crc_internal.h"
+#include "riegeli/digests/digesting_writer.h"
+#include "riegeli/digests/sha256_digester.h"
+#include "riegeli/digests/xxhash_digester.h"
+
+namespace riegeli {
+namespace {
+
+constexpr absl::string_view kCheckString = "123456789";
+constexpr Position kNumZeros = 100000;
+
+// Computes a reflected 32-bit CRC one bit at a time, as a reference for
+// `crc_internal::CrcCombine()`.
+uint32_t BitwiseCrc(uint32_t polynomial, absl::string_view data) {
+  uint32_t crc = 0xffffffff;
+  for (const char ch : data) {
+    crc ^= static_cast<unsigned char>(ch);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? polynomial : 0);
+    }
+  }
+  return crc ^ 0xffffffff;
+}
+
+// "abc" followed by `kNumZeros` zeros.
+std::string AbcAndZeros() {
+  std::string data = "abc";
+  data.append(kNumZeros, '\0');
+  return data;
+}
+
+// Writes "abc" followed by `kNumZeros` zeros through a `DigestingWriter`, using
+// `Writer::WriteZeros()`, and returns the digest.
+template <typename Digester>
+typename DigestingWriter<Digester, StringWriter<>>::DigestType
+DigestAbcAndZeros() {
+  std::string dest;
+  DigestingWriter<Digester, StringWriter<>> writer(
+      std::forward_as_tuple(&dest));
+  EXPECT_TRUE(writer.Write("abc")) << writer.status();
+  EXPECT_TRUE(writer.WriteZeros(kNumZeros)) << writer.status();
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  EXPECT_TRUE(dest == AbcAndZeros());
+  return writer.Digest();
+}
+
+TEST(CrcCombineTest, KnownValues) {
+  EXPECT_EQ(BitwiseCrc(crc_internal::kCrc32Polynomial, kCheckString),
+            0xcbf43926u);
+  EXPECT_EQ(BitwiseCrc(crc_internal::kCrc32cPolynomial, kCheckString),
+            0xe3069283u);
+}
+
+TEST(CrcCombineTest, CombinesSplits) {
+  for (const uint32_t polynomial :
+       {crc_internal::kCrc32Polynomial, crc_internal::kCrc32cPolynomial}) {
+    const uint32_t expected = BitwiseCrc(polynomial, kCheckString);
+    for (size_t split = 0; split <= kCheckString.size(); ++split) {
+      const absl::string_view first = kCheckString.substr(0, split);
+      const absl::string_view second = kCheckString.substr(split);
+      EXPECT_EQ(crc_internal::CrcCombine(polynomial,
+                                         BitwiseCrc(polynomial, first),
+                                         BitwiseCrc(polynomial, second),
+                                         second.size()),
+                expected)
+          << "Polynomial: " << polynomial << ", split: " << split;
+    }
+  }
+}
+
+TEST(CrcCombineTest, LongSecondPart) {
+  const std::string data = AbcAndZeros();
+  const absl::string_view zeros = absl::string_view(data).substr(3);
+  for (const uint32_t polynomial :
+       {crc_internal::kCrc32Polynomial, crc_internal::kCrc32cPolynomial}) {
+    EXPECT_EQ(crc_internal::CrcCombine(polynomial,
+                                       BitwiseCrc(polynomial, "abc"),
+                                       BitwiseCrc(polynomial, zeros),
+                                       zeros.size()),
+              BitwiseCrc(polynomial, data))
+        << "Polynomial: " << polynomial;
+  }
+}
+
+TEST(Crc32DigesterTest, KnownValue) {
+  Crc32Digester digester;
+  EXPECT_EQ(digester.Digest(), 0u);
+  digester.Write(kCheckString);
+  EXPECT_EQ(digester.Digest(), 0xcbf43926u);
+}
+
+TEST(Crc32DigesterTest, WriteZeros) {
+  Crc32Digester digester;
+  digester.WriteZeros(0);
+  EXPECT_EQ(digester.Digest(), 0u);
+  digester.WriteZeros(kNumZeros);
+  EXPECT_EQ(digester.Digest(), 0xd411957du);
+
+  Crc32Digester abc_digester;
+  abc_digester.Write("abc");
+  abc_digester.WriteZeros(kNumZeros);
+  EXPECT_EQ(abc_digester.Digest(), 0xfdb8c45du);
+  EXPECT_EQ(DigestAbcAndZeros<Crc32Digester>(), 0xfdb8c45du);
+}
+
+TEST(Crc32DigesterTest, Combine) {
+  Crc32Digester first;
+  first.Write("1234");
+  Crc32Digester second;
+  second.Write("56789");
+  EXPECT_EQ(Crc32Digester::Combine(first.Digest(), second.Digest(), 5),
+            0xcbf43926u);
+  EXPECT_EQ(Crc32Digester::Combine(first.Digest(), 0, 0), first.Digest());
+}
+
+TEST(Adler32DigesterTest, KnownValue) {
+  Adler32Digester digester;
+  EXPECT_EQ(digester.Digest(), 1u);
+  digester.Write("Wikipedia");
+  EXPECT_EQ(digester.Digest(), 0x11e60398u);
+}
+
+TEST(Adler32DigesterTest, WriteZeros) {
+  EXPECT_EQ(DigestAbcAndZeros<Adler32Digester>(), 0x3f0b0127u);
+}
+
+TEST(Adler32DigesterTest, Combine) {
+  Adler32Digester first;
+  first.Write("Wiki");
+  Adler32Digester second;
+  second.Write("pedia");
+  EXPECT_EQ(Adler32Digester::Combine(first.Digest(), second.Digest(), 5),
+            0x11e60398u);
+  // The length of the second part exceeds the modulus of Adler32 sums.
+  Adler32Digester abc;
+  abc.Write("abc");
+  EXPECT_EQ(Adler32Digester::Combine(abc.Digest(), 0x86af0001, kNumZeros),
+            0x3f0b0127u);
+}
+
+TEST(XxHash3DigesterTest, KnownValues) {
+  EXPECT_EQ(XxHash3Digester().Digest(), uint64_t{0x2d06800538d394c2});
+  XxHash3Digester digester;
+  digester.Write("1234");
+  // A copy continues independently.
+  XxHash3Digester copy = digester;
+  digester.Write("56789");
+  EXPECT_EQ(digester.Digest(), uint64_t{0x72dcb18b67a17dff});
+  copy.Write("56789");
+  EXPECT_EQ(copy.Digest(), uint64_t{0x72dcb18b67a17dff});
+  XxHash3Digester seeded(42);
+  seeded.Write(kCheckString);
+  EXPECT_EQ(seeded.Digest(), uint64_t{0x6f803e3c27e6da22});
+}
+
+TEST(XxHash3DigesterTest, WriteZeros) {
+  EXPECT_EQ(DigestAbcAndZeros<XxHash3Digester>(),
+            uint64_t{0x64daaab16433f2e5});
+}
+
+TEST(XxHash128DigesterTest, KnownValues) {
+  EXPECT_EQ(XxHash128Digester().Digest(),
+            absl::MakeUint128(0x99aa06d3014798d8, 0x6001c324468d497f));
+  XxHash128Digester digester;
+  digester.Write(kCheckString);
+  EXPECT_EQ(digester.Digest(),
+            absl::MakeUint128(0x33119477ede5dcd5, 0xe9716427681d5860));
+  XxHash128Digester seeded(42);
+  seeded.Write(kCheckString);
+  EXPECT_EQ(seeded.Digest(),
+            absl::MakeUint128(0xe518a4beb776a023, 0xdb3be3adc3404e29));
+}
+
+std::string HexDigest(const std::array<uint8_t, SHA256_DIGEST_LENGTH>& digest) {
+  return absl::BytesToHexString(absl::string_view(
+      reinterpret_cast<const char*>(digest.data()), digest.size()));
+}
+
+TEST(Sha256DigesterTest, KnownValues) {
+  Sha256Digester digester;
+  EXPECT_EQ(
+      HexDigest(digester.Digest()),
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  // Writing continues after `Digest()`.
+  digester.Write("a");
+  digester.Digest();
+  digester.Write("bc");
+  EXPECT_EQ(
+      HexDigest(digester.Digest()),
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(Sha256DigesterTest, WriteZeros) {
+  EXPECT_EQ(
+      HexDigest(DigestAbcAndZeros<Sha256Digester>()),
+      "5bb7faae128b31e744fbd8bba7a97892784a5fd5ff975fcadcfaad8842bc74aa");
+}
+
+}  // namespace
+}  // namespace riegeli
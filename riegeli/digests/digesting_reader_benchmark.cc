@@ -0,0 +1,67 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of `DigestingReader<Crc32cDigester>`, compared with reading
+// without digesting.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <tuple>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/digests/crc32c_digester.h"
+#include "riegeli/digests/digesting_reader.h"
+
+namespace riegeli {
+namespace {
+
+constexpr size_t kSize = size_t{1} << 20;
+
+// Reads `kSize` bytes in pieces of `state.range(0)` bytes without digesting.
+void BM_StringReader(benchmark::State& state) {
+  const size_t length = static_cast<size_t>(state.range(0));
+  const std::string src(kSize, 'a');
+  for (auto _ : state) {
+    StringReader<> reader(src);
+    absl::string_view piece;
+    while (reader.Read(length, piece)) benchmark::DoNotOptimize(piece);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kSize));
+}
+BENCHMARK(BM_StringReader)->Arg(16)->Arg(4096)->Arg(kSize);
+
+// Like `BM_StringReader()`, but computes the CRC32C of data read.
+void BM_DigestingReaderCrc32c(benchmark::State& state) {
+  const size_t length = static_cast<size_t>(state.range(0));
+  const std::string src(kSize, 'a');
+  for (auto _ : state) {
+    DigestingReader<Crc32cDigester, StringReader<>> reader(
+        std::forward_as_tuple(src));
+    absl::string_view piece;
+    while (reader.Read(length, piece)) benchmark::DoNotOptimize(piece);
+    benchmark::DoNotOptimize(reader.Digest());
+    reader.Close();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kSize));
+}
+BENCHMARK(BM_DigestingReaderCrc32c)->Arg(16)->Arg(4096)->Arg(kSize);
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,32 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/digests/highwayhash_digester.h"
+
+#include "highwayhash/hh_types.h"
+
+namespace riegeli {
+
+const highwayhash::HHKey& HighwayHashDigester::DefaultKey() {
+  HH_ALIGNAS(32)
+  static const highwayhash::HHKey kDefaultKey = {
+      0x2f696c6567656952,  // 'Riegeli/'
+      0x0a7364726f636572,  // 'records\n'
+      0x2f696c6567656952,  // 'Riegeli/'
+      0x0a7364726f636572,  // 'records\n'
+  };
+  return kDefaultKey;
+}
+
+}  // namespace riegeli
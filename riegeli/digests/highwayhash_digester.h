@@ -0,0 +1,69 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_HIGHWAYHASH_DIGESTER_H_
+#define RIEGELI_DIGESTS_HIGHWAYHASH_DIGESTER_H_
+
+#include <stdint.h>
+
+#include "absl/strings/string_view.h"
+#include "highwayhash/arch_specific.h"
+#include "highwayhash/hh_types.h"
+#include "highwayhash/highwayhash.h"
+
+namespace riegeli {
+
+// A Digester computing 64-bit HighwayHash, for `DigestingReader` and
+// `DigestingWriter`.
+//
+// HighwayHash is a keyed hash, strong enough to detect accidental and
+// adversarial changes if the key is secret. The default key is the key used by
+// Riegeli/records for chunk hashes.
+//
+// The implementation uses the best instruction set enabled by compiler flags,
+// e.g. AVX2 with `-mavx2`.
+class HighwayHashDigester {
+ public:
+  // The key used by Riegeli/records for chunk hashes.
+  static const highwayhash::HHKey& DefaultKey();
+
+  HighwayHashDigester() : HighwayHashDigester(DefaultKey()) {}
+
+  explicit HighwayHashDigester(const highwayhash::HHKey& key) : state_(key) {}
+
+  HighwayHashDigester(const HighwayHashDigester& that) = default;
+  HighwayHashDigester& operator=(const HighwayHashDigester& that) = default;
+
+  void Write(absl::string_view src) { state_.Append(src.data(), src.size()); }
+
+  uint64_t Digest() const;
+
+ private:
+  highwayhash::HighwayHashCatT<HH_TARGET> state_;
+};
+
+// Implementation details follow.
+
+inline uint64_t HighwayHashDigester::Digest() const {
+  // `Finalize()` modifies the state, so it is applied to a copy, letting
+  // writing continue after `Digest()`.
+  auto state = state_;
+  highwayhash::HHResult64 result;
+  state.Finalize(&result);
+  return result;
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_HIGHWAYHASH_DIGESTER_H_
@@ -0,0 +1,64 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_SHA256_DIGESTER_H_
+#define RIEGELI_DIGESTS_SHA256_DIGESTER_H_
+
+#include <stdint.h>
+
+#include <array>
+
+#include "absl/strings/string_view.h"
+#include "openssl/sha.h"
+
+namespace riegeli {
+
+// A Digester computing SHA-256 hashes, for `DigestingReader` and
+// `DigestingWriter`.
+//
+// SHA-256 is a cryptographic hash, suitable for detecting adversarial changes.
+// Hashes are computed by BoringSSL, which uses SHA extensions of the CPU where
+// available.
+class Sha256Digester {
+ public:
+  Sha256Digester() { SHA256_Init(&ctx_); }
+
+  Sha256Digester(const Sha256Digester& that) = default;
+  Sha256Digester& operator=(const Sha256Digester& that) = default;
+
+  void Write(absl::string_view src) {
+    SHA256_Update(&ctx_, src.data(), src.size());
+  }
+
+  std::array<uint8_t, SHA256_DIGEST_LENGTH> Digest() const;
+
+ private:
+  SHA256_CTX ctx_;
+};
+
+// Implementation details follow.
+
+inline std::array<uint8_t, SHA256_DIGEST_LENGTH> Sha256Digester::Digest()
+    const {
+  // `SHA256_Final()` modifies the context, so it is applied to a copy, letting
+  // writing continue after `Digest()`.
+  SHA256_CTX ctx = ctx_;
+  std::array<uint8_t, SHA256_DIGEST_LENGTH> digest;
+  SHA256_Final(digest.data(), &ctx);
+  return digest;
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_SHA256_DIGESTER_H_
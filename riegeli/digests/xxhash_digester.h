@@ -0,0 +1,133 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_DIGESTS_XXHASH_DIGESTER_H_
+#define RIEGELI_DIGESTS_XXHASH_DIGESTER_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "absl/numeric/int128.h"
+#include "absl/strings/string_view.h"
+#include "xxhash.h"
+
+namespace riegeli {
+
+namespace xxhash_internal {
+
+struct XXH3StateDeleter {
+  void operator()(XXH3_state_t* ptr) const { XXH3_freeState(ptr); }
+};
+
+using XXH3StatePtr = std::unique_ptr<XXH3_state_t, XXH3StateDeleter>;
+
+inline XXH3StatePtr CopyState(const XXH3_state_t& state) {
+  XXH3StatePtr copy(XXH3_createState());
+  XXH3_copyState(copy.get(), &state);
+  return copy;
+}
+
+}  // namespace xxhash_internal
+
+// A Digester computing 64-bit XXH3 hashes, for `DigestingReader` and
+// `DigestingWriter`.
+//
+// XXH3 is a fast non-cryptographic hash, suitable for detecting accidental
+// changes. The implementation uses the best instruction set enabled by compiler
+// flags, e.g. AVX2 with `-mavx2`.
+class XxHash3Digester {
+ public:
+  explicit XxHash3Digester(uint64_t seed = 0);
+
+  XxHash3Digester(const XxHash3Digester& that);
+  XxHash3Digester& operator=(const XxHash3Digester& that);
+
+  XxHash3Digester(XxHash3Digester&& that) noexcept = default;
+  XxHash3Digester& operator=(XxHash3Digester&& that) noexcept = default;
+
+  void Write(absl::string_view src) {
+    XXH3_64bits_update(state_.get(), src.data(), src.size());
+  }
+
+  uint64_t Digest() const { return XXH3_64bits_digest(state_.get()); }
+
+ private:
+  xxhash_internal::XXH3StatePtr state_;
+};
+
+// A Digester computing 128-bit XXH3 hashes (XXH128), for `DigestingReader` and
+// `DigestingWriter`.
+//
+// XXH128 is a fast non-cryptographic hash, with a lower probability of
+// collisions than 64-bit XXH3. The implementation uses the best instruction
+// set enabled by compiler flags, e.g. AVX2 with `-mavx2`.
+class XxHash128Digester {
+ public:
+  explicit XxHash128Digester(uint64_t seed = 0);
+
+  XxHash128Digester(const XxHash128Digester& that);
+  XxHash128Digester& operator=(const XxHash128Digester& that);
+
+  XxHash128Digester(XxHash128Digester&& that) noexcept = default;
+  XxHash128Digester& operator=(XxHash128Digester&& that) noexcept = default;
+
+  void Write(absl::string_view src) {
+    XXH3_128bits_update(state_.get(), src.data(), src.size());
+  }
+
+  absl::uint128 Digest() const;
+
+ private:
+  xxhash_internal::XXH3StatePtr state_;
+};
+
+// Implementation details follow.
+
+inline XxHash3Digester::XxHash3Digester(uint64_t seed)
+    : state_(XXH3_createState()) {
+  XXH3_64bits_reset_withSeed(state_.get(), seed);
+}
+
+inline XxHash3Digester::XxHash3Digester(const XxHash3Digester& that)
+    : state_(xxhash_internal::CopyState(*that.state_)) {}
+
+inline XxHash3Digester& XxHash3Digester::operator=(
+    const XxHash3Digester& that) {
+  state_ = xxhash_internal::CopyState(*that.state_);
+  return *this;
+}
+
+inline XxHash128Digester::XxHash128Digester(uint64_t seed)
+    : state_(XXH3_createState()) {
+  XXH3_128bits_reset_withSeed(state_.get(), seed);
+}
+
+inline XxHash128Digester::XxHash128Digester(const XxHash128Digester& that)
+    : state_(xxhash_internal::CopyState(*that.state_)) {}
+
+inline XxHash128Digester& XxHash128Digester::operator=(
+    const XxHash128Digester& that) {
+  state_ = xxhash_internal::CopyState(*that.state_);
+  return *this;
+}
+
+inline absl::uint128 XxHash128Digester::Digest() const {
+  const XXH128_hash_t hash = XXH3_128bits_digest(state_.get());
+  return absl::MakeUint128(hash.high64, hash.low64);
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_DIGESTS_XXHASH_DIGESTER_H_
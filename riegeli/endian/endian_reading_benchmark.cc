@@ -0,0 +1,76 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of reading arrays of fixed width integers, which are copied in
+// bulk and byte-swapped if the byte order differs from the native one.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/endian/endian_reading.h"
+
+namespace riegeli {
+namespace {
+
+// Reads arrays of `state.range(0)` integers of type `T`, as many as fit in
+// 1 MiB, with the byte order given by `read_array`.
+template <typename T, bool (*read_array)(Reader&, absl::Span<T>)>
+void BM_ReadEndianArray(benchmark::State& state) {
+  const size_t array_size = static_cast<size_t>(state.range(0));
+  const size_t num_arrays = (size_t{1} << 20) / (array_size * sizeof(T));
+  const std::string src(num_arrays * array_size * sizeof(T), '\x5a');
+  std::vector<T> dest(array_size);
+  for (auto _ : state) {
+    StringReader<> reader(src);
+    for (size_t i = 0; i < num_arrays; ++i) {
+      read_array(reader, absl::MakeSpan(dest));
+      benchmark::DoNotOptimize(dest.data());
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(src.size()));
+}
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint16_t, ReadLittleEndian16s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint16_t, ReadBigEndian16s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint32_t, ReadLittleEndian32s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint32_t, ReadBigEndian32s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint64_t, ReadLittleEndian64s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadEndianArray, uint64_t, ReadBigEndian64s)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+
+}  // namespace
+}  // namespace riegeli
@@ -15,12 +15,21 @@
 #include "riegeli/lines/line_reading.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <cstring>
 #include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "absl/base/attributes.h"
 #include "absl/base/optimization.h"
+#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
@@ -35,6 +44,86 @@ namespace riegeli {
 
 namespace {
 
+// Returns a pointer to the first CR or LF in [`begin`..`end`), or `nullptr` if
+// there is none.
+//
+// `std::memchr()` is vectorized by the C library but looks for a single
+// character, so this compares a vector of characters with both CR and LF at
+// once.
+inline const char* FindCrOrLf(const char* begin, const char* end) {
+#if defined(__AVX2__)
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (PtrDistance(begin, end) >= sizeof(__m256i)) {
+    const __m256i data =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(data, cr),
+                        _mm256_cmpeq_epi8(data, lf))));
+    if (mask != 0) return begin + absl::countr_zero(mask);
+    begin += sizeof(__m256i);
+  }
+#elif defined(__SSE2__)
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  while (PtrDistance(begin, end) >= sizeof(__m128i)) {
+    const __m128i data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(data, cr), _mm_cmpeq_epi8(data, lf))));
+    if (mask != 0) return begin + absl::countr_zero(mask);
+    begin += sizeof(__m128i);
+  }
+#endif
+  for (; begin < end; ++begin) {
+    if (*begin == '\n' || *begin == '\r') return begin;
+  }
+  return nullptr;
+}
+
+// Finds the first line terminator in [`begin`..`end`) which is recognized by
+// `newline` and which is complete, i.e. not a CR at `end[-1]` which could be
+// a part of CR-LF continuing after `end`.
+//
+// Returns a pointer to the terminator and sets `newline_length`, or returns
+// `nullptr` if there is no such terminator.
+inline const char* FindCompleteNewline(const char* begin, const char* end,
+                                       ReadNewline newline,
+                                       size_t& newline_length) {
+  switch (newline) {
+    case ReadNewline::kLf: {
+      const char* const lf = static_cast<const char*>(
+          std::memchr(begin, '\n', PtrDistance(begin, end)));
+      newline_length = 1;
+      return lf;
+    }
+    case ReadNewline::kCrLfOrLf: {
+      const char* const lf = static_cast<const char*>(
+          std::memchr(begin, '\n', PtrDistance(begin, end)));
+      if (lf == nullptr) return nullptr;
+      if (lf > begin && lf[-1] == '\r') {
+        newline_length = 2;
+        return lf - 1;
+      }
+      newline_length = 1;
+      return lf;
+    }
+    case ReadNewline::kAny: {
+      const char* const cr_or_lf = FindCrOrLf(begin, end);
+      if (cr_or_lf == nullptr) return nullptr;
+      if (*cr_or_lf == '\n') {
+        newline_length = 1;
+        return cr_or_lf;
+      }
+      if (ABSL_PREDICT_FALSE(cr_or_lf + 1 == end)) return nullptr;
+      newline_length = cr_or_lf[1] == '\n' ? 2 : 1;
+      return cr_or_lf;
+    }
+  }
+  RIEGELI_ASSERT_UNREACHABLE()
+      << "Unknown newline: " << static_cast<int>(newline);
+}
+
 // Reads `length_to_read` bytes from `src`, writes their prefix of
 // `length_to_write` bytes to `dest`, appending to existing contents
 // (unless `Dest` is `absl::string_view`).
@@ -161,37 +250,35 @@ inline bool ReadLineInternal(Reader& src, Dest& dest, ReadLineOptions options) {
               std::memchr(src.cursor() + 2, '\n', src.available() - 2));
         }
       }
-      case ReadNewline::kAny:
-        for (const char* newline = src.cursor(); newline < src.limit();
-             ++newline) {
-          if (ABSL_PREDICT_FALSE(*newline == '\n')) {
-            return FoundNewline(src, dest, options,
-                                PtrDistance(src.cursor(), newline), 1);
-          }
-          if (ABSL_PREDICT_FALSE(*newline == '\r')) {
-            length = PtrDistance(src.cursor(), newline);
-            if (ABSL_PREDICT_FALSE(newline + 1 == src.limit())) {
-              // The CR is last in the buffer.
-              if (ABSL_PREDICT_TRUE(length > 0)) {
-                // The CR is not first in the buffer. Move line read so far to
-                // `dest` to avoid copying that part during flattening of the CR
-                // together with the next buffer.
-                goto continue_reading;
-              }
-              // The buffer contains only CR.
-              return FoundNewline(
-                  src, dest, options, 0,
-                  ABSL_PREDICT_TRUE(src.Pull(2) && src.cursor()[1] == '\n')
-                      ? size_t{2}
-                      : size_t{1});
-            }
-            return FoundNewline(
-                src, dest, options, length,
-                ABSL_PREDICT_TRUE(newline[1] == '\n') ? size_t{2} : size_t{1});
+      case ReadNewline::kAny: {
+        const char* const newline = FindCrOrLf(src.cursor(), src.limit());
+        if (ABSL_PREDICT_FALSE(newline == nullptr)) {
+          length = src.available();
+          goto continue_reading;
+        }
+        length = PtrDistance(src.cursor(), newline);
+        if (*newline == '\n') {
+          return FoundNewline(src, dest, options, length, 1);
+        }
+        if (ABSL_PREDICT_FALSE(newline + 1 == src.limit())) {
+          // The CR is last in the buffer.
+          if (ABSL_PREDICT_TRUE(length > 0)) {
+            // The CR is not first in the buffer. Move line read so far to
+            // `dest` to avoid copying that part during flattening of the CR
+            // together with the next buffer.
+            goto continue_reading;
           }
+          // The buffer contains only CR.
+          return FoundNewline(
+              src, dest, options, 0,
+              ABSL_PREDICT_TRUE(src.Pull(2) && src.cursor()[1] == '\n')
+                  ? size_t{2}
+                  : size_t{1});
         }
-        length = src.available();
-        goto continue_reading;
+        return FoundNewline(
+            src, dest, options, length,
+            ABSL_PREDICT_TRUE(newline[1] == '\n') ? size_t{2} : size_t{1});
+      }
     }
     RIEGELI_ASSERT_UNREACHABLE()
         << "Unknown newline: " << static_cast<int>(options.newline());
@@ -259,24 +346,20 @@ bool ReadLine(Reader& src, absl::string_view& dest, ReadLineOptions options) {
           // terminator. Search for LF again.
           length += 2;
         }
-      case ReadNewline::kAny:
-        for (const char* newline = src.cursor() + length; newline < src.limit();
-             ++newline) {
-          if (ABSL_PREDICT_FALSE(*newline == '\n')) {
-            return FoundNewline(src, dest, options,
-                                PtrDistance(src.cursor(), newline), 1);
-          }
-          if (ABSL_PREDICT_FALSE(*newline == '\r')) {
-            length = PtrDistance(src.cursor(), newline);
-            return FoundNewline(
-                src, dest, options, length,
-                ABSL_PREDICT_TRUE(src.Pull(length + 2) &&
-                                  src.cursor()[length + 1] == '\n')
-                    ? size_t{2}
-                    : size_t{1});
-          }
+      case ReadNewline::kAny: {
+        const char* const newline =
+            FindCrOrLf(src.cursor() + length, src.limit());
+        if (ABSL_PREDICT_FALSE(newline == nullptr)) goto continue_reading;
+        length = PtrDistance(src.cursor(), newline);
+        if (*newline == '\n') {
+          return FoundNewline(src, dest, options, length, 1);
         }
-        goto continue_reading;
+        return FoundNewline(src, dest, options, length,
+                            ABSL_PREDICT_TRUE(src.Pull(length + 2) &&
+                                              src.cursor()[length + 1] == '\n')
+                                ? size_t{2}
+                                : size_t{1});
+      }
     }
     RIEGELI_ASSERT_UNREACHABLE()
         << "Unknown newline: " << static_cast<int>(options.newline());
@@ -307,6 +390,35 @@ bool ReadLine(Reader& src, absl::Cord& dest, ReadLineOptions options) {
   return ReadLineInternal(src, dest, options);
 }
 
+bool ReadLines(Reader& src, std::vector<absl::string_view>& dest,
+               ReadLineOptions options) {
+  dest.clear();
+  if (ABSL_PREDICT_FALSE(!src.Pull())) return false;
+  const char* cursor = src.cursor();
+  size_t newline_length;
+  while (const char* const newline = FindCompleteNewline(
+             cursor, src.limit(), options.newline(), newline_length)) {
+    size_t length = PtrDistance(cursor, newline);
+    const size_t length_with_newline = length + newline_length;
+    if (options.keep_newline()) length = length_with_newline;
+    // Let `ReadLine()` below report the failure.
+    if (ABSL_PREDICT_FALSE(length > options.max_length())) break;
+    dest.emplace_back(cursor, length);
+    cursor += length_with_newline;
+  }
+  if (ABSL_PREDICT_TRUE(!dest.empty())) {
+    src.set_cursor(cursor);
+    return true;
+  }
+  // No complete line is buffered.
+  dest.emplace_back();
+  if (ABSL_PREDICT_FALSE(!ReadLine(src, dest.back(), options))) {
+    if (src.ok()) dest.clear();
+    return false;
+  }
+  return true;
+}
+
 void SkipBOM(Reader& src) {
   if (src.pos() != 0) return;
   src.Pull(3);
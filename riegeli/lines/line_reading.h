@@ -20,6 +20,7 @@
 #include <limits>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
@@ -106,6 +107,22 @@ bool ReadLine(Reader& src, Chain& dest,
 bool ReadLine(Reader& src, absl::Cord& dest,
               ReadLineOptions options = ReadLineOptions());
 
+// Reads all lines which are complete in the buffer of `src`, or one line if
+// the buffer has no complete line, replacing the contents of `dest`.
+//
+// This avoids per-line overhead of `ReadLine()` when lines are short. Lines
+// are read like with `ReadLine(Reader&, absl::string_view&, ReadLineOptions)`,
+// and `dest` is invalidated like that `absl::string_view` by the next non-const
+// operation on `src`.
+//
+// Return values:
+//  * `true`                     - success (`dest` has at least one line)
+//  * `false` (when `src.ok()`)  - source ends (`dest` is empty)
+//  * `false` (when `!src.ok()`) - failure (`dest` has the partial line read
+//                                 before the failure)
+bool ReadLines(Reader& src, std::vector<absl::string_view>& dest,
+               ReadLineOptions options = ReadLineOptions());
+
 // Skips an initial UTF-8 BOM if it is present.
 //
 // Does nothing unless `src.pos() == 0`.
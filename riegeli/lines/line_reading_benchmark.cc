@@ -0,0 +1,75 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of `ReadLine()` with each `ReadNewline` mode.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/lines/line_reading.h"
+#include "riegeli/lines/newline.h"
+
+namespace riegeli {
+namespace {
+
+// Returns about 1 MiB of lines of `line_length` characters, each terminated
+// with `newline`.
+std::string Lines(size_t line_length, absl::string_view newline) {
+  std::string lines;
+  const std::string line(line_length, 'a');
+  while (lines.size() < (size_t{1} << 20)) {
+    lines.append(line);
+    lines.append(newline.data(), newline.size());
+  }
+  return lines;
+}
+
+// Reads lines of `state.range(0)` characters terminated with `newline`, with
+// `ReadNewline` mode `read_newline`.
+void ReadLines(benchmark::State& state, absl::string_view newline,
+               ReadNewline read_newline) {
+  const std::string src =
+      Lines(static_cast<size_t>(state.range(0)), newline);
+  const ReadLineOptions options = ReadLineOptions().set_newline(read_newline);
+  for (auto _ : state) {
+    StringReader<> reader(src);
+    absl::string_view line;
+    while (ReadLine(reader, line, options)) benchmark::DoNotOptimize(line);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(src.size()));
+}
+
+void BM_ReadLineLf(benchmark::State& state) {
+  ReadLines(state, "\n", ReadNewline::kLf);
+}
+BENCHMARK(BM_ReadLineLf)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_ReadLineCrLfOrLf(benchmark::State& state) {
+  ReadLines(state, "\r\n", ReadNewline::kCrLfOrLf);
+}
+BENCHMARK(BM_ReadLineCrLfOrLf)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_ReadLineAny(benchmark::State& state) {
+  ReadLines(state, "\r\n", ReadNewline::kAny);
+}
+BENCHMARK(BM_ReadLineAny)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,187 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/lines/line_reading.h"
+
+#include <stddef.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/bytes/buffer_options.h"
+#include "riegeli/bytes/buffered_reader.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/lines/newline.h"
+
+namespace riegeli {
+namespace {
+
+// A `Reader` of `data` whose reads stop at multiples of `fragment_size` when
+// possible, so that the buffer usually ends at these positions.
+class FragmentedReader : public BufferedReader {
+ public:
+  explicit FragmentedReader(absl::string_view data, size_t fragment_size)
+      : BufferedReader(BufferOptions().set_buffer_size(fragment_size)),
+        data_(data),
+        fragment_size_(fragment_size) {}
+
+ protected:
+  bool ReadInternal(size_t min_length, size_t max_length,
+                    char* dest) override {
+    const size_t pos = IntCast<size_t>(limit_pos());
+    const size_t to_boundary = fragment_size_ - pos % fragment_size_;
+    const size_t length =
+        UnsignedMin(UnsignedMax(min_length, to_boundary), max_length,
+                    data_.size() - pos);
+    std::memcpy(dest, data_.data() + pos, length);
+    move_limit_pos(length);
+    return length >= min_length;
+  }
+
+ private:
+  absl::string_view data_;
+  size_t fragment_size_;
+};
+
+// Reads all lines with `ReadLine()`.
+std::vector<std::string> ReadLinesOneByOne(absl::string_view data,
+                                           const ReadLineOptions& options) {
+  StringReader<> src(data);
+  std::vector<std::string> lines;
+  absl::string_view line;
+  while (ReadLine(src, line, options)) lines.emplace_back(line);
+  EXPECT_TRUE(src.Close()) << src.status();
+  return lines;
+}
+
+// Reads all lines with `ReadLines()`.
+std::vector<std::string> ReadLinesInBatches(Reader& src,
+                                            const ReadLineOptions& options) {
+  std::vector<std::string> lines;
+  std::vector<absl::string_view> batch;
+  while (ReadLines(src, batch, options)) {
+    EXPECT_FALSE(batch.empty());
+    for (const absl::string_view line : batch) lines.emplace_back(line);
+  }
+  EXPECT_TRUE(batch.empty());
+  EXPECT_TRUE(src.Close()) << src.status();
+  return lines;
+}
+
+std::string TestText(size_t num_lines) {
+  static constexpr absl::string_view kNewlines[] = {"\n", "\r", "\r\n"};
+  std::mt19937 random(1);
+  std::string text;
+  for (size_t i = 0; i < num_lines; ++i) {
+    const size_t length = random() % 10;
+    for (size_t j = 0; j < length; ++j) {
+      text.push_back(static_cast<char>('a' + random() % 26));
+    }
+    const absl::string_view newline = kNewlines[random() % 3];
+    text.append(newline.data(), newline.size());
+  }
+  // The last line is not terminated.
+  text.append("last");
+  return text;
+}
+
+class ReadLinesTest
+    : public testing::TestWithParam<std::tuple<ReadNewline, bool, size_t>> {
+ protected:
+  ReadLineOptions options() const {
+    return ReadLineOptions()
+        .set_newline(std::get<0>(GetParam()))
+        .set_keep_newline(std::get<1>(GetParam()));
+  }
+  size_t fragment_size() const { return std::get<2>(GetParam()); }
+};
+
+TEST_P(ReadLinesTest, MatchesReadLine) {
+  const std::string text = TestText(1000);
+  FragmentedReader src(text, fragment_size());
+  EXPECT_EQ(ReadLinesInBatches(src, options()),
+            ReadLinesOneByOne(text, options()));
+}
+
+TEST_P(ReadLinesTest, CrAtBufferEnd) {
+  // With some shift, each CR ends a fragment: of CR-LF, of a lone CR, of CR
+  // followed by another CR, and of CR at the end of the source.
+  for (size_t shift = 0; shift < fragment_size(); ++shift) {
+    const std::string text =
+        std::string(shift, 'x') + "ab\r\ncd\ref\r\rgh\r\n\r\nij\r";
+    FragmentedReader src(text, fragment_size());
+    EXPECT_EQ(ReadLinesInBatches(src, options()),
+              ReadLinesOneByOne(text, options()))
+        << "Shift: " << shift;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    NewlineKeepNewlineFragmentSize, ReadLinesTest,
+    testing::Combine(testing::Values(ReadNewline::kLf, ReadNewline::kCrLfOrLf,
+                                     ReadNewline::kAny),
+                     testing::Bool(), testing::Values(1, 2, 3, 7, 64)));
+
+TEST(ReadLinesTest, ReadsBufferedLinesAtOnce) {
+  StringReader<> src("a\nbb\r\nccc");
+  std::vector<absl::string_view> lines;
+  ASSERT_TRUE(ReadLines(src, lines,
+                        ReadLineOptions().set_newline(ReadNewline::kAny)));
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"a", "bb"}));
+  // The last line has no terminator, so it is read by itself.
+  ASSERT_TRUE(ReadLines(src, lines,
+                        ReadLineOptions().set_newline(ReadNewline::kAny)));
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"ccc"}));
+  EXPECT_FALSE(ReadLines(src, lines,
+                         ReadLineOptions().set_newline(ReadNewline::kAny)));
+  EXPECT_TRUE(lines.empty());
+  EXPECT_TRUE(src.Close()) << src.status();
+}
+
+TEST(ReadLinesTest, CrAtBufferEndIsNotTerminated) {
+  // The buffer ends with CR, which can begin CR-LF.
+  FragmentedReader src("ab\rcd\r\nef", 6);
+  std::vector<absl::string_view> lines;
+  const ReadLineOptions options =
+      ReadLineOptions().set_newline(ReadNewline::kAny);
+  ASSERT_TRUE(ReadLines(src, lines, options)) << src.status();
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"ab"}));
+  ASSERT_TRUE(ReadLines(src, lines, options)) << src.status();
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"cd"}));
+  EXPECT_EQ(src.pos(), 7u);
+  ASSERT_TRUE(ReadLines(src, lines, options)) << src.status();
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"ef"}));
+  EXPECT_FALSE(ReadLines(src, lines, options));
+  EXPECT_TRUE(src.Close()) << src.status();
+}
+
+TEST(ReadLinesTest, MaxLengthExceeded) {
+  StringReader<> src("a\nbcdef\ng\n");
+  std::vector<absl::string_view> lines;
+  const ReadLineOptions options = ReadLineOptions().set_max_length(3);
+  ASSERT_TRUE(ReadLines(src, lines, options));
+  EXPECT_EQ(lines, (std::vector<absl::string_view>{"a"}));
+  EXPECT_FALSE(ReadLines(src, lines, options));
+  EXPECT_TRUE(absl::IsResourceExhausted(src.status())) << src.status();
+}
+
+}  // namespace
+}  // namespace riegeli
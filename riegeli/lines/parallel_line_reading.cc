@@ -0,0 +1,245 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/lines/parallel_line_reading.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/reader_factory.h"
+#include "riegeli/lines/line_reading.h"
+
+namespace riegeli {
+
+// Before C++17 if a constexpr static data member is ODR-used, its definition at
+// namespace scope is required. Since C++17 these definitions are deprecated:
+// http://en.cppreference.com/w/cpp/language/static
+#if __cplusplus < 201703
+constexpr Position ParallelLineReadingOptions::kDefaultShardSize;
+#endif
+
+namespace {
+
+using ProcessLineFunction = absl::FunctionRef<absl::Status(
+    absl::string_view line, const LinePosition& position)>;
+
+// Calls `process()` for lines of `src` starting before `end`.
+//
+// If `skip_partial_line`, `src` is positioned one byte before the beginning of
+// the shard, and the line containing that byte is skipped. The line starting
+// after it is the first line starting at or after the beginning of the shard,
+// even if the shard begins inside a line terminator. Otherwise `src` is
+// positioned at the beginning of a line.
+//
+// Returns early without a failure if `cancelled` becomes `true`.
+absl::Status ProcessShard(Reader& src, bool skip_partial_line, Position end,
+                          absl::optional<uint64_t> line_number,
+                          const ReadLineOptions& options,
+                          const std::atomic<bool>& cancelled,
+                          ProcessLineFunction process) {
+  absl::string_view line;
+  if (skip_partial_line) {
+    // The skipped line belongs to the previous shard, which checks its length.
+    if (ABSL_PREDICT_FALSE(!ReadLine(
+            src, line, ReadLineOptions().set_newline(options.newline())))) {
+      // The source ends, or reading failed.
+      return src.status();
+    }
+  }
+  while (src.pos() < end) {
+    if (ABSL_PREDICT_FALSE(cancelled.load(std::memory_order_relaxed))) {
+      return absl::OkStatus();
+    }
+    const Position pos = src.pos();
+    if (ABSL_PREDICT_FALSE(!ReadLine(src, line, options))) {
+      // The source ends, or reading failed.
+      return src.status();
+    }
+    absl::Status status = process(line, LinePosition{pos, line_number});
+    if (ABSL_PREDICT_FALSE(!status.ok())) return status;
+    if (line_number != absl::nullopt) ++*line_number;
+  }
+  return absl::OkStatus();
+}
+
+// Calls `process_shard(shard_index, cancelled)` for each shard, in background
+// with at most `options.parallelism()` tasks, and in the calling thread.
+//
+// After a failure, remaining shards are not started, and `cancelled` is set to
+// `true` to let shards being processed return early.
+absl::Status ForEachShard(
+    size_t num_shards, const ParallelLineReadingOptions& options,
+    absl::FunctionRef<absl::Status(size_t shard_index,
+                                   const std::atomic<bool>& cancelled)>
+        process_shard) {
+  struct State {
+    std::atomic<size_t> next_shard{0};
+    std::atomic<bool> cancelled{false};
+    absl::Mutex mutex;
+    absl::Status status ABSL_GUARDED_BY(mutex);
+    size_t num_running ABSL_GUARDED_BY(mutex) = 0;
+  };
+  State state;
+  const auto run = [&] {
+    while (!state.cancelled.load(std::memory_order_relaxed)) {
+      const size_t shard_index =
+          state.next_shard.fetch_add(1, std::memory_order_relaxed);
+      if (shard_index >= num_shards) return;
+      absl::Status shard_status = process_shard(shard_index, state.cancelled);
+      if (ABSL_PREDICT_FALSE(!shard_status.ok())) {
+        absl::MutexLock lock(&state.mutex);
+        state.status.Update(shard_status);
+        state.cancelled.store(true, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  Executor& executor = options.executor() != nullptr ? *options.executor()
+                                                     : Executor::global();
+  const size_t num_tasks =
+      std::min(IntCast<size_t>(options.parallelism()), num_shards - 1);
+  {
+    absl::MutexLock lock(&state.mutex);
+    state.num_running = num_tasks;
+  }
+  for (size_t i = 0; i < num_tasks; ++i) {
+    executor.Schedule([&] {
+      run();
+      absl::MutexLock lock(&state.mutex);
+      --state.num_running;
+    });
+  }
+  run();
+  absl::MutexLock lock(&state.mutex);
+  state.mutex.Await(absl::Condition(
+      +[](State* state) ABSL_EXCLUSIVE_LOCKS_REQUIRED(state->mutex) {
+        return state->num_running == 0;
+      },
+      &state));
+  return state.status;
+}
+
+}  // namespace
+
+absl::Status ProcessLinesInParallel(Reader& src, ProcessLineFunction process,
+                                    const ParallelLineReadingOptions& options) {
+  const Position begin = src.pos();
+  absl::optional<Position> size;
+  if (options.parallelism() > 0 && src.SupportsRandomAccess() &&
+      src.SupportsSize()) {
+    size = src.Size();
+    if (ABSL_PREDICT_FALSE(size == absl::nullopt)) return src.status();
+  }
+  if (size == absl::nullopt || *size <= begin ||
+      *size - begin <= options.shard_size()) {
+    const std::atomic<bool> cancelled{false};
+    return ProcessShard(
+        src, false, std::numeric_limits<Position>::max(),
+        options.line_numbers() ? absl::make_optional(uint64_t{0})
+                               : absl::nullopt,
+        options.read_line_options(), cancelled, process);
+  }
+
+  const Position shard_size = options.shard_size();
+  const size_t num_shards =
+      IntCast<size_t>((*size - begin - 1) / shard_size + 1);
+  const auto shard_begin = [&](size_t shard_index) {
+    return begin + IntCast<Position>(shard_index) * shard_size;
+  };
+  const auto shard_end = [&](size_t shard_index) {
+    return shard_index == num_shards - 1 ? *size : shard_begin(shard_index + 1);
+  };
+
+  ReaderFactory<Reader*> factory(&src);
+  if (ABSL_PREDICT_FALSE(!factory.ok())) return factory.status();
+  const auto for_each_line_of_shard =
+      [&](size_t shard_index, absl::optional<uint64_t> first_line_number,
+          const std::atomic<bool>& cancelled, ProcessLineFunction process) {
+        const std::unique_ptr<Reader> reader =
+            factory.NewReader(shard_index == 0 ? begin
+                                               : shard_begin(shard_index) - 1);
+        if (ABSL_PREDICT_FALSE(reader == nullptr)) return factory.status();
+        absl::Status shard_status =
+            ProcessShard(*reader, shard_index > 0, shard_end(shard_index),
+                         first_line_number, options.read_line_options(),
+                         cancelled, process);
+        if (ABSL_PREDICT_FALSE(!reader->Close())) {
+          shard_status.Update(reader->status());
+        }
+        return shard_status;
+      };
+
+  // Line numbers of the first lines of shards, computed as prefix sums of
+  // numbers of lines of shards.
+  std::vector<uint64_t> first_line_numbers;
+  absl::Status status;
+  if (options.line_numbers()) {
+    first_line_numbers.resize(num_shards);
+    status = ForEachShard(
+        num_shards, options,
+        [&](size_t shard_index, const std::atomic<bool>& cancelled) {
+          uint64_t num_lines = 0;
+          absl::Status shard_status = for_each_line_of_shard(
+              shard_index, absl::nullopt, cancelled,
+              [&](absl::string_view, const LinePosition&) {
+                ++num_lines;
+                return absl::OkStatus();
+              });
+          first_line_numbers[shard_index] = num_lines;
+          return shard_status;
+        });
+    uint64_t line_number = 0;
+    for (uint64_t& first_line_number : first_line_numbers) {
+      const uint64_t num_lines = first_line_number;
+      first_line_number = line_number;
+      line_number += num_lines;
+    }
+  }
+  if (ABSL_PREDICT_TRUE(status.ok())) {
+    status = ForEachShard(
+        num_shards, options,
+        [&](size_t shard_index, const std::atomic<bool>& cancelled) {
+          return for_each_line_of_shard(
+              shard_index,
+              options.line_numbers()
+                  ? absl::make_optional(first_line_numbers[shard_index])
+                  : absl::nullopt,
+              cancelled, process);
+        });
+  }
+  if (ABSL_PREDICT_FALSE(!factory.Close())) status.Update(factory.status());
+  if (ABSL_PREDICT_TRUE(status.ok())) {
+    if (ABSL_PREDICT_FALSE(!src.Seek(*size))) return src.status();
+  }
+  return status;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,171 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_LINES_PARALLEL_LINE_READING_H_
+#define RIEGELI_LINES_PARALLEL_LINE_READING_H_
+
+#include <stdint.h>
+
+#include <utility>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/lines/line_reading.h"
+
+namespace riegeli {
+
+// Options for `ProcessLinesInParallel()`.
+class ParallelLineReadingOptions {
+ public:
+  ParallelLineReadingOptions() noexcept {}
+
+  // Options for reading each line: line terminators to recognize, whether to
+  // keep them, and the expected maximum line length.
+  //
+  // Default: `ReadLineOptions()`.
+  ParallelLineReadingOptions& set_read_line_options(
+      ReadLineOptions read_line_options) & {
+    read_line_options_ = read_line_options;
+    return *this;
+  }
+  ParallelLineReadingOptions&& set_read_line_options(
+      ReadLineOptions read_line_options) && {
+    return std::move(set_read_line_options(read_line_options));
+  }
+  ReadLineOptions& read_line_options() { return read_line_options_; }
+  const ReadLineOptions& read_line_options() const {
+    return read_line_options_;
+  }
+
+  // The source is split into shards of `shard_size` bytes, which are processed
+  // in parallel. A line belongs to the shard containing its first byte.
+  //
+  // Default: `kDefaultShardSize` (16M).
+  static constexpr Position kDefaultShardSize = Position{16} << 20;
+  ParallelLineReadingOptions& set_shard_size(Position shard_size) & {
+    RIEGELI_ASSERT_GT(shard_size, 0u)
+        << "Failed precondition of "
+           "ParallelLineReadingOptions::set_shard_size(): "
+           "zero shard size";
+    shard_size_ = shard_size;
+    return *this;
+  }
+  ParallelLineReadingOptions&& set_shard_size(Position shard_size) && {
+    return std::move(set_shard_size(shard_size));
+  }
+  Position shard_size() const { return shard_size_; }
+
+  // Maximum number of shards processed in background, in parallel with the
+  // calling thread, which processes shards too.
+  //
+  // If 0, lines are processed in the calling thread, in order.
+  //
+  // Default: 0.
+  ParallelLineReadingOptions& set_parallelism(int parallelism) & {
+    RIEGELI_ASSERT_GE(parallelism, 0)
+        << "Failed precondition of "
+           "ParallelLineReadingOptions::set_parallelism(): "
+           "negative parallelism";
+    parallelism_ = parallelism;
+    return *this;
+  }
+  ParallelLineReadingOptions&& set_parallelism(int parallelism) && {
+    return std::move(set_parallelism(parallelism));
+  }
+  int parallelism() const { return parallelism_; }
+
+  // `Executor` which processes shards in background if `parallelism > 0`.
+  // It is not owned and must outlive `ProcessLinesInParallel()`.
+  //
+  // `nullptr` means `Executor::global()`.
+  //
+  // Default: `nullptr`.
+  ParallelLineReadingOptions& set_executor(Executor* executor) & {
+    executor_ = executor;
+    return *this;
+  }
+  ParallelLineReadingOptions&& set_executor(Executor* executor) && {
+    return std::move(set_executor(executor));
+  }
+  Executor* executor() const { return executor_; }
+
+  // If `true`, `LinePosition::line_number` is known.
+  //
+  // When lines are processed in parallel, this costs an additional pass over
+  // the source, which counts lines of each shard.
+  //
+  // Default: `false`.
+  ParallelLineReadingOptions& set_line_numbers(bool line_numbers) & {
+    line_numbers_ = line_numbers;
+    return *this;
+  }
+  ParallelLineReadingOptions&& set_line_numbers(bool line_numbers) && {
+    return std::move(set_line_numbers(line_numbers));
+  }
+  bool line_numbers() const { return line_numbers_; }
+
+ private:
+  ReadLineOptions read_line_options_;
+  Position shard_size_ = kDefaultShardSize;
+  int parallelism_ = 0;
+  Executor* executor_ = nullptr;
+  bool line_numbers_ = false;
+};
+
+// The position of a line processed by `ProcessLinesInParallel()`.
+struct LinePosition {
+  // Position of the beginning of the line in the source.
+  Position pos = 0;
+  // Index of the line among lines read, counting from 0, if
+  // `ParallelLineReadingOptions::line_numbers()`, otherwise `absl::nullopt`.
+  absl::optional<uint64_t> line_number;
+};
+
+// Reads all lines from `src`, starting from `src.pos()`, and calls
+// `process(line, position)` for each line.
+//
+// `line` is valid only until `process` returns. Line terminators are
+// recognized according to `options.read_line_options()`.
+//
+// If `options.parallelism() > 0` and `src` supports random access and
+// `Size()`, the source is split into shards of `options.shard_size()` bytes,
+// which are read with independent `Reader`s from a `ReaderFactory`. A shard
+// other than the first one is read from the first line starting at or after
+// its first byte, so that each line is processed exactly once. `process` is
+// then called concurrently from multiple threads, in an unspecified order.
+//
+// If `process` returns a failure, processing stops and that failure is
+// returned.
+//
+// On success, `src` is positioned at its end. `src` is not closed.
+//
+// Returns status:
+//  * `status.ok()`  - success
+//  * `!status.ok()` - failure
+absl::Status ProcessLinesInParallel(
+    Reader& src,
+    absl::FunctionRef<absl::Status(absl::string_view line,
+                                   const LinePosition& position)>
+        process,
+    const ParallelLineReadingOptions& options = ParallelLineReadingOptions());
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_LINES_PARALLEL_LINE_READING_H_
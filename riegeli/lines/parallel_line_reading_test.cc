@@ -0,0 +1,177 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/lines/parallel_line_reading.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/lines/line_reading.h"
+#include "riegeli/lines/newline.h"
+
+namespace riegeli {
+namespace {
+
+// A line with its position and line number.
+using Line = std::tuple<Position, uint64_t, std::string>;
+
+// Reads lines of `data` from `begin` with `ReadLine()`.
+std::vector<Line> ReadLinesSequentially(absl::string_view data, Position begin,
+                                        const ReadLineOptions& options) {
+  StringReader<> src(data);
+  EXPECT_TRUE(src.Seek(begin)) << src.status();
+  std::vector<Line> lines;
+  absl::string_view line;
+  for (;;) {
+    const Position pos = src.pos();
+    if (!ReadLine(src, line, options)) break;
+    lines.emplace_back(pos, lines.size(), std::string(line));
+  }
+  EXPECT_TRUE(src.Close()) << src.status();
+  return lines;
+}
+
+// Reads lines of `data` from `begin` with `ProcessLinesInParallel()`, and
+// returns them sorted by positions.
+std::vector<Line> ReadLinesInParallel(
+    absl::string_view data, Position begin,
+    const ParallelLineReadingOptions& options) {
+  StringReader<> src(data);
+  EXPECT_TRUE(src.Seek(begin)) << src.status();
+  absl::Mutex mutex;
+  std::vector<Line> lines;
+  const absl::Status status = ProcessLinesInParallel(
+      src,
+      [&](absl::string_view line, const LinePosition& position) {
+        EXPECT_NE(position.line_number, absl::nullopt);
+        absl::MutexLock lock(&mutex);
+        lines.emplace_back(position.pos, position.line_number.value_or(0),
+                           std::string(line));
+        return absl::OkStatus();
+      },
+      options);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(src.pos(), data.size());
+  EXPECT_TRUE(src.Close()) << src.status();
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+std::string TestText(size_t num_lines) {
+  static constexpr absl::string_view kNewlines[] = {"\n", "\r", "\r\n"};
+  std::mt19937 random(1);
+  std::string text;
+  for (size_t i = 0; i < num_lines; ++i) {
+    const size_t length = random() % 8;
+    for (size_t j = 0; j < length; ++j) {
+      text.push_back(static_cast<char>('a' + random() % 26));
+    }
+    const absl::string_view newline = kNewlines[random() % 3];
+    text.append(newline.data(), newline.size());
+  }
+  // The last line is not terminated.
+  text.append("last");
+  return text;
+}
+
+class ProcessLinesInParallelTest
+    : public testing::TestWithParam<std::tuple<ReadNewline, bool, int>> {
+ protected:
+  ReadLineOptions read_line_options() const {
+    return ReadLineOptions()
+        .set_newline(std::get<0>(GetParam()))
+        .set_keep_newline(std::get<1>(GetParam()));
+  }
+  ParallelLineReadingOptions options(Position shard_size) const {
+    return ParallelLineReadingOptions()
+        .set_read_line_options(read_line_options())
+        .set_shard_size(shard_size)
+        .set_parallelism(std::get<2>(GetParam()))
+        .set_line_numbers(true);
+  }
+};
+
+TEST_P(ProcessLinesInParallelTest, MatchesReadLine) {
+  const std::string text = TestText(500);
+  for (const Position shard_size : {1, 2, 3, 7, 64, 100000}) {
+    for (const Position begin : {0, 5}) {
+      EXPECT_EQ(ReadLinesInParallel(text, begin, options(shard_size)),
+                ReadLinesSequentially(text, begin, read_line_options()))
+          << "Shard size: " << shard_size << ", begin: " << begin;
+    }
+  }
+}
+
+TEST_P(ProcessLinesInParallelTest, CrLfAtShardBoundary) {
+  // With some shift, each shard boundary falls between CR and LF, after CR-LF,
+  // and between two CRs.
+  constexpr Position kShardSize = 4;
+  for (size_t shift = 0; shift < kShardSize; ++shift) {
+    const std::string text =
+        std::string(shift, 'x') + "ab\r\n\r\ncd\r\ref\r\n";
+    EXPECT_EQ(ReadLinesInParallel(text, 0, options(kShardSize)),
+              ReadLinesSequentially(text, 0, read_line_options()))
+        << "Shift: " << shift;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    NewlineKeepNewlineParallelism, ProcessLinesInParallelTest,
+    testing::Combine(testing::Values(ReadNewline::kLf, ReadNewline::kCrLfOrLf,
+                                     ReadNewline::kAny),
+                     testing::Bool(), testing::Values(0, 1, 4)));
+
+TEST(ProcessLinesInParallelTest, FailureStopsProcessing) {
+  const std::string text = TestText(1000);
+  StringReader<> src(text);
+  const absl::Status status = ProcessLinesInParallel(
+      src,
+      [&](absl::string_view, const LinePosition& position) {
+        if (position.pos >= text.size() / 2) {
+          return absl::CancelledError("Second half");
+        }
+        return absl::OkStatus();
+      },
+      ParallelLineReadingOptions().set_shard_size(16).set_parallelism(4));
+  EXPECT_TRUE(absl::IsCancelled(status)) << status;
+  EXPECT_TRUE(src.Close()) << src.status();
+}
+
+TEST(ProcessLinesInParallelTest, MaxLengthExceeded) {
+  const std::string text = "a\nbcdefghij\nk\n";
+  StringReader<> src(text);
+  const absl::Status status = ProcessLinesInParallel(
+      src,
+      [](absl::string_view, const LinePosition&) { return absl::OkStatus(); },
+      ParallelLineReadingOptions()
+          .set_read_line_options(ReadLineOptions().set_max_length(4))
+          .set_shard_size(4)
+          .set_parallelism(2));
+  EXPECT_TRUE(absl::IsResourceExhausted(status)) << status;
+}
+
+}  // namespace
+}  // namespace riegeli
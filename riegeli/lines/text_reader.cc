@@ -134,32 +134,43 @@ bool TextReaderImpl<ReadNewline::kCrLfOrLf>::ReadInternal(size_t min_length,
       ++dest;
       length = 1;
     } else {
-      length = UnsignedMin(src.available(), max_length);
-      const char* cr_ptr =
-          static_cast<const char*>(std::memchr(src.cursor(), '\r', length));
-      if (cr_ptr == nullptr) {
-        std::memcpy(dest, src.cursor(), length);
-        src.move_cursor(length);
-        dest += length;
-      } else {
-        length = PtrDistance(src.cursor(), cr_ptr);
-        std::memcpy(dest, src.cursor(), length);
+      // Convert all CR-LF in the available data at once instead of returning
+      // after each of them, which matters when lines are short.
+      const char* cursor = src.cursor();
+      const char* const limit =
+          cursor + UnsignedMin(src.available(), max_length);
+      char* const dest_start = dest;
+      for (;;) {
+        const char* const cr_ptr = static_cast<const char*>(
+            std::memchr(cursor, '\r', PtrDistance(cursor, limit)));
+        if (cr_ptr == nullptr) {
+          const size_t remaining = PtrDistance(cursor, limit);
+          std::memcpy(dest, cursor, remaining);
+          dest += remaining;
+          cursor = limit;
+          break;
+        }
+        const size_t length_before_cr = PtrDistance(cursor, cr_ptr);
+        std::memcpy(dest, cursor, length_before_cr);
+        dest += length_before_cr;
         if (ABSL_PREDICT_FALSE(cr_ptr == src.limit() - 1)) {
-          src.move_cursor(length + 1);
-          dest += length;
+          cursor = cr_ptr + 1;
           pending_cr_ = true;
+          break;
+        }
+        // The character after the CR is available even if `cr_ptr + 1` is
+        // `limit`, i.e. a CR-LF can extend past `max_length` in the source.
+        if (cr_ptr[1] == '\n') {
+          *dest++ = '\n';
+          cursor = cr_ptr + 2;
         } else {
-          ++length;
-          src.move_cursor(length);
-          dest += length;
-          if (cr_ptr[1] == '\n') {
-            src.move_cursor(1);
-            dest[-1] = '\n';
-          } else {
-            dest[-1] = '\r';
-          }
+          *dest++ = '\r';
+          cursor = cr_ptr + 1;
         }
+        if (cursor >= limit) break;
       }
+      src.set_cursor(cursor);
+      length = PtrDistance(dest_start, dest);
     }
     move_limit_pos(length);
     if (length >= min_length) return true;
@@ -209,26 +220,35 @@ bool TextReaderImpl<ReadNewline::kAny>::ReadInternal(size_t min_length,
         if (ABSL_PREDICT_FALSE(!src.Pull(1, max_length))) return false;
       }
     }
-    size_t length = UnsignedMin(src.available(), max_length);
-    const char* cr_ptr =
-        static_cast<const char*>(std::memchr(src.cursor(), '\r', length));
-    if (cr_ptr == nullptr) {
-      std::memcpy(dest, src.cursor(), length);
-      src.move_cursor(length);
-      dest += length;
-    } else {
-      length = PtrDistance(src.cursor(), cr_ptr);
-      std::memcpy(dest, src.cursor(), length);
-      ++length;
+    // Convert all CR and CR-LF in the available data at once instead of
+    // returning after each of them, which matters when lines are short.
+    const char* cursor = src.cursor();
+    const char* const limit = cursor + UnsignedMin(src.available(), max_length);
+    char* const dest_start = dest;
+    for (;;) {
+      const char* const cr_ptr = static_cast<const char*>(
+          std::memchr(cursor, '\r', PtrDistance(cursor, limit)));
+      if (cr_ptr == nullptr) {
+        const size_t remaining = PtrDistance(cursor, limit);
+        std::memcpy(dest, cursor, remaining);
+        dest += remaining;
+        cursor = limit;
+        break;
+      }
+      const size_t length_before_cr = PtrDistance(cursor, cr_ptr);
+      std::memcpy(dest, cursor, length_before_cr);
+      dest += length_before_cr;
+      *dest++ = '\n';
       if (ABSL_PREDICT_FALSE(cr_ptr == src.limit() - 1)) {
-        src.move_cursor(length);
+        cursor = cr_ptr + 1;
         pending_cr_ = true;
-      } else {
-        src.move_cursor(length + (cr_ptr[1] == '\n' ? 1 : 0));
+        break;
       }
-      dest += length;
-      dest[-1] = '\n';
+      cursor = cr_ptr + (cr_ptr[1] == '\n' ? 2 : 1);
+      if (cursor >= limit) break;
     }
+    src.set_cursor(cursor);
+    const size_t length = PtrDistance(dest_start, dest);
     move_limit_pos(length);
     if (length >= min_length) return true;
     min_length -= length;
@@ -28,6 +28,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message_lite.h"
@@ -36,7 +37,6 @@
 #include "riegeli/base/buffering.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/types.h"
-#include "riegeli/bytes/chain_reader.h"
 #include "riegeli/bytes/cord_reader.h"
 #include "riegeli/bytes/limiting_reader.h"
 #include "riegeli/bytes/reader.h"
@@ -81,6 +81,39 @@ inline absl::Status CheckInitialized(Reader& src,
   return absl::OkStatus();
 }
 
+// Parses from `src` until its end. Returns `false` on a parse error.
+inline bool ParseFromInputStream(google::protobuf::io::ZeroCopyInputStream& src,
+                                 google::protobuf::MessageLite& dest,
+                                 const ParseOptions& options) {
+  if (!options.merge() &&
+      options.recursion_limit() ==
+          google::protobuf::io::CodedInputStream::GetDefaultRecursionLimit()) {
+    return dest.ParsePartialFromZeroCopyStream(&src);
+  }
+  if (!options.merge()) dest.Clear();
+  google::protobuf::io::CodedInputStream coded_stream(&src);
+  coded_stream.SetRecursionLimit(options.recursion_limit());
+  return dest.MergePartialFromCodedStream(&coded_stream) &&
+         coded_stream.ConsumedEntireMessage();
+}
+
+// Parses with `parse` into a new message of the same type as `prototype`.
+template <typename Parse>
+inline absl::Status ParseToNew(const google::protobuf::MessageLite& prototype,
+                               google::protobuf::Arena* arena,
+                               google::protobuf::MessageLite*& dest,
+                               Parse parse) {
+  google::protobuf::MessageLite* const message = prototype.New(arena);
+  absl::Status status = parse(*message);
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    if (arena == nullptr) delete message;
+    dest = nullptr;
+    return status;
+  }
+  dest = message;
+  return status;
+}
+
 }  // namespace
 
 namespace messages_internal {
@@ -224,23 +257,41 @@ absl::Status ParseFromChain(const Chain& src,
       return CheckInitialized(dest, options);
     }
   }
-  ChainReader<> reader(&src);
-  ReaderInputStream input_stream(&reader);
-  bool parse_ok;
+  ChainInputStream input_stream(&src);
+  if (ABSL_PREDICT_FALSE(!ParseFromInputStream(input_stream, dest, options))) {
+    return ParseError(dest);
+  }
+  return CheckInitialized(dest, options);
+}
+
+absl::Status ParseFromChain(const Chain& src, size_t pos, size_t length,
+                            google::protobuf::MessageLite& dest,
+                            ParseOptions options) {
+  RIEGELI_ASSERT_LE(pos, src.size())
+      << "Failed precondition of ParseFromChain(): position out of range";
+  RIEGELI_ASSERT_LE(length, src.size() - pos)
+      << "Failed precondition of ParseFromChain(): length out of range";
+  ChainInputStream input_stream(&src, pos, length);
   if (!options.merge() &&
       options.recursion_limit() ==
           google::protobuf::io::CodedInputStream::GetDefaultRecursionLimit()) {
-    parse_ok = dest.ParsePartialFromZeroCopyStream(&input_stream);
-  } else {
-    if (!options.merge()) dest.Clear();
-    google::protobuf::io::CodedInputStream coded_stream(&input_stream);
-    coded_stream.SetRecursionLimit(options.recursion_limit());
-    parse_ok = dest.MergePartialFromCodedStream(&coded_stream) &&
-               coded_stream.ConsumedEntireMessage();
+    const void* data;
+    int size;
+    if (input_stream.Next(&data, &size)) {
+      if (IntCast<size_t>(size) == length) {
+        // The data are flat. `ParsePartialFromArray()` is faster than
+        // `ParsePartialFromZeroCopyStream()`.
+        if (ABSL_PREDICT_FALSE(!dest.ParsePartialFromArray(data, size))) {
+          return ParseError(dest);
+        }
+        return CheckInitialized(dest, options);
+      }
+      input_stream.BackUp(size);
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!ParseFromInputStream(input_stream, dest, options))) {
+    return ParseError(dest);
   }
-  RIEGELI_ASSERT(reader.ok())
-      << "A ChainReader has no reason to fail: " << reader.status();
-  if (ABSL_PREDICT_FALSE(!parse_ok)) return ParseError(dest);
   return CheckInitialized(dest, options);
 }
 
@@ -281,6 +332,122 @@ absl::Status ParseFromCord(const absl::Cord& src,
   return CheckInitialized(dest, options);
 }
 
+absl::Status ParseFromReaderWithLength(
+    Reader& src, size_t length, const google::protobuf::MessageLite& prototype,
+    google::protobuf::Arena* arena, google::protobuf::MessageLite*& dest,
+    ParseOptions options) {
+  options.set_merge(false);
+  return ParseToNew(prototype, arena, dest,
+                    [&](google::protobuf::MessageLite& message) {
+                      return ParseFromReaderWithLength(src, length, message,
+                                                       std::move(options));
+                    });
+}
+
+absl::Status ParseFromString(absl::string_view src,
+                             const google::protobuf::MessageLite& prototype,
+                             google::protobuf::Arena* arena,
+                             google::protobuf::MessageLite*& dest,
+                             ParseOptions options) {
+  options.set_merge(false);
+  return ParseToNew(prototype, arena, dest,
+                    [&](google::protobuf::MessageLite& message) {
+                      return ParseFromString(src, message, std::move(options));
+                    });
+}
+
+absl::Status ParseFromChain(const Chain& src,
+                            const google::protobuf::MessageLite& prototype,
+                            google::protobuf::Arena* arena,
+                            google::protobuf::MessageLite*& dest,
+                            ParseOptions options) {
+  options.set_merge(false);
+  return ParseToNew(prototype, arena, dest,
+                    [&](google::protobuf::MessageLite& message) {
+                      return ParseFromChain(src, message, std::move(options));
+                    });
+}
+
+absl::Status ParseFromCord(const absl::Cord& src,
+                           const google::protobuf::MessageLite& prototype,
+                           google::protobuf::Arena* arena,
+                           google::protobuf::MessageLite*& dest,
+                           ParseOptions options) {
+  options.set_merge(false);
+  return ParseToNew(prototype, arena, dest,
+                    [&](google::protobuf::MessageLite& message) {
+                      return ParseFromCord(src, message, std::move(options));
+                    });
+}
+
+ChainInputStream::ChainInputStream(const Chain* src, size_t pos, size_t length)
+    : src_(RIEGELI_ASSERT_NOTNULL(src)),
+      begin_(pos),
+      end_(pos + length),
+      pos_(pos) {
+  RIEGELI_ASSERT_LE(pos, src_->size())
+      << "Failed precondition of ChainInputStream: position out of range";
+  RIEGELI_ASSERT_LE(length, src_->size() - pos)
+      << "Failed precondition of ChainInputStream: length out of range";
+  const Chain::BlockAndChar block_and_char = src_->BlockAndCharIndex(pos);
+  block_iter_ = block_and_char.block_iter;
+  char_index_ = block_and_char.char_index;
+}
+
+bool ChainInputStream::Next(const void** data, int* size) {
+  if (ABSL_PREDICT_FALSE(pos_ == end_)) return false;
+  while (char_index_ == block_iter_->size()) {
+    ++block_iter_;
+    char_index_ = 0;
+  }
+  const size_t length =
+      UnsignedMin(block_iter_->size() - char_index_, end_ - pos_,
+                  size_t{std::numeric_limits<int>::max()});
+  *data = block_iter_->data() + char_index_;
+  *size = IntCast<int>(length);
+  char_index_ += length;
+  pos_ += length;
+  return true;
+}
+
+void ChainInputStream::BackUp(int length) {
+  RIEGELI_ASSERT_GE(length, 0)
+      << "Failed precondition of ZeroCopyInputStream::BackUp(): "
+         "negative length";
+  RIEGELI_ASSERT_LE(IntCast<size_t>(length), char_index_)
+      << "Failed precondition of ZeroCopyInputStream::BackUp(): "
+         "length larger than the amount of buffered data";
+  char_index_ -= IntCast<size_t>(length);
+  pos_ -= IntCast<size_t>(length);
+}
+
+bool ChainInputStream::Skip(int length) {
+  RIEGELI_ASSERT_GE(length, 0)
+      << "Failed precondition of ZeroCopyInputStream::Skip(): negative length";
+  if (ABSL_PREDICT_FALSE(IntCast<size_t>(length) > end_ - pos_)) {
+    pos_ = end_;
+    const Chain::BlockAndChar block_and_char = src_->BlockAndCharIndex(pos_);
+    block_iter_ = block_and_char.block_iter;
+    char_index_ = block_and_char.char_index;
+    return false;
+  }
+  if (pos_ < end_ &&
+      IntCast<size_t>(length) <= block_iter_->size() - char_index_) {
+    char_index_ += IntCast<size_t>(length);
+    pos_ += IntCast<size_t>(length);
+    return true;
+  }
+  pos_ += IntCast<size_t>(length);
+  const Chain::BlockAndChar block_and_char = src_->BlockAndCharIndex(pos_);
+  block_iter_ = block_and_char.block_iter;
+  char_index_ = block_and_char.char_index;
+  return true;
+}
+
+int64_t ChainInputStream::ByteCount() const {
+  return IntCast<int64_t>(pos_ - begin_);
+}
+
 bool ReaderInputStream::Next(const void** data, int* size) {
   if (ABSL_PREDICT_FALSE(src_->pos() >=
                          Position{std::numeric_limits<int64_t>::max()})) {
@@ -25,6 +25,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/message_lite.h"
@@ -160,6 +161,21 @@ absl::Status ParseFromChain(const Chain& src,
                             google::protobuf::MessageLite& dest,
                             ParseOptions options = ParseOptions());
 
+// Reads a message in binary format from `length` bytes of the given `Chain`
+// starting at `pos`.
+//
+// Blocks of `src` are given to the parser directly, without flattening and
+// without an intermediate `Reader`.
+//
+// Precondition: `pos + length <= src.size()`
+//
+// Returns status:
+//  * `status.ok()`  - success (`dest` is filled)
+//  * `!status.ok()` - failure (`dest` is unspecified)
+absl::Status ParseFromChain(const Chain& src, size_t pos, size_t length,
+                            google::protobuf::MessageLite& dest,
+                            ParseOptions options = ParseOptions());
+
 // Reads a message in binary format from the given `absl::Cord`.
 //
 // Returns status:
@@ -169,6 +185,39 @@ absl::Status ParseFromCord(const absl::Cord& src,
                            google::protobuf::MessageLite& dest,
                            ParseOptions options = ParseOptions());
 
+// Variants of the functions above which parse into a new message of the same
+// type as `prototype`, allocated on `arena`, or on the heap and owned by the
+// caller if `arena == nullptr`.
+//
+// Allocating the message on an arena makes its submessages, strings, and
+// repeated fields allocated on the arena too, which avoids most of the cost of
+// memory allocation for deeply nested messages.
+//
+// `ParseOptions::merge()` is irrelevant because the message is new.
+//
+// Returns status:
+//  * `status.ok()`  - success (`dest` is set to the new message)
+//  * `!status.ok()` - failure (`dest` is set to `nullptr`)
+absl::Status ParseFromReaderWithLength(
+    Reader& src, size_t length, const google::protobuf::MessageLite& prototype,
+    google::protobuf::Arena* arena, google::protobuf::MessageLite*& dest,
+    ParseOptions options = ParseOptions());
+absl::Status ParseFromString(absl::string_view src,
+                             const google::protobuf::MessageLite& prototype,
+                             google::protobuf::Arena* arena,
+                             google::protobuf::MessageLite*& dest,
+                             ParseOptions options = ParseOptions());
+absl::Status ParseFromChain(const Chain& src,
+                            const google::protobuf::MessageLite& prototype,
+                            google::protobuf::Arena* arena,
+                            google::protobuf::MessageLite*& dest,
+                            ParseOptions options = ParseOptions());
+absl::Status ParseFromCord(const absl::Cord& src,
+                           const google::protobuf::MessageLite& prototype,
+                           google::protobuf::Arena* arena,
+                           google::protobuf::MessageLite*& dest,
+                           ParseOptions options = ParseOptions());
+
 // Adapts a `Reader` to a `google::protobuf::io::ZeroCopyInputStream`.
 class ReaderInputStream : public google::protobuf::io::ZeroCopyInputStream {
  public:
@@ -183,6 +232,37 @@ class ReaderInputStream : public google::protobuf::io::ZeroCopyInputStream {
   Reader* src_;
 };
 
+// Adapts a fragment of a `Chain` to a
+// `google::protobuf::io::ZeroCopyInputStream`. Blocks of the `Chain` are
+// returned directly.
+class ChainInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  // Will read all of `*src`.
+  explicit ChainInputStream(const Chain* src)
+      : ChainInputStream(src, 0, RIEGELI_ASSERT_NOTNULL(src)->size()) {}
+
+  // Will read `length` bytes of `*src` starting at `pos`.
+  //
+  // Precondition: `pos + length <= src->size()`
+  explicit ChainInputStream(const Chain* src, size_t pos, size_t length);
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int length) override;
+  bool Skip(int length) override;
+  int64_t ByteCount() const override;
+
+ private:
+  const Chain* src_;
+  size_t begin_;
+  size_t end_;
+  // Position in `*src_` of the next data to return.
+  size_t pos_;
+  // Block containing `pos_`, and the position of `pos_` in that block, which
+  // can be the end of the block.
+  Chain::BlockIterator block_iter_;
+  size_t char_index_;
+};
+
 // Implementation details follow.
 
 namespace messages_internal {
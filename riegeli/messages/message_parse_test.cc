@@ -0,0 +1,236 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/messages/message_parse.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/chain.h"
+
+namespace riegeli {
+namespace {
+
+// Returns a `Chain` with the given blocks. Blocks are large enough not to be
+// merged when appended.
+Chain ChainWithBlocks(const std::vector<std::string>& blocks) {
+  Chain chain;
+  for (const std::string& block : blocks) {
+    chain.Append(Chain::FromExternal(std::string(block)));
+  }
+  EXPECT_EQ(chain.blocks().size(), blocks.size());
+  return chain;
+}
+
+std::vector<std::string> TestBlocks() {
+  std::vector<std::string> blocks;
+  for (size_t i = 0; i < 5; ++i) {
+    blocks.emplace_back(1000 + i * 300, static_cast<char>('a' + i));
+  }
+  return blocks;
+}
+
+std::string Concat(const std::vector<std::string>& blocks) {
+  std::string result;
+  for (const std::string& block : blocks) result.append(block);
+  return result;
+}
+
+TEST(ChainInputStreamTest, NextReturnsBlocks) {
+  const std::vector<std::string> blocks = TestBlocks();
+  const Chain chain = ChainWithBlocks(blocks);
+  ChainInputStream input_stream(&chain);
+  size_t byte_count = 0;
+  for (const std::string& block : blocks) {
+    const void* data;
+    int size;
+    ASSERT_TRUE(input_stream.Next(&data, &size));
+    EXPECT_EQ(absl::string_view(static_cast<const char*>(data),
+                                static_cast<size_t>(size)),
+              block);
+    byte_count += block.size();
+    EXPECT_EQ(input_stream.ByteCount(), static_cast<int64_t>(byte_count));
+  }
+  const void* data;
+  int size;
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  EXPECT_EQ(input_stream.ByteCount(), static_cast<int64_t>(chain.size()));
+}
+
+TEST(ChainInputStreamTest, BackUpAndSkip) {
+  const std::vector<std::string> blocks = TestBlocks();
+  const Chain chain = ChainWithBlocks(blocks);
+  const std::string flat = Concat(blocks);
+  ChainInputStream input_stream(&chain);
+  const void* data;
+  int size;
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  ASSERT_EQ(static_cast<size_t>(size), blocks[0].size());
+  input_stream.BackUp(100);
+  EXPECT_EQ(input_stream.ByteCount(), size - 100);
+  // The backed up data are returned again.
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(size, 100);
+  EXPECT_EQ(static_cast<const char*>(data),
+            chain.blocks().front().data() + blocks[0].size() - 100);
+  // Skip within a block.
+  ASSERT_TRUE(input_stream.Skip(10));
+  EXPECT_EQ(input_stream.ByteCount(),
+            static_cast<int64_t>(blocks[0].size() + 10));
+  // Skip across blocks.
+  ASSERT_TRUE(input_stream.Skip(static_cast<int>(blocks[1].size())));
+  size_t pos = blocks[0].size() + blocks[1].size() + 10;
+  EXPECT_EQ(input_stream.ByteCount(), static_cast<int64_t>(pos));
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data),
+                              static_cast<size_t>(size)),
+            absl::string_view(flat).substr(pos, blocks[2].size() - 10));
+  // Skip beyond the end.
+  EXPECT_FALSE(input_stream.Skip(static_cast<int>(flat.size())));
+  EXPECT_EQ(input_stream.ByteCount(), static_cast<int64_t>(flat.size()));
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+}
+
+TEST(ChainInputStreamTest, RandomOperationsOnFragment) {
+  const std::vector<std::string> blocks = TestBlocks();
+  const Chain chain = ChainWithBlocks(blocks);
+  const std::string flat = Concat(blocks);
+  std::mt19937 random(1);
+  for (int iteration = 0; iteration < 1000; ++iteration) {
+    const size_t begin = random() % (flat.size() + 1);
+    const size_t length = random() % (flat.size() - begin + 1);
+    const absl::string_view expected =
+        absl::string_view(flat).substr(begin, length);
+    ChainInputStream input_stream(&chain, begin, length);
+    // Position relative to `begin`, and the length returned by the last
+    // `Next()` which may be backed up.
+    size_t pos = 0;
+    size_t available_to_back_up = 0;
+    for (int operation = 0; operation < 20; ++operation) {
+      switch (random() % 3) {
+        case 0: {
+          const void* data;
+          int size;
+          if (pos == length) {
+            EXPECT_FALSE(input_stream.Next(&data, &size));
+            available_to_back_up = 0;
+            break;
+          }
+          ASSERT_TRUE(input_stream.Next(&data, &size));
+          ASSERT_GT(size, 0);
+          ASSERT_EQ(absl::string_view(static_cast<const char*>(data),
+                                      static_cast<size_t>(size)),
+                    expected.substr(pos, static_cast<size_t>(size)));
+          pos += static_cast<size_t>(size);
+          available_to_back_up = static_cast<size_t>(size);
+          break;
+        }
+        case 1: {
+          const size_t back_up_length =
+              random() % (available_to_back_up + 1);
+          input_stream.BackUp(static_cast<int>(back_up_length));
+          pos -= back_up_length;
+          available_to_back_up = 0;
+          break;
+        }
+        case 2: {
+          const size_t skip_length = random() % 3000;
+          EXPECT_EQ(input_stream.Skip(static_cast<int>(skip_length)),
+                    skip_length <= length - pos);
+          pos = UnsignedMin(pos + skip_length, length);
+          available_to_back_up = 0;
+          break;
+        }
+      }
+      ASSERT_EQ(input_stream.ByteCount(), static_cast<int64_t>(pos))
+          << "begin " << begin << ", length " << length;
+    }
+  }
+}
+
+google::protobuf::FileDescriptorProto TestMessage(size_t num_messages) {
+  google::protobuf::FileDescriptorProto message;
+  message.set_name("test.proto");
+  message.set_package("riegeli.test");
+  for (size_t i = 0; i < num_messages; ++i) {
+    message.add_message_type()->set_name(absl::StrCat("Message", i));
+  }
+  return message;
+}
+
+// Parses a message from the middle of a `Chain`, where it is surrounded by 500
+// bytes of other data on each side, and the `Chain` is split into blocks at
+// `split_points`.
+void TestParseFragment(size_t num_messages,
+                       const std::vector<size_t>& split_points) {
+  const google::protobuf::FileDescriptorProto message =
+      TestMessage(num_messages);
+  const std::string prefix(500, '\xff');
+  const std::string flat = absl::StrCat(prefix, message.SerializeAsString(),
+                                        std::string(500, '\xff'));
+  std::vector<std::string> blocks;
+  size_t begin = 0;
+  for (const size_t split_point : split_points) {
+    blocks.push_back(flat.substr(begin, split_point - begin));
+    begin = split_point;
+  }
+  blocks.push_back(flat.substr(begin));
+  const Chain chain = ChainWithBlocks(blocks);
+  google::protobuf::FileDescriptorProto parsed;
+  const absl::Status status = ParseFromChain(
+      chain, prefix.size(), message.ByteSizeLong(), parsed);
+  ASSERT_TRUE(status.ok()) << status;
+  EXPECT_EQ(parsed.SerializeAsString(), message.SerializeAsString());
+}
+
+TEST(ParseFromChainTest, FragmentInOneBlock) {
+  for (const size_t num_messages : {10, 2000}) {
+    // The message is in the middle block, which is parsed in place even if it
+    // is large.
+    const size_t size = TestMessage(num_messages).ByteSizeLong();
+    TestParseFragment(num_messages, {400, 500 + size + 100});
+  }
+}
+
+TEST(ParseFromChainTest, FragmentAcrossBlocks) {
+  TestParseFragment(10, {550});
+  TestParseFragment(50, {300, 600, 900});
+  TestParseFragment(2000, {600, 5000, 10000});
+}
+
+TEST(ParseFromChainTest, TruncatedFragmentFails) {
+  const google::protobuf::FileDescriptorProto message = TestMessage(100);
+  const std::string serialized = message.SerializeAsString();
+  const Chain chain = ChainWithBlocks(
+      {serialized.substr(0, serialized.size() / 2),
+       serialized.substr(serialized.size() / 2)});
+  google::protobuf::FileDescriptorProto parsed;
+  // Cut in the middle of the last message type name.
+  EXPECT_FALSE(ParseFromChain(chain, 0, serialized.size() - 1, parsed).ok());
+  EXPECT_TRUE(ParseFromChain(chain, 0, serialized.size(), parsed).ok());
+}
+
+}  // namespace
+}  // namespace riegeli
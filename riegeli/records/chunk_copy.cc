@@ -0,0 +1,186 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/chunk_copy.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/chunk_encoding/chunk.h"
+#include "riegeli/chunk_encoding/constants.h"
+#include "riegeli/records/chunk_reader.h"
+#include "riegeli/records/chunk_writer.h"
+
+namespace riegeli {
+
+namespace {
+
+bool WriteSignature(ChunkWriter& dest) {
+  Chunk chunk;
+  chunk.header = ChunkHeader(chunk.data, ChunkType::kFileSignature, 0, 0);
+  return dest.WriteChunk(chunk);
+}
+
+// Returns `true` if a chunk of this type is a part of the file header rather
+// than of file contents.
+inline bool IsHeaderChunk(ChunkType chunk_type) {
+  return chunk_type == ChunkType::kFileSignature ||
+         chunk_type == ChunkType::kFileMetadata ||
+         chunk_type == ChunkType::kPadding;
+}
+
+// Copies chunks of file contents from `src` to `dest`, preceded by the file
+// metadata chunk if `keep_metadata`.
+absl::Status CopyChunks(ChunkReader& src, bool keep_metadata,
+                        ChunkWriter& dest) {
+  Chunk chunk;
+  while (src.ReadChunk(chunk)) {
+    const ChunkType chunk_type = chunk.header.chunk_type();
+    if (IsHeaderChunk(chunk_type) &&
+        !(chunk_type == ChunkType::kFileMetadata && keep_metadata)) {
+      continue;
+    }
+    if (ABSL_PREDICT_FALSE(!dest.WriteChunk(chunk))) return dest.status();
+  }
+  if (ABSL_PREDICT_FALSE(!src.ok())) return src.status();
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status ConcatenateChunks(absl::Span<ChunkReader* const> srcs,
+                               ChunkWriter& dest,
+                               const ConcatenateOptions& options) {
+  if (ABSL_PREDICT_FALSE(!WriteSignature(dest))) return dest.status();
+  for (size_t i = 0; i < srcs.size(); ++i) {
+    absl::Status status =
+        CopyChunks(*srcs[i], i == 0 && options.keep_metadata(), dest);
+    if (ABSL_PREDICT_FALSE(!status.ok())) return status;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ConcatenateFiles(absl::Span<const std::string> src_filenames,
+                              absl::string_view dest_filename,
+                              const ConcatenateOptions& options) {
+  DefaultChunkWriter<FdWriter<>> dest(std::forward_as_tuple(dest_filename));
+  absl::Status status;
+  if (ABSL_PREDICT_FALSE(!WriteSignature(dest))) {
+    status = dest.status();
+  } else {
+    // Open each source only while it is copied, so that the number of sources
+    // is not limited by the number of file descriptors.
+    for (size_t i = 0; i < src_filenames.size(); ++i) {
+      DefaultChunkReader<FdReader<>> src(
+          std::forward_as_tuple(src_filenames[i]));
+      status = CopyChunks(src, i == 0 && options.keep_metadata(), dest);
+      if (ABSL_PREDICT_FALSE(!src.Close())) status.Update(src.status());
+      if (ABSL_PREDICT_FALSE(!status.ok())) break;
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!dest.Close())) status.Update(dest.status());
+  return status;
+}
+
+absl::Status SplitChunks(
+    ChunkReader& src, absl::FunctionRef<ChunkWriter*(size_t shard_index)> shard,
+    const SplitOptions& options) {
+  absl::optional<Chunk> metadata;
+  ChunkWriter* dest = nullptr;
+  size_t shard_index = 0;
+  Position shard_begin = 0;
+  uint64_t shard_records = 0;
+  const auto start_shard = [&]() -> absl::Status {
+    dest = shard(shard_index++);
+    if (ABSL_PREDICT_FALSE(dest == nullptr)) {
+      return absl::CancelledError("Splitting cancelled");
+    }
+    shard_begin = dest->pos();
+    shard_records = 0;
+    if (ABSL_PREDICT_FALSE(!WriteSignature(*dest))) return dest->status();
+    if (metadata != absl::nullopt) {
+      if (ABSL_PREDICT_FALSE(!dest->WriteChunk(*metadata))) {
+        return dest->status();
+      }
+    }
+    return absl::OkStatus();
+  };
+  Chunk chunk;
+  while (src.ReadChunk(chunk)) {
+    const ChunkType chunk_type = chunk.header.chunk_type();
+    if (IsHeaderChunk(chunk_type)) {
+      if (chunk_type == ChunkType::kFileMetadata && options.keep_metadata() &&
+          dest == nullptr) {
+        metadata = chunk;
+      }
+      continue;
+    }
+    if (dest == nullptr ||
+        (shard_records > 0 &&
+         (chunk.header.num_records() >
+              options.max_shard_records() - shard_records ||
+          ChunkHeader::size() + chunk.header.data_size() >
+              options.max_shard_size() -
+                  UnsignedMin(dest->pos() - shard_begin,
+                              options.max_shard_size())))) {
+      absl::Status status = start_shard();
+      if (ABSL_PREDICT_FALSE(!status.ok())) return status;
+    }
+    if (ABSL_PREDICT_FALSE(!dest->WriteChunk(chunk))) return dest->status();
+    shard_records += chunk.header.num_records();
+  }
+  if (ABSL_PREDICT_FALSE(!src.ok())) return src.status();
+  if (dest == nullptr) return start_shard();
+  return absl::OkStatus();
+}
+
+absl::Status SplitFile(
+    absl::string_view src_filename,
+    absl::FunctionRef<std::string(size_t shard_index)> dest_filename,
+    const SplitOptions& options) {
+  DefaultChunkReader<FdReader<>> src(std::forward_as_tuple(src_filename));
+  DefaultChunkWriter<FdWriter<>> dest(kClosed);
+  absl::Status close_status;
+  absl::Status status = SplitChunks(
+      src,
+      [&](size_t shard_index) -> ChunkWriter* {
+        if (ABSL_PREDICT_FALSE(!dest.Close())) {
+          close_status = dest.status();
+          return nullptr;
+        }
+        dest.Reset(std::forward_as_tuple(dest_filename(shard_index)));
+        return &dest;
+      },
+      options);
+  if (ABSL_PREDICT_FALSE(!close_status.ok())) status = std::move(close_status);
+  if (ABSL_PREDICT_FALSE(!dest.Close())) status.Update(dest.status());
+  if (ABSL_PREDICT_FALSE(!src.Close())) status.Update(src.status());
+  return status;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,162 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_CHUNK_COPY_H_
+#define RIEGELI_RECORDS_CHUNK_COPY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "riegeli/base/types.h"
+#include "riegeli/records/chunk_reader.h"
+#include "riegeli/records/chunk_writer.h"
+
+namespace riegeli {
+
+// Functions in this file copy chunks of Riegeli/records files without decoding
+// records. Chunk data are transferred as `Chain` blocks; only block headers,
+// which depend on chunk positions, are recomputed by the `ChunkWriter`.
+//
+// Padding chunks are dropped. Chunks of unknown types are copied.
+
+class ConcatenateOptions {
+ public:
+  ConcatenateOptions() noexcept {}
+
+  // If `true`, the file metadata chunk of the first source is written to the
+  // destination. File metadata of other sources are always dropped, because
+  // file metadata can only follow the file signature.
+  //
+  // Default: `true`.
+  ConcatenateOptions& set_keep_metadata(bool keep_metadata) & {
+    keep_metadata_ = keep_metadata;
+    return *this;
+  }
+  ConcatenateOptions&& set_keep_metadata(bool keep_metadata) && {
+    return std::move(set_keep_metadata(keep_metadata));
+  }
+  bool keep_metadata() const { return keep_metadata_; }
+
+ private:
+  bool keep_metadata_ = true;
+};
+
+// Writes a file signature to `dest`, followed by chunks read from each of
+// `srcs` in turn.
+//
+// `srcs` and `dest` are not closed.
+//
+// Returns status:
+//  * `status.ok()`  - success
+//  * `!status.ok()` - failure
+absl::Status ConcatenateChunks(
+    absl::Span<ChunkReader* const> srcs, ChunkWriter& dest,
+    const ConcatenateOptions& options = ConcatenateOptions());
+
+// Like `ConcatenateChunks()`, but reads the files named `src_filenames` and
+// writes the file named `dest_filename`. Each source file is open only while
+// it is being copied.
+absl::Status ConcatenateFiles(
+    absl::Span<const std::string> src_filenames,
+    absl::string_view dest_filename,
+    const ConcatenateOptions& options = ConcatenateOptions());
+
+class SplitOptions {
+ public:
+  SplitOptions() noexcept {}
+
+  // A new shard is started before a chunk which would make the shard longer
+  // than `max_shard_size` bytes, unless the shard has no records yet. Block
+  // headers interleaved with the next chunk are not counted, so the limit is
+  // approximate.
+  //
+  // Default: `std::numeric_limits<Position>::max()`.
+  SplitOptions& set_max_shard_size(Position max_shard_size) & {
+    max_shard_size_ = max_shard_size;
+    return *this;
+  }
+  SplitOptions&& set_max_shard_size(Position max_shard_size) && {
+    return std::move(set_max_shard_size(max_shard_size));
+  }
+  Position max_shard_size() const { return max_shard_size_; }
+
+  // A new shard is started before a chunk which would make the shard contain
+  // more than `max_shard_records` records, unless the shard has no records
+  // yet.
+  //
+  // Default: `std::numeric_limits<uint64_t>::max()`.
+  SplitOptions& set_max_shard_records(uint64_t max_shard_records) & {
+    max_shard_records_ = max_shard_records;
+    return *this;
+  }
+  SplitOptions&& set_max_shard_records(uint64_t max_shard_records) && {
+    return std::move(set_max_shard_records(max_shard_records));
+  }
+  uint64_t max_shard_records() const { return max_shard_records_; }
+
+  // If `true`, the file metadata chunk of the source is written to each shard.
+  //
+  // Default: `true`.
+  SplitOptions& set_keep_metadata(bool keep_metadata) & {
+    keep_metadata_ = keep_metadata;
+    return *this;
+  }
+  SplitOptions&& set_keep_metadata(bool keep_metadata) && {
+    return std::move(set_keep_metadata(keep_metadata));
+  }
+  bool keep_metadata() const { return keep_metadata_; }
+
+ private:
+  Position max_shard_size_ = std::numeric_limits<Position>::max();
+  uint64_t max_shard_records_ = std::numeric_limits<uint64_t>::max();
+  bool keep_metadata_ = true;
+};
+
+// Reads chunks from `src` and distributes them among consecutive shards on
+// chunk boundaries. Records are never split between shards, so a shard can
+// exceed the limits if a single chunk does.
+//
+// `shard(shard_index)` is called with consecutive indices starting from 0 and
+// returns the `ChunkWriter` of the next shard, which must remain valid until
+// the next call of `shard()` or until `SplitChunks()` returns. It is called
+// at least once, even if `src` has no records. If it returns `nullptr`,
+// splitting is aborted and `absl::CancelledError()` is returned.
+//
+// Each shard begins with a file signature. `src` and shards are not closed.
+//
+// Returns status:
+//  * `status.ok()`  - success
+//  * `!status.ok()` - failure
+absl::Status SplitChunks(
+    ChunkReader& src, absl::FunctionRef<ChunkWriter*(size_t shard_index)> shard,
+    const SplitOptions& options = SplitOptions());
+
+// Like `SplitChunks()`, but reads the file named `src_filename` and writes
+// shards to files named `dest_filename(shard_index)`.
+absl::Status SplitFile(
+    absl::string_view src_filename,
+    absl::FunctionRef<std::string(size_t shard_index)> dest_filename,
+    const SplitOptions& options = SplitOptions());
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_CHUNK_COPY_H_
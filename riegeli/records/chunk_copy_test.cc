@@ -0,0 +1,299 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/chunk_copy.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/chunk_encoding/chunk.h"
+#include "riegeli/records/chunk_reader.h"
+#include "riegeli/records/chunk_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+#include "riegeli/records/records_metadata.pb.h"
+
+namespace riegeli {
+namespace {
+
+RecordWriterBase::Options WriterOptions(absl::string_view file_comment) {
+  RecordsMetadata metadata;
+  metadata.set_file_comment(std::string(file_comment));
+  return RecordWriterBase::Options()
+      .set_uncompressed()
+      .set_chunk_size(1000)
+      .set_metadata(std::move(metadata));
+}
+
+// Returns records with the given prefix, large enough that a chunk contains
+// several of them.
+std::vector<std::string> TestRecords(absl::string_view prefix,
+                                     size_t num_records) {
+  std::vector<std::string> records;
+  for (size_t i = 0; i < num_records; ++i) {
+    std::string record = absl::StrCat(prefix, ":", i);
+    record.resize(99, '.');
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+std::string WriteRecords(const std::vector<std::string>& records,
+                         absl::string_view file_comment) {
+  std::string data;
+  RecordWriter<StringWriter<>> writer(std::forward_as_tuple(&data),
+                                      WriterOptions(file_comment));
+  for (const std::string& record : records) {
+    EXPECT_TRUE(writer.WriteRecord(record)) << writer.status();
+  }
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  return data;
+}
+
+template <typename Src>
+std::vector<std::string> ReadRecords(Src&& src, std::string* file_comment) {
+  RecordReader<std::decay_t<Src>> reader(std::forward<Src>(src));
+  RecordsMetadata metadata;
+  EXPECT_TRUE(reader.ReadMetadata(metadata)) << reader.status();
+  if (file_comment != nullptr) *file_comment = metadata.file_comment();
+  std::vector<std::string> records;
+  std::string record;
+  while (reader.ReadRecord(record)) records.push_back(record);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  return records;
+}
+
+// Returns the numbers of records of chunks of `data` with records.
+std::vector<uint64_t> ChunkRecordCounts(const std::string& data) {
+  DefaultChunkReader<StringReader<>> src(std::forward_as_tuple(data));
+  std::vector<uint64_t> counts;
+  Chunk chunk;
+  while (src.ReadChunk(chunk)) {
+    if (chunk.header.num_records() > 0) {
+      counts.push_back(chunk.header.num_records());
+    }
+  }
+  EXPECT_TRUE(src.Close()) << src.status();
+  return counts;
+}
+
+// Returns the size of the first chunk of `data` with records, including its
+// header.
+Position FirstChunkSize(const std::string& data) {
+  DefaultChunkReader<StringReader<>> src(std::forward_as_tuple(data));
+  Chunk chunk;
+  while (src.ReadChunk(chunk)) {
+    if (chunk.header.num_records() > 0) {
+      return ChunkHeader::size() + chunk.header.data_size();
+    }
+  }
+  ADD_FAILURE() << "No chunk with records";
+  return 0;
+}
+
+// Splits `data` with `options`, and returns the shards.
+std::vector<std::string> Split(const std::string& data,
+                               const SplitOptions& options) {
+  DefaultChunkReader<StringReader<>> src(std::forward_as_tuple(data));
+  std::vector<std::unique_ptr<std::string>> shards;
+  std::unique_ptr<DefaultChunkWriter<StringWriter<>>> dest;
+  const absl::Status status = SplitChunks(
+      src,
+      [&](size_t shard_index) -> ChunkWriter* {
+        EXPECT_EQ(shard_index, shards.size());
+        if (dest != nullptr) EXPECT_TRUE(dest->Close()) << dest->status();
+        shards.push_back(std::make_unique<std::string>());
+        dest = std::make_unique<DefaultChunkWriter<StringWriter<>>>(
+            std::forward_as_tuple(shards.back().get()));
+        return dest.get();
+      },
+      options);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_TRUE(dest->Close()) << dest->status();
+  EXPECT_TRUE(src.Close()) << src.status();
+  std::vector<std::string> result;
+  for (const std::unique_ptr<std::string>& shard : shards) {
+    result.push_back(*shard);
+  }
+  return result;
+}
+
+TEST(SplitChunksTest, MaxShardRecords) {
+  constexpr uint64_t kMaxShardRecords = 35;
+  const std::vector<std::string> records = TestRecords("record", 1000);
+  const std::string data = WriteRecords(records, "comment");
+  // Each shard takes whole chunks, as many as fit.
+  std::vector<uint64_t> expected_shard_records = {0};
+  for (const uint64_t chunk_records : ChunkRecordCounts(data)) {
+    ASSERT_LE(chunk_records, kMaxShardRecords);
+    if (expected_shard_records.back() + chunk_records > kMaxShardRecords) {
+      expected_shard_records.push_back(0);
+    }
+    expected_shard_records.back() += chunk_records;
+  }
+  const std::vector<std::string> shards =
+      Split(data, SplitOptions().set_max_shard_records(kMaxShardRecords));
+  ASSERT_EQ(shards.size(), expected_shard_records.size());
+  std::vector<std::string> read_records;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    std::string file_comment;
+    const std::vector<std::string> shard_records =
+        ReadRecords(StringReader<>(shards[i]), &file_comment);
+    // The metadata are kept in every shard.
+    EXPECT_EQ(file_comment, "comment") << "Shard " << i;
+    EXPECT_EQ(shard_records.size(), expected_shard_records[i])
+        << "Shard " << i;
+    read_records.insert(read_records.end(), shard_records.begin(),
+                        shard_records.end());
+  }
+  EXPECT_EQ(read_records, records);
+}
+
+TEST(SplitChunksTest, MaxShardSize) {
+  constexpr Position kMaxShardSize = 10000;
+  const std::vector<std::string> records = TestRecords("record", 1000);
+  const std::string data = WriteRecords(records, "comment");
+  const std::vector<std::string> shards =
+      Split(data, SplitOptions().set_max_shard_size(kMaxShardSize));
+  EXPECT_GT(shards.size(), 10u);
+  std::vector<std::string> read_records;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    // Block headers are not counted, and shards are small enough to have at
+    // most one.
+    EXPECT_LE(shards[i].size(), kMaxShardSize + 24) << "Shard " << i;
+    if (i + 1 < shards.size()) {
+      // The next chunk did not fit.
+      EXPECT_GT(shards[i].size() + FirstChunkSize(shards[i + 1]),
+                kMaxShardSize)
+          << "Shard " << i;
+    }
+    std::string file_comment;
+    const std::vector<std::string> shard_records =
+        ReadRecords(StringReader<>(shards[i]), &file_comment);
+    EXPECT_EQ(file_comment, "comment") << "Shard " << i;
+    read_records.insert(read_records.end(), shard_records.begin(),
+                        shard_records.end());
+  }
+  EXPECT_EQ(read_records, records);
+}
+
+TEST(SplitChunksTest, ChunkLargerThanLimit) {
+  const std::vector<std::string> records = TestRecords("record", 100);
+  const std::string data = WriteRecords(records, "comment");
+  // A shard gets at least one chunk even if it exceeds the limits.
+  const std::vector<uint64_t> chunk_records = ChunkRecordCounts(data);
+  const std::vector<std::string> shards = Split(
+      data, SplitOptions().set_max_shard_records(1).set_max_shard_size(1));
+  ASSERT_EQ(shards.size(), chunk_records.size());
+  for (size_t i = 0; i < shards.size(); ++i) {
+    EXPECT_EQ(ReadRecords(StringReader<>(shards[i]), nullptr).size(),
+              chunk_records[i])
+        << "Shard " << i;
+  }
+}
+
+TEST(SplitChunksTest, WithoutMetadata) {
+  const std::string data =
+      WriteRecords(TestRecords("record", 100), "comment");
+  const std::vector<std::string> shards = Split(
+      data, SplitOptions().set_max_shard_records(50).set_keep_metadata(false));
+  ASSERT_GT(shards.size(), 1u);
+  for (const std::string& shard : shards) {
+    std::string file_comment;
+    ReadRecords(StringReader<>(shard), &file_comment);
+    EXPECT_EQ(file_comment, "");
+  }
+}
+
+TEST(ConcatenateChunksTest, ReadsBackRecords) {
+  std::vector<std::string> datas;
+  std::vector<std::string> records;
+  for (size_t i = 0; i < 5; ++i) {
+    const std::vector<std::string> file_records =
+        TestRecords(absl::StrCat("file", i), 20 + i * 7);
+    datas.push_back(WriteRecords(file_records, absl::StrCat("comment", i)));
+    records.insert(records.end(), file_records.begin(), file_records.end());
+  }
+  std::vector<std::unique_ptr<DefaultChunkReader<StringReader<>>>> srcs;
+  std::vector<ChunkReader*> src_ptrs;
+  for (const std::string& data : datas) {
+    srcs.push_back(std::make_unique<DefaultChunkReader<StringReader<>>>(
+        std::forward_as_tuple(data)));
+    src_ptrs.push_back(srcs.back().get());
+  }
+  std::string concatenated;
+  DefaultChunkWriter<StringWriter<>> dest(std::forward_as_tuple(&concatenated));
+  const absl::Status status = ConcatenateChunks(src_ptrs, dest);
+  ASSERT_TRUE(status.ok()) << status;
+  ASSERT_TRUE(dest.Close()) << dest.status();
+  std::string file_comment;
+  EXPECT_EQ(ReadRecords(StringReader<>(concatenated), &file_comment), records);
+  // Only the metadata of the first source are kept.
+  EXPECT_EQ(file_comment, "comment0");
+}
+
+TEST(ConcatenateFilesTest, ManyFiles) {
+  // More files than should be open at a time.
+  constexpr size_t kNumFiles = 200;
+  std::vector<std::string> filenames;
+  std::vector<std::string> records;
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    filenames.push_back(
+        absl::StrCat(testing::TempDir(), "/concatenate_source_", i));
+    const std::vector<std::string> file_records =
+        TestRecords(absl::StrCat("file", i), i % 3);
+    RecordWriter<FdWriter<>> writer(std::forward_as_tuple(filenames.back()),
+                                    WriterOptions(absl::StrCat("comment", i)));
+    for (const std::string& record : file_records) {
+      ASSERT_TRUE(writer.WriteRecord(record)) << writer.status();
+    }
+    ASSERT_TRUE(writer.Close()) << writer.status();
+    records.insert(records.end(), file_records.begin(), file_records.end());
+  }
+  const std::string dest_filename =
+      absl::StrCat(testing::TempDir(), "/concatenated");
+  const absl::Status status = ConcatenateFiles(filenames, dest_filename);
+  ASSERT_TRUE(status.ok()) << status;
+  std::string file_comment;
+  EXPECT_EQ(ReadRecords(FdReader<>(dest_filename), &file_comment), records);
+  EXPECT_EQ(file_comment, "comment0");
+}
+
+TEST(ConcatenateFilesTest, MissingSourceFails) {
+  const std::string dest_filename =
+      absl::StrCat(testing::TempDir(), "/concatenated_missing");
+  EXPECT_FALSE(ConcatenateFiles({absl::StrCat(testing::TempDir(),
+                                              "/missing_source")},
+                                dest_filename)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace riegeli
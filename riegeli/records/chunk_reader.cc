@@ -28,6 +28,7 @@
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/chunk_encoding/chunk.h"
@@ -154,8 +155,13 @@ bool DefaultChunkReaderBase::ReadChunk(Chunk& chunk) {
 
   if (ABSL_PREDICT_FALSE(!src.Seek(chunk_end))) return FailReading(src);
 
+  const bool stats_enabled = StatsEnabled();
+  const uint64_t start_ns = stats_enabled ? stats_internal::Now_ns() : 0;
   const uint64_t computed_data_hash =
       chunk_encoding_internal::Hash(chunk_.data);
+  if (ABSL_PREDICT_FALSE(stats_enabled)) {
+    hash_time_ns_ += stats_internal::Now_ns() - start_ns;
+  }
   if (ABSL_PREDICT_FALSE(computed_data_hash != chunk_.header.data_hash())) {
     // `Recoverable::kHaveChunk`, not `Recoverable::kFindChunk`, because while
     // chunk data are invalid, chunk header has a correct hash, and thus the
@@ -15,6 +15,8 @@
 #ifndef RIEGELI_RECORDS_CHUNK_READER_H_
 #define RIEGELI_RECORDS_CHUNK_READER_H_
 
+#include <stdint.h>
+
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -99,6 +101,10 @@ class DefaultChunkReaderBase : public Object {
   // `pos()` is unchanged by `Close()`.
   Position pos() const { return pos_; }
 
+  // Returns time spent verifying hashes of chunk data, in nanoseconds,
+  // collected while `StatsEnabled()`.
+  uint64_t hash_time_ns() const { return hash_time_ns_; }
+
   // Returns `true` if this `ChunkReader` supports `Seek()`,
   // `SeekToChunkContaining()`, `SeekToChunkAfter()`, and `Size()`.
   bool SupportsRandomAccess();
@@ -228,6 +234,8 @@ class DefaultChunkReaderBase : public Object {
   // Invariant:
   //   if `recoverable_ != Recoverable::kNo` then `recoverable_pos_ >= pos_`
   Position recoverable_pos_ = 0;
+
+  uint64_t hash_time_ns_ = 0;
 };
 
 // A `ChunkReader` reads chunks of a Riegeli/records file (rather than
@@ -367,7 +375,8 @@ inline DefaultChunkReaderBase::DefaultChunkReaderBase(
       chunk_(std::move(that.chunk_)),
       block_header_(that.block_header_),
       recoverable_(std::exchange(that.recoverable_, Recoverable::kNo)),
-      recoverable_pos_(that.recoverable_pos_) {}
+      recoverable_pos_(that.recoverable_pos_),
+      hash_time_ns_(std::exchange(that.hash_time_ns_, 0)) {}
 
 inline DefaultChunkReaderBase& DefaultChunkReaderBase::operator=(
     DefaultChunkReaderBase&& that) noexcept {
@@ -378,6 +387,7 @@ inline DefaultChunkReaderBase& DefaultChunkReaderBase::operator=(
   block_header_ = that.block_header_;
   recoverable_ = std::exchange(that.recoverable_, Recoverable::kNo);
   recoverable_pos_ = that.recoverable_pos_;
+  hash_time_ns_ = std::exchange(that.hash_time_ns_, 0);
   return *this;
 }
 
@@ -388,6 +398,7 @@ inline void DefaultChunkReaderBase::Reset(Closed) {
   chunk_.Reset();
   recoverable_ = Recoverable::kNo;
   recoverable_pos_ = 0;
+  hash_time_ns_ = 0;
 }
 
 inline void DefaultChunkReaderBase::Reset() {
@@ -397,6 +408,7 @@ inline void DefaultChunkReaderBase::Reset() {
   chunk_.Clear();
   recoverable_ = Recoverable::kNo;
   recoverable_pos_ = 0;
+  hash_time_ns_ = 0;
 }
 
 template <typename Src>
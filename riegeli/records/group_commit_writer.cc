@@ -0,0 +1,183 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/group_commit_writer.h"
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/message_lite.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/messages/message_serialize.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+
+namespace {
+
+GroupCommitWriterBase::FutureStatus ReadyFuture(absl::Status status) {
+  std::promise<absl::Status> promise;
+  promise.set_value(std::move(status));
+  return promise.get_future().share();
+}
+
+}  // namespace
+
+GroupCommitWriterBase::GroupCommitWriterBase(Options&& options)
+    : options_(std::move(options)),
+      last_future_(ReadyFuture(absl::OkStatus())) {}
+
+GroupCommitWriterBase::~GroupCommitWriterBase() {
+  RIEGELI_ASSERT(!committer_.joinable())
+      << "Failed precondition of GroupCommitWriterBase::"
+         "~GroupCommitWriterBase(): "
+         "Stop() not called by the derived class";
+}
+
+void GroupCommitWriterBase::Initialize(RecordWriterBase* dest) {
+  RIEGELI_ASSERT(dest != nullptr)
+      << "Failed precondition of GroupCommitWriter: null RecordWriter pointer";
+  if (ABSL_PREDICT_FALSE(!dest->ok())) {
+    FailWithoutAnnotation(dest->status());
+    return;
+  }
+  committer_ = std::thread([this] { Run(); });
+}
+
+void GroupCommitWriterBase::Stop() {
+  if (!committer_.joinable()) return;
+  {
+    absl::MutexLock lock(&mutex_);
+    closing_ = true;
+  }
+  committer_.join();
+}
+
+void GroupCommitWriterBase::Done() {
+  Stop();
+  absl::Status status;
+  {
+    absl::MutexLock lock(&mutex_);
+    status = committer_status_;
+  }
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    FailWithoutAnnotation(std::move(status));
+  }
+}
+
+GroupCommitWriterBase::FutureStatus GroupCommitWriterBase::Commit(
+    const google::protobuf::MessageLite& record,
+    SerializeOptions serialize_options) {
+  Chain serialized;
+  {
+    absl::Status status =
+        SerializeToChain(record, serialized, std::move(serialize_options));
+    if (ABSL_PREDICT_FALSE(!status.ok())) return ReadyFuture(std::move(status));
+  }
+  return Commit(std::move(serialized));
+}
+
+GroupCommitWriterBase::FutureStatus GroupCommitWriterBase::Commit(
+    absl::string_view record) {
+  return Commit(Chain(record));
+}
+
+GroupCommitWriterBase::FutureStatus GroupCommitWriterBase::Commit(
+    Chain record) {
+  RIEGELI_ASSERT(is_open())
+      << "Failed precondition of GroupCommitWriterBase::Commit(): "
+         "GroupCommitWriter closed";
+  if (ABSL_PREDICT_FALSE(!ok())) return ReadyFuture(status());
+  absl::MutexLock lock(&mutex_);
+  if (ABSL_PREDICT_FALSE(!committer_status_.ok())) {
+    return ReadyFuture(committer_status_);
+  }
+  if (pending_ == nullptr) {
+    pending_ = std::make_unique<Epoch>();
+    pending_->deadline = absl::Now() + options_.max_delay();
+    pending_->future = pending_->promise.get_future().share();
+  }
+  pending_->size += record.size();
+  pending_->records.push_back(std::move(record));
+  return pending_->future;
+}
+
+GroupCommitWriterBase::FutureStatus GroupCommitWriterBase::Sync() {
+  if (ABSL_PREDICT_FALSE(!ok())) return ReadyFuture(status());
+  absl::MutexLock lock(&mutex_);
+  if (pending_ != nullptr) return pending_->future;
+  return last_future_;
+}
+
+void GroupCommitWriterBase::Run() {
+  RecordWriterBase& dest = *DestRecordWriter();
+  for (;;) {
+    std::unique_ptr<Epoch> epoch;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          +[](GroupCommitWriterBase* self)
+               ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+                 return self->pending_ != nullptr || self->closing_;
+               },
+          this));
+      if (pending_ == nullptr) return;
+      // Wait for more records unless enough were collected.
+      mutex_.AwaitWithDeadline(
+          absl::Condition(
+              +[](GroupCommitWriterBase* self)
+                   ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+                     return self->pending_->size >=
+                                self->options_.max_bytes() ||
+                            self->closing_;
+                   },
+              this),
+          pending_->deadline);
+      epoch = std::move(pending_);
+      last_future_ = epoch->future;
+    }
+    // Records committed while this epoch is being flushed are collected in the
+    // next epoch.
+    absl::Status status = CommitEpoch(dest, *epoch);
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      absl::MutexLock lock(&mutex_);
+      if (committer_status_.ok()) committer_status_ = status;
+    }
+    epoch->promise.set_value(std::move(status));
+  }
+}
+
+absl::Status GroupCommitWriterBase::CommitEpoch(RecordWriterBase& dest,
+                                                Epoch& epoch) {
+  for (Chain& record : epoch.records) {
+    if (ABSL_PREDICT_FALSE(!dest.WriteRecord(std::move(record)))) {
+      return dest.status();
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!dest.Flush(options_.flush_type()))) {
+    return dest.status();
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace riegeli
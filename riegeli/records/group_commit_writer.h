@@ -0,0 +1,277 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_GROUP_COMMIT_WRITER_H_
+#define RIEGELI_RECORDS_GROUP_COMMIT_WRITER_H_
+
+#include <stdint.h>
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "google/protobuf/message_lite.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/dependency.h"
+#include "riegeli/base/object.h"
+#include "riegeli/base/types.h"
+#include "riegeli/messages/message_serialize.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+
+// Template parameter independent part of `GroupCommitWriter`.
+class GroupCommitWriterBase : public Object {
+ public:
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // A commit is delayed by up to `max_delay` after its first record, so that
+    // records committed meanwhile by other threads share the same flush.
+    //
+    // Independently of `max_delay()`, records committed while a flush is in
+    // progress are batched together for the next flush.
+    //
+    // Default: `absl::ZeroDuration()`.
+    Options& set_max_delay(absl::Duration max_delay) & {
+      max_delay_ = max_delay;
+      return *this;
+    }
+    Options&& set_max_delay(absl::Duration max_delay) && {
+      return std::move(set_max_delay(max_delay));
+    }
+    absl::Duration max_delay() const { return max_delay_; }
+
+    // A commit is not delayed by `max_delay()` after the total size of its
+    // records reaches `max_bytes`.
+    //
+    // Default: `kDefaultMaxBytes` (1M).
+    static constexpr uint64_t kDefaultMaxBytes = uint64_t{1} << 20;
+    Options& set_max_bytes(uint64_t max_bytes) & {
+      max_bytes_ = max_bytes;
+      return *this;
+    }
+    Options&& set_max_bytes(uint64_t max_bytes) && {
+      return std::move(set_max_bytes(max_bytes));
+    }
+    uint64_t max_bytes() const { return max_bytes_; }
+
+    // The flush which makes a commit complete.
+    //
+    // With `FdWriter`, consider `FdWriterBase::Options::set_data_sync()` and
+    // `set_write_behind()` to make `FlushType::kFromMachine` cheaper.
+    //
+    // Default: `FlushType::kFromMachine`.
+    Options& set_flush_type(FlushType flush_type) & {
+      flush_type_ = flush_type;
+      return *this;
+    }
+    Options&& set_flush_type(FlushType flush_type) && {
+      return std::move(set_flush_type(flush_type));
+    }
+    FlushType flush_type() const { return flush_type_; }
+
+   private:
+    absl::Duration max_delay_ = absl::ZeroDuration();
+    uint64_t max_bytes_ = kDefaultMaxBytes;
+    FlushType flush_type_ = FlushType::kFromMachine;
+  };
+
+  // `get()` returns the resolved value. Can block.
+  using FutureStatus = std::shared_future<absl::Status>;
+
+  ~GroupCommitWriterBase() override;
+
+  // Returns the `RecordWriter` being written to. Unchanged by `Close()`.
+  //
+  // It must not be accessed while the `GroupCommitWriter` is open.
+  virtual RecordWriterBase* DestRecordWriter() = 0;
+
+  // Writes a record, and returns a future resolved when the record has been
+  // flushed with `Options::flush_type()`, together with all other records
+  // committed before it flushes.
+  //
+  // A proto message is serialized in the calling thread.
+  //
+  // If committing failed before, returns a future resolved with the failure.
+  //
+  // `Commit()` may be called concurrently from multiple threads, but not
+  // concurrently with `Close()`.
+  //
+  // Precondition: `is_open()`
+  FutureStatus Commit(const google::protobuf::MessageLite& record,
+                      SerializeOptions serialize_options = SerializeOptions());
+  FutureStatus Commit(absl::string_view record);
+  FutureStatus Commit(Chain record);
+
+  // Returns a future resolved when all records committed so far have been
+  // flushed.
+  //
+  // `Sync()` may be called concurrently with `Commit()`.
+  FutureStatus Sync();
+
+ protected:
+  explicit GroupCommitWriterBase(Options&& options);
+
+  // Starts the background committer. Must be called by the constructor of
+  // the derived class, after the `RecordWriter` is available.
+  void Initialize(RecordWriterBase* dest);
+
+  // Flushes pending records and stops the background committer, if running.
+  // Must be called by the destructor of the derived class, while the
+  // `RecordWriter` is still available.
+  void Stop();
+
+  void Done() override;
+
+ private:
+  // Records flushed together. Their `Commit()` calls share `future`.
+  struct Epoch {
+    std::vector<Chain> records;
+    uint64_t size = 0;
+    absl::Time deadline;
+    std::promise<absl::Status> promise;
+    FutureStatus future;
+  };
+
+  void Run();
+  absl::Status CommitEpoch(RecordWriterBase& dest, Epoch& epoch);
+
+  Options options_;
+  absl::Mutex mutex_;
+  std::unique_ptr<Epoch> pending_ ABSL_GUARDED_BY(mutex_);
+  // The future of the epoch being flushed or flushed last.
+  FutureStatus last_future_ ABSL_GUARDED_BY(mutex_);
+  // The first failure of committing. It is propagated to the `Object` state by
+  // `Done()`, because the `Object` state may be changed only by the thread
+  // owning the `GroupCommitWriter`.
+  absl::Status committer_status_ ABSL_GUARDED_BY(mutex_);
+  bool closing_ ABSL_GUARDED_BY(mutex_) = false;
+  std::thread committer_;
+};
+
+// `GroupCommitWriter` lets many threads write records to a single
+// `RecordWriter`, each waiting until its records are durable, while sharing
+// flushes among records committed around the same time ("group commit").
+//
+// A background thread collects records committed since the last flush, writes
+// them as one chunk, and flushes once for all of them. This amortizes the cost
+// of `fsync()`, which otherwise limits the rate of durable commits.
+//
+// The `Dest` template parameter specifies the type of the object providing and
+// possibly owning the `RecordWriter`. `Dest` must support
+// `Dependency<RecordWriterBase*, Dest>`, e.g. `RecordWriterBase*` (not owned,
+// default), `std::unique_ptr<RecordWriterBase>` (owned),
+// `RecordWriter<FdWriter<>>` (owned).
+//
+// The `RecordWriter` should not use `RecordWriterBase::Options::chunk_size()`
+// smaller than a typical batch, so that a batch forms a single chunk.
+//
+// `Close()` flushes pending records, stops the background thread, and closes
+// the `RecordWriter` if it is owned. Failures of committing are reported by
+// futures returned by `Commit()`, and by `Close()` and then `status()`.
+template <typename Dest = RecordWriterBase*>
+class GroupCommitWriter : public GroupCommitWriterBase {
+ public:
+  // Will write to the `RecordWriter` provided by `dest`.
+  explicit GroupCommitWriter(const Dest& dest, Options options = Options());
+  explicit GroupCommitWriter(Dest&& dest, Options options = Options());
+
+  // Will write to the `RecordWriter` provided by a `Dest` constructed from
+  // elements of `dest_args`. This avoids constructing a temporary `Dest` and
+  // moving from it.
+  template <typename... DestArgs>
+  explicit GroupCommitWriter(std::tuple<DestArgs...> dest_args,
+                             Options options = Options());
+
+  ~GroupCommitWriter() override { Stop(); }
+
+  // Returns the object providing and possibly owning the `RecordWriter`.
+  // Unchanged by `Close()`.
+  Dest& dest() { return dest_.manager(); }
+  const Dest& dest() const { return dest_.manager(); }
+  RecordWriterBase* DestRecordWriter() override { return dest_.get(); }
+
+ protected:
+  void Done() override;
+
+ private:
+  // The object providing and possibly owning the `RecordWriter`.
+  Dependency<RecordWriterBase*, Dest> dest_;
+};
+
+// Support CTAD.
+#if __cpp_deduction_guides
+template <typename Dest>
+explicit GroupCommitWriter(const Dest& dest,
+                           GroupCommitWriterBase::Options options =
+                               GroupCommitWriterBase::Options())
+    -> GroupCommitWriter<std::decay_t<Dest>>;
+template <typename Dest>
+explicit GroupCommitWriter(Dest&& dest, GroupCommitWriterBase::Options options =
+                                            GroupCommitWriterBase::Options())
+    -> GroupCommitWriter<std::decay_t<Dest>>;
+template <typename... DestArgs>
+explicit GroupCommitWriter(
+    std::tuple<DestArgs...> dest_args,
+    GroupCommitWriterBase::Options options = GroupCommitWriterBase::Options())
+    -> GroupCommitWriter<DeleteCtad<std::tuple<DestArgs...>>>;
+#endif
+
+// Implementation details follow.
+
+template <typename Dest>
+inline GroupCommitWriter<Dest>::GroupCommitWriter(const Dest& dest,
+                                                  Options options)
+    : GroupCommitWriterBase(std::move(options)), dest_(dest) {
+  Initialize(dest_.get());
+}
+
+template <typename Dest>
+inline GroupCommitWriter<Dest>::GroupCommitWriter(Dest&& dest, Options options)
+    : GroupCommitWriterBase(std::move(options)), dest_(std::move(dest)) {
+  Initialize(dest_.get());
+}
+
+template <typename Dest>
+template <typename... DestArgs>
+inline GroupCommitWriter<Dest>::GroupCommitWriter(
+    std::tuple<DestArgs...> dest_args, Options options)
+    : GroupCommitWriterBase(std::move(options)), dest_(std::move(dest_args)) {
+  Initialize(dest_.get());
+}
+
+template <typename Dest>
+void GroupCommitWriter<Dest>::Done() {
+  GroupCommitWriterBase::Done();
+  if (dest_.is_owning()) {
+    if (ABSL_PREDICT_FALSE(!dest_->Close())) {
+      FailWithoutAnnotation(dest_->status());
+    }
+  }
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_GROUP_COMMIT_WRITER_H_
@@ -0,0 +1,154 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/group_commit_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+namespace {
+
+// A `StringWriter` which counts durable flushes, and can fail them.
+class DurableFlushCountingWriter : public StringWriter<std::string*> {
+ public:
+  using StringWriter::StringWriter;
+
+  void set_fail_durable_flushes(bool fail_durable_flushes) {
+    fail_durable_flushes_ = fail_durable_flushes;
+  }
+
+  int num_durable_flushes() const {
+    return num_durable_flushes_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  bool FlushImpl(FlushType flush_type) override {
+    if (flush_type == FlushType::kFromMachine) {
+      num_durable_flushes_.fetch_add(1, std::memory_order_relaxed);
+      if (fail_durable_flushes_) {
+        return Fail(absl::DataLossError("Durable flush failed"));
+      }
+    }
+    return StringWriter::FlushImpl(flush_type);
+  }
+
+ private:
+  bool fail_durable_flushes_ = false;
+  std::atomic<int> num_durable_flushes_{0};
+};
+
+std::vector<std::string> ReadRecords(const std::string& data) {
+  RecordReader<StringReader<>> reader(std::forward_as_tuple(data));
+  std::vector<std::string> records;
+  std::string record;
+  while (reader.ReadRecord(record)) records.push_back(record);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  return records;
+}
+
+TEST(GroupCommitWriterTest, BatchesDurableFlushes) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumRecordsPerThread = 16;
+  std::string data;
+  DurableFlushCountingWriter counting_writer(&data);
+  GroupCommitWriter<RecordWriter<DurableFlushCountingWriter*>> writer(
+      std::forward_as_tuple(&counting_writer),
+      GroupCommitWriterBase::Options().set_max_delay(absl::Milliseconds(20)));
+  ASSERT_TRUE(writer.ok()) << writer.status();
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+    threads.emplace_back([&writer, thread_index] {
+      for (int i = 0; i < kNumRecordsPerThread; ++i) {
+        // Each record is durable before the next one is committed.
+        const absl::Status status =
+            writer.Commit(absl::StrCat(thread_index, ":", i)).get();
+        EXPECT_TRUE(status.ok()) << status;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  const int num_durable_flushes = counting_writer.num_durable_flushes();
+  EXPECT_GE(num_durable_flushes, kNumRecordsPerThread);
+  EXPECT_LT(num_durable_flushes, kNumThreads * kNumRecordsPerThread / 2)
+      << "Concurrent commits did not share flushes";
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_FALSE(writer.dest().is_open()) << "Owned RecordWriter not closed";
+
+  std::vector<std::string> records = ReadRecords(data);
+  std::vector<std::string> expected;
+  for (int thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+    for (int i = 0; i < kNumRecordsPerThread; ++i) {
+      expected.push_back(absl::StrCat(thread_index, ":", i));
+    }
+  }
+  std::sort(records.begin(), records.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(records, expected);
+}
+
+TEST(GroupCommitWriterTest, MaxBytesEndsDelay) {
+  std::string data;
+  DurableFlushCountingWriter counting_writer(&data);
+  RecordWriter<DurableFlushCountingWriter*> record_writer(&counting_writer);
+  GroupCommitWriter<> writer(&record_writer, GroupCommitWriterBase::Options()
+                                                 .set_max_delay(absl::Hours(1))
+                                                 .set_max_bytes(100));
+  std::vector<GroupCommitWriterBase::FutureStatus> futures;
+  for (int i = 0; i < 10; ++i) {
+    futures.push_back(
+        writer.Commit(std::string(10, static_cast<char>('a' + i))));
+  }
+  // The batch reached `max_bytes()`, so it is flushed without waiting for
+  // `max_delay()`.
+  for (GroupCommitWriterBase::FutureStatus& future : futures) {
+    EXPECT_TRUE(future.get().ok()) << future.get();
+  }
+  EXPECT_TRUE(writer.Sync().get().ok());
+  EXPECT_EQ(counting_writer.num_durable_flushes(), 1);
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  ASSERT_TRUE(record_writer.Close()) << record_writer.status();
+  EXPECT_EQ(ReadRecords(data).size(), 10u);
+}
+
+TEST(GroupCommitWriterTest, FailureIsReported) {
+  std::string data;
+  DurableFlushCountingWriter counting_writer(&data);
+  counting_writer.set_fail_durable_flushes(true);
+  GroupCommitWriter<RecordWriter<DurableFlushCountingWriter*>> writer(
+      std::forward_as_tuple(&counting_writer));
+  const absl::Status status = writer.Commit("record").get();
+  EXPECT_TRUE(absl::IsDataLoss(status)) << status;
+  // Later commits fail immediately.
+  EXPECT_TRUE(absl::IsDataLoss(writer.Commit("another record").get()));
+  EXPECT_FALSE(writer.Close());
+  EXPECT_TRUE(absl::IsDataLoss(writer.status())) << writer.status();
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,319 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/recompress.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <deque>
+#include <future>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/bytes/chain_backward_writer.h"
+#include "riegeli/bytes/chain_reader.h"
+#include "riegeli/bytes/chain_writer.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/chunk_encoding/chunk.h"
+#include "riegeli/chunk_encoding/chunk_decoder.h"
+#include "riegeli/chunk_encoding/chunk_encoder.h"
+#include "riegeli/chunk_encoding/compressor_options.h"
+#include "riegeli/chunk_encoding/constants.h"
+#include "riegeli/chunk_encoding/field_projection.h"
+#include "riegeli/chunk_encoding/simple_encoder.h"
+#include "riegeli/chunk_encoding/transpose_decoder.h"
+#include "riegeli/chunk_encoding/transpose_encoder.h"
+#include "riegeli/messages/message_parse.h"
+#include "riegeli/records/chunk_reader.h"
+#include "riegeli/records/chunk_writer.h"
+#include "riegeli/records/record_writer.h"
+#include "riegeli/records/records_metadata.pb.h"
+
+namespace riegeli {
+
+namespace {
+
+struct EncodedChunk {
+  absl::Status status;
+  Chunk chunk;
+};
+
+// Based on `RecordWriterBase::Worker::MakeChunkEncoder()`.
+std::unique_ptr<ChunkEncoder> MakeChunkEncoder(
+    const RecordWriterBase::Options& options) {
+  if (options.transpose()) {
+    const long double long_double_bucket_size =
+        std::round(static_cast<long double>(options.effective_chunk_size()) *
+                   static_cast<long double>(options.bucket_fraction()));
+    const uint64_t bucket_size =
+        ABSL_PREDICT_FALSE(
+            long_double_bucket_size >=
+            static_cast<long double>(std::numeric_limits<uint64_t>::max()))
+            ? std::numeric_limits<uint64_t>::max()
+        : ABSL_PREDICT_TRUE(long_double_bucket_size >= 1.0L)
+            ? static_cast<uint64_t>(long_double_bucket_size)
+            : uint64_t{1};
+    return std::make_unique<TransposeEncoder>(options.compressor_options(),
+                                              bucket_size);
+  }
+  return std::make_unique<SimpleEncoder>(options.compressor_options(),
+                                         options.effective_chunk_size());
+}
+
+bool SameCompressorOptions(const CompressorOptions& a,
+                           const CompressorOptions& b) {
+  return a.compression_type() == b.compression_type() &&
+         a.compression_level() == b.compression_level() &&
+         a.window_log() == b.window_log();
+}
+
+// Removes `record_writer_options` from the file metadata `chunk`, re-encoding
+// it with `target` compressor options. If they are present and valid and
+// `source_compressor_options` are not known yet, sets
+// `source_compressor_options` from them.
+absl::Status ProcessMetadata(
+    const RecordWriterBase::Options& target, Chunk& chunk,
+    absl::optional<CompressorOptions>& source_compressor_options) {
+  // Based on `RecordReaderBase::ParseMetadata()`.
+  if (ABSL_PREDICT_FALSE(chunk.header.num_records() != 0)) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Invalid file metadata chunk: number of records is not zero: ",
+        chunk.header.num_records()));
+  }
+  Chain serialized_metadata;
+  {
+    ChainReader<> data_reader(&chunk.data);
+    TransposeDecoder transpose_decoder;
+    ChainBackwardWriter<> serialized_metadata_writer(&serialized_metadata);
+    std::vector<size_t> limits;
+    const bool decode_ok = transpose_decoder.Decode(
+        1, chunk.header.decoded_data_size(), FieldProjection::All(),
+        data_reader, serialized_metadata_writer, limits);
+    if (ABSL_PREDICT_FALSE(!serialized_metadata_writer.Close())) {
+      return serialized_metadata_writer.status();
+    }
+    if (ABSL_PREDICT_FALSE(!decode_ok)) return transpose_decoder.status();
+    if (ABSL_PREDICT_FALSE(!data_reader.VerifyEndAndClose())) {
+      return data_reader.status();
+    }
+  }
+  RecordsMetadata metadata;
+  {
+    absl::Status status = ParseFromChain(serialized_metadata, metadata);
+    if (ABSL_PREDICT_FALSE(!status.ok())) return status;
+  }
+  if (!metadata.has_record_writer_options()) return absl::OkStatus();
+  if (source_compressor_options == absl::nullopt) {
+    RecordWriterBase::Options source_options;
+    if (source_options.FromString(metadata.record_writer_options()).ok()) {
+      source_compressor_options = source_options.compressor_options();
+    }
+  }
+  metadata.clear_record_writer_options();
+
+  // Based on `RecordWriterBase::Worker::EncodeMetadata()`.
+  TransposeEncoder transpose_encoder(target.compressor_options(),
+                                     std::numeric_limits<uint64_t>::max());
+  if (ABSL_PREDICT_FALSE(!transpose_encoder.AddRecord(metadata))) {
+    return transpose_encoder.status();
+  }
+  Chunk new_chunk;
+  ChainWriter<> data_writer(&new_chunk.data);
+  ChunkType chunk_type;
+  uint64_t num_records;
+  uint64_t decoded_data_size;
+  if (ABSL_PREDICT_FALSE(!transpose_encoder.EncodeAndClose(
+          data_writer, chunk_type, num_records, decoded_data_size))) {
+    return transpose_encoder.status();
+  }
+  if (ABSL_PREDICT_FALSE(!data_writer.Close())) return data_writer.status();
+  new_chunk.header = ChunkHeader(new_chunk.data, ChunkType::kFileMetadata, 0,
+                                 decoded_data_size);
+  chunk = std::move(new_chunk);
+  return absl::OkStatus();
+}
+
+// Returns `true` if `chunk` should be copied without decoding.
+bool PassThrough(const Chunk& chunk, const RecompressOptions& options,
+                 const absl::optional<CompressorOptions>&
+                     source_compressor_options) {
+  if (chunk.data.empty()) return true;
+  // Both simple and transposed chunks begin with the compression type.
+  const CompressionType compression_type =
+      static_cast<CompressionType>(*chunk.data.blocks().front().data());
+  if (options.pass_through_uncompressed() &&
+      chunk.header.chunk_type() == ChunkType::kSimple &&
+      compression_type == CompressionType::kNone) {
+    return true;
+  }
+  const RecordWriterBase::Options& target = options.record_writer_options();
+  return options.pass_through_matching() &&
+         chunk.header.chunk_type() == (target.transpose()
+                                           ? ChunkType::kTransposed
+                                           : ChunkType::kSimple) &&
+         compression_type == target.compressor_options().compression_type() &&
+         source_compressor_options != absl::nullopt &&
+         SameCompressorOptions(*source_compressor_options,
+                               target.compressor_options());
+}
+
+EncodedChunk Reencode(const Chunk& src,
+                      const RecordWriterBase::Options& options) {
+  EncodedChunk dest;
+  ChunkDecoder chunk_decoder;
+  if (ABSL_PREDICT_FALSE(!chunk_decoder.Decode(src))) {
+    dest.status = chunk_decoder.status();
+    return dest;
+  }
+  const std::unique_ptr<ChunkEncoder> chunk_encoder = MakeChunkEncoder(options);
+  Chain record;
+  while (chunk_decoder.ReadRecord(record)) {
+    if (ABSL_PREDICT_FALSE(!chunk_encoder->AddRecord(std::move(record)))) {
+      dest.status = chunk_encoder->status();
+      return dest;
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!chunk_decoder.Close())) {
+    dest.status = chunk_decoder.status();
+    return dest;
+  }
+  ChunkType chunk_type;
+  uint64_t num_records;
+  uint64_t decoded_data_size;
+  ChainWriter<> data_writer(&dest.chunk.data);
+  if (ABSL_PREDICT_FALSE(!chunk_encoder->EncodeAndClose(
+          data_writer, chunk_type, num_records, decoded_data_size))) {
+    dest.status = chunk_encoder->status();
+    return dest;
+  }
+  if (ABSL_PREDICT_FALSE(!data_writer.Close())) {
+    dest.status = data_writer.status();
+    return dest;
+  }
+  dest.chunk.header =
+      ChunkHeader(dest.chunk.data, chunk_type, num_records, decoded_data_size);
+  return dest;
+}
+
+std::future<EncodedChunk> ReadyChunk(EncodedChunk&& chunk) {
+  std::promise<EncodedChunk> promise;
+  promise.set_value(std::move(chunk));
+  return promise.get_future();
+}
+
+}  // namespace
+
+absl::Status Recompress(ChunkReader& src, ChunkWriter& dest,
+                        const RecompressOptions& options) {
+  Executor& executor = options.executor() != nullptr ? *options.executor()
+                                                     : Executor::global();
+  absl::optional<CompressorOptions> source_compressor_options =
+      options.source_compressor_options();
+  // Chunks in the order of reading. Re-encoding of a chunk can be in progress.
+  std::deque<std::future<EncodedChunk>> chunks;
+  absl::Status status;
+  const auto write_chunk = [&] {
+    EncodedChunk encoded = chunks.front().get();
+    chunks.pop_front();
+    if (ABSL_PREDICT_FALSE(!status.ok())) return;
+    if (ABSL_PREDICT_FALSE(!encoded.status.ok())) {
+      status = src.AnnotateStatus(std::move(encoded.status));
+      return;
+    }
+    if (ABSL_PREDICT_FALSE(!dest.WriteChunk(encoded.chunk))) {
+      status = dest.status();
+    }
+  };
+  while (status.ok()) {
+    Chunk chunk;
+    if (ABSL_PREDICT_FALSE(!src.ReadChunk(chunk))) {
+      if (ABSL_PREDICT_FALSE(!src.ok())) status = src.status();
+      break;
+    }
+    switch (chunk.header.chunk_type()) {
+      case ChunkType::kPadding:
+        continue;
+      case ChunkType::kFileMetadata: {
+        absl::Status metadata_status = ProcessMetadata(
+            options.record_writer_options(), chunk, source_compressor_options);
+        if (ABSL_PREDICT_FALSE(!metadata_status.ok())) {
+          chunks.push_back(ReadyChunk(
+              EncodedChunk{std::move(metadata_status), Chunk()}));
+        } else {
+          chunks.push_back(
+              ReadyChunk(EncodedChunk{absl::OkStatus(), std::move(chunk)}));
+        }
+        break;
+      }
+      case ChunkType::kSimple:
+      case ChunkType::kTransposed:
+        if (!PassThrough(chunk, options, source_compressor_options)) {
+          if (options.parallelism() == 0) {
+            chunks.push_back(
+                ReadyChunk(Reencode(chunk, options.record_writer_options())));
+          } else {
+            const std::shared_ptr<std::promise<EncodedChunk>> promise =
+                std::make_shared<std::promise<EncodedChunk>>();
+            chunks.push_back(promise->get_future());
+            executor.Schedule([promise, chunk = std::move(chunk), &options] {
+              promise->set_value(
+                  Reencode(chunk, options.record_writer_options()));
+            });
+          }
+          break;
+        }
+        ABSL_FALLTHROUGH_INTENDED;
+      default:
+        // File signature, chunks passed through, and chunks of unknown types
+        // are copied.
+        chunks.push_back(ReadyChunk(EncodedChunk{absl::OkStatus(),
+                                                 std::move(chunk)}));
+        break;
+    }
+    while (chunks.size() > IntCast<size_t>(options.parallelism())) {
+      write_chunk();
+    }
+  }
+  // Wait for chunks being re-encoded even after a failure, because they refer
+  // to `options`.
+  while (!chunks.empty()) write_chunk();
+  return status;
+}
+
+absl::Status RecompressFile(absl::string_view src_filename,
+                            absl::string_view dest_filename,
+                            const RecompressOptions& options) {
+  DefaultChunkReader<FdReader<>> src(std::forward_as_tuple(src_filename));
+  DefaultChunkWriter<FdWriter<>> dest(std::forward_as_tuple(dest_filename));
+  absl::Status status = Recompress(src, dest, options);
+  if (ABSL_PREDICT_FALSE(!dest.Close())) status.Update(dest.status());
+  if (ABSL_PREDICT_FALSE(!src.Close())) status.Update(src.status());
+  return status;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,192 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_RECOMPRESS_H_
+#define RIEGELI_RECORDS_RECOMPRESS_H_
+
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/chunk_encoding/compressor_options.h"
+#include "riegeli/records/chunk_reader.h"
+#include "riegeli/records/chunk_writer.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+
+class RecompressOptions {
+ public:
+  RecompressOptions() noexcept {}
+
+  // Options of the target encoding: `transpose()`, `compressor_options()`,
+  // `chunk_size()` and `bucket_fraction()` are used.
+  //
+  // Chunk boundaries are preserved: each chunk is re-encoded separately.
+  // Metadata and padding options are ignored: file metadata are preserved,
+  // except for `RecordsMetadata::record_writer_options`, which are removed
+  // because re-encoded chunks no longer follow them, and padding is dropped.
+  //
+  // Default: `RecordWriterBase::Options()`.
+  RecompressOptions& set_record_writer_options(
+      const RecordWriterBase::Options& record_writer_options) & {
+    record_writer_options_ = record_writer_options;
+    return *this;
+  }
+  RecompressOptions& set_record_writer_options(
+      RecordWriterBase::Options&& record_writer_options) & {
+    record_writer_options_ = std::move(record_writer_options);
+    return *this;
+  }
+  RecompressOptions&& set_record_writer_options(
+      const RecordWriterBase::Options& record_writer_options) && {
+    return std::move(set_record_writer_options(record_writer_options));
+  }
+  RecompressOptions&& set_record_writer_options(
+      RecordWriterBase::Options&& record_writer_options) && {
+    return std::move(
+        set_record_writer_options(std::move(record_writer_options)));
+  }
+  RecordWriterBase::Options& record_writer_options() {
+    return record_writer_options_;
+  }
+  const RecordWriterBase::Options& record_writer_options() const {
+    return record_writer_options_;
+  }
+
+  // Maximum number of chunks being decoded and re-encoded in parallel in
+  // background.
+  //
+  // If 0, chunks are re-encoded in the calling thread.
+  //
+  // Default: 0.
+  RecompressOptions& set_parallelism(int parallelism) & {
+    RIEGELI_ASSERT_GE(parallelism, 0)
+        << "Failed precondition of RecompressOptions::set_parallelism(): "
+           "negative parallelism";
+    parallelism_ = parallelism;
+    return *this;
+  }
+  RecompressOptions&& set_parallelism(int parallelism) && {
+    return std::move(set_parallelism(parallelism));
+  }
+  int parallelism() const { return parallelism_; }
+
+  // `Executor` which re-encodes chunks in background if `parallelism > 0`.
+  // It is not owned and must outlive `Recompress()`.
+  //
+  // `nullptr` means `Executor::global()`.
+  //
+  // Default: `nullptr`.
+  RecompressOptions& set_executor(Executor* executor) & {
+    executor_ = executor;
+    return *this;
+  }
+  RecompressOptions&& set_executor(Executor* executor) && {
+    return std::move(set_executor(executor));
+  }
+  Executor* executor() const { return executor_; }
+
+  // If `true`, a chunk which already has the target chunk type (simple or
+  // transposed), and which was compressed with the target compressor options
+  // (compression type, level, and window log), is copied without decoding.
+  // Its chunk size is not changed.
+  //
+  // The compression level and window log are not stored in chunks, so they
+  // are known only from `source_compressor_options()`. If these are unknown,
+  // chunks are not passed through as matching.
+  //
+  // Default: `true`.
+  RecompressOptions& set_pass_through_matching(bool pass_through_matching) & {
+    pass_through_matching_ = pass_through_matching;
+    return *this;
+  }
+  RecompressOptions&& set_pass_through_matching(
+      bool pass_through_matching) && {
+    return std::move(set_pass_through_matching(pass_through_matching));
+  }
+  bool pass_through_matching() const { return pass_through_matching_; }
+
+  // Compressor options which chunks of the source were compressed with, used
+  // by `pass_through_matching()`.
+  //
+  // If `absl::nullopt`, they are taken from
+  // `RecordsMetadata::record_writer_options` of the source, if present.
+  //
+  // Default: `absl::nullopt`.
+  RecompressOptions& set_source_compressor_options(
+      absl::optional<CompressorOptions> source_compressor_options) & {
+    source_compressor_options_ = source_compressor_options;
+    return *this;
+  }
+  RecompressOptions&& set_source_compressor_options(
+      absl::optional<CompressorOptions> source_compressor_options) && {
+    return std::move(set_source_compressor_options(source_compressor_options));
+  }
+  const absl::optional<CompressorOptions>& source_compressor_options() const {
+    return source_compressor_options_;
+  }
+
+  // If `true`, a simple chunk without compression is copied without decoding.
+  // This saves time when such chunks are small and compressing them would not
+  // help.
+  //
+  // Default: `false`.
+  RecompressOptions& set_pass_through_uncompressed(
+      bool pass_through_uncompressed) & {
+    pass_through_uncompressed_ = pass_through_uncompressed;
+    return *this;
+  }
+  RecompressOptions&& set_pass_through_uncompressed(
+      bool pass_through_uncompressed) && {
+    return std::move(set_pass_through_uncompressed(pass_through_uncompressed));
+  }
+  bool pass_through_uncompressed() const { return pass_through_uncompressed_; }
+
+ private:
+  RecordWriterBase::Options record_writer_options_;
+  int parallelism_ = 0;
+  Executor* executor_ = nullptr;
+  bool pass_through_matching_ = true;
+  absl::optional<CompressorOptions> source_compressor_options_;
+  bool pass_through_uncompressed_ = false;
+};
+
+// Reads all chunks from `src` and writes them to `dest`, re-encoding simple
+// and transposed chunks with `options.record_writer_options()`.
+//
+// File signature and file metadata chunks are copied, except that
+// `RecordsMetadata::record_writer_options` are removed. Padding chunks are
+// dropped. Records are never merged across chunks or split between chunks.
+//
+// `src` and `dest` are not closed.
+//
+// Returns status:
+//  * `status.ok()`  - success
+//  * `!status.ok()` - failure
+absl::Status Recompress(ChunkReader& src, ChunkWriter& dest,
+                        const RecompressOptions& options = RecompressOptions());
+
+// Like `Recompress(ChunkReader&, ChunkWriter&)`, but reads the file named
+// `src_filename` and writes the file named `dest_filename`.
+absl::Status RecompressFile(
+    absl::string_view src_filename, absl::string_view dest_filename,
+    const RecompressOptions& options = RecompressOptions());
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_RECOMPRESS_H_
@@ -0,0 +1,118 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_RECORD_FOLLOWER_H_
+#define RIEGELI_RECORDS_RECORD_FOLLOWER_H_
+
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/bytes/file_watcher.h"
+#include "riegeli/records/record_reader.h"
+
+namespace riegeli {
+
+// `RecordFollower` reads records from a Riegeli/records file which is being
+// written concurrently, waiting for more records at the end of the file
+// ("tail -f").
+//
+// The `RecordReader` must read from a source which supports growing, e.g.
+// `FdReader` with `FdReaderBase::Options().set_growing_source(true)`. When the
+// file ends in the middle of a chunk, `RecordReader::ReadRecord()` returns
+// `false` while `ok()`, and the partially read chunk is continued when the
+// file grows. `RecordFollower` waits for the file to grow with `FileWatcher`,
+// i.e. with `inotify` where available, falling back to polling.
+//
+// Example:
+// ```
+//   riegeli::RecordReader reader(riegeli::FdReader(
+//       filename, riegeli::FdReaderBase::Options().set_growing_source(true)));
+//   riegeli::RecordFollower follower(&reader, filename);
+//   std::string record;
+//   while (follower.ReadRecord(record)) {
+//     ... Process record.
+//   }
+//   // follower.ReadRecord() returned false because of a failure, or because
+//   // another thread called follower.Cancel().
+//   if (!reader.Close()) {
+//     ... Failed with reason: reader.status()
+//   }
+// ```
+class RecordFollower {
+ public:
+  using Options = FileWatcher::Options;
+
+  // Will read records from `*reader`, which reads the file named `filename`.
+  explicit RecordFollower(RecordReaderBase* reader, absl::string_view filename,
+                          Options options = Options())
+      : reader_(reader), watcher_(filename, std::move(options)) {
+    RIEGELI_ASSERT(reader_ != nullptr)
+        << "Failed precondition of RecordFollower: null RecordReader pointer";
+  }
+
+  RecordFollower(const RecordFollower&) = delete;
+  RecordFollower& operator=(const RecordFollower&) = delete;
+
+  // Reads the next record, waiting until it is complete or until `deadline`.
+  //
+  // `Record` is any type accepted by `RecordReaderBase::ReadRecord()`.
+  //
+  // Return values:
+  //  * `true`                       - success (`record` is set)
+  //  * `false` (when `reader->ok()`) - no complete record before `deadline`,
+  //                                   or `Cancel()` was called; reading can
+  //                                   be retried later
+  //  * `false` (when `!reader->ok()`) - failure
+  template <typename Record>
+  bool ReadRecord(Record& record, absl::Time deadline = absl::InfiniteFuture());
+
+  // Like `ReadRecord(record, deadline)`, with a relative `timeout`.
+  template <typename Record>
+  bool ReadRecord(Record& record, absl::Duration timeout) {
+    return ReadRecord(record, absl::Now() + timeout);
+  }
+
+  // Makes a current and all future `ReadRecord()` calls return `false` instead
+  // of waiting. Records which are already complete can still be read.
+  //
+  // `Cancel()` may be called concurrently with `ReadRecord()`.
+  void Cancel() { watcher_.Cancel(); }
+
+  // Returns `true` if the file is watched with notifications rather than with
+  // polling.
+  bool notifications() const { return watcher_.notifications(); }
+
+ private:
+  RecordReaderBase* reader_;
+  FileWatcher watcher_;
+};
+
+// Implementation details follow.
+
+template <typename Record>
+bool RecordFollower::ReadRecord(Record& record, absl::Time deadline) {
+  for (;;) {
+    if (reader_->ReadRecord(record)) return true;
+    if (ABSL_PREDICT_FALSE(!reader_->ok())) return false;
+    if (!watcher_.Wait(deadline)) return false;
+  }
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_RECORD_FOLLOWER_H_
@@ -0,0 +1,137 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/record_follower.h"
+
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+namespace {
+
+class RecordFollowerTest : public testing::TestWithParam<bool> {
+ protected:
+  RecordFollower::Options follower_options() const {
+    return RecordFollower::Options()
+        .set_use_inotify(GetParam())
+        .set_poll_interval(absl::Milliseconds(10));
+  }
+};
+
+TEST_P(RecordFollowerTest, FollowsAppendedRecords) {
+  constexpr int kNumBatches = 10;
+  constexpr int kNumRecordsPerBatch = 5;
+  const std::string filename = absl::StrCat(
+      testing::TempDir(), "/follows_appended_records_", GetParam());
+  RecordWriter<FdWriter<>> writer(std::forward_as_tuple(filename));
+  // Write the file signature before the file is opened for reading.
+  ASSERT_TRUE(writer.Flush()) << writer.status();
+
+  RecordReader<FdReader<>> reader(std::forward_as_tuple(
+      filename, FdReaderBase::Options().set_growing_source(true)));
+  RecordFollower follower(&reader, filename, follower_options());
+  std::thread writer_thread([&writer] {
+    for (int batch = 0; batch < kNumBatches; ++batch) {
+      for (int i = 0; i < kNumRecordsPerBatch; ++i) {
+        EXPECT_TRUE(writer.WriteRecord(absl::StrCat(batch, ":", i)))
+            << writer.status();
+      }
+      EXPECT_TRUE(writer.Flush()) << writer.status();
+      absl::SleepFor(absl::Milliseconds(5));
+    }
+  });
+
+  std::vector<std::string> records;
+  std::string record;
+  while (records.size() < kNumBatches * kNumRecordsPerBatch &&
+         follower.ReadRecord(record, absl::Seconds(30))) {
+    records.push_back(record);
+  }
+  writer_thread.join();
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  ASSERT_EQ(records.size(), size_t{kNumBatches * kNumRecordsPerBatch});
+  for (int batch = 0; batch < kNumBatches; ++batch) {
+    for (int i = 0; i < kNumRecordsPerBatch; ++i) {
+      EXPECT_EQ(records[batch * kNumRecordsPerBatch + i],
+                absl::StrCat(batch, ":", i));
+    }
+  }
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_FALSE(follower.ReadRecord(record, absl::ZeroDuration()));
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST_P(RecordFollowerTest, DeadlineExpires) {
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/deadline_expires_", GetParam());
+  RecordWriter<FdWriter<>> writer(std::forward_as_tuple(filename));
+  ASSERT_TRUE(writer.WriteRecord("record")) << writer.status();
+  ASSERT_TRUE(writer.Flush()) << writer.status();
+
+  RecordReader<FdReader<>> reader(std::forward_as_tuple(
+      filename, FdReaderBase::Options().set_growing_source(true)));
+  RecordFollower follower(&reader, filename, follower_options());
+  std::string record;
+  ASSERT_TRUE(follower.ReadRecord(record, absl::Seconds(30)))
+      << reader.status();
+  EXPECT_EQ(record, "record");
+  const absl::Time start = absl::Now();
+  EXPECT_FALSE(follower.ReadRecord(record, absl::Milliseconds(50)));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(50));
+  // Nothing was lost, reading can be retried.
+  EXPECT_TRUE(reader.ok()) << reader.status();
+  ASSERT_TRUE(writer.WriteRecord("another record")) << writer.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  ASSERT_TRUE(follower.ReadRecord(record, absl::Seconds(30)))
+      << reader.status();
+  EXPECT_EQ(record, "another record");
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST_P(RecordFollowerTest, CancelEndsWait) {
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/cancel_ends_wait_", GetParam());
+  RecordWriter<FdWriter<>> writer(std::forward_as_tuple(filename));
+  ASSERT_TRUE(writer.Flush()) << writer.status();
+
+  RecordReader<FdReader<>> reader(std::forward_as_tuple(
+      filename, FdReaderBase::Options().set_growing_source(true)));
+  RecordFollower follower(&reader, filename, follower_options());
+  std::thread cancel_thread([&follower] {
+    absl::SleepFor(absl::Milliseconds(50));
+    follower.Cancel();
+  });
+  std::string record;
+  EXPECT_FALSE(follower.ReadRecord(record));
+  cancel_thread.join();
+  EXPECT_TRUE(reader.ok()) << reader.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+INSTANTIATE_TEST_SUITE_P(UseInotify, RecordFollowerTest, testing::Bool());
+
+}  // namespace
+}  // namespace riegeli
@@ -31,6 +31,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/compare.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/message.h"
@@ -40,6 +41,7 @@
 #include "riegeli/base/binary_search.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/chain_backward_writer.h"
@@ -113,7 +115,9 @@ RecordReaderBase::RecordReaderBase(RecordReaderBase&& that) noexcept
       chunk_decoder_(std::move(that.chunk_decoder_)),
       last_record_is_valid_(std::exchange(that.last_record_is_valid_, false)),
       recoverable_(std::exchange(that.recoverable_, Recoverable::kNo)),
-      recovery_(std::move(that.recovery_)) {}
+      recovery_(std::move(that.recovery_)),
+      reset_arena_per_chunk_(that.reset_arena_per_chunk_),
+      stats_(std::exchange(that.stats_, RecordStats())) {}
 
 RecordReaderBase& RecordReaderBase::operator=(
     RecordReaderBase&& that) noexcept {
@@ -123,6 +127,8 @@ RecordReaderBase& RecordReaderBase::operator=(
   last_record_is_valid_ = std::exchange(that.last_record_is_valid_, false);
   recoverable_ = std::exchange(that.recoverable_, Recoverable::kNo);
   recovery_ = std::move(that.recovery_);
+  reset_arena_per_chunk_ = that.reset_arena_per_chunk_;
+  stats_ = std::exchange(that.stats_, RecordStats());
   return *this;
 }
 
@@ -133,6 +139,8 @@ void RecordReaderBase::Reset(Closed) {
   last_record_is_valid_ = false;
   recoverable_ = Recoverable::kNo;
   recovery_ = nullptr;
+  reset_arena_per_chunk_ = false;
+  stats_ = RecordStats();
 }
 
 void RecordReaderBase::Reset() {
@@ -142,6 +150,8 @@ void RecordReaderBase::Reset() {
   last_record_is_valid_ = false;
   recoverable_ = Recoverable::kNo;
   recovery_ = nullptr;
+  reset_arena_per_chunk_ = false;
+  stats_ = RecordStats();
 }
 
 void RecordReaderBase::Initialize(ChunkReader* src, Options&& options) {
@@ -155,6 +165,7 @@ void RecordReaderBase::Initialize(ChunkReader* src, Options&& options) {
   chunk_decoder_.Reset(ChunkDecoder::Options().set_field_projection(
       std::move(options.field_projection())));
   recovery_ = std::move(options.recovery());
+  reset_arena_per_chunk_ = options.reset_arena_per_chunk();
 }
 
 void RecordReaderBase::Done() {
@@ -163,6 +174,9 @@ void RecordReaderBase::Done() {
   if (ABSL_PREDICT_FALSE(!chunk_decoder_.Close())) {
     Fail(chunk_decoder_.status());
   }
+  if (stats_.num_chunks > 0) {
+    stats_internal::AddToProcessStats(&ProcessStats::record_reads, stats_);
+  }
 }
 
 inline bool RecordReaderBase::FailReading(const ChunkReader& src) {
@@ -314,14 +328,83 @@ bool RecordReaderBase::ReadRecord(absl::Cord& record) {
   return ReadRecordImpl(record);
 }
 
+struct RecordReaderBase::ArenaRecord {
+  const google::protobuf::MessageLite* prototype;
+  google::protobuf::Arena* arena;
+  google::protobuf::MessageLite* message;
+  // Whether `Options::reset_arena_per_chunk()` applies to this record.
+  bool may_reset_arena;
+};
+
+bool RecordReaderBase::ReadRecord(
+    const google::protobuf::MessageLite& prototype,
+    google::protobuf::Arena& arena, google::protobuf::MessageLite*& record) {
+  ArenaRecord arena_record = {&prototype, &arena, nullptr, true};
+  if (ABSL_PREDICT_FALSE(!ReadRecordImpl(arena_record))) return false;
+  record = arena_record.message;
+  return true;
+}
+
+bool RecordReaderBase::ReadChunkRecords(
+    const google::protobuf::MessageLite& prototype,
+    google::protobuf::Arena& arena,
+    std::vector<google::protobuf::MessageLite*>& records) {
+  ArenaRecord arena_record = {&prototype, &arena, nullptr, true};
+  if (ABSL_PREDICT_FALSE(!ReadRecordImpl(arena_record))) return false;
+  records.push_back(arena_record.message);
+  // Records already in the batch must stay valid.
+  arena_record.may_reset_arena = false;
+  // Read only from the current chunk. A failure is left for the next call,
+  // where recovery can skip to another chunk, which begins another batch.
+  while (ReadRecordFromChunk(arena_record)) {
+    if (ABSL_PREDICT_FALSE(StatsEnabled())) ++stats_.num_records;
+    records.push_back(arena_record.message);
+  }
+  return true;
+}
+
+template <typename Record>
+inline bool RecordReaderBase::ReadRecordFromChunk(Record& record) {
+  return chunk_decoder_.ReadRecord(record);
+}
+
+inline bool RecordReaderBase::ReadRecordFromChunk(
+    google::protobuf::MessageLite& record) {
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) {
+    return chunk_decoder_.ReadRecord(record);
+  }
+  const uint64_t start_ns = stats_internal::Now_ns();
+  const bool read_ok = chunk_decoder_.ReadRecord(record);
+  stats_.message_time_ns += stats_internal::Now_ns() - start_ns;
+  return read_ok;
+}
+
+inline bool RecordReaderBase::ReadRecordFromChunk(ArenaRecord& record) {
+  if (reset_arena_per_chunk_ && record.may_reset_arena &&
+      chunk_decoder_.index() == 0 &&
+      chunk_decoder_.num_records() > 0) {
+    record.arena->Reset();
+  }
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) {
+    return chunk_decoder_.ReadRecord(*record.prototype, record.arena,
+                                     record.message);
+  }
+  const uint64_t start_ns = stats_internal::Now_ns();
+  const bool read_ok = chunk_decoder_.ReadRecord(*record.prototype,
+                                                 record.arena, record.message);
+  stats_.message_time_ns += stats_internal::Now_ns() - start_ns;
+  return read_ok;
+}
+
 template <typename Record>
 inline bool RecordReaderBase::ReadRecordImpl(Record& record) {
   last_record_is_valid_ = false;
   for (;;) {
-    if (ABSL_PREDICT_TRUE(chunk_decoder_.ReadRecord(record))) {
+    if (ABSL_PREDICT_TRUE(ReadRecordFromChunk(record))) {
       RIEGELI_ASSERT_GT(chunk_decoder_.index(), 0u)
           << "ChunkDecoder::ReadRecord() left record index at 0";
       last_record_is_valid_ = true;
+      if (ABSL_PREDICT_FALSE(StatsEnabled())) ++stats_.num_records;
       return true;
     }
     if (ABSL_PREDICT_FALSE(!ok())) {
@@ -665,7 +748,10 @@ inline bool RecordReaderBase::ReadChunk() {
   ChunkReader& src = *SrcChunkReader();
   chunk_begin_ = src.pos();
   Chunk chunk;
-  if (ABSL_PREDICT_FALSE(!src.ReadChunk(chunk))) {
+  const uint64_t hash_time_ns_before = src.hash_time_ns();
+  const bool read_ok = src.ReadChunk(chunk);
+  stats_.hash_time_ns += src.hash_time_ns() - hash_time_ns_before;
+  if (ABSL_PREDICT_FALSE(!read_ok)) {
     chunk_decoder_.Clear();
     if (ABSL_PREDICT_FALSE(!src.ok())) {
       recoverable_ = Recoverable::kRecoverChunkReader;
@@ -677,6 +763,7 @@ inline bool RecordReaderBase::ReadChunk() {
     recoverable_ = Recoverable::kRecoverChunkDecoder;
     return Fail(chunk_decoder_.status());
   }
+  if (ABSL_PREDICT_FALSE(StatsEnabled())) ++stats_.num_chunks;
   return true;
 }
 
@@ -21,6 +21,7 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "absl/base/attributes.h"
 #include "absl/base/optimization.h"
@@ -30,12 +31,14 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/compare.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message_lite.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/dependency.h"
 #include "riegeli/base/object.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/chunk_encoding/chunk.h"
@@ -157,9 +160,25 @@ class RecordReaderBase : public Object {
       return recovery_;
     }
 
+    // If `true`, reading records into messages allocated on an arena calls
+    // `arena.Reset()` before reading the first record of each chunk. This
+    // bounds memory used by the arena to about one chunk worth of messages,
+    // but makes messages read from earlier chunks invalid.
+    //
+    // Default: `false`.
+    Options& set_reset_arena_per_chunk(bool reset_arena_per_chunk) & {
+      reset_arena_per_chunk_ = reset_arena_per_chunk;
+      return *this;
+    }
+    Options&& set_reset_arena_per_chunk(bool reset_arena_per_chunk) && {
+      return std::move(set_reset_arena_per_chunk(reset_arena_per_chunk));
+    }
+    bool reset_arena_per_chunk() const { return reset_arena_per_chunk_; }
+
    private:
     FieldProjection field_projection_ = FieldProjection::All();
     std::function<bool(const SkippedRegion&)> recovery_;
+    bool reset_arena_per_chunk_ = false;
   };
 
   // Returns the Riegeli/records file being read from. Unchanged by `Close()`.
@@ -216,6 +235,52 @@ class RecordReaderBase : public Object {
   bool ReadRecord(Chain& record);
   bool ReadRecord(absl::Cord& record);
 
+  // Reads the next record, parsing it into a new message of the same type as
+  // `prototype`, allocated on `arena`. `record` is owned by `arena`.
+  //
+  // Allocating messages on an arena avoids most of the cost of memory
+  // allocation for deeply nested messages. See also
+  // `Options::set_reset_arena_per_chunk()`.
+  //
+  // `ReadRecord(arena, record)` with `Message*& record` uses
+  // `Message::default_instance()` as the prototype.
+  //
+  // Return values:
+  //  * `true`                 - success (`record` is set)
+  //  * `false` (when `ok()`)  - source ends
+  //  * `false` (when `!ok()`) - failure
+  bool ReadRecord(const google::protobuf::MessageLite& prototype,
+                  google::protobuf::Arena& arena,
+                  google::protobuf::MessageLite*& record);
+  template <
+      typename Message,
+      std::enable_if_t<
+          std::is_base_of<google::protobuf::MessageLite, Message>::value, int> =
+          0>
+  bool ReadRecord(google::protobuf::Arena& arena, Message*& record);
+
+  // Reads the remaining records of the current chunk, or of the next chunk if
+  // no records remain in the current chunk, parsing them into new messages of
+  // the same type as `prototype`, allocated on `arena`, and appending them to
+  // `records`. Messages are owned by `arena`.
+  //
+  // This reads records in batches corresponding to chunks, so that a caller
+  // can process a batch and then reset the arena. With
+  // `Options::reset_arena_per_chunk()`, the arena is reset before a batch
+  // which begins a chunk, but never in the middle of a batch.
+  //
+  // All records of a batch come from the same chunk. If reading fails after
+  // some records were appended, `ReadChunkRecords()` returns `true`, and the
+  // failure is reported, or recovered from, by the next call.
+  //
+  // Return values:
+  //  * `true`                 - success (at least one record is appended)
+  //  * `false` (when `ok()`)  - source ends
+  //  * `false` (when `!ok()`) - failure
+  bool ReadChunkRecords(const google::protobuf::MessageLite& prototype,
+                        google::protobuf::Arena& arena,
+                        std::vector<google::protobuf::MessageLite*>& records);
+
   // Like `Options::set_field_projection()`, but can be done at any time.
   //
   // This may cause reading the current chunk again.
@@ -282,6 +347,11 @@ class RecordReaderBase : public Object {
   // `pos()` is unchanged by `Close()`.
   RecordPosition pos() const;
 
+  // Returns statistics of reading, collected while `StatsEnabled()`.
+  // `hash_time_ns` covers verifying hashes of chunk data, `message_time_ns`
+  // covers parsing records into proto messages.
+  const RecordStats& stats() const { return stats_; }
+
   // Returns `true` if this `RecordReader` supports `Seek()`, `SeekBack()`,
   // `Size()`, and `Search()`.
   bool SupportsRandomAccess();
@@ -437,8 +507,13 @@ class RecordReaderBase : public Object {
 
   std::function<bool(const SkippedRegion&)> recovery_;
 
+  bool reset_arena_per_chunk_ = false;
+
+  RecordStats stats_;
+
  private:
   class ChunkSearchTraits;
+  struct ArenaRecord;
 
   bool FailReading(const ChunkReader& src);
   bool FailSeeking(const ChunkReader& src);
@@ -448,6 +523,12 @@ class RecordReaderBase : public Object {
   template <typename Record>
   bool ReadRecordImpl(Record& record);
 
+  // Reads the next record of the current chunk into `record`.
+  template <typename Record>
+  bool ReadRecordFromChunk(Record& record);
+  bool ReadRecordFromChunk(google::protobuf::MessageLite& record);
+  bool ReadRecordFromChunk(ArenaRecord& record);
+
   // Reads the next chunk from `chunk_reader_` and decodes it into
   // `chunk_decoder_` and `chunk_begin_`. On failure resets `chunk_decoder_`.
   //
@@ -611,6 +692,21 @@ inline bool RecordReaderBase::TryRecovery() {
   return Recover(&skipped_region) && recovery_(skipped_region);
 }
 
+template <typename Message,
+          std::enable_if_t<
+              std::is_base_of<google::protobuf::MessageLite, Message>::value,
+              int>>
+inline bool RecordReaderBase::ReadRecord(google::protobuf::Arena& arena,
+                                         Message*& record) {
+  google::protobuf::MessageLite* message;
+  if (ABSL_PREDICT_FALSE(
+          !ReadRecord(Message::default_instance(), arena, message))) {
+    return false;
+  }
+  record = static_cast<Message*>(message);
+  return true;
+}
+
 inline RecordPosition RecordReaderBase::last_pos() const {
   RIEGELI_ASSERT(last_record_is_valid())
       << "Failed precondition of RecordReaderBase::last_pos(): "
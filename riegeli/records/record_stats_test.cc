@@ -0,0 +1,136 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <string>
+#include <tuple>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/stats.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+namespace {
+
+constexpr uint64_t kNumRecords = 1000;
+
+std::string Record(uint64_t index) {
+  return absl::StrCat("record ", index, " ", std::string(index % 100, 'x'));
+}
+
+// Enables collecting statistics for the duration of a test.
+class StatsTest : public testing::Test {
+ protected:
+  void SetUp() override { SetStatsEnabled(true); }
+  void TearDown() override { SetStatsEnabled(false); }
+};
+
+TEST_F(StatsTest, WriteAndRead) {
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/record_stats");
+  uint64_t records_size = 0;
+  const ProcessStats before_writing = GetProcessStats();
+  {
+    RecordWriter<FdWriter<>> writer(
+        std::forward_as_tuple(filename),
+        RecordWriterBase::Options().set_chunk_size(4 << 10));
+    for (uint64_t i = 0; i < kNumRecords; ++i) {
+      const std::string record = Record(i);
+      ASSERT_TRUE(writer.WriteRecord(record)) << writer.status();
+      records_size += record.size();
+    }
+    ASSERT_TRUE(writer.Close()) << writer.status();
+
+    const RecordStats& record_stats = writer.stats();
+    EXPECT_EQ(record_stats.num_records, kNumRecords);
+    EXPECT_GT(record_stats.num_chunks, 1u);
+    const IoStats& io_stats = writer.dest().stats();
+    EXPECT_GT(io_stats.num_ops, 0u);
+    EXPECT_EQ(io_stats.bytes, writer.dest().pos());
+  }
+  const ProcessStats after_writing = GetProcessStats();
+  EXPECT_EQ(after_writing.record_writes.num_records -
+                before_writing.record_writes.num_records,
+            kNumRecords);
+  EXPECT_GT(after_writing.record_writes.num_chunks,
+            before_writing.record_writes.num_chunks);
+  EXPECT_GT(after_writing.buffered_writes.bytes,
+            before_writing.buffered_writes.bytes);
+  const uint64_t compressed_bytes_in = after_writing.compression.bytes_in -
+                                       before_writing.compression.bytes_in;
+  EXPECT_GE(compressed_bytes_in, records_size);
+  EXPECT_GT(after_writing.compression.bytes_out,
+            before_writing.compression.bytes_out);
+  EXPECT_GT(after_writing.compression.time_ns,
+            before_writing.compression.time_ns);
+
+  {
+    RecordReader<FdReader<>> reader(std::forward_as_tuple(filename));
+    absl::string_view record;
+    uint64_t num_records = 0;
+    while (reader.ReadRecord(record)) {
+      EXPECT_EQ(record, Record(num_records));
+      ++num_records;
+    }
+    EXPECT_EQ(num_records, kNumRecords);
+    ASSERT_TRUE(reader.Close()) << reader.status();
+
+    const RecordStats& record_stats = reader.stats();
+    EXPECT_EQ(record_stats.num_records, kNumRecords);
+    EXPECT_GT(record_stats.num_chunks, 1u);
+    EXPECT_GT(record_stats.hash_time_ns, 0u);
+    const IoStats& io_stats = reader.src().stats();
+    EXPECT_GT(io_stats.num_ops, 0u);
+    EXPECT_EQ(io_stats.bytes, reader.src().pos());
+  }
+  const ProcessStats after_reading = GetProcessStats();
+  EXPECT_EQ(after_reading.record_reads.num_records -
+                after_writing.record_reads.num_records,
+            kNumRecords);
+  EXPECT_GT(after_reading.record_reads.num_chunks,
+            after_writing.record_reads.num_chunks);
+  EXPECT_GT(after_reading.buffered_reads.bytes,
+            after_writing.buffered_reads.bytes);
+  EXPECT_EQ(after_reading.decompression.bytes_out -
+                after_writing.decompression.bytes_out,
+            compressed_bytes_in);
+  EXPECT_GT(after_reading.decompression.time_ns,
+            after_writing.decompression.time_ns);
+}
+
+TEST_F(StatsTest, DisabledStatsAreNotCollected) {
+  SetStatsEnabled(false);
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/record_stats_disabled");
+  const ProcessStats before = GetProcessStats();
+  RecordWriter<FdWriter<>> writer(std::forward_as_tuple(filename));
+  for (uint64_t i = 0; i < kNumRecords; ++i) {
+    ASSERT_TRUE(writer.WriteRecord(Record(i))) << writer.status();
+  }
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  EXPECT_EQ(writer.stats().num_records, 0u);
+  EXPECT_EQ(writer.dest().stats().num_ops, 0u);
+  const ProcessStats after = GetProcessStats();
+  EXPECT_EQ(after.record_writes.num_records, before.record_writes.num_records);
+  EXPECT_EQ(after.buffered_writes.bytes, before.buffered_writes.bytes);
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -17,8 +17,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <cmath>
 #include <deque>
+#include <functional>
 #include <future>
 #include <limits>
 #include <memory>
@@ -44,11 +46,14 @@
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/base/memory_budget.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/options_parser.h"
-#include "riegeli/base/parallelism.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
+#include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/chain_writer.h"
 #include "riegeli/chunk_encoding/chunk.h"
 #include "riegeli/chunk_encoding/chunk_encoder.h"
@@ -101,6 +106,22 @@ class FileDescriptorCollector {
   absl::flat_hash_set<std::string> files_seen_;
 };
 
+// Returns memory of buffers of a compressor with `compressor_options`, which a
+// chunk encoded in background draws together with the chunk itself.
+size_t CompressorBufferMemory(const CompressorOptions& compressor_options) {
+  switch (compressor_options.compression_type()) {
+    case CompressionType::kBrotli:
+    case CompressionType::kZstd:
+      return BufferOptions::kDefaultMaxBufferSize;
+    case CompressionType::kNone:
+    case CompressionType::kSnappy:
+      return 0;
+  }
+  RIEGELI_ASSERT_UNREACHABLE()
+      << "Unknown compression type: "
+      << static_cast<unsigned>(compressor_options.compression_type());
+}
+
 }  // namespace
 
 void SetRecordType(const google::protobuf::Descriptor& descriptor,
@@ -175,8 +196,11 @@ class RecordWriterBase::Worker {
 
   // Precondition: chunk is open.
   //
+  // `chunk_size` is the size of the chunk as estimated by `RecordWriterBase`,
+  // i.e. the size of records with their per-record overhead.
+  //
   // If the result is `false` then `!ok()`.
-  virtual bool CloseChunk() = 0;
+  virtual bool CloseChunk(uint64_t chunk_size) = 0;
 
   bool MaybePadToBlockBoundary();
 
@@ -192,6 +216,10 @@ class RecordWriterBase::Worker {
 
   virtual Position EstimatedSize() const = 0;
 
+  // Returns `num_chunks` and `hash_time_ns` of chunks encoded so far, collected
+  // while `StatsEnabled()`. Chunks can be encoded in background threads.
+  RecordStats stats() const;
+
  protected:
   void Initialize(Position initial_pos);
 
@@ -215,6 +243,10 @@ class RecordWriterBase::Worker {
   ChunkWriter* chunk_writer_;
   // Invariant: if chunk is open then `chunk_encoder_ != nullptr`
   std::unique_ptr<ChunkEncoder> chunk_encoder_;
+
+ private:
+  std::atomic<uint64_t> num_chunks_{0};
+  std::atomic<uint64_t> hash_time_ns_{0};
 };
 
 inline RecordWriterBase::Worker::Worker(ChunkWriter* chunk_writer,
@@ -250,6 +282,13 @@ inline void RecordWriterBase::Worker::Initialize(Position initial_pos) {
   }
 }
 
+RecordStats RecordWriterBase::Worker::stats() const {
+  RecordStats stats;
+  stats.num_chunks = num_chunks_.load(std::memory_order_relaxed);
+  stats.hash_time_ns = hash_time_ns_.load(std::memory_order_relaxed);
+  return stats;
+}
+
 inline bool RecordWriterBase::Worker::MaybePadToBlockBoundary() {
   if (options_.pad_to_block_boundary()) {
     return PadToBlockBoundary();
@@ -260,6 +299,13 @@ inline bool RecordWriterBase::Worker::MaybePadToBlockBoundary() {
 
 inline std::unique_ptr<ChunkEncoder>
 RecordWriterBase::Worker::MakeChunkEncoder() {
+  // Without parallelism, buffers of the compressor are drawn from the memory
+  // budget while encoding. With parallelism, the chunk draws memory for them
+  // before being encoded in background, so that a background task does not
+  // wait for memory while holding some.
+  CompressorOptions compressor_options = options_.compressor_options();
+  compressor_options.set_memory_budget(
+      options_.parallelism() == 0 ? options_.memory_budget() : nullptr);
   std::unique_ptr<ChunkEncoder> chunk_encoder;
   if (options_.transpose()) {
     const long double long_double_bucket_size =
@@ -274,10 +320,10 @@ RecordWriterBase::Worker::MakeChunkEncoder() {
             ? static_cast<uint64_t>(long_double_bucket_size)
             : uint64_t{1};
     chunk_encoder = std::make_unique<TransposeEncoder>(
-        options_.compressor_options(), bucket_size);
+        std::move(compressor_options), bucket_size);
   } else {
     chunk_encoder = std::make_unique<SimpleEncoder>(
-        options_.compressor_options(), options_.effective_chunk_size());
+        std::move(compressor_options), options_.effective_chunk_size());
   }
   if (options_.parallelism() == 0) {
     return chunk_encoder;
@@ -351,8 +397,18 @@ inline bool RecordWriterBase::Worker::EncodeChunk(ChunkEncoder& chunk_encoder,
   if (ABSL_PREDICT_FALSE(!data_writer.Close())) {
     return Fail(data_writer.status());
   }
+  if (ABSL_PREDICT_TRUE(!StatsEnabled())) {
+    chunk.header =
+        ChunkHeader(chunk.data, chunk_type, num_records, decoded_data_size);
+    return true;
+  }
+  // `ChunkHeader` computes hashes of chunk data and of itself.
+  const uint64_t start_ns = stats_internal::Now_ns();
   chunk.header =
       ChunkHeader(chunk.data, chunk_type, num_records, decoded_data_size);
+  hash_time_ns_.fetch_add(stats_internal::Now_ns() - start_ns,
+                          std::memory_order_relaxed);
+  num_chunks_.fetch_add(1, std::memory_order_relaxed);
   return true;
 }
 
@@ -364,7 +420,7 @@ class RecordWriterBase::SerialWorker : public Worker {
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateStatus(absl::Status status) override;
 
   void OpenChunk() override { chunk_encoder_->Clear(); }
-  bool CloseChunk() override;
+  bool CloseChunk(uint64_t chunk_size) override;
   bool Flush(FlushType flush_type) override;
   std::future<bool> FutureFlush(FlushType flush_type) override;
   FutureRecordPosition LastPos() const override;
@@ -426,7 +482,8 @@ bool RecordWriterBase::SerialWorker::WriteMetadata() {
   return true;
 }
 
-bool RecordWriterBase::SerialWorker::CloseChunk() {
+bool RecordWriterBase::SerialWorker::CloseChunk(
+    ABSL_ATTRIBUTE_UNUSED uint64_t chunk_size) {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   Chunk chunk;
   if (ABSL_PREDICT_FALSE(!EncodeChunk(*chunk_encoder_, chunk))) return false;
@@ -487,7 +544,7 @@ class RecordWriterBase::ParallelWorker : public Worker {
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateStatus(absl::Status status) override;
 
   void OpenChunk() override { chunk_encoder_ = MakeChunkEncoder(); }
-  bool CloseChunk() override;
+  bool CloseChunk(uint64_t chunk_size) override;
   bool Flush(FlushType flush_type) override;
   std::future<bool> FutureFlush(FlushType flush_type) override;
   FutureRecordPosition LastPos() const override;
@@ -504,12 +561,9 @@ class RecordWriterBase::ParallelWorker : public Worker {
   bool PadToBlockBoundary() override;
 
  private:
-  struct ChunkPromises {
-    std::promise<ChunkHeader> chunk_header;
-    std::promise<Chunk> chunk;
-  };
-
-  // A request to the chunk writer thread.
+  // A request to write to `chunk_writer_`. Requests are handled in order, by
+  // a task of `executor_` or by the task which finished encoding the chunk
+  // at the front.
   struct DoneRequest {
     std::promise<void> done;
   };
@@ -519,7 +573,12 @@ class RecordWriterBase::ParallelWorker : public Worker {
   };
   struct WriteChunkRequest {
     std::shared_future<ChunkHeader> chunk_header;
-    std::future<Chunk> chunk;
+    // Valid if `encoded`.
+    Chunk chunk;
+    bool encoded = false;
+    // Memory drawn from `Options::memory_budget()` by the chunk, returned when
+    // the chunk is written.
+    MemoryReservation memory;
   };
   struct PadToBlockBoundaryRequest {};
   struct FlushRequest {
@@ -533,8 +592,29 @@ class RecordWriterBase::ParallelWorker : public Worker {
   bool HasCapacityForRequest() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   records_internal::FutureChunkBegin ChunkBegin() const;
 
+  // Appends `request` to `chunk_writer_requests_`, waiting for capacity, and
+  // starts handling requests if possible. Returns the appended request, which
+  // stays valid until it is handled.
+  ChunkWriterRequest& AddRequest(ChunkWriterRequest&& request);
+
+  // Adds a `WriteChunkRequest` for a chunk encoded with `encode` in a task of
+  // `executor_`.
+  void WriteChunkInBackground(std::function<void(Chunk&)> encode,
+                              MemoryReservation memory);
+
+  // Marks `handling_requests_` and returns `true` if requests should be
+  // handled now: they are not being handled yet, and the first one is ready.
+  bool StartHandlingRequests() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Handles requests while the first one is ready. `StartHandlingRequests()`
+  // must have returned `true`.
+  void HandleRequests();
+
+  Executor* executor_;
   mutable absl::Mutex mutex_;
   std::deque<ChunkWriterRequest> chunk_writer_requests_ ABSL_GUARDED_BY(mutex_);
+  // Whether a task is handling `chunk_writer_requests_`.
+  bool handling_requests_ ABSL_GUARDED_BY(mutex_) = false;
   // Position before handling `chunk_writer_requests_`.
   Position pos_before_chunks_ ABSL_GUARDED_BY(mutex_);
 };
@@ -542,79 +622,143 @@ class RecordWriterBase::ParallelWorker : public Worker {
 inline RecordWriterBase::ParallelWorker::ParallelWorker(
     ChunkWriter* chunk_writer, Options&& options)
     : Worker(chunk_writer, std::move(options)),
+      executor_(options_.executor() != nullptr ? options_.executor()
+                                               : &Executor::global()),
       pos_before_chunks_(chunk_writer_->pos()) {
-  internal::ThreadPool::global().Schedule([this] {
-    struct Visitor {
-      bool operator()(DoneRequest& request) const {
-        request.done.set_value();
-        return false;
-      }
+  Initialize(pos_before_chunks_);
+}
 
-      bool operator()(AnnotateStatusRequest& request) const {
-        request.done.set_value(
-            self->chunk_writer_->AnnotateStatus(request.status));
-        return true;
-      }
+bool RecordWriterBase::ParallelWorker::StartHandlingRequests() {
+  if (handling_requests_ || chunk_writer_requests_.empty()) return false;
+  const WriteChunkRequest* const write_chunk_request =
+      absl::get_if<WriteChunkRequest>(&chunk_writer_requests_.front());
+  if (write_chunk_request != nullptr && !write_chunk_request->encoded) {
+    // The task encoding the chunk will handle requests.
+    return false;
+  }
+  handling_requests_ = true;
+  return true;
+}
 
-      bool operator()(WriteChunkRequest& request) const {
-        // If `!ok()`, the chunk must still be waited for, to ensure that the
-        // chunk encoder thread exits before the chunk writer thread responds to
-        // `DoneRequest`.
-        const Chunk chunk = request.chunk.get();
-        if (ABSL_PREDICT_FALSE(!self->ok())) return true;
-        if (ABSL_PREDICT_FALSE(!self->chunk_writer_->WriteChunk(chunk))) {
-          self->FailWithoutAnnotation(self->chunk_writer_->status());
-        }
-        return true;
+void RecordWriterBase::ParallelWorker::HandleRequests() {
+  struct Visitor {
+    void operator()(AnnotateStatusRequest& request) const {
+      request.done.set_value(
+          self->chunk_writer_->AnnotateStatus(request.status));
+    }
+
+    void operator()(WriteChunkRequest& request) const {
+      if (ABSL_PREDICT_FALSE(!self->ok())) return;
+      if (ABSL_PREDICT_FALSE(!self->chunk_writer_->WriteChunk(request.chunk))) {
+        self->FailWithoutAnnotation(self->chunk_writer_->status());
       }
+    }
 
-      bool operator()(PadToBlockBoundaryRequest& request) const {
-        if (ABSL_PREDICT_FALSE(!self->ok())) return true;
-        if (ABSL_PREDICT_FALSE(!self->chunk_writer_->PadToBlockBoundary())) {
-          self->FailWithoutAnnotation(self->chunk_writer_->status());
-        }
-        return true;
+    void operator()(PadToBlockBoundaryRequest&) const {
+      if (ABSL_PREDICT_FALSE(!self->ok())) return;
+      if (ABSL_PREDICT_FALSE(!self->chunk_writer_->PadToBlockBoundary())) {
+        self->FailWithoutAnnotation(self->chunk_writer_->status());
       }
+    }
 
-      bool operator()(FlushRequest& request) const {
-        if (ABSL_PREDICT_FALSE(!self->ok())) {
-          request.done.set_value(false);
-          return true;
-        }
-        if (ABSL_PREDICT_FALSE(
-                !self->chunk_writer_->Flush(request.flush_type))) {
-          self->FailWithoutAnnotation(self->chunk_writer_->status());
-          request.done.set_value(false);
-          return true;
-        }
-        request.done.set_value(true);
-        return true;
+    void operator()(FlushRequest& request) const {
+      if (ABSL_PREDICT_FALSE(!self->ok())) {
+        request.done.set_value(false);
+        return;
       }
+      if (ABSL_PREDICT_FALSE(
+              !self->chunk_writer_->Flush(request.flush_type))) {
+        self->FailWithoutAnnotation(self->chunk_writer_->status());
+        request.done.set_value(false);
+        return;
+      }
+      request.done.set_value(true);
+    }
 
-      ParallelWorker* self;
-    };
+    void operator()(DoneRequest&) const {
+      RIEGELI_ASSERT_UNREACHABLE() << "DoneRequest handled separately";
+    }
 
-    mutex_.Lock();
-    for (;;) {
-      mutex_.Await(absl::Condition(
-          +[](std::deque<ChunkWriterRequest>* chunk_writer_requests) {
-            return !chunk_writer_requests->empty();
-          },
-          &chunk_writer_requests_));
-      ChunkWriterRequest& request = chunk_writer_requests_.front();
-      mutex_.Unlock();
-      if (ABSL_PREDICT_FALSE(!absl::visit(Visitor{this}, request))) return;
-      mutex_.Lock();
+    ParallelWorker* self;
+  };
+
+  mutex_.Lock();
+  RIEGELI_ASSERT(handling_requests_)
+      << "Failed precondition of RecordWriterBase::ParallelWorker::"
+         "HandleRequests(): requests are not being handled";
+  for (;;) {
+    ChunkWriterRequest& request = chunk_writer_requests_.front();
+    DoneRequest* const done_request = absl::get_if<DoneRequest>(&request);
+    if (done_request != nullptr) {
+      // `DoneRequest` is the last request. `*this` may be destroyed as soon as
+      // it is answered, so it must not be accessed afterwards.
+      std::promise<void> done = std::move(done_request->done);
       chunk_writer_requests_.pop_front();
-      pos_before_chunks_ = chunk_writer_->pos();
+      handling_requests_ = false;
+      mutex_.Unlock();
+      done.set_value();
+      return;
     }
+    mutex_.Unlock();
+    absl::visit(Visitor{this}, request);
+    mutex_.Lock();
+    chunk_writer_requests_.pop_front();
+    pos_before_chunks_ = chunk_writer_->pos();
+    handling_requests_ = false;
+    if (!StartHandlingRequests()) break;
+  }
+  mutex_.Unlock();
+}
+
+RecordWriterBase::ParallelWorker::ChunkWriterRequest&
+RecordWriterBase::ParallelWorker::AddRequest(ChunkWriterRequest&& request) {
+  mutex_.LockWhen(
+      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
+  chunk_writer_requests_.push_back(std::move(request));
+  ChunkWriterRequest& added_request = chunk_writer_requests_.back();
+  const bool start_handling_requests = StartHandlingRequests();
+  mutex_.Unlock();
+  if (start_handling_requests) {
+    // Handle requests in background, because writing to `chunk_writer_` may
+    // block.
+    executor_->Schedule([this] { HandleRequests(); });
+  }
+  return added_request;
+}
+
+void RecordWriterBase::ParallelWorker::WriteChunkInBackground(
+    std::function<void(Chunk&)> encode, MemoryReservation memory) {
+  std::promise<ChunkHeader>* const chunk_header_promise =
+      new std::promise<ChunkHeader>();
+  // The request is not handled before the chunk is encoded, so it stays valid
+  // until then.
+  WriteChunkRequest& request = absl::get<WriteChunkRequest>(AddRequest(
+      WriteChunkRequest{chunk_header_promise->get_future().share(), Chunk(),
+                        false, std::move(memory)}));
+  executor_->Schedule([this, &request, chunk_header_promise,
+                       encode = std::move(encode)]() mutable {
+    Chunk chunk;
+    encode(chunk);
+    // Release resources used for encoding before `*this` may be destroyed.
+    encode = nullptr;
+    chunk_header_promise->set_value(chunk.header);
+    delete chunk_header_promise;
+    bool start_handling_requests;
+    {
+      absl::MutexLock lock(&mutex_);
+      request.chunk = std::move(chunk);
+      request.encoded = true;
+      start_handling_requests = StartHandlingRequests();
+    }
+    // Unless requests are handled here, `*this` may be destroyed as soon as
+    // `mutex_` is unlocked.
+    if (start_handling_requests) HandleRequests();
   });
-  Initialize(pos_before_chunks_);
 }
 
 RecordWriterBase::ParallelWorker::~ParallelWorker() {
   if (ABSL_PREDICT_FALSE(state_.is_open())) {
-    // Ask the chunk writer thread to stop working and exit.
+    // Skip pending requests, and wait until tasks stop accessing `*this`.
     ParallelWorker::FailWithoutAnnotation(absl::CancelledError());
     Done();
   }
@@ -623,10 +767,7 @@ RecordWriterBase::ParallelWorker::~ParallelWorker() {
 void RecordWriterBase::ParallelWorker::Done() {
   std::promise<void> done_promise;
   std::future<void> done_future = done_promise.get_future();
-  {
-    absl::MutexLock lock(&mutex_);
-    chunk_writer_requests_.emplace_back(DoneRequest{std::move(done_promise)});
-  }
+  AddRequest(DoneRequest{std::move(done_promise)});
   done_future.get();
 }
 
@@ -650,11 +791,7 @@ absl::Status RecordWriterBase::ParallelWorker::AnnotateStatus(
     absl::Status status) {
   std::promise<absl::Status> done_promise;
   std::future<absl::Status> done_future = done_promise.get_future();
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(
-      AnnotateStatusRequest{std::move(status), std::move(done_promise)});
-  mutex_.Unlock();
+  AddRequest(AnnotateStatusRequest{std::move(status), std::move(done_promise)});
   return done_future.get();
 }
 
@@ -667,15 +804,10 @@ bool RecordWriterBase::ParallelWorker::WriteSignature() {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   Chunk chunk;
   EncodeSignature(chunk);
-  ChunkPromises chunk_promises;
-  chunk_promises.chunk_header.set_value(chunk.header);
-  chunk_promises.chunk.set_value(std::move(chunk));
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(
-      WriteChunkRequest{chunk_promises.chunk_header.get_future(),
-                        chunk_promises.chunk.get_future()});
-  mutex_.Unlock();
+  std::promise<ChunkHeader> chunk_header_promise;
+  chunk_header_promise.set_value(chunk.header);
+  AddRequest(WriteChunkRequest{chunk_header_promise.get_future().share(),
+                               std::move(chunk), true, MemoryReservation()});
   return true;
 }
 
@@ -685,51 +817,33 @@ bool RecordWriterBase::ParallelWorker::WriteMetadata() {
       options_.serialized_metadata() == absl::nullopt) {
     return true;
   }
-  ChunkPromises* const chunk_promises = new ChunkPromises();
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(
-      WriteChunkRequest{chunk_promises->chunk_header.get_future(),
-                        chunk_promises->chunk.get_future()});
-  mutex_.Unlock();
-  internal::ThreadPool::global().Schedule([this, chunk_promises] {
-    Chunk chunk;
-    EncodeMetadata(chunk);
-    chunk_promises->chunk_header.set_value(chunk.header);
-    chunk_promises->chunk.set_value(std::move(chunk));
-    delete chunk_promises;
-  });
+  WriteChunkInBackground([this](Chunk& chunk) { EncodeMetadata(chunk); },
+                         MemoryReservation());
   return true;
 }
 
-bool RecordWriterBase::ParallelWorker::CloseChunk() {
+bool RecordWriterBase::ParallelWorker::CloseChunk(uint64_t chunk_size) {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
-  ChunkEncoder* const chunk_encoder = chunk_encoder_.release();
-  ChunkPromises* const chunk_promises = new ChunkPromises();
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(
-      WriteChunkRequest{chunk_promises->chunk_header.get_future(),
-                        chunk_promises->chunk.get_future()});
-  mutex_.Unlock();
-  internal::ThreadPool::global().Schedule(
-      [this, chunk_encoder, chunk_promises] {
-        Chunk chunk;
+  // Draw memory before locking `mutex_`, because while waiting for memory
+  // pending requests must be able to be handled, returning memory.
+  MemoryReservation memory(
+      options_.memory_budget(),
+      SaturatingAdd(SaturatingIntCast<size_t>(chunk_size),
+                    CompressorBufferMemory(options_.compressor_options())));
+  // `std::function` must be copyable, so `chunk_encoder` cannot be captured as
+  // `std::unique_ptr`.
+  std::shared_ptr<ChunkEncoder> chunk_encoder = std::move(chunk_encoder_);
+  WriteChunkInBackground(
+      [this, chunk_encoder = std::move(chunk_encoder)](Chunk& chunk) {
         EncodeChunk(*chunk_encoder, chunk);
-        delete chunk_encoder;
-        chunk_promises->chunk_header.set_value(chunk.header);
-        chunk_promises->chunk.set_value(std::move(chunk));
-        delete chunk_promises;
-      });
+      },
+      std::move(memory));
   return true;
 }
 
 bool RecordWriterBase::ParallelWorker::PadToBlockBoundary() {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(PadToBlockBoundaryRequest());
-  mutex_.Unlock();
+  AddRequest(PadToBlockBoundaryRequest());
   return true;
 }
 
@@ -741,11 +855,7 @@ std::future<bool> RecordWriterBase::ParallelWorker::FutureFlush(
     FlushType flush_type) {
   std::promise<bool> done_promise;
   std::future<bool> done_future = done_promise.get_future();
-  mutex_.LockWhen(
-      absl::Condition(this, &ParallelWorker::HasCapacityForRequest));
-  chunk_writer_requests_.emplace_back(
-      FlushRequest{flush_type, std::move(done_promise)});
-  mutex_.Unlock();
+  AddRequest(FlushRequest{flush_type, std::move(done_promise)});
   return done_future;
 }
 
@@ -811,6 +921,7 @@ void RecordWriterBase::Reset(Closed) {
   chunk_size_so_far_ = 0;
   last_record_is_valid_ = false;
   worker_.reset();
+  stats_ = RecordStats();
 }
 
 void RecordWriterBase::Reset() {
@@ -819,6 +930,7 @@ void RecordWriterBase::Reset() {
   chunk_size_so_far_ = 0;
   last_record_is_valid_ = false;
   worker_.reset();
+  stats_ = RecordStats();
 }
 
 RecordWriterBase::RecordWriterBase(RecordWriterBase&& that) noexcept
@@ -826,7 +938,8 @@ RecordWriterBase::RecordWriterBase(RecordWriterBase&& that) noexcept
       desired_chunk_size_(that.desired_chunk_size_),
       chunk_size_so_far_(that.chunk_size_so_far_),
       last_record_is_valid_(std::exchange(that.last_record_is_valid_, false)),
-      worker_(std::move(that.worker_)) {}
+      worker_(std::move(that.worker_)),
+      stats_(std::exchange(that.stats_, RecordStats())) {}
 
 RecordWriterBase& RecordWriterBase::operator=(
     RecordWriterBase&& that) noexcept {
@@ -835,6 +948,7 @@ RecordWriterBase& RecordWriterBase::operator=(
   chunk_size_so_far_ = that.chunk_size_so_far_;
   last_record_is_valid_ = std::exchange(that.last_record_is_valid_, false);
   worker_ = std::move(that.worker_);
+  stats_ = std::exchange(that.stats_, RecordStats());
   return *this;
 }
 
@@ -868,7 +982,7 @@ void RecordWriterBase::Done() {
   }
   last_record_is_valid_ = false;
   if (chunk_size_so_far_ != 0) {
-    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk())) {
+    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk(chunk_size_so_far_))) {
       FailWithoutAnnotation(worker_->status());
     }
     chunk_size_so_far_ = 0;
@@ -879,10 +993,20 @@ void RecordWriterBase::Done() {
   if (ABSL_PREDICT_FALSE(!worker_->Close())) {
     FailWithoutAnnotation(worker_->status());
   }
+  stats_ += worker_->stats();
+  if (stats_.num_chunks > 0 || stats_.num_records > 0) {
+    stats_internal::AddToProcessStats(&ProcessStats::record_writes, stats_);
+  }
 }
 
 void RecordWriterBase::DoneBackground() { worker_.reset(); }
 
+RecordStats RecordWriterBase::stats() const {
+  RecordStats stats = stats_;
+  if (is_open()) stats += worker_->stats();
+  return stats;
+}
+
 absl::Status RecordWriterBase::AnnotateStatusImpl(absl::Status status) {
   if (is_open()) {
     RIEGELI_ASSERT(worker_ != nullptr)
@@ -911,14 +1035,23 @@ bool RecordWriterBase::WriteRecord(const google::protobuf::MessageLite& record,
                          added_size >
                              desired_chunk_size_ - chunk_size_so_far_) &&
       chunk_size_so_far_ > 0) {
-    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk())) {
+    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk(chunk_size_so_far_))) {
       return FailWithoutAnnotation(worker_->status());
     }
     worker_->OpenChunk();
     chunk_size_so_far_ = 0;
   }
   chunk_size_so_far_ += added_size;
-  if (ABSL_PREDICT_FALSE(!worker_->AddRecord(record, serialize_options))) {
+  if (ABSL_PREDICT_FALSE(StatsEnabled())) {
+    const uint64_t start_ns = stats_internal::Now_ns();
+    const bool add_ok = worker_->AddRecord(record, serialize_options);
+    stats_.message_time_ns += stats_internal::Now_ns() - start_ns;
+    if (ABSL_PREDICT_FALSE(!add_ok)) {
+      return FailWithoutAnnotation(worker_->status());
+    }
+    ++stats_.num_records;
+  } else if (ABSL_PREDICT_FALSE(
+                 !worker_->AddRecord(record, serialize_options))) {
     return FailWithoutAnnotation(worker_->status());
   }
   last_record_is_valid_ = true;
@@ -968,7 +1101,7 @@ inline bool RecordWriterBase::WriteRecordImpl(Record&& record) {
                          added_size >
                              desired_chunk_size_ - chunk_size_so_far_) &&
       chunk_size_so_far_ > 0) {
-    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk())) {
+    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk(chunk_size_so_far_))) {
       return FailWithoutAnnotation(worker_->status());
     }
     worker_->OpenChunk();
@@ -978,6 +1111,7 @@ inline bool RecordWriterBase::WriteRecordImpl(Record&& record) {
   if (ABSL_PREDICT_FALSE(!worker_->AddRecord(std::forward<Record>(record)))) {
     return FailWithoutAnnotation(worker_->status());
   }
+  if (ABSL_PREDICT_FALSE(StatsEnabled())) ++stats_.num_records;
   last_record_is_valid_ = true;
   return true;
 }
@@ -986,7 +1120,7 @@ bool RecordWriterBase::Flush(FlushType flush_type) {
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   last_record_is_valid_ = false;
   if (chunk_size_so_far_ != 0) {
-    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk())) {
+    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk(chunk_size_so_far_))) {
       return FailWithoutAnnotation(worker_->status());
     }
   }
@@ -1014,7 +1148,7 @@ RecordWriterBase::FutureBool RecordWriterBase::FutureFlush(
   }
   last_record_is_valid_ = false;
   if (chunk_size_so_far_ != 0) {
-    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk())) {
+    if (ABSL_PREDICT_FALSE(!worker_->CloseChunk(chunk_size_so_far_))) {
       FailWithoutAnnotation(worker_->status());
       std::promise<bool> promise;
       promise.set_value(false);
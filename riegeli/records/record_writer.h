@@ -35,8 +35,11 @@
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
 #include "riegeli/base/dependency.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/base/memory_budget.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/stable_dependency.h"
+#include "riegeli/base/stats.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/writer.h"
 #include "riegeli/chunk_encoding/compressor_options.h"
@@ -413,6 +416,45 @@ class RecordWriterBase : public Object {
     }
     int parallelism() const { return parallelism_; }
 
+    // `Executor` which encodes chunks and writes them to the byte `Writer` in
+    // background if `parallelism > 0`. It is not owned and must outlive the
+    // `RecordWriter`.
+    //
+    // `nullptr` means `Executor::global()`.
+    //
+    // Default: `nullptr`.
+    Options& set_executor(Executor* executor) & {
+      executor_ = executor;
+      return *this;
+    }
+    Options&& set_executor(Executor* executor) && {
+      return std::move(set_executor(executor));
+    }
+    Executor* executor() const { return executor_; }
+
+    // `MemoryBudget` from which chunks being encoded in background draw their
+    // memory, including buffers of the compressor, if `parallelism > 0`.
+    // If `parallelism == 0`, buffers of the compressor draw from it while a
+    // chunk is encoded. It is not owned and must outlive the `RecordWriter`.
+    //
+    // Closing a chunk waits until the budget has room for it, which reduces
+    // effective parallelism when many `RecordWriter`s share a tight budget.
+    // If `parallelism > 0`, the destination should not draw from the same
+    // budget, because memory of chunks is returned after writing them to the
+    // destination.
+    //
+    // `nullptr` means no limit besides `parallelism`.
+    //
+    // Default: `nullptr`.
+    Options& set_memory_budget(MemoryBudget* memory_budget) & {
+      memory_budget_ = memory_budget;
+      return *this;
+    }
+    Options&& set_memory_budget(MemoryBudget* memory_budget) && {
+      return std::move(set_memory_budget(memory_budget));
+    }
+    MemoryBudget* memory_budget() const { return memory_budget_; }
+
    private:
     bool transpose_ = false;
     CompressorOptions compressor_options_;
@@ -422,6 +464,8 @@ class RecordWriterBase : public Object {
     absl::optional<Chain> serialized_metadata_;
     bool pad_to_block_boundary_ = false;
     int parallelism_ = 0;
+    Executor* executor_ = nullptr;
+    MemoryBudget* memory_budget_ = nullptr;
   };
 
   // `get()` returns the resolved value. Can block.
@@ -540,6 +584,12 @@ class RecordWriterBase : public Object {
   // background work to complete.
   Position EstimatedSize() const;
 
+  // Returns statistics of writing, collected while `StatsEnabled()`.
+  // `hash_time_ns` covers computing hashes of chunks, `message_time_ns` covers
+  // serializing proto messages into the current chunk. Chunks being encoded in
+  // background are not counted yet.
+  RecordStats stats() const;
+
  protected:
   explicit RecordWriterBase(Closed) noexcept;
 
@@ -574,6 +624,8 @@ class RecordWriterBase : public Object {
   bool last_record_is_valid_ = false;
   // Invariant: if `is_open()` then `worker_ != nullptr`.
   std::unique_ptr<Worker> worker_;
+  // Statistics other than these of `worker_` while `is_open()`.
+  RecordStats stats_;
 };
 
 // `RecordWriter` writes records to a Riegeli/records file. A record is
@@ -0,0 +1,130 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/record_writer.h"
+
+#include <stddef.h>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/memory_budget.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/records/record_reader.h"
+
+namespace riegeli {
+namespace {
+
+std::vector<std::string> TestRecords(size_t num_records, int seed) {
+  std::mt19937 random(seed);
+  std::vector<std::string> records;
+  for (size_t i = 0; i < num_records; ++i) {
+    std::string record = absl::StrCat(seed, ":", i, ":");
+    const size_t length = random() % 1000;
+    for (size_t j = 0; j < length; ++j) {
+      record.push_back(static_cast<char>('a' + random() % 26));
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+TEST(RecordWriterMemoryBudgetTest, ParallelWritersShareBudget) {
+  constexpr int kNumWriters = 4;
+  constexpr size_t kNumRecords = 500;
+  // Room for a few chunks with compressor buffers, fewer than the writers
+  // could encode in parallel.
+  MemoryBudget budget(size_t{256} << 10);
+  std::vector<std::string> files(kNumWriters);
+  std::vector<std::thread> threads;
+  for (int writer_index = 0; writer_index < kNumWriters; ++writer_index) {
+    threads.emplace_back([&budget, &files, writer_index] {
+      RecordWriter<StringWriter<>> writer(
+          std::forward_as_tuple(&files[writer_index]),
+          RecordWriterBase::Options()
+              .set_parallelism(2)
+              .set_chunk_size(size_t{16} << 10)
+              .set_memory_budget(&budget));
+      for (const std::string& record : TestRecords(kNumRecords, writer_index)) {
+        EXPECT_TRUE(writer.WriteRecord(record)) << writer.status();
+      }
+      EXPECT_TRUE(writer.Close()) << writer.status();
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_GT(budget.peak_usage(), 0u);
+  EXPECT_LE(budget.peak_usage(), budget.limit());
+  EXPECT_EQ(budget.usage(), 0u);
+
+  for (int writer_index = 0; writer_index < kNumWriters; ++writer_index) {
+    RecordReader<StringReader<>> reader(
+        std::forward_as_tuple(files[writer_index]));
+    std::vector<std::string> records;
+    std::string record;
+    while (reader.ReadRecord(record)) records.push_back(record);
+    EXPECT_TRUE(reader.Close()) << reader.status();
+    EXPECT_EQ(records, TestRecords(kNumRecords, writer_index))
+        << "Writer: " << writer_index;
+  }
+}
+
+TEST(RecordWriterMemoryBudgetTest, BuffersDrawFromBudget) {
+  constexpr size_t kNumRecords = 1000;
+  const std::string filename =
+      absl::StrCat(testing::TempDir(), "/buffers_draw_from_budget");
+  const std::vector<std::string> expected = TestRecords(kNumRecords, 1);
+  MemoryBudget budget(size_t{1} << 20);
+  {
+    // Without parallelism, buffers of the destination and of the compressor
+    // draw from the budget.
+    RecordWriter<FdWriter<>> writer(
+        std::forward_as_tuple(
+            filename, FdWriterBase::Options().set_memory_budget(&budget)),
+        RecordWriterBase::Options().set_memory_budget(&budget));
+    for (const std::string& record : expected) {
+      ASSERT_TRUE(writer.WriteRecord(record)) << writer.status();
+    }
+    EXPECT_GT(budget.usage(), 0u);
+    EXPECT_TRUE(writer.Close()) << writer.status();
+    EXPECT_EQ(budget.usage(), 0u);
+  }
+  EXPECT_GT(budget.peak_usage(), 0u);
+  EXPECT_LE(budget.peak_usage(), budget.limit());
+
+  MemoryBudget read_budget(size_t{1} << 20);
+  RecordReader<FdReader<>> reader(std::forward_as_tuple(
+      filename, FdReaderBase::Options().set_memory_budget(&read_budget)));
+  std::vector<std::string> records;
+  std::string record;
+  while (reader.ReadRecord(record)) {
+    EXPECT_GT(read_budget.usage(), 0u);
+    records.push_back(record);
+  }
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  EXPECT_EQ(read_budget.usage(), 0u);
+  EXPECT_LE(read_budget.peak_usage(), read_budget.limit());
+  EXPECT_EQ(records, expected);
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,113 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/sort/record_merger.h"
+
+#include <stddef.h>
+
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/object.h"
+#include "riegeli/records/record_reader.h"
+
+namespace riegeli {
+
+RecordMerger::RecordMerger(std::vector<RecordReaderBase*> sources,
+                           SortKeyExtractor key_extractor)
+    : sources_(std::move(sources)),
+      key_extractor_(std::move(key_extractor)),
+      heads_(sources_.size()) {
+  RIEGELI_ASSERT(key_extractor_ != nullptr)
+      << "Failed precondition of RecordMerger: null key extractor";
+  for (RecordReaderBase* const source : sources_) {
+    RIEGELI_ASSERT(source != nullptr)
+        << "Failed precondition of RecordMerger: null RecordReader pointer";
+  }
+}
+
+void RecordMerger::Done() {
+  heads_ = std::vector<Head>();
+  losers_ = std::vector<size_t>();
+  winner_returned_ = false;
+}
+
+inline bool RecordMerger::Less(size_t a, size_t b) const {
+  const size_t sentinel = sources_.size();
+  if (a == sentinel) return b != sentinel;
+  if (b == sentinel) return false;
+  const Head& head_a = heads_[a];
+  const Head& head_b = heads_[b];
+  if (head_a.exhausted) return false;
+  if (head_b.exhausted) return true;
+  const int ordering = head_a.key.compare(head_b.key);
+  if (ordering != 0) return ordering < 0;
+  return a < b;
+}
+
+inline void RecordMerger::Adjust(size_t index) {
+  size_t winner = index;
+  for (size_t node = (index + sources_.size()) / 2; node > 0; node /= 2) {
+    if (Less(losers_[node], winner)) std::swap(winner, losers_[node]);
+  }
+  losers_[0] = winner;
+}
+
+inline bool RecordMerger::Advance(size_t index) {
+  Head& head = heads_[index];
+  RecordReaderBase& source = *sources_[index];
+  if (ABSL_PREDICT_FALSE(!source.ReadRecord(head.record))) {
+    if (ABSL_PREDICT_FALSE(!source.ok())) return Fail(source.status());
+    head.record = absl::string_view();
+    head.exhausted = true;
+    return true;
+  }
+  key_extractor_(head.record, head.key);
+  return true;
+}
+
+bool RecordMerger::ReadRecord(absl::string_view& record,
+                              absl::string_view* key) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  if (ABSL_PREDICT_FALSE(!started_)) {
+    started_ = true;
+    if (sources_.empty()) return false;
+    // Start with the sentinel everywhere, so that inserting sources from the
+    // last one replays all matches.
+    losers_.assign(sources_.size(), sources_.size());
+    for (size_t index = 0; index < sources_.size(); ++index) {
+      if (ABSL_PREDICT_FALSE(!Advance(index))) return false;
+    }
+    for (size_t index = sources_.size(); index > 0; --index) {
+      Adjust(index - 1);
+    }
+  } else if (winner_returned_) {
+    winner_returned_ = false;
+    const size_t winner = losers_[0];
+    if (ABSL_PREDICT_FALSE(!Advance(winner))) return false;
+    Adjust(winner);
+  }
+  if (ABSL_PREDICT_FALSE(losers_.empty())) return false;
+  const Head& head = heads_[losers_[0]];
+  if (head.exhausted) return false;
+  record = head.record;
+  if (key != nullptr) *key = head.key;
+  winner_returned_ = true;
+  return true;
+}
+
+}  // namespace riegeli
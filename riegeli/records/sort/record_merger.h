@@ -0,0 +1,113 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_SORT_RECORD_MERGER_H_
+#define RIEGELI_RECORDS_SORT_RECORD_MERGER_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "riegeli/base/object.h"
+#include "riegeli/records/record_reader.h"
+
+namespace riegeli {
+
+// Extracts the sort key of `record` into `key`. Keys are compared as byte
+// strings.
+//
+// `key` is passed with contents of an earlier key, to let its memory be reused,
+// and should be replaced.
+using SortKeyExtractor =
+    std::function<void(absl::string_view record, std::string& key)>;
+
+// `RecordMerger` merges records from several `RecordReader`s, each of which
+// reads records sorted by their keys, into one sequence of records sorted by
+// their keys.
+//
+// Records with equal keys are returned in the order of their sources, and
+// records with equal keys from the same source keep their order, i.e. merging
+// is stable.
+//
+// A loser tree selects the next record with about `log2(sources.size())` key
+// comparisons per record.
+//
+// The `RecordReader`s are not owned and not closed. Read-ahead is controlled by
+// buffer sizes of their byte `Reader`s.
+class RecordMerger : public Object {
+ public:
+  // Creates a closed `RecordMerger`.
+  explicit RecordMerger(Closed) noexcept : Object(kClosed) {}
+
+  // Will merge records from `sources`, which must stay valid while the
+  // `RecordMerger` is open.
+  explicit RecordMerger(std::vector<RecordReaderBase*> sources,
+                        SortKeyExtractor key_extractor);
+
+  RecordMerger(const RecordMerger&) = delete;
+  RecordMerger& operator=(const RecordMerger&) = delete;
+
+  // Reads the next record in the merged order.
+  //
+  // The `absl::string_view` is valid until the next non-const operation on this
+  // `RecordMerger`.
+  //
+  // If `key != nullptr`, `*key` is set to the key of the record, valid for the
+  // same time as `record`.
+  //
+  // Return values:
+  //  * `true`                 - success (`record` is set)
+  //  * `false` (when `ok()`)  - all sources end
+  //  * `false` (when `!ok()`) - failure
+  bool ReadRecord(absl::string_view& record, absl::string_view* key = nullptr);
+
+ protected:
+  void Done() override;
+
+ private:
+  // The current record of a source.
+  struct Head {
+    absl::string_view record;
+    std::string key;
+    bool exhausted = false;
+  };
+
+  // Returns `true` if the current record of source `a` goes before the current
+  // record of source `b`. `sources_.size()` is a sentinel going before all
+  // sources.
+  bool Less(size_t a, size_t b) const;
+  // Replays the matches on the path from source `index` to the root.
+  void Adjust(size_t index);
+  // Reads the next record of source `index` into `heads_[index]`.
+  bool Advance(size_t index);
+
+  std::vector<RecordReaderBase*> sources_;
+  SortKeyExtractor key_extractor_;
+  std::vector<Head> heads_;
+  // `losers_[0]` is the index of the winning source. For `i > 0`,
+  // `losers_[i]` is the index of the source which lost the match at internal
+  // node `i`. Leaves are implicit: source `j` is at node `sources_.size() + j`.
+  std::vector<size_t> losers_;
+  bool started_ = false;
+  // Whether the record of the winning source was returned and the source must
+  // be advanced before selecting the next record.
+  bool winner_returned_ = false;
+};
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_SORT_RECORD_MERGER_H_
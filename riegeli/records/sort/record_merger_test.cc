@@ -0,0 +1,171 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/sort/record_merger.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Records are "key/source/index"; the key is the part before the first '/'.
+void ExtractKey(absl::string_view record, std::string& key) {
+  const absl::string_view extracted = record.substr(0, record.find('/'));
+  key.assign(extracted.data(), extracted.size());
+}
+
+std::string WriteRecords(const std::vector<std::string>& records) {
+  std::string data;
+  RecordWriter<StringWriter<>> writer(std::forward_as_tuple(&data));
+  for (const std::string& record : records) {
+    EXPECT_TRUE(writer.WriteRecord(record)) << writer.status();
+  }
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  return data;
+}
+
+// Merges `sources`, each sorted by keys, and returns the merged records.
+std::vector<std::string> Merge(
+    const std::vector<std::vector<std::string>>& sources) {
+  std::vector<std::string> files;
+  for (const std::vector<std::string>& source : sources) {
+    files.push_back(WriteRecords(source));
+  }
+  std::vector<std::unique_ptr<RecordReader<StringReader<>>>> readers;
+  std::vector<RecordReaderBase*> reader_ptrs;
+  for (const std::string& file : files) {
+    readers.push_back(std::make_unique<RecordReader<StringReader<>>>(
+        std::forward_as_tuple(file)));
+    reader_ptrs.push_back(readers.back().get());
+  }
+  RecordMerger merger(std::move(reader_ptrs), ExtractKey);
+  std::vector<std::string> merged;
+  absl::string_view record;
+  absl::string_view key;
+  while (merger.ReadRecord(record, &key)) {
+    std::string expected_key;
+    ExtractKey(record, expected_key);
+    EXPECT_EQ(key, expected_key);
+    merged.emplace_back(record);
+  }
+  EXPECT_TRUE(merger.Close()) << merger.status();
+  for (const std::unique_ptr<RecordReader<StringReader<>>>& reader : readers) {
+    EXPECT_TRUE(reader->Close()) << reader->status();
+  }
+  return merged;
+}
+
+// Returns the expected result of merging: records of all sources, stably
+// sorted by keys, with ties broken by the order of sources.
+std::vector<std::string> ExpectedMerge(
+    const std::vector<std::vector<std::string>>& sources) {
+  std::vector<std::string> expected;
+  for (const std::vector<std::string>& source : sources) {
+    expected.insert(expected.end(), source.begin(), source.end());
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const std::string& a, const std::string& b) {
+                     std::string key_a, key_b;
+                     ExtractKey(a, key_a);
+                     ExtractKey(b, key_b);
+                     return key_a < key_b;
+                   });
+  return expected;
+}
+
+TEST(RecordMergerTest, NoSources) { EXPECT_TRUE(Merge({}).empty()); }
+
+TEST(RecordMergerTest, EmptySources) {
+  EXPECT_TRUE(Merge({{}, {}, {}}).empty());
+}
+
+TEST(RecordMergerTest, OneSource) {
+  const std::vector<std::vector<std::string>> sources = {
+      {"a/0/0", "b/0/1", "c/0/2"}};
+  EXPECT_EQ(Merge(sources), sources[0]);
+}
+
+TEST(RecordMergerTest, InterleavedSources) {
+  const std::vector<std::vector<std::string>> sources = {
+      {"a/0/0", "d/0/1", "g/0/2"},
+      {"b/1/0", "e/1/1"},
+      {},
+      {"c/3/0", "f/3/1", "h/3/2", "i/3/3"}};
+  const std::vector<std::string> expected = {
+      "a/0/0", "b/1/0", "c/3/0", "d/0/1", "e/1/1",
+      "f/3/1", "g/0/2", "h/3/2", "i/3/3"};
+  EXPECT_EQ(Merge(sources), expected);
+}
+
+TEST(RecordMergerTest, EqualKeysAreStable) {
+  const std::vector<std::vector<std::string>> sources = {
+      {"a/0/0", "k/0/1", "k/0/2"},
+      {"k/1/0", "k/1/1", "z/1/2"},
+      {"k/2/0"}};
+  const std::vector<std::string> expected = {
+      "a/0/0", "k/0/1", "k/0/2", "k/1/0", "k/1/1", "k/2/0", "z/1/2"};
+  EXPECT_EQ(Merge(sources), expected);
+}
+
+TEST(RecordMergerTest, RandomSources) {
+  std::mt19937 random(1);
+  // Numbers of sources which make loser trees of different shapes.
+  for (size_t num_sources : {1, 2, 3, 4, 5, 7, 8, 9, 16, 33}) {
+    std::vector<std::vector<std::string>> sources(num_sources);
+    for (size_t source = 0; source < num_sources; ++source) {
+      const size_t num_records = random() % 50;
+      std::vector<int> keys;
+      for (size_t i = 0; i < num_records; ++i) keys.push_back(random() % 20);
+      std::sort(keys.begin(), keys.end());
+      for (size_t i = 0; i < num_records; ++i) {
+        // Two digit keys compare as byte strings like numbers.
+        sources[source].push_back(absl::StrCat(
+            absl::Dec(keys[i], absl::kZeroPad2), "/", source, "/", i));
+      }
+    }
+    EXPECT_EQ(Merge(sources), ExpectedMerge(sources))
+        << "Sources: " << num_sources;
+  }
+}
+
+TEST(RecordMergerTest, SourceFailure) {
+  const std::string valid = WriteRecords({"a/0/0", "c/0/1"});
+  const std::string invalid = "Not a Riegeli/records file";
+  RecordReader<StringReader<>> valid_reader(std::forward_as_tuple(valid));
+  RecordReader<StringReader<>> invalid_reader(std::forward_as_tuple(invalid));
+  RecordMerger merger({&valid_reader, &invalid_reader}, ExtractKey);
+  absl::string_view record;
+  EXPECT_FALSE(merger.ReadRecord(record));
+  EXPECT_FALSE(merger.ok());
+  EXPECT_FALSE(merger.Close());
+}
+
+}  // namespace
+}  // namespace riegeli
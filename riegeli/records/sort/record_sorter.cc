@@ -0,0 +1,335 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <process.h>
+#include <sys/stat.h>
+#endif
+
+#include "riegeli/records/sort/record_sorter.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/message_lite.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/object.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/messages/message_serialize.h"
+#include "riegeli/ordered_varint/ordered_varint_writing.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+#include "riegeli/records/sort/record_merger.h"
+#include "riegeli/varint/varint_reading.h"
+#include "riegeli/varint/varint_writing.h"
+
+namespace riegeli {
+
+namespace {
+
+// A record in a run is stored as:
+//  * key length (varint64)
+//  * key: the key prefix (ordered varint64) if any, then the key
+//  * record
+
+// Splits a record stored in a run into its key and the original record.
+// Returns `false` if `stored` is invalid.
+inline bool SplitStoredRecord(absl::string_view stored, absl::string_view& key,
+                              absl::string_view& record) {
+  uint64_t key_size;
+  const absl::optional<const char*> key_begin =
+      ReadVarint64(stored.data(), stored.data() + stored.size(), key_size);
+  if (ABSL_PREDICT_FALSE(key_begin == absl::nullopt)) return false;
+  const size_t remaining =
+      PtrDistance(*key_begin, stored.data() + stored.size());
+  if (ABSL_PREDICT_FALSE(key_size > remaining)) return false;
+  key = absl::string_view(*key_begin, IntCast<size_t>(key_size));
+  record = absl::string_view(*key_begin + key_size,
+                             remaining - IntCast<size_t>(key_size));
+  return true;
+}
+
+void ExtractStoredKey(absl::string_view stored, std::string& key) {
+  absl::string_view stored_key;
+  absl::string_view record;
+  if (ABSL_PREDICT_FALSE(!SplitStoredRecord(stored, stored_key, record))) {
+    // Reported when the record is written.
+    key.clear();
+    return;
+  }
+  // TODO: When `absl::string_view` becomes C++17 `std::string_view`:
+  // `key = stored_key`
+  key.assign(stored_key.data(), stored_key.size());
+}
+
+// Run files are created exclusively and readable only by the owner, so that a
+// file which already exists under a predictable name is never written to or
+// deleted.
+FdWriterBase::Options RunFileOptions() {
+#ifndef _WIN32
+  return FdWriterBase::Options()
+      .set_mode(O_WRONLY | O_CREAT | O_EXCL)
+      .set_permissions(0600);
+#else
+  return FdWriterBase::Options()
+      .set_mode(_O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY)
+      .set_permissions(_S_IREAD | _S_IWRITE);
+#endif
+}
+
+}  // namespace
+
+RecordSorter::RecordSorter(SortKeyExtractor key_extractor, Options options)
+    : key_extractor_(std::move(key_extractor)), options_(std::move(options)) {
+  RIEGELI_ASSERT(key_extractor_ != nullptr)
+      << "Failed precondition of RecordSorter: null key extractor";
+}
+
+RecordSorter::~RecordSorter() { DeleteRuns(runs_); }
+
+void RecordSorter::Done() {
+  entries_ = std::vector<Entry>();
+  memory_used_ = 0;
+  DeleteRuns(runs_);
+}
+
+bool RecordSorter::AddRecord(const google::protobuf::MessageLite& record,
+                             SerializeOptions serialize_options) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  Entry entry;
+  {
+    absl::Status status =
+        SerializeToString(record, entry.record, std::move(serialize_options));
+    if (ABSL_PREDICT_FALSE(!status.ok())) return Fail(std::move(status));
+  }
+  return AddEntry(std::move(entry));
+}
+
+bool RecordSorter::AddRecord(absl::string_view record) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  Entry entry;
+  // TODO: When `absl::string_view` becomes C++17 `std::string_view`:
+  // `entry.record = record`
+  entry.record.assign(record.data(), record.size());
+  return AddEntry(std::move(entry));
+}
+
+inline bool RecordSorter::AddEntry(Entry&& entry) {
+  RIEGELI_ASSERT(!finished_)
+      << "Failed precondition of RecordSorter::AddRecord(): "
+         "Finish() already called";
+  entry.key_prefix = options_.key_prefix() == nullptr
+                         ? 0
+                         : options_.key_prefix()(entry.record);
+  key_extractor_(entry.record, entry.key);
+  memory_used_ += sizeof(Entry) + entry.key.capacity() +
+                  entry.record.capacity();
+  entries_.push_back(std::move(entry));
+  if (memory_used_ >= options_.memory_limit()) return WriteRun();
+  return true;
+}
+
+void RecordSorter::SortEntries() {
+  std::stable_sort(entries_.begin(), entries_.end(),
+                   [](const Entry& a, const Entry& b) {
+                     if (a.key_prefix != b.key_prefix) {
+                       return a.key_prefix < b.key_prefix;
+                     }
+                     return a.key < b.key;
+                   });
+}
+
+bool RecordSorter::WriteRun() {
+  SortEntries();
+  FdWriter<> file(kClosed);
+  if (ABSL_PREDICT_FALSE(!CreateRun(file))) return false;
+  RecordWriter<FdWriter<>> writer(std::move(file), options_.run_options());
+  std::string stored;
+  for (const Entry& entry : entries_) {
+    stored.clear();
+    StringWriter<> stored_writer(&stored);
+    const size_t key_size =
+        (options_.key_prefix() == nullptr
+             ? 0
+             : LengthOrderedVarint64(entry.key_prefix)) +
+        entry.key.size();
+    WriteVarint64(IntCast<uint64_t>(key_size), stored_writer);
+    if (options_.key_prefix() != nullptr) {
+      WriteOrderedVarint64(entry.key_prefix, stored_writer);
+    }
+    stored_writer.Write(entry.key);
+    stored_writer.Write(entry.record);
+    if (ABSL_PREDICT_FALSE(!stored_writer.Close())) {
+      return Fail(stored_writer.status());
+    }
+    if (ABSL_PREDICT_FALSE(!writer.WriteRecord(stored))) break;
+  }
+  entries_.clear();
+  memory_used_ = 0;
+  if (ABSL_PREDICT_FALSE(!writer.Close())) return Fail(writer.status());
+  return true;
+}
+
+bool RecordSorter::Finish(RecordWriterBase& dest) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  RIEGELI_ASSERT(!finished_)
+      << "Failed precondition of RecordSorter::Finish(): "
+         "Finish() already called";
+  finished_ = true;
+  if (runs_.empty()) {
+    // Everything fits in memory.
+    SortEntries();
+    for (const Entry& entry : entries_) {
+      if (ABSL_PREDICT_FALSE(!dest.WriteRecord(entry.record))) {
+        return Fail(dest.status());
+      }
+    }
+    entries_ = std::vector<Entry>();
+    memory_used_ = 0;
+    return true;
+  }
+  if (!entries_.empty()) {
+    if (ABSL_PREDICT_FALSE(!WriteRun())) return false;
+  }
+  // Merge groups of consecutive runs, so that merging stays stable.
+  std::vector<std::string> level = runs_;
+  while (level.size() > options_.max_fan_in()) {
+    std::vector<std::string> next_level;
+    for (size_t begin = 0; begin < level.size();
+         begin += options_.max_fan_in()) {
+      const std::vector<std::string> group(
+          level.begin() + begin,
+          level.begin() +
+              UnsignedMin(begin + options_.max_fan_in(), level.size()));
+      if (group.size() == 1) {
+        next_level.push_back(group.front());
+        continue;
+      }
+      FdWriter<> file(kClosed);
+      if (ABSL_PREDICT_FALSE(!CreateRun(file))) return false;
+      next_level.push_back(runs_.back());
+      RecordWriter<FdWriter<>> writer(std::move(file), options_.run_options());
+      const bool merge_ok = MergeRuns(group, writer, false);
+      if (ABSL_PREDICT_FALSE(!writer.Close())) {
+        if (merge_ok) return Fail(writer.status());
+      }
+      if (ABSL_PREDICT_FALSE(!merge_ok)) return false;
+      for (const std::string& run : group) {
+        std::remove(run.c_str());
+        runs_.erase(std::find(runs_.begin(), runs_.end(), run));
+      }
+    }
+    level = std::move(next_level);
+  }
+  const bool merge_ok = MergeRuns(level, dest, true);
+  DeleteRuns(runs_);
+  return merge_ok;
+}
+
+bool RecordSorter::MergeRuns(const std::vector<std::string>& runs,
+                             RecordWriterBase& dest, bool strip_keys) {
+  std::vector<RecordReader<FdReader<>>> readers;
+  readers.reserve(runs.size());
+  std::vector<RecordReaderBase*> sources;
+  sources.reserve(runs.size());
+  for (const std::string& run : runs) {
+    readers.emplace_back(std::forward_as_tuple(
+        run, FdReaderBase::Options().set_buffer_size(options_.read_ahead())));
+    sources.push_back(&readers.back());
+  }
+  absl::Status status;
+  RecordMerger merger(std::move(sources), ExtractStoredKey);
+  absl::string_view stored;
+  while (merger.ReadRecord(stored)) {
+    absl::string_view record = stored;
+    if (strip_keys) {
+      absl::string_view key;
+      if (ABSL_PREDICT_FALSE(!SplitStoredRecord(stored, key, record))) {
+        status = absl::DataLossError("Invalid record in a temporary run");
+        break;
+      }
+    }
+    if (ABSL_PREDICT_FALSE(!dest.WriteRecord(record))) {
+      status = dest.status();
+      break;
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!merger.Close())) status.Update(merger.status());
+  for (RecordReader<FdReader<>>& reader : readers) {
+    if (ABSL_PREDICT_FALSE(!reader.Close())) status.Update(reader.status());
+  }
+  if (ABSL_PREDICT_FALSE(!status.ok())) return Fail(std::move(status));
+  return true;
+}
+
+bool RecordSorter::CreateRun(FdWriter<>& file) {
+  // Names of runs are unique within the process, but a file can be left by
+  // an earlier process with the same pid.
+  constexpr int kMaxAttempts = 100;
+  for (int attempt = 1;; ++attempt) {
+    std::string filename = NewRunFilename();
+    file.Reset(filename, RunFileOptions());
+    if (ABSL_PREDICT_TRUE(file.ok())) {
+      runs_.push_back(std::move(filename));
+      return true;
+    }
+    if (!absl::IsAlreadyExists(file.status()) || attempt == kMaxAttempts) {
+      return Fail(file.status());
+    }
+  }
+}
+
+std::string RecordSorter::NewRunFilename() {
+  absl::string_view temp_dir = options_.temp_dir();
+  if (temp_dir.empty()) {
+    const char* const env_temp_dir = std::getenv("TMPDIR");
+    temp_dir = env_temp_dir != nullptr && *env_temp_dir != '\0'
+                   ? absl::string_view(env_temp_dir)
+                   : absl::string_view("/tmp");
+  }
+#ifndef _WIN32
+  const int pid = getpid();
+#else
+  const int pid = _getpid();
+#endif
+  return absl::StrCat(temp_dir, "/riegeli_sort_", pid, "_",
+                      absl::Hex(reinterpret_cast<uintptr_t>(this)), "_",
+                      num_runs_created_++);
+}
+
+void RecordSorter::DeleteRuns(std::vector<std::string>& runs) {
+  for (const std::string& run : runs) std::remove(run.c_str());
+  runs.clear();
+}
+
+}  // namespace riegeli
@@ -0,0 +1,275 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_RECORDS_SORT_RECORD_SORTER_H_
+#define RIEGELI_RECORDS_SORT_RECORD_SORTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/object.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/messages/message_serialize.h"
+#include "riegeli/records/record_writer.h"
+#include "riegeli/records/sort/record_merger.h"
+
+namespace riegeli {
+
+// `RecordSorter` sorts records by their keys in bounded memory, spilling
+// sorted runs to temporary Riegeli/records files and merging them.
+//
+// Records are sorted by keys given by a `SortKeyExtractor`, optionally preceded
+// by a numeric key given by `Options::key_prefix()`. Sorting is stable.
+//
+// The sorted output can be searched with `RecordReaderBase::Search()` by
+// comparing keys in the same order: the numeric key given by
+// `Options::key_prefix()` first if it is set, then the key given by the
+// `SortKeyExtractor` as a byte string. Records are written without keys, so
+// the test passed to `Search()` extracts them from the record again.
+//
+// Example:
+// ```
+//   riegeli::RecordSorter sorter(
+//       [](absl::string_view record, std::string& key) {
+//         key.assign(ExtractKey(record));
+//       },
+//       riegeli::RecordSorter::Options().set_temp_dir("/bigdisk/tmp"));
+//   for (...) {
+//     if (!sorter.AddRecord(record)) {
+//       ... Failed with reason: sorter.status()
+//     }
+//   }
+//   riegeli::RecordWriter writer(riegeli::FdWriter(output_filename));
+//   if (!sorter.Finish(writer) || !sorter.Close()) {
+//     ... Failed with reason: sorter.status()
+//   }
+//   if (!writer.Close()) {
+//     ... Failed with reason: writer.status()
+//   }
+// ```
+class RecordSorter : public Object {
+ public:
+  // Extracts a numeric key from `record`. Numeric keys are compared before
+  // `SortKeyExtractor` keys, as integers.
+  using KeyPrefixExtractor = std::function<uint64_t(absl::string_view record)>;
+
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // The amount of memory for records kept in memory, after which they are
+    // sorted and written as a run to a temporary file.
+    //
+    // Default: `kDefaultMemoryLimit` (256M).
+    static constexpr size_t kDefaultMemoryLimit = size_t{256} << 20;
+    Options& set_memory_limit(size_t memory_limit) & {
+      memory_limit_ = memory_limit;
+      return *this;
+    }
+    Options&& set_memory_limit(size_t memory_limit) && {
+      return std::move(set_memory_limit(memory_limit));
+    }
+    size_t memory_limit() const { return memory_limit_; }
+
+    // The directory for temporary files.
+    //
+    // If empty, the directory from the `TMPDIR` environment variable is used,
+    // or `/tmp` if that is not set.
+    //
+    // Default: "".
+    Options& set_temp_dir(absl::string_view temp_dir) & {
+      // TODO: When `absl::string_view` becomes C++17
+      // `std::string_view`: `temp_dir_ = temp_dir`
+      temp_dir_.assign(temp_dir.data(), temp_dir.size());
+      return *this;
+    }
+    Options&& set_temp_dir(absl::string_view temp_dir) && {
+      return std::move(set_temp_dir(temp_dir));
+    }
+    const std::string& temp_dir() const { return temp_dir_; }
+
+    // Options for writing temporary runs. `RecordWriterBase::Options::
+    // parallelism()` lets a run be compressed in background while the next
+    // run is being collected and sorted.
+    //
+    // Default: `RecordWriterBase::Options().set_snappy().set_parallelism(2)`.
+    Options& set_run_options(const RecordWriterBase::Options& run_options) & {
+      run_options_ = run_options;
+      return *this;
+    }
+    Options& set_run_options(RecordWriterBase::Options&& run_options) & {
+      run_options_ = std::move(run_options);
+      return *this;
+    }
+    Options&& set_run_options(const RecordWriterBase::Options& run_options) && {
+      return std::move(set_run_options(run_options));
+    }
+    Options&& set_run_options(RecordWriterBase::Options&& run_options) && {
+      return std::move(set_run_options(std::move(run_options)));
+    }
+    RecordWriterBase::Options& run_options() { return run_options_; }
+    const RecordWriterBase::Options& run_options() const {
+      return run_options_;
+    }
+
+    // The maximum number of runs merged at once. If there are more runs,
+    // groups of runs are merged into longer runs first.
+    //
+    // `max_fan_in` must be at least 2.
+    // Default: 64.
+    Options& set_max_fan_in(size_t max_fan_in) & {
+      RIEGELI_ASSERT_GE(max_fan_in, 2u)
+          << "Failed precondition of RecordSorter::Options::set_max_fan_in(): "
+             "fan-in out of range";
+      max_fan_in_ = max_fan_in;
+      return *this;
+    }
+    Options&& set_max_fan_in(size_t max_fan_in) && {
+      return std::move(set_max_fan_in(max_fan_in));
+    }
+    size_t max_fan_in() const { return max_fan_in_; }
+
+    // Buffer size for reading each run while merging. Larger values make
+    // reads larger and fewer, which matters with many runs on disks with
+    // expensive seeks.
+    //
+    // Default: `kDefaultReadAhead` (1M).
+    static constexpr size_t kDefaultReadAhead = size_t{1} << 20;
+    Options& set_read_ahead(size_t read_ahead) & {
+      read_ahead_ = read_ahead;
+      return *this;
+    }
+    Options&& set_read_ahead(size_t read_ahead) && {
+      return std::move(set_read_ahead(read_ahead));
+    }
+    size_t read_ahead() const { return read_ahead_; }
+
+    // If not `nullptr`, a numeric key compared before other keys. Comparing
+    // integers in memory is cheaper than comparing byte strings, and in
+    // temporary runs the numeric key is stored as an ordered varint, which
+    // keeps the combined key comparable as a byte string.
+    //
+    // Default: `nullptr`.
+    Options& set_key_prefix(const KeyPrefixExtractor& key_prefix) & {
+      key_prefix_ = key_prefix;
+      return *this;
+    }
+    Options& set_key_prefix(KeyPrefixExtractor&& key_prefix) & {
+      key_prefix_ = std::move(key_prefix);
+      return *this;
+    }
+    Options&& set_key_prefix(const KeyPrefixExtractor& key_prefix) && {
+      return std::move(set_key_prefix(key_prefix));
+    }
+    Options&& set_key_prefix(KeyPrefixExtractor&& key_prefix) && {
+      return std::move(set_key_prefix(std::move(key_prefix)));
+    }
+    KeyPrefixExtractor& key_prefix() { return key_prefix_; }
+    const KeyPrefixExtractor& key_prefix() const { return key_prefix_; }
+
+   private:
+    size_t memory_limit_ = kDefaultMemoryLimit;
+    std::string temp_dir_;
+    RecordWriterBase::Options run_options_ =
+        RecordWriterBase::Options().set_snappy().set_parallelism(2);
+    size_t max_fan_in_ = 64;
+    size_t read_ahead_ = kDefaultReadAhead;
+    KeyPrefixExtractor key_prefix_;
+  };
+
+  // Creates a closed `RecordSorter`.
+  explicit RecordSorter(Closed) noexcept : Object(kClosed) {}
+
+  // Will sort records by keys extracted with `key_extractor`.
+  explicit RecordSorter(SortKeyExtractor key_extractor,
+                        Options options = Options());
+
+  RecordSorter(const RecordSorter&) = delete;
+  RecordSorter& operator=(const RecordSorter&) = delete;
+
+  ~RecordSorter();
+
+  // Adds a record to be sorted.
+  //
+  // `AddRecord(google::protobuf::MessageLite)` serializes a proto message to
+  // raw bytes beforehand.
+  //
+  // Return values:
+  //  * `true`  - success (`ok()`)
+  //  * `false` - failure (`!ok()`)
+  bool AddRecord(const google::protobuf::MessageLite& record,
+                 SerializeOptions serialize_options = SerializeOptions());
+  bool AddRecord(absl::string_view record);
+
+  // Writes all added records to `dest` in the sorted order. `dest` is not
+  // closed.
+  //
+  // `Finish()` must be called at most once. Afterwards the `RecordSorter` can
+  // only be closed.
+  //
+  // Return values:
+  //  * `true`  - success (`ok()`)
+  //  * `false` - failure (`!ok()`)
+  bool Finish(RecordWriterBase& dest);
+
+ protected:
+  void Done() override;
+
+ private:
+  struct Entry {
+    uint64_t key_prefix;
+    std::string key;
+    std::string record;
+  };
+
+  bool AddEntry(Entry&& entry);
+  // Sorts `entries_` stably by keys.
+  void SortEntries();
+  // Sorts `entries_` and writes them to a new run.
+  bool WriteRun();
+  // Merges `runs` into `dest`. If `strip_keys`, records are written without
+  // keys stored in runs.
+  bool MergeRuns(const std::vector<std::string>& runs, RecordWriterBase& dest,
+                 bool strip_keys);
+  // Creates a new run file, opening `file` for it and adding its filename to
+  // `runs_`.
+  bool CreateRun(FdWriter<>& file);
+  // Returns a filename for a new run.
+  std::string NewRunFilename();
+  // Deletes files of `runs` and clears `runs`.
+  static void DeleteRuns(std::vector<std::string>& runs);
+
+  SortKeyExtractor key_extractor_;
+  Options options_;
+  std::vector<Entry> entries_;
+  // Estimated memory used by `entries_`.
+  size_t memory_used_ = 0;
+  // Filenames of existing runs, to be deleted when no longer needed. Before
+  // `Finish()`, runs are in the order in which they were written.
+  std::vector<std::string> runs_;
+  uint64_t num_runs_created_ = 0;
+  bool finished_ = false;
+};
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_RECORDS_SORT_RECORD_SORTER_H_
@@ -0,0 +1,183 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/records/sort/record_sorter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/compare.h"
+#include "absl/types/optional.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Records are "number/name/index". The numeric key is the number, the key is
+// the name.
+uint64_t ExtractNumber(absl::string_view record) {
+  uint64_t number;
+  EXPECT_TRUE(absl::SimpleAtoi(record.substr(0, record.find('/')), &number))
+      << record;
+  return number;
+}
+
+absl::string_view NameOf(absl::string_view record) {
+  const size_t begin = record.find('/') + 1;
+  return record.substr(begin, record.find('/', begin) - begin);
+}
+
+void ExtractName(absl::string_view record, std::string& key) {
+  const absl::string_view name = NameOf(record);
+  key.assign(name.data(), name.size());
+}
+
+std::vector<std::string> RandomRecords(size_t num_records) {
+  std::mt19937 random(1);
+  std::vector<std::string> records;
+  for (size_t i = 0; i < num_records; ++i) {
+    records.push_back(absl::StrCat(random() % 1000, "/name", random() % 10,
+                                   "/", i));
+  }
+  return records;
+}
+
+std::vector<std::string> Sort(const std::vector<std::string>& records,
+                              RecordSorter::Options options) {
+  options.set_temp_dir(testing::TempDir());
+  RecordSorter sorter(ExtractName, std::move(options));
+  for (const std::string& record : records) {
+    EXPECT_TRUE(sorter.AddRecord(record)) << sorter.status();
+  }
+  std::string data;
+  RecordWriter<StringWriter<>> writer(std::forward_as_tuple(&data));
+  EXPECT_TRUE(sorter.Finish(writer)) << sorter.status();
+  EXPECT_TRUE(sorter.Close()) << sorter.status();
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  RecordReader<StringReader<>> reader(std::forward_as_tuple(data));
+  std::vector<std::string> sorted;
+  std::string record;
+  while (reader.ReadRecord(record)) sorted.push_back(record);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  return sorted;
+}
+
+TEST(RecordSorterTest, InMemory) {
+  std::vector<std::string> records = RandomRecords(1000);
+  const std::vector<std::string> sorted = Sort(records, {});
+  std::stable_sort(records.begin(), records.end(),
+                   [](const std::string& a, const std::string& b) {
+                     return NameOf(a) < NameOf(b);
+                   });
+  EXPECT_EQ(sorted, records);
+}
+
+TEST(RecordSorterTest, MultiLevelMerge) {
+  std::vector<std::string> records = RandomRecords(5000);
+  // Many small runs, merged two at a time over several levels.
+  const std::vector<std::string> sorted =
+      Sort(records, RecordSorter::Options()
+                        .set_memory_limit(4096)
+                        .set_max_fan_in(2)
+                        .set_key_prefix(ExtractNumber));
+  std::stable_sort(records.begin(), records.end(),
+                   [](const std::string& a, const std::string& b) {
+                     const uint64_t number_a = ExtractNumber(a);
+                     const uint64_t number_b = ExtractNumber(b);
+                     if (number_a != number_b) return number_a < number_b;
+                     return NameOf(a) < NameOf(b);
+                   });
+  EXPECT_EQ(sorted, records);
+}
+
+TEST(RecordSorterTest, SearchWithKeyPrefix) {
+  const std::vector<std::string> records = RandomRecords(2000);
+  RecordSorter sorter(ExtractName, RecordSorter::Options()
+                                       .set_temp_dir(testing::TempDir())
+                                       .set_memory_limit(8192)
+                                       .set_key_prefix(ExtractNumber));
+  for (const std::string& record : records) {
+    ASSERT_TRUE(sorter.AddRecord(record)) << sorter.status();
+  }
+  std::string data;
+  RecordWriter<StringWriter<>> writer(
+      std::forward_as_tuple(&data),
+      RecordWriterBase::Options().set_chunk_size(1024));
+  ASSERT_TRUE(sorter.Finish(writer)) << sorter.status();
+  ASSERT_TRUE(sorter.Close()) << sorter.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+
+  // The numeric key is compared first, then the key.
+  const std::string& target = records[records.size() / 2];
+  const uint64_t target_number = ExtractNumber(target);
+  const absl::string_view target_name = NameOf(target);
+  RecordReader<StringReader<>> reader(std::forward_as_tuple(data));
+  const absl::optional<absl::partial_ordering> found =
+      reader.Search<absl::string_view>([&](absl::string_view record) {
+        const uint64_t number = ExtractNumber(record);
+        if (number != target_number) {
+          return number < target_number ? absl::partial_ordering::less
+                                        : absl::partial_ordering::greater;
+        }
+        const int ordering = NameOf(record).compare(target_name);
+        return ordering < 0    ? absl::partial_ordering::less
+               : ordering == 0 ? absl::partial_ordering::equivalent
+                               : absl::partial_ordering::greater;
+      });
+  ASSERT_EQ(found, absl::partial_ordering::equivalent) << reader.status();
+  std::string record;
+  ASSERT_TRUE(reader.ReadRecord(record)) << reader.status();
+  EXPECT_EQ(ExtractNumber(record), target_number);
+  EXPECT_EQ(NameOf(record), target_name);
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST(RecordSorterTest, RunsAreDeleted) {
+  const std::string temp_dir = absl::StrCat(testing::TempDir(), "/sort_runs");
+  ASSERT_EQ(mkdir(temp_dir.c_str(), 0700), 0);
+  {
+    RecordSorter sorter(ExtractName, RecordSorter::Options()
+                                         .set_temp_dir(temp_dir)
+                                         .set_memory_limit(1024));
+    for (const std::string& record : RandomRecords(500)) {
+      ASSERT_TRUE(sorter.AddRecord(record)) << sorter.status();
+    }
+    std::string data;
+    RecordWriter<StringWriter<>> writer(std::forward_as_tuple(&data));
+    ASSERT_TRUE(sorter.Finish(writer)) << sorter.status();
+    ASSERT_TRUE(sorter.Close()) << sorter.status();
+    ASSERT_TRUE(writer.Close()) << writer.status();
+  }
+  // The directory can be removed only if it is empty.
+  EXPECT_EQ(rmdir(temp_dir.c_str()), 0);
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,172 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of every compressor and decompressor at standard compression
+// levels, on a fixed synthetic corpus.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/chain.h"
+#include "riegeli/base/no_destructor.h"
+#include "riegeli/brotli/brotli_reader.h"
+#include "riegeli/brotli/brotli_writer.h"
+#include "riegeli/bytes/chain_reader.h"
+#include "riegeli/bytes/chain_writer.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bzip2/bzip2_reader.h"
+#include "riegeli/bzip2/bzip2_writer.h"
+#include "riegeli/lz4/lz4_reader.h"
+#include "riegeli/lz4/lz4_writer.h"
+#include "riegeli/snappy/framed/framed_snappy_reader.h"
+#include "riegeli/snappy/framed/framed_snappy_writer.h"
+#include "riegeli/snappy/hadoop/hadoop_snappy_reader.h"
+#include "riegeli/snappy/hadoop/hadoop_snappy_writer.h"
+#include "riegeli/snappy/snappy_reader.h"
+#include "riegeli/snappy/snappy_writer.h"
+#include "riegeli/zlib/zlib_reader.h"
+#include "riegeli/zlib/zlib_writer.h"
+#include "riegeli/zstd/zstd_reader.h"
+#include "riegeli/zstd/zstd_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Returns 1 MiB of text made of words from a small vocabulary and numbers,
+// chosen by a fixed pseudo-random sequence, which compresses moderately.
+Chain MakeCorpus() {
+  static constexpr const char* kWords[] = {
+      "the",    "quick",  "brown",   "fox",    "jumps",  "over",
+      "lazy",   "dog",    "record",  "chunk",  "reader", "writer",
+      "buffer", "stream", "compress", "level", "window", "block"};
+  std::string text;
+  uint32_t random = 1;
+  while (text.size() < (size_t{1} << 20)) {
+    random = random * 1103515245 + 12345;
+    const uint32_t choice = random >> 16;
+    if (choice % 8 == 0) {
+      absl::StrAppend(&text, choice % 10000, " ");
+    } else {
+      absl::StrAppend(&text, kWords[choice % (sizeof(kWords) /
+                                              sizeof(kWords[0]))],
+                      choice % 16 == 1 ? "\n" : " ");
+    }
+  }
+  return Chain(std::move(text));
+}
+
+const Chain& Corpus() {
+  static const NoDestructor<Chain> kCorpus(MakeCorpus());
+  return *kCorpus;
+}
+
+template <typename WriterType>
+Chain Compress(const Chain& src, const typename WriterType::Options& options) {
+  Chain dest;
+  WriterType writer(std::forward_as_tuple(&dest), options);
+  writer.Write(src);
+  RIEGELI_CHECK(writer.Close()) << writer.status();
+  return dest;
+}
+
+template <typename ReaderType>
+Chain Decompress(const Chain& src) {
+  Chain dest;
+  const absl::Status status =
+      ReadAll(ReaderType(std::forward_as_tuple(&src)), dest);
+  RIEGELI_CHECK(status.ok()) << status;
+  return dest;
+}
+
+// Registers benchmarks of compressing the corpus with `WriterType` with
+// `options`, and of decompressing it with `ReaderType`.
+template <typename WriterType, typename ReaderType>
+void RegisterCompressor(const std::string& name,
+                        const typename WriterType::Options& options) {
+  benchmark::RegisterBenchmark(
+      absl::StrCat("BM_Compress/", name).c_str(),
+      [options](benchmark::State& state) {
+        const Chain& src = Corpus();
+        for (auto _ : state) {
+          benchmark::DoNotOptimize(Compress<WriterType>(src, options));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                                static_cast<int64_t>(src.size()));
+        state.counters["ratio"] =
+            static_cast<double>(src.size()) /
+            static_cast<double>(Compress<WriterType>(src, options).size());
+      });
+  benchmark::RegisterBenchmark(
+      absl::StrCat("BM_Decompress/", name).c_str(),
+      [options](benchmark::State& state) {
+        const Chain compressed = Compress<WriterType>(Corpus(), options);
+        for (auto _ : state) {
+          benchmark::DoNotOptimize(Decompress<ReaderType>(compressed));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                                static_cast<int64_t>(Corpus().size()));
+      });
+}
+
+const bool kRegistered = [] {
+  for (const int level : {1, 6, 9}) {
+    RegisterCompressor<ZlibWriter<ChainWriter<>>, ZlibReader<ChainReader<>>>(
+        absl::StrCat("zlib/", level),
+        ZlibWriterBase::Options().set_compression_level(level));
+  }
+  for (const int level : {1, 9}) {
+    RegisterCompressor<Bzip2Writer<ChainWriter<>>,
+                       Bzip2Reader<ChainReader<>>>(
+        absl::StrCat("bzip2/", level),
+        Bzip2WriterBase::Options().set_compression_level(level));
+  }
+  for (const int level : {0, 6, 9, 11}) {
+    RegisterCompressor<BrotliWriter<ChainWriter<>>,
+                       BrotliReader<ChainReader<>>>(
+        absl::StrCat("brotli/", level),
+        BrotliWriterBase::Options().set_compression_level(level));
+  }
+  for (const int level : {1, 3, 9, 19}) {
+    RegisterCompressor<ZstdWriter<ChainWriter<>>, ZstdReader<ChainReader<>>>(
+        absl::StrCat("zstd/", level),
+        ZstdWriterBase::Options().set_compression_level(level));
+  }
+  for (const int level : {0, 9}) {
+    RegisterCompressor<Lz4Writer<ChainWriter<>>, Lz4Reader<ChainReader<>>>(
+        absl::StrCat("lz4/", level),
+        Lz4WriterBase::Options().set_compression_level(level));
+  }
+  RegisterCompressor<SnappyWriter<ChainWriter<>>,
+                     SnappyReader<ChainReader<>>>(
+      "snappy", SnappyWriterBase::Options());
+  RegisterCompressor<FramedSnappyWriter<ChainWriter<>>,
+                     FramedSnappyReader<ChainReader<>>>(
+      "framed_snappy", FramedSnappyWriterBase::Options());
+  RegisterCompressor<HadoopSnappyWriter<ChainWriter<>>,
+                     HadoopSnappyReader<ChainReader<>>>(
+      "hadoop_snappy", HadoopSnappyWriterBase::Options());
+  return true;
+}();
+
+}  // namespace
+}  // namespace riegeli
@@ -15,24 +15,36 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <deque>
+#include <future>
 #include <limits>
+#include <map>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "absl/base/optimization.h"
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
+#include "absl/functional/function_ref.h"
+#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/util/json_util.h"
 #include "riegeli/base/any_dependency.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/chain.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/backward_writer.h"
 #include "riegeli/bytes/chain_backward_writer.h"
@@ -42,21 +54,26 @@
 #include "riegeli/bytes/null_backward_writer.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/bytes/std_io.h"
+#include "riegeli/bytes/string_writer.h"
 #include "riegeli/bytes/writer.h"
 #include "riegeli/chunk_encoding/chunk.h"
+#include "riegeli/chunk_encoding/chunk_decoder.h"
 #include "riegeli/chunk_encoding/constants.h"
 #include "riegeli/chunk_encoding/decompressor.h"
 #include "riegeli/chunk_encoding/field_projection.h"
 #include "riegeli/chunk_encoding/transpose_decoder.h"
+#include "riegeli/chunk_encoding/transpose_internal.h"
 #include "riegeli/lines/line_writing.h"
 #include "riegeli/lines/text_writer.h"
 #include "riegeli/messages/message_parse.h"
+#include "riegeli/messages/message_wire_format.h"
 #include "riegeli/messages/text_print.h"
 #include "riegeli/records/chunk_reader.h"
 #include "riegeli/records/records_metadata.pb.h"
 #include "riegeli/records/skipped_region.h"
 #include "riegeli/records/tools/riegeli_summary.pb.h"
 #include "riegeli/varint/varint_reading.h"
+#include "riegeli/varint/varint_writing.h"
 
 ABSL_FLAG(bool, show_records_metadata, true,
           "If true, show parsed file metadata.");
@@ -64,6 +81,25 @@ ABSL_FLAG(bool, show_record_sizes, false,
           "If true, show the list of record sizes in each chunk.");
 ABSL_FLAG(bool, show_records, false,
           "If true, show contents of records in each chunk.");
+ABSL_FLAG(bool, show_buffer_sizes, false,
+          "If true, show sizes of buckets and buffers in transposed chunks.");
+ABSL_FLAG(bool, show_field_sizes, false,
+          "If true, show sizes contributed by each field in transposed "
+          "chunks.");
+ABSL_FLAG(bool, show_decode_time, false,
+          "If true, decode records in each chunk and show the time it took.");
+ABSL_FLAG(bool, show_statistics, false,
+          "If true, show statistics aggregated by chunk type and compression "
+          "type.");
+ABSL_FLAG(std::string, format, "text",
+          "Output format: \"text\" (text proto) or \"json\" (a JSON object "
+          "per file).");
+ABSL_FLAG(int, parallelism, 8,
+          "Maximum number of ranges of a file described in parallel. "
+          "If 0, the file is described sequentially.");
+ABSL_FLAG(uint64_t, range_size, uint64_t{64} << 20,
+          "Size of a range of a file described by one task if parallelism "
+          "is positive.");
 
 namespace riegeli {
 namespace tools {
@@ -206,6 +242,328 @@ absl::Status DescribeSimpleChunk(const Chunk& chunk,
   return absl::OkStatus();
 }
 
+// Returns `true` if `tag` is a valid protocol buffer tag.
+bool ValidTag(uint32_t tag) {
+  switch (GetTagWireType(tag)) {
+    case WireType::kVarint:
+    case WireType::kFixed32:
+    case WireType::kFixed64:
+    case WireType::kLengthDelimited:
+    case WireType::kStartGroup:
+    case WireType::kEndGroup:
+      return tag >= 8;
+    default:
+      return false;
+  }
+}
+
+// A node of the state machine of a transposed chunk, reduced to what is needed
+// to attribute sizes to fields.
+struct FieldNode {
+  // Proto tag, or `MessageId` of a node which is not a proto field.
+  uint32_t tag = 0;
+  bool end_of_submessage = false;
+  // Index of the buffer holding values, or `absl::nullopt` if values are
+  // inline or there are no values.
+  absl::optional<uint32_t> buffer_index;
+  uint32_t next_node = 0;
+  bool implicit = false;
+  // Field numbers from the root message, known after the node is visited.
+  absl::optional<std::vector<uint32_t>> path;
+  uint64_t num_visits = 0;
+};
+
+// Reads the state machine of a transposed chunk from `header_reader`, then
+// walks it following transitions from `transitions_reader`, and attributes
+// `buffer_sizes` and tags to fields.
+absl::Status DescribeTransposedFields(
+    Reader& header_reader, Reader& transitions_reader,
+    const std::vector<uint64_t>& buffer_sizes,
+    summary::TransposedChunk& transposed_chunk) {
+  // Based on `TransposeDecoder::Parse()`.
+  uint32_t state_machine_size;
+  if (ABSL_PREDICT_FALSE(!ReadVarint32(header_reader, state_machine_size))) {
+    return header_reader.StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading state machine size failed"));
+  }
+  std::vector<FieldNode> nodes;
+  size_t num_subtypes = 0;
+  for (uint32_t i = 0; i < state_machine_size; ++i) {
+    FieldNode node;
+    if (ABSL_PREDICT_FALSE(!ReadVarint32(header_reader, node.tag))) {
+      return header_reader.StatusOrAnnotate(
+          absl::InvalidArgumentError("Reading field tag failed"));
+    }
+    if (ValidTag(node.tag) && chunk_encoding_internal::HasSubtype(node.tag)) {
+      ++num_subtypes;
+    }
+    nodes.push_back(std::move(node));
+  }
+  for (FieldNode& node : nodes) {
+    if (ABSL_PREDICT_FALSE(!ReadVarint32(header_reader, node.next_node))) {
+      return header_reader.StatusOrAnnotate(
+          absl::InvalidArgumentError("Reading next node index failed"));
+    }
+    if (node.next_node >= state_machine_size) {
+      node.next_node -= state_machine_size;
+      node.implicit = true;
+    }
+    if (ABSL_PREDICT_FALSE(node.next_node >= state_machine_size)) {
+      return absl::InvalidArgumentError("Node index too large");
+    }
+  }
+  std::string subtypes;
+  if (ABSL_PREDICT_FALSE(!header_reader.Read(num_subtypes, subtypes))) {
+    return header_reader.StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading subtypes failed"));
+  }
+  size_t subtype_index = 0;
+  bool has_nonproto_op = false;
+  for (FieldNode& node : nodes) {
+    bool has_buffer = false;
+    switch (static_cast<chunk_encoding_internal::MessageId>(node.tag)) {
+      case chunk_encoding_internal::MessageId::kNoOp:
+      case chunk_encoding_internal::MessageId::kStartOfMessage:
+      case chunk_encoding_internal::MessageId::kStartOfSubmessage:
+        break;
+      case chunk_encoding_internal::MessageId::kNonProto:
+        has_buffer = true;
+        has_nonproto_op = true;
+        break;
+      default: {
+        chunk_encoding_internal::Subtype subtype =
+            chunk_encoding_internal::Subtype::kTrivial;
+        // End of submessage is encoded as `kSubmessageWireType`.
+        if (GetTagWireType(node.tag) ==
+            chunk_encoding_internal::kSubmessageWireType) {
+          node.tag -= static_cast<uint32_t>(
+                          chunk_encoding_internal::kSubmessageWireType) -
+                      static_cast<uint32_t>(WireType::kLengthDelimited);
+          node.end_of_submessage = true;
+          subtype =
+              chunk_encoding_internal::Subtype::kLengthDelimitedEndOfSubmessage;
+        }
+        if (ABSL_PREDICT_FALSE(!ValidTag(node.tag))) {
+          return absl::InvalidArgumentError("Invalid tag");
+        }
+        if (chunk_encoding_internal::HasSubtype(node.tag)) {
+          subtype = static_cast<chunk_encoding_internal::Subtype>(
+              subtypes[subtype_index++]);
+        }
+        has_buffer = chunk_encoding_internal::HasDataBuffer(node.tag, subtype);
+      }
+    }
+    if (has_buffer) {
+      uint32_t buffer_index;
+      if (ABSL_PREDICT_FALSE(!ReadVarint32(header_reader, buffer_index))) {
+        return header_reader.StatusOrAnnotate(
+            absl::InvalidArgumentError("Reading buffer index failed"));
+      }
+      if (ABSL_PREDICT_FALSE(buffer_index >= buffer_sizes.size())) {
+        return absl::InvalidArgumentError("Buffer index too large");
+      }
+      node.buffer_index = buffer_index;
+    }
+  }
+  uint32_t first_node;
+  if (ABSL_PREDICT_FALSE(!ReadVarint32(header_reader, first_node))) {
+    return header_reader.StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading first node index failed"));
+  }
+  if (ABSL_PREDICT_FALSE(first_node >= state_machine_size)) {
+    return absl::InvalidArgumentError("First node index too large");
+  }
+
+  // Based on `TransposeDecoder::Decode()`. Records are decoded backwards, so
+  // the end of a submessage is visited before its start.
+  std::vector<uint32_t> submessage_stack;
+  FieldNode* node = &nodes[first_node];
+  int num_iters = node->implicit ? 1 : 0;
+  // Number of implicit transitions since the last transition which made
+  // progress, to detect implicit loops.
+  size_t num_implicit = 0;
+  for (;;) {
+    ++node->num_visits;
+    if (ValidTag(node->tag)) {
+      if (node->path == absl::nullopt) {
+        node->path = submessage_stack;
+        node->path->push_back(
+            IntCast<uint32_t>(GetTagFieldNumber(node->tag)));
+      }
+      if (node->end_of_submessage) {
+        submessage_stack.push_back(
+            IntCast<uint32_t>(GetTagFieldNumber(node->tag)));
+      }
+    } else if (node->tag == static_cast<uint32_t>(
+                                chunk_encoding_internal::MessageId::
+                                    kStartOfSubmessage)) {
+      if (ABSL_PREDICT_FALSE(submessage_stack.empty())) {
+        return absl::InvalidArgumentError("Submessage stack underflow");
+      }
+      submessage_stack.pop_back();
+    } else if (node->tag == static_cast<uint32_t>(
+                                chunk_encoding_internal::MessageId::
+                                    kStartOfMessage)) {
+      if (ABSL_PREDICT_FALSE(!submessage_stack.empty())) {
+        return absl::InvalidArgumentError("Submessages still open");
+      }
+    }
+    uint32_t next_node = node->next_node;
+    if (num_iters == 0) {
+      uint8_t transition_byte;
+      if (!transitions_reader.ReadByte(transition_byte)) break;
+      next_node += transition_byte >> 2;
+      if (ABSL_PREDICT_FALSE(next_node >= state_machine_size)) {
+        return absl::InvalidArgumentError("Node index too large");
+      }
+      num_iters = transition_byte & 3;
+      if (nodes[next_node].implicit) ++num_iters;
+      num_implicit = 0;
+    } else if (!nodes[next_node].implicit) {
+      --num_iters;
+      num_implicit = 0;
+    } else if (ABSL_PREDICT_FALSE(++num_implicit > state_machine_size)) {
+      return absl::InvalidArgumentError("Nodes contain an implicit loop");
+    }
+    node = &nodes[next_node];
+  }
+  if (ABSL_PREDICT_FALSE(!transitions_reader.ok())) {
+    return transitions_reader.status();
+  }
+  if (ABSL_PREDICT_FALSE(!submessage_stack.empty())) {
+    return absl::InvalidArgumentError("Submessages still open");
+  }
+
+  // Aggregate nodes by field path and wire type. A buffer can be shared by
+  // nodes, e.g. by varints of different lengths, so it is counted once.
+  std::map<std::pair<std::vector<uint32_t>, uint32_t>, summary::FieldSize>
+      field_sizes;
+  std::vector<bool> buffer_counted(buffer_sizes.size());
+  uint64_t non_proto_size = 0;
+  if (has_nonproto_op) {
+    // The last buffer is the `nonproto_lengths` buffer.
+    if (ABSL_PREDICT_FALSE(buffer_sizes.empty())) {
+      return absl::InvalidArgumentError("Missing buffer for non-proto records");
+    }
+    non_proto_size += buffer_sizes.back();
+    buffer_counted.back() = true;
+  }
+  for (const FieldNode& node : nodes) {
+    uint64_t buffer_size = 0;
+    if (node.buffer_index != absl::nullopt &&
+        !buffer_counted[*node.buffer_index]) {
+      buffer_counted[*node.buffer_index] = true;
+      buffer_size = buffer_sizes[*node.buffer_index];
+    }
+    if (!ValidTag(node.tag)) {
+      non_proto_size += buffer_size;
+      continue;
+    }
+    // A node which is never visited does not contribute to records, but its
+    // buffer is still stored.
+    std::vector<uint32_t> path = node.path != absl::nullopt
+                                     ? *node.path
+                                     : std::vector<uint32_t>{IntCast<uint32_t>(
+                                           GetTagFieldNumber(node.tag))};
+    const uint32_t wire_type = static_cast<uint32_t>(GetTagWireType(node.tag));
+    summary::FieldSize& field_size =
+        field_sizes[std::make_pair(path, wire_type)];
+    if (field_size.path().empty()) {
+      field_size.mutable_path()->Add(path.begin(), path.end());
+      field_size.set_wire_type(wire_type);
+    }
+    field_size.set_num_values(field_size.num_values() + node.num_visits);
+    field_size.set_buffer_size(field_size.buffer_size() + buffer_size);
+    field_size.set_tag_size(field_size.tag_size() +
+                            node.num_visits * LengthVarint32(node.tag));
+  }
+  for (auto& entry : field_sizes) {
+    *transposed_chunk.add_field_sizes() = std::move(entry.second);
+  }
+  if (has_nonproto_op) transposed_chunk.set_non_proto_size(non_proto_size);
+  return absl::OkStatus();
+}
+
+absl::Status DescribeTransposedHeader(
+    Reader& src, CompressionType compression_type,
+    summary::TransposedChunk& transposed_chunk) {
+  const bool show_buffer_sizes = absl::GetFlag(FLAGS_show_buffer_sizes);
+  const bool show_field_sizes = absl::GetFlag(FLAGS_show_field_sizes);
+
+  // Based on `TransposeDecoder::Parse()` and
+  // `TransposeDecoder::ParseBuffersForFiltering()`.
+  uint64_t header_size;
+  Chain header;
+  if (ABSL_PREDICT_FALSE(!ReadVarint64(src, header_size) ||
+                         !src.Read(header_size, header))) {
+    return src.StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading header failed"));
+  }
+  if (show_buffer_sizes) transposed_chunk.set_header_size(header_size);
+  chunk_encoding_internal::Decompressor<ChainReader<>> header_decompressor(
+      std::forward_as_tuple(&header), compression_type);
+  if (ABSL_PREDICT_FALSE(!header_decompressor.ok())) {
+    return header_decompressor.status();
+  }
+  uint32_t num_buckets;
+  uint32_t num_buffers;
+  if (ABSL_PREDICT_FALSE(
+          !ReadVarint32(header_decompressor.reader(), num_buckets) ||
+          !ReadVarint32(header_decompressor.reader(), num_buffers))) {
+    return header_decompressor.reader().StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading number of buffers failed"));
+  }
+  Position buckets_size = 0;
+  for (uint32_t i = 0; i < num_buckets; ++i) {
+    uint64_t bucket_size;
+    if (ABSL_PREDICT_FALSE(
+            !ReadVarint64(header_decompressor.reader(), bucket_size))) {
+      return header_decompressor.reader().StatusOrAnnotate(
+          absl::InvalidArgumentError("Reading bucket length failed"));
+    }
+    if (show_buffer_sizes) transposed_chunk.add_bucket_sizes(bucket_size);
+    buckets_size += bucket_size;
+  }
+  std::vector<uint64_t> buffer_sizes;
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    uint64_t buffer_size;
+    if (ABSL_PREDICT_FALSE(
+            !ReadVarint64(header_decompressor.reader(), buffer_size))) {
+      return header_decompressor.reader().StatusOrAnnotate(
+          absl::InvalidArgumentError("Reading buffer length failed"));
+    }
+    if (show_buffer_sizes) transposed_chunk.add_buffer_sizes(buffer_size);
+    buffer_sizes.push_back(buffer_size);
+  }
+  if (!show_field_sizes) return absl::OkStatus();
+
+  // Transitions follow the buckets.
+  if (ABSL_PREDICT_FALSE(!src.Skip(buckets_size))) {
+    return src.StatusOrAnnotate(
+        absl::InvalidArgumentError("Reading buckets failed"));
+  }
+  chunk_encoding_internal::Decompressor<> transitions_decompressor(
+      &src, compression_type);
+  if (ABSL_PREDICT_FALSE(!transitions_decompressor.ok())) {
+    return transitions_decompressor.status();
+  }
+  {
+    absl::Status status = DescribeTransposedFields(
+        header_decompressor.reader(), transitions_decompressor.reader(),
+        buffer_sizes, transposed_chunk);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!header_decompressor.VerifyEndAndClose())) {
+    return header_decompressor.status();
+  }
+  if (ABSL_PREDICT_FALSE(!transitions_decompressor.VerifyEndAndClose())) {
+    return transitions_decompressor.status();
+  }
+  return absl::OkStatus();
+}
+
 absl::Status DescribeTransposedChunk(
     const Chunk& chunk, summary::TransposedChunk& transposed_chunk) {
   ChainReader<> src(&chunk.data);
@@ -220,6 +578,16 @@ absl::Status DescribeTransposedChunk(
   transposed_chunk.set_compression_type(
       static_cast<summary::CompressionType>(compression_type_byte));
 
+  if (absl::GetFlag(FLAGS_show_buffer_sizes) ||
+      absl::GetFlag(FLAGS_show_field_sizes)) {
+    absl::Status status = DescribeTransposedHeader(
+        src, static_cast<CompressionType>(compression_type_byte),
+        transposed_chunk);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
   if (show_record_sizes || show_records) {
     // Based on `ChunkDecoder::Parse()`.
     src.Seek(0);
@@ -274,28 +642,155 @@ absl::Status DescribeTransposedChunk(
   return absl::OkStatus();
 }
 
-void DescribeFile(absl::string_view filename, Writer& report, Writer& errors) {
-  WriteLine("file {", report);
-  WriteLine("  filename: \"", absl::Utf8SafeCEscape(filename), '"', report);
-  DefaultChunkReader<FdReader<>> chunk_reader(std::forward_as_tuple(filename));
-  if (chunk_reader.SupportsRandomAccess()) {
-    const absl::optional<Position> size = chunk_reader.Size();
-    if (size != absl::nullopt) {
-      WriteLine("  file_size: ", *size, report);
+// Chunk statistics by chunk type and compression type.
+using StatisticsMap = std::map<std::pair<uint8_t, uint8_t>,
+                               summary::CompressionStatistics>;
+
+void MergeStatistics(const summary::CompressionStatistics& src,
+                     summary::CompressionStatistics& dest) {
+  dest.set_chunk_type(src.chunk_type());
+  dest.set_compression_type(src.compression_type());
+  dest.set_num_chunks(dest.num_chunks() + src.num_chunks());
+  dest.set_num_records(dest.num_records() + src.num_records());
+  dest.set_data_size(dest.data_size() + src.data_size());
+  dest.set_decoded_data_size(dest.decoded_data_size() +
+                             src.decoded_data_size());
+  while (dest.compression_ratio_histogram_size() <
+         src.compression_ratio_histogram_size()) {
+    dest.add_compression_ratio_histogram(0);
+  }
+  for (int i = 0; i < src.compression_ratio_histogram_size(); ++i) {
+    dest.set_compression_ratio_histogram(
+        i, dest.compression_ratio_histogram(i) +
+               src.compression_ratio_histogram(i));
+  }
+  dest.set_decode_time_ns(dest.decode_time_ns() + src.decode_time_ns());
+}
+
+void MergeStatistics(const StatisticsMap& src, StatisticsMap& dest) {
+  for (const auto& entry : src) {
+    MergeStatistics(entry.second, dest[entry.first]);
+  }
+}
+
+void AddToStatistics(const Chunk& chunk, const summary::Chunk& chunk_summary,
+                     StatisticsMap& statistics) {
+  uint8_t compression_type_byte = static_cast<uint8_t>(CompressionType::kNone);
+  switch (chunk.header.chunk_type()) {
+    case ChunkType::kFileMetadata:
+    case ChunkType::kSimple:
+    case ChunkType::kTransposed:
+      // Chunk data begin with the compression type.
+      if (!chunk.data.empty()) {
+        compression_type_byte =
+            static_cast<uint8_t>(*chunk.data.blocks().front().data());
+      }
+      break;
+    default:
+      break;
+  }
+  summary::CompressionStatistics chunk_statistics;
+  chunk_statistics.set_chunk_type(chunk_summary.chunk_type());
+  chunk_statistics.set_compression_type(
+      static_cast<summary::CompressionType>(compression_type_byte));
+  chunk_statistics.set_num_chunks(1);
+  chunk_statistics.set_num_records(chunk.header.num_records());
+  chunk_statistics.set_data_size(chunk.header.data_size());
+  chunk_statistics.set_decoded_data_size(chunk.header.decoded_data_size());
+  if (chunk.header.data_size() > 0) {
+    const int bucket = absl::bit_width(chunk.header.decoded_data_size() /
+                                       chunk.header.data_size());
+    for (int i = 0; i < bucket; ++i) {
+      chunk_statistics.add_compression_ratio_histogram(0);
     }
+    chunk_statistics.add_compression_ratio_histogram(1);
   }
+  chunk_statistics.set_decode_time_ns(chunk_summary.decode_time_ns());
+  MergeStatistics(
+      chunk_statistics,
+      statistics[std::make_pair(
+          static_cast<uint8_t>(chunk.header.chunk_type()),
+          compression_type_byte)]);
+}
+
+enum class Format { kText, kJson };
+
+Format GetFormat() {
+  return absl::GetFlag(FLAGS_format) == "json" ? Format::kJson : Format::kText;
+}
+
+// Formats `message` as JSON in a single line.
+//
+// If formatting fails, reports the failure with `add_error()` and returns an
+// empty object.
+std::string FormatJson(
+    const google::protobuf::Message& message,
+    absl::FunctionRef<void(absl::string_view message)> add_error) {
+  std::string json;
+  google::protobuf::util::JsonPrintOptions json_options;
+  json_options.preserve_proto_field_names = true;
+  const auto status =
+      google::protobuf::util::MessageToJsonString(message, &json, json_options);
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    add_error(absl::StrCat("Formatting JSON failed: ", status.ToString()));
+    return "{}";
+  }
+  return json;
+}
+
+// Formats `message` as a text proto field named `name`, indented by 2.
+std::string FormatText(absl::string_view name,
+                       const google::protobuf::Message& message) {
   TextPrintOptions print_options;
   print_options.printer().SetInitialIndentLevel(2);
   print_options.printer().SetUseShortRepeatedPrimitives(true);
   print_options.printer().SetUseUtf8StringEscaping(true);
+  std::string text;
+  TextWriter<WriteNewline::kNative, StringWriter<>> text_writer(
+      std::forward_as_tuple(&text));
+  WriteLine("  ", name, " {", text_writer);
+  TextPrintToWriter(message, &text_writer, print_options).IgnoreError();
+  WriteLine("  }", text_writer);
+  text_writer.Close();
+  return text;
+}
+
+absl::Status MeasureDecodeTime(const Chunk& chunk,
+                               summary::Chunk& chunk_summary) {
+  const absl::Time start = absl::Now();
+  ChunkDecoder chunk_decoder;
+  if (ABSL_PREDICT_FALSE(!chunk_decoder.Decode(chunk))) {
+    return chunk_decoder.status();
+  }
+  absl::string_view record;
+  while (chunk_decoder.ReadRecord(record)) {
+  }
+  if (ABSL_PREDICT_FALSE(!chunk_decoder.Close())) {
+    return chunk_decoder.status();
+  }
+  chunk_summary.set_decode_time_ns(
+      IntCast<uint64_t>(absl::ToInt64Nanoseconds(absl::Now() - start)));
+  return absl::OkStatus();
+}
+
+// Describes chunks beginning before `end`, or until the end of file if `end`
+// is `absl::nullopt`.
+void DescribeChunks(
+    ChunkReader& chunk_reader, absl::optional<Position> end,
+    absl::FunctionRef<void(std::string formatted)> add_chunk,
+    absl::FunctionRef<void(absl::string_view message)> add_error,
+    StatisticsMap& statistics) {
+  const Format format = GetFormat();
+  const bool show_decode_time = absl::GetFlag(FLAGS_show_decode_time);
+  const bool show_statistics = absl::GetFlag(FLAGS_show_statistics);
   for (;;) {
-    report.Flush();
     const Position chunk_begin = chunk_reader.pos();
+    if (end != absl::nullopt && chunk_begin >= *end) break;
     Chunk chunk;
     if (ABSL_PREDICT_FALSE(!chunk_reader.ReadChunk(chunk))) {
       SkippedRegion skipped_region;
       if (chunk_reader.Recover(&skipped_region)) {
-        WriteLine(skipped_region.message(), errors);
+        add_error(skipped_region.message());
         continue;
       }
       break;
@@ -327,14 +822,126 @@ void DescribeFile(absl::string_view filename, Writer& report, Writer& errors) {
         default:
           break;
       }
-      if (ABSL_PREDICT_FALSE(!status.ok())) {
-        WriteLine(status.message(), errors);
+      if (show_decode_time &&
+          (chunk.header.chunk_type() == ChunkType::kSimple ||
+           chunk.header.chunk_type() == ChunkType::kTransposed)) {
+        status.Update(MeasureDecodeTime(chunk, chunk_summary));
       }
+      if (ABSL_PREDICT_FALSE(!status.ok())) add_error(status.message());
+    }
+    if (show_statistics) AddToStatistics(chunk, chunk_summary, statistics);
+    add_chunk(format == Format::kJson ? FormatJson(chunk_summary, add_error)
+                                      : FormatText("chunk", chunk_summary));
+  }
+}
+
+// Chunks beginning in a range of a file, described in background.
+struct DescribedRange {
+  std::vector<std::string> chunks;
+  std::vector<std::string> errors;
+  StatisticsMap statistics;
+};
+
+DescribedRange DescribeRange(const std::string& filename, Position begin,
+                             Position end) {
+  DescribedRange range;
+  DefaultChunkReader<FdReader<>> chunk_reader(std::forward_as_tuple(filename));
+  if (begin == 0 || chunk_reader.SeekToChunkAfter(begin)) {
+    DescribeChunks(
+        chunk_reader, end,
+        [&](std::string formatted) {
+          range.chunks.push_back(std::move(formatted));
+        },
+        [&](absl::string_view message) {
+          range.errors.emplace_back(message);
+        },
+        range.statistics);
+  }
+  if (!chunk_reader.Close()) {
+    range.errors.emplace_back(chunk_reader.status().message());
+  }
+  return range;
+}
+
+void DescribeFile(absl::string_view filename, Writer& report, Writer& errors) {
+  const Format format = GetFormat();
+  const int parallelism = absl::GetFlag(FLAGS_parallelism);
+  DefaultChunkReader<FdReader<>> chunk_reader(std::forward_as_tuple(filename));
+  absl::optional<Position> size;
+  if (chunk_reader.SupportsRandomAccess()) size = chunk_reader.Size();
+  const auto add_error = [&](absl::string_view message) {
+    WriteLine(message, errors);
+  };
+  if (format == Format::kJson) {
+    summary::File file_summary;
+    file_summary.set_filename(std::string(filename));
+    if (size != absl::nullopt) file_summary.set_file_size(*size);
+    std::string header = FormatJson(file_summary, add_error);
+    // Leave the object open for chunks. The header has no fields if formatting
+    // failed.
+    header.pop_back();
+    if (header != "{") header.push_back(',');
+    report.Write(absl::StrCat(header, "\"chunk\":["));
+  } else {
+    WriteLine("file {", report);
+    WriteLine("  filename: \"", absl::Utf8SafeCEscape(filename), '"', report);
+    if (size != absl::nullopt) WriteLine("  file_size: ", *size, report);
+  }
+  bool first_chunk = true;
+  const auto add_chunk = [&](std::string formatted) {
+    if (format == Format::kJson) {
+      report.Write(first_chunk ? "\n" : ",\n");
+    }
+    first_chunk = false;
+    report.Write(formatted);
+    report.Flush();
+  };
+  StatisticsMap statistics;
+  if (parallelism > 0 && size != absl::nullopt) {
+    // Describe ranges of the file in parallel, each range with its own
+    // `ChunkReader`, and write results in order.
+    const Position range_size =
+        UnsignedMax(absl::GetFlag(FLAGS_range_size), Position{1});
+    const std::string filename_string(filename);
+    std::deque<std::future<DescribedRange>> ranges;
+    Position next_begin = 0;
+    while (next_begin < *size || !ranges.empty()) {
+      while (next_begin < *size &&
+             ranges.size() < IntCast<size_t>(parallelism)) {
+        const Position begin = next_begin;
+        next_begin += UnsignedMin(range_size, *size - next_begin);
+        const Position end = next_begin;
+        const std::shared_ptr<std::promise<DescribedRange>> promise =
+            std::make_shared<std::promise<DescribedRange>>();
+        ranges.push_back(promise->get_future());
+        Executor::global().Schedule([promise, &filename_string, begin, end] {
+          promise->set_value(DescribeRange(filename_string, begin, end));
+        });
+      }
+      DescribedRange range = ranges.front().get();
+      ranges.pop_front();
+      for (std::string& formatted : range.chunks) {
+        add_chunk(std::move(formatted));
+      }
+      for (const std::string& message : range.errors) add_error(message);
+      MergeStatistics(range.statistics, statistics);
+    }
+  } else {
+    DescribeChunks(chunk_reader, absl::nullopt, add_chunk, add_error,
+                   statistics);
+  }
+  if (format == Format::kJson) report.Write("\n]");
+  if (absl::GetFlag(FLAGS_show_statistics)) {
+    summary::Statistics statistics_summary;
+    for (auto& entry : statistics) {
+      *statistics_summary.add_compression() = std::move(entry.second);
+    }
+    if (format == Format::kJson) {
+      report.Write(absl::StrCat(",\"statistics\":",
+                                FormatJson(statistics_summary, add_error)));
+    } else {
+      report.Write(FormatText("statistics", statistics_summary));
     }
-    WriteLine("  chunk {", report);
-    TextPrintToWriter(chunk_summary, TextWriter(&report), print_options)
-        .IgnoreError();
-    WriteLine("  }", report);
   }
   WriteLine('}', report);
   report.Flush();
@@ -357,6 +964,13 @@ int main(int argc, char** argv) {
   const std::vector<char*> args = absl::ParseCommandLine(argc, argv);
   riegeli::StdOut std_out;
   riegeli::StdErr std_err;
+  const std::string format = absl::GetFlag(FLAGS_format);
+  if (format != "text" && format != "json") {
+    riegeli::WriteLine("Unknown --format: ", format, std_err);
+    std_out.Close();
+    std_err.Close();
+    return 1;
+  }
   for (size_t i = 1; i < args.size(); ++i) {
     riegeli::tools::DescribeFile(args[i], std_out, std_err);
   }
@@ -0,0 +1,813 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Make file offsets 64-bit even on 32-bit systems.
+#undef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/compare.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/message_lite.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/chain_block_allocator.h"
+#include "riegeli/base/stats.h"
+#include "riegeli/bytes/caching_reader.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/std_io.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/bytes/writer.h"
+#include "riegeli/endian/endian_reading.h"
+#include "riegeli/endian/endian_writing.h"
+#include "riegeli/lines/line_writing.h"
+#include "riegeli/lines/text_writer.h"
+#include "riegeli/records/record_reader.h"
+#include "riegeli/records/record_writer.h"
+#include "riegeli/records/tools/records_load_benchmark.pb.h"
+#include "riegeli/varint/varint_writing.h"
+
+ABSL_FLAG(std::string, workloads, "fixed zipf nested random",
+          "Whitespace-separated synthetic workloads: fixed (fixed-size "
+          "compressible records), zipf (Zipf-distributed sizes), nested "
+          "(serialized proto-like nested messages), random (incompressible "
+          "records)");
+ABSL_FLAG(std::string, riegeli_benchmarks,
+          "uncompressed "
+          "brotli:6 "
+          "brotli:6,parallelism:10 "
+          "zstd:3 "
+          "zstd:3,parallelism:10 "
+          "snappy "
+          "transpose,zstd:3",
+          "Whitespace-separated Riegeli RecordWriter options");
+ABSL_FLAG(uint64_t, num_records, 100000,
+          "Number of records of a workload, written by each writer thread");
+ABSL_FLAG(uint64_t, record_size, 1000,
+          "Size of fixed, nested and random records, and the maximum size of "
+          "zipf records, in bytes");
+ABSL_FLAG(double, zipf_exponent, 1.1, "Exponent of the zipf size distribution");
+ABSL_FLAG(uint64_t, seed, 1, "Seed of synthetic workloads");
+ABSL_FLAG(int32_t, writer_threads, 1,
+          "Number of threads writing concurrently, each to its own file");
+ABSL_FLAG(int32_t, reader_threads, 1,
+          "Number of threads reading concurrently, thread i reading the file "
+          "of writer i modulo writer_threads");
+ABSL_FLAG(std::string, nested_messages, "none",
+          "How records of the nested workload are read: \"none\" (as bytes), "
+          "\"heap\" (parsed into a new message per record, with submessages "
+          "on the heap), or \"arena\" (parsed in batches of a chunk into "
+          "messages on an Arena, which is reset after each batch)");
+ABSL_FLAG(uint64_t, flush_every, 0,
+          "If positive, writers call Flush() after every this many records, "
+          "and flush latency is measured");
+ABSL_FLAG(int32_t, num_seeks, 1000,
+          "Number of random Seek() and Search() operations measured");
+ABSL_FLAG(uint64_t, seek_cache_mb, 0,
+          "If positive, Seek() and Search() read through a CachingReader with "
+          "a cache of this many MB, and cache hits and misses are reported");
+ABSL_FLAG(std::string, chain_block_allocator, "default",
+          "Allocator of Chain blocks: \"default\" (operator new), \"slab\" "
+          "(ChainBlockAllocator), or \"slab_huge_pages\" (ChainBlockAllocator "
+          "backed by huge pages); with a slab allocator, the size of slabs is "
+          "reported");
+ABSL_FLAG(bool, stats, false,
+          "If true, Riegeli statistics are collected, and time spent in "
+          "buffered I/O (which includes buffered codecs), compression, "
+          "hashing, and parsing is reported in the text format");
+ABSL_FLAG(std::string, output_dir, "/tmp",
+          "Directory to write files to (files are named "
+          "record_load_benchmark_*)");
+ABSL_FLAG(bool, fork_runs, true,
+          "If true, each combination of a workload and options runs in a "
+          "forked process, so that peak RSS is measured per run; otherwise "
+          "peak RSS is of the whole process, including earlier runs");
+ABSL_FLAG(std::string, format, "text",
+          "Output format: \"text\" or \"json\" (a JSON object per line)");
+
+namespace {
+
+// Counts allocations by global `operator new` of the whole process.
+std::atomic<uint64_t> num_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* const ptr = std::malloc(size == 0 ? 1 : size);
+  if (ABSL_PREDICT_FALSE(ptr == nullptr)) std::abort();
+  return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+uint64_t FileSize(const std::string& filename) {
+  struct stat stat_info;
+  RIEGELI_CHECK_EQ(stat(filename.c_str(), &stat_info), 0)
+      << absl::ErrnoToStatus(errno, "stat() failed").message();
+  return riegeli::IntCast<uint64_t>(stat_info.st_size);
+}
+
+uint64_t RealTimeNow_ns() {
+  struct timespec time_info;
+  RIEGELI_CHECK_EQ(clock_gettime(CLOCK_MONOTONIC, &time_info), 0);
+  return riegeli::IntCast<uint64_t>(time_info.tv_sec) * uint64_t{1000000000} +
+         riegeli::IntCast<uint64_t>(time_info.tv_nsec);
+}
+
+// Peak resident set size of the process, in bytes.
+uint64_t PeakRss() {
+  struct rusage usage;
+  RIEGELI_CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  return riegeli::IntCast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+class Latencies {
+ public:
+  void Add(uint64_t latency_ns) { samples_.push_back(latency_ns); }
+  void Merge(Latencies&& that);
+
+  bool empty() const { return samples_.empty(); }
+
+  // Returns the given quantile, in microseconds.
+  double Quantile_us(double quantile);
+
+ private:
+  std::vector<uint64_t> samples_;
+  bool sorted_ = false;
+};
+
+void Latencies::Merge(Latencies&& that) {
+  samples_.insert(samples_.end(), that.samples_.begin(), that.samples_.end());
+  sorted_ = false;
+}
+
+double Latencies::Quantile_us(double quantile) {
+  RIEGELI_CHECK(!samples_.empty()) << "No data";
+  if (!sorted_) {
+    std::sort(samples_.begin(), samples_.end());
+    sorted_ = true;
+  }
+  const size_t index = std::min(
+      static_cast<size_t>(quantile * static_cast<double>(samples_.size())),
+      samples_.size() - 1);
+  return static_cast<double>(samples_[index]) / 1000.0;
+}
+
+// Synthetic records. Each record contains its index as 8 big endian bytes
+// at `key_offset`, which makes records sorted and searchable.
+struct Workload {
+  std::string name;
+  std::vector<std::string> records;
+  size_t key_offset = 0;
+  uint64_t total_size = 0;
+};
+
+// Appends compressible text-like filler up to `size`.
+void AppendFiller(size_t size, std::mt19937_64& random, std::string& dest) {
+  static constexpr absl::string_view kWords[] = {
+      "riegeli ", "record ", "chunk ", "block ", "brotli ", "zstd ",
+      "snappy ", "transpose ", "varint ", "field ", "message ", "value "};
+  while (dest.size() < size) {
+    const absl::string_view word =
+        kWords[random() % (sizeof(kWords) / sizeof(kWords[0]))];
+    dest.append(word.data(), std::min(word.size(), size - dest.size()));
+  }
+}
+
+void AppendKey(uint64_t index, std::string& dest) {
+  char key[sizeof(uint64_t)];
+  riegeli::WriteBigEndian64(index, key);
+  dest.append(key, sizeof(key));
+}
+
+// Serializes a message resembling a log entry: an id, a name, and repeated
+// submessages with an integer, a fixed64 and a string field.
+std::string NestedRecord(uint64_t index, size_t size,
+                         std::mt19937_64& random) {
+  std::string record;
+  riegeli::StringWriter<> writer(&record);
+  // Field 1, fixed64: the key.
+  riegeli::WriteVarint32(uint32_t{(1 << 3) | 1}, writer);
+  char key[sizeof(uint64_t)];
+  riegeli::WriteBigEndian64(index, key);
+  writer.Write(absl::string_view(key, sizeof(key)));
+  // Field 2, string.
+  riegeli::WriteVarint32(uint32_t{(2 << 3) | 2}, writer);
+  const std::string name = absl::StrCat("entry-", random() % 1000);
+  riegeli::WriteVarint64(name.size(), writer);
+  writer.Write(name);
+  while (writer.pos() < size) {
+    std::string submessage;
+    {
+      riegeli::StringWriter<> sub_writer(&submessage);
+      riegeli::WriteVarint32(uint32_t{(1 << 3) | 0}, sub_writer);
+      riegeli::WriteVarint64(random() % 100000, sub_writer);
+      riegeli::WriteVarint32(uint32_t{(2 << 3) | 1}, sub_writer);
+      char fixed[sizeof(uint64_t)];
+      riegeli::WriteLittleEndian64(random(), fixed);
+      sub_writer.Write(absl::string_view(fixed, sizeof(fixed)));
+      std::string text;
+      AppendFiller(riegeli::IntCast<size_t>(random() % 40), random, text);
+      riegeli::WriteVarint32(uint32_t{(3 << 3) | 2}, sub_writer);
+      riegeli::WriteVarint64(text.size(), sub_writer);
+      sub_writer.Write(text);
+      RIEGELI_CHECK(sub_writer.Close()) << sub_writer.status();
+    }
+    // Field 3, repeated message.
+    riegeli::WriteVarint32(uint32_t{(3 << 3) | 2}, writer);
+    riegeli::WriteVarint64(submessage.size(), writer);
+    writer.Write(submessage);
+  }
+  RIEGELI_CHECK(writer.Close()) << writer.status();
+  return record;
+}
+
+Workload MakeWorkload(absl::string_view name) {
+  Workload workload;
+  workload.name = std::string(name);
+  const uint64_t num_records = absl::GetFlag(FLAGS_num_records);
+  const size_t record_size = std::max(
+      riegeli::IntCast<size_t>(absl::GetFlag(FLAGS_record_size)),
+      sizeof(uint64_t));
+  std::mt19937_64 random(absl::GetFlag(FLAGS_seed));
+  std::vector<double> zipf_cdf;
+  if (name == "zipf") {
+    // Sizes from `sizeof(uint64_t)` to `record_size`, the smallest being the
+    // most frequent.
+    const double exponent = absl::GetFlag(FLAGS_zipf_exponent);
+    double sum = 0.0;
+    for (size_t rank = 1; rank <= record_size - sizeof(uint64_t) + 1; ++rank) {
+      sum += 1.0 / std::pow(static_cast<double>(rank), exponent);
+      zipf_cdf.push_back(sum);
+    }
+  } else if (name == "nested") {
+    workload.key_offset = 1;
+  } else {
+    RIEGELI_CHECK(name == "fixed" || name == "random")
+        << "Unknown workload: " << name;
+  }
+  workload.records.reserve(riegeli::IntCast<size_t>(num_records));
+  for (uint64_t index = 0; index < num_records; ++index) {
+    std::string record;
+    if (name == "nested") {
+      record = NestedRecord(index, record_size, random);
+    } else {
+      AppendKey(index, record);
+      if (name == "fixed") {
+        AppendFiller(record_size, random, record);
+      } else if (name == "random") {
+        while (record.size() < record_size) {
+          record.push_back(static_cast<char>(random()));
+        }
+      } else {
+        const double target = std::uniform_real_distribution<double>(
+            0.0, zipf_cdf.back())(random);
+        const size_t rank = riegeli::IntCast<size_t>(
+            std::lower_bound(zipf_cdf.begin(), zipf_cdf.end(), target) -
+            zipf_cdf.begin());
+        AppendFiller(sizeof(uint64_t) + rank, random, record);
+      }
+    }
+    workload.total_size += record.size();
+    workload.records.push_back(std::move(record));
+  }
+  return workload;
+}
+
+struct Result {
+  std::string workload;
+  std::string options;
+  // `--nested_messages` if it applies to the workload, otherwise empty.
+  std::string nested_messages;
+  double compression_ratio = 0.0;
+  double write_speed = 0.0;
+  double read_speed = 0.0;
+  Latencies write_latencies;
+  Latencies flush_latencies;
+  Latencies read_latencies;
+  Latencies seek_latencies;
+  Latencies search_latencies;
+  uint64_t seek_cache_hits = 0;
+  uint64_t seek_cache_misses = 0;
+  uint64_t write_allocations = 0;
+  uint64_t read_allocations = 0;
+  // Peak resident set size of the process performing the run, including the
+  // workload generated before it. Without `--fork_runs` this includes earlier
+  // runs too.
+  uint64_t peak_rss = 0;
+  uint64_t chain_slab_size = 0;
+  riegeli::ProcessStats stats_before;
+  riegeli::ProcessStats stats_after;
+};
+
+std::string Filename(absl::string_view workload, absl::string_view options,
+                     int thread) {
+  std::string filename = absl::StrCat(workload, "_", options, "_", thread);
+  for (char& ch : filename) {
+    if (!(ch == '-' || ch == '.' || (ch >= '0' && ch <= '9') ||
+          (ch >= 'A' && ch <= 'Z') || ch == '_' || (ch >= 'a' && ch <= 'z'))) {
+      ch = '_';
+    }
+  }
+  return absl::StrCat(absl::GetFlag(FLAGS_output_dir),
+                      "/record_load_benchmark_", filename);
+}
+
+void WriteFile(const std::string& filename,
+               const riegeli::RecordWriterBase::Options& options,
+               const Workload& workload, Latencies& write_latencies,
+               Latencies& flush_latencies) {
+  const uint64_t flush_every = absl::GetFlag(FLAGS_flush_every);
+  riegeli::RecordWriter<riegeli::FdWriter<>> record_writer(
+      std::forward_as_tuple(filename), options);
+  uint64_t num_written = 0;
+  for (const std::string& record : workload.records) {
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    RIEGELI_CHECK(record_writer.WriteRecord(record)) << record_writer.status();
+    write_latencies.Add(RealTimeNow_ns() - time_before_ns);
+    if (flush_every > 0 && ++num_written % flush_every == 0) {
+      const uint64_t flush_before_ns = RealTimeNow_ns();
+      RIEGELI_CHECK(record_writer.Flush()) << record_writer.status();
+      flush_latencies.Add(RealTimeNow_ns() - flush_before_ns);
+    }
+  }
+  RIEGELI_CHECK(record_writer.Close()) << record_writer.status();
+}
+
+// Reads records of the nested workload parsed into `NestedRecord` messages:
+// if `arena`, in batches of a chunk into messages allocated on an arena which
+// is reset after each batch, otherwise into a new message per record.
+void ReadNestedMessages(const std::string& filename, const Workload& workload,
+                        bool arena, Latencies& read_latencies) {
+  using riegeli::records_load_benchmark::NestedRecord;
+  riegeli::RecordReader<riegeli::FdReader<>> record_reader(
+      std::forward_as_tuple(filename));
+  size_t index = 0;
+  const auto check_record = [&](const NestedRecord& record) {
+    RIEGELI_CHECK(index < workload.records.size() &&
+                  record.key() ==
+                      riegeli::ReadLittleEndian64(
+                          workload.records[index].data() + workload.key_offset))
+        << "Decoded records do not match";
+    ++index;
+  };
+  if (arena) {
+    google::protobuf::Arena message_arena;
+    std::vector<google::protobuf::MessageLite*> records;
+    for (;;) {
+      records.clear();
+      const uint64_t time_before_ns = RealTimeNow_ns();
+      if (!record_reader.ReadChunkRecords(NestedRecord::default_instance(),
+                                          message_arena, records)) {
+        break;
+      }
+      // Each record of a batch gets an equal share of the batch latency.
+      const uint64_t latency_ns =
+          (RealTimeNow_ns() - time_before_ns) / records.size();
+      for (const google::protobuf::MessageLite* record : records) {
+        read_latencies.Add(latency_ns);
+        check_record(*static_cast<const NestedRecord*>(record));
+      }
+      message_arena.Reset();
+    }
+  } else {
+    for (;;) {
+      const uint64_t time_before_ns = RealTimeNow_ns();
+      NestedRecord record;
+      if (!record_reader.ReadRecord(record)) break;
+      read_latencies.Add(RealTimeNow_ns() - time_before_ns);
+      check_record(record);
+    }
+  }
+  RIEGELI_CHECK(record_reader.Close()) << record_reader.status();
+  RIEGELI_CHECK_EQ(index, workload.records.size()) << "Missing records";
+}
+
+void ReadFile(const std::string& filename, const Workload& workload,
+              Latencies& read_latencies) {
+  const std::string nested_messages = absl::GetFlag(FLAGS_nested_messages);
+  if (workload.name == "nested" && nested_messages != "none") {
+    ReadNestedMessages(filename, workload, nested_messages == "arena",
+                       read_latencies);
+    return;
+  }
+  riegeli::RecordReader<riegeli::FdReader<>> record_reader(
+      std::forward_as_tuple(filename));
+  absl::string_view record;
+  size_t index = 0;
+  for (;;) {
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    if (!record_reader.ReadRecord(record)) break;
+    read_latencies.Add(RealTimeNow_ns() - time_before_ns);
+    RIEGELI_CHECK(index < workload.records.size() &&
+                  record == workload.records[index])
+        << "Decoded records do not match";
+    ++index;
+  }
+  RIEGELI_CHECK(record_reader.Close()) << record_reader.status();
+  RIEGELI_CHECK_EQ(index, workload.records.size()) << "Missing records";
+}
+
+void SeekAndSearch(const std::string& filename, const Workload& workload,
+                   riegeli::ReaderBlockCache* cache, Latencies& seek_latencies,
+                   Latencies& search_latencies) {
+  const int num_seeks = absl::GetFlag(FLAGS_num_seeks);
+  if (num_seeks <= 0 || workload.records.empty()) return;
+  std::unique_ptr<riegeli::FdReader<>> fd_reader =
+      std::make_unique<riegeli::FdReader<>>(filename);
+  const int fd = fd_reader->SrcFd();
+  std::unique_ptr<riegeli::Reader> src = std::move(fd_reader);
+  if (cache != nullptr) {
+    src = std::make_unique<
+        riegeli::CachingReader<std::unique_ptr<riegeli::Reader>>>(
+        std::move(src),
+        riegeli::CachingReaderBase::Options().set_cache(cache).set_fd(fd));
+  }
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> record_reader(
+      std::move(src));
+  std::vector<riegeli::Position> positions;
+  positions.reserve(workload.records.size());
+  absl::string_view record;
+  while (record_reader.ReadRecord(record)) {
+    positions.push_back(record_reader.last_pos().numeric());
+  }
+  std::mt19937_64 random(absl::GetFlag(FLAGS_seed));
+  for (int i = 0; i < num_seeks; ++i) {
+    const size_t index = random() % positions.size();
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    RIEGELI_CHECK(record_reader.Seek(positions[index]))
+        << record_reader.status();
+    RIEGELI_CHECK(record_reader.ReadRecord(record)) << record_reader.status();
+    seek_latencies.Add(RealTimeNow_ns() - time_before_ns);
+    RIEGELI_CHECK(record == workload.records[index]) << "Seek() failed";
+  }
+  const size_t key_offset = workload.key_offset;
+  for (int i = 0; i < num_seeks; ++i) {
+    const size_t index = random() % positions.size();
+    const absl::string_view target(
+        workload.records[index].data() + key_offset, sizeof(uint64_t));
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    const absl::optional<absl::partial_ordering> found =
+        record_reader.Search<absl::string_view>(
+            [&](absl::string_view candidate) {
+              const int ordering =
+                  candidate.substr(key_offset, sizeof(uint64_t))
+                      .compare(target);
+              return ordering < 0    ? absl::partial_ordering::less
+                     : ordering == 0 ? absl::partial_ordering::equivalent
+                                     : absl::partial_ordering::greater;
+            });
+    RIEGELI_CHECK(record_reader.ReadRecord(record)) << record_reader.status();
+    search_latencies.Add(RealTimeNow_ns() - time_before_ns);
+    RIEGELI_CHECK(found == absl::partial_ordering::equivalent &&
+                  record == workload.records[index])
+        << "Search() failed";
+  }
+  RIEGELI_CHECK(record_reader.Close()) << record_reader.status();
+}
+
+Result RunOne(const Workload& workload, absl::string_view options_text,
+              const riegeli::RecordWriterBase::Options& options) {
+  const int writer_threads = std::max(absl::GetFlag(FLAGS_writer_threads), 1);
+  const int reader_threads = std::max(absl::GetFlag(FLAGS_reader_threads), 1);
+  Result result;
+  result.workload = workload.name;
+  result.options = std::string(options_text);
+  if (workload.name == "nested" &&
+      absl::GetFlag(FLAGS_nested_messages) != "none") {
+    result.nested_messages = absl::GetFlag(FLAGS_nested_messages);
+  }
+  result.stats_before = riegeli::GetProcessStats();
+  std::vector<std::string> filenames;
+  for (int i = 0; i < writer_threads; ++i) {
+    filenames.push_back(Filename(workload.name, options_text, i));
+  }
+
+  {
+    std::vector<Latencies> write_latencies(writer_threads);
+    std::vector<Latencies> flush_latencies(writer_threads);
+    const uint64_t allocations_before = num_allocations.load();
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < writer_threads; ++i) {
+      threads.emplace_back([&, i] {
+        WriteFile(filenames[i], options, workload, write_latencies[i],
+                  flush_latencies[i]);
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+    const uint64_t time_after_ns = RealTimeNow_ns();
+    result.write_allocations = num_allocations.load() - allocations_before;
+    result.write_speed = static_cast<double>(workload.total_size) *
+                         writer_threads /
+                         static_cast<double>(time_after_ns - time_before_ns) *
+                         1000.0;
+    for (int i = 0; i < writer_threads; ++i) {
+      result.write_latencies.Merge(std::move(write_latencies[i]));
+      result.flush_latencies.Merge(std::move(flush_latencies[i]));
+    }
+  }
+  result.compression_ratio = static_cast<double>(FileSize(filenames[0])) /
+                             static_cast<double>(workload.total_size) * 100.0;
+
+  {
+    std::vector<Latencies> read_latencies(reader_threads);
+    const uint64_t allocations_before = num_allocations.load();
+    const uint64_t time_before_ns = RealTimeNow_ns();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < reader_threads; ++i) {
+      threads.emplace_back([&, i] {
+        ReadFile(filenames[i % writer_threads], workload, read_latencies[i]);
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+    const uint64_t time_after_ns = RealTimeNow_ns();
+    result.read_allocations = num_allocations.load() - allocations_before;
+    result.read_speed = static_cast<double>(workload.total_size) *
+                        reader_threads /
+                        static_cast<double>(time_after_ns - time_before_ns) *
+                        1000.0;
+    for (Latencies& latencies : read_latencies) {
+      result.read_latencies.Merge(std::move(latencies));
+    }
+  }
+
+  {
+    const uint64_t seek_cache_mb = absl::GetFlag(FLAGS_seek_cache_mb);
+    std::unique_ptr<riegeli::ReaderBlockCache> cache;
+    if (seek_cache_mb > 0) {
+      cache = std::make_unique<riegeli::ReaderBlockCache>(
+          riegeli::ReaderBlockCache::Options().set_capacity(
+              riegeli::IntCast<size_t>(seek_cache_mb << 20)));
+    }
+    SeekAndSearch(filenames[0], workload, cache.get(), result.seek_latencies,
+                  result.search_latencies);
+    if (cache != nullptr) {
+      const riegeli::ReaderBlockCache::Stats stats = cache->stats();
+      result.seek_cache_hits = stats.hits;
+      result.seek_cache_misses = stats.misses;
+    }
+  }
+  result.peak_rss = PeakRss();
+  result.chain_slab_size = riegeli::ChainBlockAllocator::stats().slab_size;
+  result.stats_after = riegeli::GetProcessStats();
+  for (const std::string& filename : filenames) std::remove(filename.c_str());
+  return result;
+}
+
+double TimeDelta_ms(uint64_t before_ns, uint64_t after_ns) {
+  return static_cast<double>(after_ns - before_ns) / 1000000.0;
+}
+
+std::string FormatLatencies(Latencies& latencies, bool json) {
+  if (latencies.empty()) return json ? "null" : "-";
+  if (json) {
+    return absl::StrFormat("{\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f}",
+                           latencies.Quantile_us(0.5),
+                           latencies.Quantile_us(0.99),
+                           latencies.Quantile_us(0.999));
+  }
+  return absl::StrFormat("%.3f/%.3f/%.3f us", latencies.Quantile_us(0.5),
+                         latencies.Quantile_us(0.99),
+                         latencies.Quantile_us(0.999));
+}
+
+void WriteResult(Result& result, riegeli::Writer& report) {
+  if (absl::GetFlag(FLAGS_format) == "json") {
+    // Workload names and RecordWriter options need no JSON escaping.
+    riegeli::WriteLine(
+        absl::StrFormat(
+            "{\"workload\":\"%s\",\"options\":\"%s\",\"nested_messages\":"
+            "\"%s\",\"writer_threads\":%d,\"reader_threads\":%d,"
+            "\"compression_ratio_percent\":%.3f,\"write_mb_per_s\":%.3f,"
+            "\"read_mb_per_s\":%.3f,",
+            result.workload, result.options,
+            result.nested_messages.empty() ? "none" : result.nested_messages,
+            absl::GetFlag(FLAGS_writer_threads),
+            absl::GetFlag(FLAGS_reader_threads), result.compression_ratio,
+            result.write_speed, result.read_speed),
+        absl::StrCat("\"write_latency\":",
+                     FormatLatencies(result.write_latencies, true),
+                     ",\"flush_latency\":",
+                     FormatLatencies(result.flush_latencies, true),
+                     ",\"read_latency\":",
+                     FormatLatencies(result.read_latencies, true),
+                     ",\"seek_latency\":",
+                     FormatLatencies(result.seek_latencies, true),
+                     ",\"search_latency\":",
+                     FormatLatencies(result.search_latencies, true)),
+        absl::StrFormat(",\"seek_cache_hits\":%d,\"seek_cache_misses\":%d,"
+                        "\"write_allocations\":%d,\"read_allocations\":%d,"
+                        "\"peak_rss_bytes\":%d,\"chain_slab_bytes\":%d}",
+                        result.seek_cache_hits, result.seek_cache_misses,
+                        result.write_allocations, result.read_allocations,
+                        result.peak_rss, result.chain_slab_size),
+        report);
+  } else {
+    riegeli::WriteLine(result.workload, " riegeli ", result.options,
+                       result.nested_messages.empty()
+                           ? ""
+                           : absl::StrCat(", ", result.nested_messages,
+                                          " messages"),
+                       report);
+    absl::Format(&report, "  compression ratio: %.3f%%",
+                 result.compression_ratio);
+    riegeli::WriteLine(report);
+    absl::Format(&report, "  write: %.1f MB/s, record p50/p99/p999: %s",
+                 result.write_speed,
+                 FormatLatencies(result.write_latencies, false));
+    riegeli::WriteLine(", flush p50/p99/p999: ",
+                       FormatLatencies(result.flush_latencies, false), report);
+    absl::Format(&report, "  read: %.1f MB/s, record p50/p99/p999: %s",
+                 result.read_speed,
+                 FormatLatencies(result.read_latencies, false));
+    riegeli::WriteLine(report);
+    riegeli::WriteLine("  seek p50/p99/p999: ",
+                       FormatLatencies(result.seek_latencies, false),
+                       ", search p50/p99/p999: ",
+                       FormatLatencies(result.search_latencies, false),
+                       report);
+    if (absl::GetFlag(FLAGS_seek_cache_mb) > 0) {
+      absl::Format(&report, "  seek cache: %d hits, %d misses",
+                   result.seek_cache_hits, result.seek_cache_misses);
+      riegeli::WriteLine(report);
+    }
+    absl::Format(&report,
+                 "  allocations: write %d, read %d; peak RSS: %.1f MB",
+                 result.write_allocations, result.read_allocations,
+                 static_cast<double>(result.peak_rss) / 1000000.0);
+    riegeli::WriteLine(report);
+    if (riegeli::ChainBlockAllocator::enabled()) {
+      absl::Format(&report, "  chain slabs: %.1f MB",
+                   static_cast<double>(result.chain_slab_size) / 1000000.0);
+      riegeli::WriteLine(report);
+    }
+    if (absl::GetFlag(FLAGS_stats)) {
+      const riegeli::ProcessStats& before = result.stats_before;
+      const riegeli::ProcessStats& after = result.stats_after;
+      absl::Format(
+          &report,
+          "  write time: buffered I/O %.1f ms, compression %.1f ms, "
+          "hashing %.1f ms, serialization %.1f ms",
+          TimeDelta_ms(before.buffered_writes.time_ns,
+                       after.buffered_writes.time_ns),
+          TimeDelta_ms(before.compression.time_ns, after.compression.time_ns),
+          TimeDelta_ms(before.record_writes.hash_time_ns,
+                       after.record_writes.hash_time_ns),
+          TimeDelta_ms(before.record_writes.message_time_ns,
+                       after.record_writes.message_time_ns));
+      riegeli::WriteLine(report);
+      absl::Format(
+          &report,
+          "  read time: buffered I/O %.1f ms, decompression %.1f ms, "
+          "hashing %.1f ms, parsing %.1f ms",
+          TimeDelta_ms(before.buffered_reads.time_ns,
+                       after.buffered_reads.time_ns),
+          TimeDelta_ms(before.decompression.time_ns,
+                       after.decompression.time_ns),
+          TimeDelta_ms(before.record_reads.hash_time_ns,
+                       after.record_reads.hash_time_ns),
+          TimeDelta_ms(before.record_reads.message_time_ns,
+                       after.record_reads.message_time_ns));
+      riegeli::WriteLine(report);
+    }
+  }
+  report.Flush();
+}
+
+const char kUsage[] =
+    "Usage: records_load_benchmark (OPTION)...\n"
+    "\n"
+    "Writes and reads synthetic workloads with concurrent threads, measuring "
+    "throughput, latency percentiles, allocations and memory usage.\n";
+
+template <typename Function>
+void ForEachWord(absl::string_view words, Function&& f) {
+  for (const absl::string_view word :
+       absl::StrSplit(words, absl::ByAnyChar("\t\n "), absl::SkipEmpty())) {
+    f(word);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(kUsage);
+  const std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  if (args.size() > 1) {
+    riegeli::TextWriter<riegeli::WriteNewline::kNative, riegeli::StdErr>
+        std_err(std::forward_as_tuple());
+    std_err.Write(kUsage, '\n');
+    std_err.Close();
+    return 1;
+  }
+  riegeli::SetStatsEnabled(absl::GetFlag(FLAGS_stats));
+  const std::string chain_block_allocator =
+      absl::GetFlag(FLAGS_chain_block_allocator);
+  if (chain_block_allocator == "slab") {
+    riegeli::ChainBlockAllocator::Enable();
+  } else if (chain_block_allocator == "slab_huge_pages") {
+    riegeli::ChainBlockAllocator::Enable(
+        riegeli::ChainBlockAllocator::Options().set_huge_pages(true));
+  } else {
+    RIEGELI_CHECK_EQ(chain_block_allocator, "default")
+        << "Unknown --chain_block_allocator";
+  }
+  const std::string nested_messages = absl::GetFlag(FLAGS_nested_messages);
+  RIEGELI_CHECK(nested_messages == "none" || nested_messages == "heap" ||
+                nested_messages == "arena")
+      << "Unknown --nested_messages: " << nested_messages;
+  std::vector<std::pair<std::string, riegeli::RecordWriterBase::Options>>
+      benchmarks;
+  ForEachWord(absl::GetFlag(FLAGS_riegeli_benchmarks),
+              [&](absl::string_view riegeli_options) {
+                riegeli::RecordWriterBase::Options options;
+                RIEGELI_CHECK_EQ(options.FromString(riegeli_options),
+                                 absl::OkStatus());
+                benchmarks.emplace_back(std::string(riegeli_options),
+                                        std::move(options));
+              });
+  const bool fork_runs = absl::GetFlag(FLAGS_fork_runs);
+  riegeli::StdOut std_out;
+  ForEachWord(absl::GetFlag(FLAGS_workloads), [&](absl::string_view name) {
+    const Workload workload = MakeWorkload(name);
+    for (const std::pair<std::string, riegeli::RecordWriterBase::Options>&
+             benchmark : benchmarks) {
+      if (!fork_runs) {
+        Result result = RunOne(workload, benchmark.first, benchmark.second);
+        WriteResult(result, std_out);
+        continue;
+      }
+      // Run in a child process, which starts with the memory of this process
+      // holding the workload, and does not see memory peaks of earlier runs.
+      // Buffered output is flushed first so that it is not duplicated.
+      std_out.Flush();
+      const pid_t pid = fork();
+      RIEGELI_CHECK_GE(pid, 0)
+          << absl::ErrnoToStatus(errno, "fork() failed").message();
+      if (pid == 0) {
+        Result result = RunOne(workload, benchmark.first, benchmark.second);
+        WriteResult(result, std_out);
+        _exit(0);
+      }
+      int status;
+      RIEGELI_CHECK_EQ(waitpid(pid, &status, 0), pid)
+          << absl::ErrnoToStatus(errno, "waitpid() failed").message();
+      RIEGELI_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0)
+          << "Run of " << name << " with " << benchmark.first << " failed";
+    }
+  });
+  std_out.Close();
+}
@@ -0,0 +1,114 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "riegeli/bytes/std_io.h"
+#include "riegeli/chunk_encoding/compressor_options.h"
+#include "riegeli/lines/line_writing.h"
+#include "riegeli/records/recompress.h"
+#include "riegeli/records/record_writer.h"
+
+ABSL_FLAG(std::string, record_writer_options, "",
+          "Options of the target encoding, in the format of "
+          "RecordWriterBase::Options::FromString().");
+ABSL_FLAG(int, parallelism, 0,
+          "Maximum number of chunks re-encoded in parallel in background.");
+ABSL_FLAG(bool, pass_through_matching, true,
+          "If true, chunks already having the target chunk type and "
+          "compressor options (compression type, level, and window log) are "
+          "copied without decoding.");
+ABSL_FLAG(std::string, source_compressor_options, "",
+          "Compressor options of the source, in the format of "
+          "CompressorOptions::FromString(), used by --pass_through_matching. "
+          "If empty, they are taken from record_writer_options in file "
+          "metadata, if present.");
+ABSL_FLAG(bool, pass_through_uncompressed, false,
+          "If true, uncompressed simple chunks are copied without decoding.");
+
+namespace riegeli {
+namespace tools {
+namespace {
+
+const char kUsage[] =
+    "Usage: riegeli_recompress (OPTION)... SRC DEST\n"
+    "\n"
+    "Re-encodes chunks of a Riegeli/records file with different compression "
+    "or transposition, without changing records or their grouping into "
+    "chunks.\n";
+
+}  // namespace
+}  // namespace tools
+}  // namespace riegeli
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(riegeli::tools::kUsage);
+  const std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  riegeli::StdErr std_err;
+  if (args.size() != 3) {
+    riegeli::WriteLine(riegeli::tools::kUsage, std_err);
+    std_err.Close();
+    return 1;
+  }
+  riegeli::RecompressOptions options;
+  {
+    const absl::Status status = options.record_writer_options().FromString(
+        absl::GetFlag(FLAGS_record_writer_options));
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      riegeli::WriteLine(status.message(), std_err);
+      std_err.Close();
+      return 1;
+    }
+  }
+  const std::string source_compressor_options_text =
+      absl::GetFlag(FLAGS_source_compressor_options);
+  if (!source_compressor_options_text.empty()) {
+    riegeli::CompressorOptions source_compressor_options;
+    const absl::Status status =
+        source_compressor_options.FromString(source_compressor_options_text);
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      riegeli::WriteLine(status.message(), std_err);
+      std_err.Close();
+      return 1;
+    }
+    options.set_source_compressor_options(source_compressor_options);
+  }
+  const int parallelism = absl::GetFlag(FLAGS_parallelism);
+  if (ABSL_PREDICT_FALSE(parallelism < 0)) {
+    riegeli::WriteLine(absl::StrCat("Negative --parallelism: ", parallelism),
+                       std_err);
+    std_err.Close();
+    return 1;
+  }
+  options.set_parallelism(parallelism)
+      .set_pass_through_matching(absl::GetFlag(FLAGS_pass_through_matching))
+      .set_pass_through_uncompressed(
+          absl::GetFlag(FLAGS_pass_through_uncompressed));
+  const absl::Status status =
+      riegeli::RecompressFile(args[1], args[2], options);
+  if (ABSL_PREDICT_FALSE(!status.ok())) {
+    riegeli::WriteLine(status.message(), std_err);
+    std_err.Close();
+    return 1;
+  }
+  std_err.Close();
+  return 0;
+}
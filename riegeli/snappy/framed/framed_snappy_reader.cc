@@ -17,6 +17,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <cstring>
+#include <functional>
+#include <future>
 #include <limits>
 #include <memory>
 #include <string>
@@ -30,6 +33,7 @@
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/buffer.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/pullable_reader.h"
@@ -46,6 +50,76 @@ inline uint32_t MaskChecksum(uint32_t x) {
   return ((x >> 15) | (x << 17)) + 0xa282ead8;
 }
 
+// The preferred compressed size of a batch of chunks decompressed in
+// background.
+constexpr size_t kBatchSize = size_t{1} << 20;
+
+absl::Status InvalidStreamError(absl::string_view message) {
+  return absl::InvalidArgumentError(
+      absl::StrCat("Invalid FramedSnappy-compressed stream: ", message));
+}
+
+// Decompresses data chunks, each including its header, stored consecutively in
+// `batch`. Replaces `dest` with their concatenated uncompressed data, and sets
+// `size` to its length.
+absl::Status DecompressBatch(absl::string_view batch, Buffer& dest,
+                             size_t& size) {
+  // Find the total uncompressed size first, so that chunks can be
+  // decompressed into a single flat buffer.
+  size = 0;
+  for (absl::string_view chunks = batch; !chunks.empty();) {
+    const uint32_t chunk_header = ReadLittleEndian32(chunks.data());
+    const uint8_t chunk_type = static_cast<uint8_t>(chunk_header);
+    const size_t chunk_length = IntCast<size_t>(chunk_header >> 8);
+    if (ABSL_PREDICT_FALSE(chunk_length < sizeof(uint32_t))) {
+      return InvalidStreamError(chunk_type == 0x00
+                                    ? "compressed data too short"
+                                    : "uncompressed data too short");
+    }
+    const char* const data = chunks.data() + 2 * sizeof(uint32_t);
+    const size_t data_length = chunk_length - sizeof(uint32_t);
+    size_t uncompressed_length = data_length;
+    if (chunk_type == 0x00 &&
+        ABSL_PREDICT_FALSE(!snappy::GetUncompressedLength(
+            data, data_length, &uncompressed_length))) {
+      return InvalidStreamError("invalid uncompressed length");
+    }
+    if (ABSL_PREDICT_FALSE(uncompressed_length > snappy::kBlockSize)) {
+      return InvalidStreamError("uncompressed length too large");
+    }
+    size += uncompressed_length;
+    chunks.remove_prefix(sizeof(uint32_t) + chunk_length);
+  }
+  dest.Reset(size);
+  char* cursor = dest.data();
+  for (absl::string_view chunks = batch; !chunks.empty();) {
+    const uint32_t chunk_header = ReadLittleEndian32(chunks.data());
+    const uint8_t chunk_type = static_cast<uint8_t>(chunk_header);
+    const size_t chunk_length = IntCast<size_t>(chunk_header >> 8);
+    const uint32_t checksum =
+        ReadLittleEndian32(chunks.data() + sizeof(uint32_t));
+    const char* const data = chunks.data() + 2 * sizeof(uint32_t);
+    const size_t data_length = chunk_length - sizeof(uint32_t);
+    size_t uncompressed_length = data_length;
+    if (chunk_type == 0x00) {
+      snappy::GetUncompressedLength(data, data_length, &uncompressed_length);
+      if (ABSL_PREDICT_FALSE(
+              !snappy::RawUncompress(data, data_length, cursor))) {
+        return InvalidStreamError("invalid compressed data");
+      }
+    } else if (uncompressed_length > 0) {
+      std::memcpy(cursor, data, uncompressed_length);
+    }
+    if (ABSL_PREDICT_FALSE(MaskChecksum(crc32c::Crc32c(
+                               cursor, uncompressed_length)) != checksum)) {
+      return InvalidStreamError("wrong checksum");
+    }
+    cursor += uncompressed_length;
+    chunks.remove_prefix(sizeof(uint32_t) + chunk_length);
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 void FramedSnappyReaderBase::Initialize(Reader* src) {
@@ -67,11 +141,11 @@ void FramedSnappyReaderBase::Done() {
   }
   PullableReader::Done();
   uncompressed_ = Buffer();
+  pending_batches_.clear();
 }
 
 bool FramedSnappyReaderBase::FailInvalidStream(absl::string_view message) {
-  return Fail(absl::InvalidArgumentError(
-      absl::StrCat("Invalid FramedSnappy-compressed stream: ", message)));
+  return Fail(InvalidStreamError(message));
 }
 
 absl::Status FramedSnappyReaderBase::AnnotateStatusImpl(absl::Status status) {
@@ -104,6 +178,7 @@ bool FramedSnappyReaderBase::PullBehindScratch(size_t recommended_length) {
       << "Failed precondition of PullableReader::PullBehindScratch(): "
          "scratch used";
   if (ABSL_PREDICT_FALSE(!ok())) return false;
+  if (parallelism_ > 0) return PullParallel();
   Reader& src = *SrcReader();
   truncated_ = false;
   while (src.Pull(sizeof(uint32_t))) {
@@ -229,6 +304,122 @@ bool FramedSnappyReaderBase::PullBehindScratch(size_t recommended_length) {
   return false;
 }
 
+bool FramedSnappyReaderBase::PullParallel() {
+  Reader& src = *SrcReader();
+  for (;;) {
+    while (pending_batches_.size() < IntCast<size_t>(parallelism_)) {
+      std::string batch;
+      {
+        absl::Status status = ReadBatch(batch);
+        if (ABSL_PREDICT_FALSE(!status.ok())) {
+          // Return data decompressed before the failure first.
+          if (!pending_batches_.empty()) break;
+          set_buffer();
+          if (!src.ok()) {
+            return FailWithoutAnnotation(AnnotateOverSrc(std::move(status)));
+          }
+          return Fail(std::move(status));
+        }
+      }
+      if (batch.empty()) break;
+      std::promise<DecompressedBatch>* const batch_promise =
+          new std::promise<DecompressedBatch>();
+      pending_batches_.push_back(batch_promise->get_future());
+      Executor& executor =
+          executor_ != nullptr ? *executor_ : Executor::global();
+      executor.Schedule(
+          [batch_promise, batch = std::move(batch)] {
+            DecompressedBatch decompressed;
+            decompressed.status =
+                DecompressBatch(batch, decompressed.data, decompressed.size);
+            batch_promise->set_value(std::move(decompressed));
+            delete batch_promise;
+          });
+    }
+    set_buffer();
+    if (pending_batches_.empty()) return false;
+    // The source might be truncated only after all pending batches.
+    truncated_ = false;
+    DecompressedBatch decompressed = pending_batches_.front().get();
+    pending_batches_.pop_front();
+    if (ABSL_PREDICT_FALSE(!decompressed.status.ok())) {
+      return Fail(std::move(decompressed.status));
+    }
+    if (ABSL_PREDICT_FALSE(decompressed.size == 0)) continue;
+    uncompressed_ = std::move(decompressed.data);
+    const Position max_length =
+        std::numeric_limits<Position>::max() - limit_pos();
+    if (ABSL_PREDICT_FALSE(decompressed.size > max_length)) {
+      set_buffer(uncompressed_.data(), IntCast<size_t>(max_length));
+      move_limit_pos(available());
+      return FailOverflow();
+    }
+    set_buffer(uncompressed_.data(), decompressed.size);
+    move_limit_pos(available());
+    return true;
+  }
+}
+
+absl::Status FramedSnappyReaderBase::ReadBatch(std::string& batch) {
+  Reader& src = *SrcReader();
+  truncated_ = false;
+  while (batch.size() < kBatchSize) {
+    if (ABSL_PREDICT_FALSE(!src.Pull(sizeof(uint32_t)))) {
+      if (ABSL_PREDICT_FALSE(!src.ok())) {
+        // Return complete chunks first, the failure will be detected again.
+        if (!batch.empty()) break;
+        return src.status();
+      }
+      if (ABSL_PREDICT_FALSE(src.available() > 0)) truncated_ = true;
+      break;
+    }
+    const uint32_t chunk_header = ReadLittleEndian32(src.cursor());
+    const uint8_t chunk_type = static_cast<uint8_t>(chunk_header);
+    const size_t chunk_length = IntCast<size_t>(chunk_header >> 8);
+    if (ABSL_PREDICT_FALSE(!src.Pull(sizeof(uint32_t) + chunk_length))) {
+      if (ABSL_PREDICT_FALSE(!src.ok())) {
+        if (!batch.empty()) break;
+        return src.status();
+      }
+      truncated_ = true;
+      break;
+    }
+    absl::string_view invalid_stream_message;
+    if (ABSL_PREDICT_FALSE(src.pos() == 0 &&
+                           chunk_type != 0xff /* Stream identifier */)) {
+      invalid_stream_message = "missing stream identifier";
+    } else {
+      switch (chunk_type) {
+        case 0x00:  // Compressed data.
+        case 0x01:  // Uncompressed data.
+          // Data chunks are validated when they are decompressed.
+          batch.append(src.cursor(), sizeof(uint32_t) + chunk_length);
+          break;
+        case 0xff:  // Stream identifier.
+          if (ABSL_PREDICT_FALSE(
+                  absl::string_view(src.cursor() + sizeof(uint32_t),
+                                    chunk_length) !=
+                  absl::string_view("sNaPpY", 6))) {
+            invalid_stream_message = "invalid stream identifier";
+          }
+          break;
+        default:
+          if (ABSL_PREDICT_FALSE(chunk_type < 0x80)) {
+            invalid_stream_message = "reserved unskippable chunk";
+          }
+          break;
+      }
+    }
+    if (ABSL_PREDICT_FALSE(!invalid_stream_message.empty())) {
+      // Return complete chunks first, the failure will be detected again.
+      if (!batch.empty()) break;
+      return InvalidStreamError(invalid_stream_message);
+    }
+    src.move_cursor(sizeof(uint32_t) + chunk_length);
+  }
+  return absl::OkStatus();
+}
+
 bool FramedSnappyReaderBase::ToleratesReadingAhead() {
   Reader* const src = SrcReader();
   return src != nullptr && src->ToleratesReadingAhead();
@@ -253,6 +444,7 @@ bool FramedSnappyReaderBase::SeekBehindScratch(Position new_pos) {
     truncated_ = false;
     set_buffer();
     set_limit_pos(0);
+    pending_batches_.clear();
     if (ABSL_PREDICT_FALSE(!src.Seek(initial_compressed_pos_))) {
       return FailWithoutAnnotation(
           AnnotateOverSrc(src.StatusOrAnnotate(absl::DataLossError(
@@ -283,7 +475,10 @@ std::unique_ptr<Reader> FramedSnappyReaderBase::NewReaderImpl(
   }
   std::unique_ptr<Reader> reader =
       std::make_unique<FramedSnappyReader<std::unique_ptr<Reader>>>(
-          std::move(compressed_reader));
+          std::move(compressed_reader),
+          FramedSnappyReaderBase::Options()
+              .set_parallelism(parallelism_)
+              .set_executor(executor_));
   reader->Seek(initial_pos);
   return reader;
 }
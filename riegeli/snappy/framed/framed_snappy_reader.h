@@ -17,7 +17,10 @@
 
 #include <stddef.h>
 
+#include <deque>
+#include <future>
 #include <memory>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -26,8 +29,10 @@
 #include "absl/base/optimization.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "riegeli/base/assert.h"
 #include "riegeli/base/buffer.h"
 #include "riegeli/base/dependency.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/pullable_reader.h"
@@ -38,7 +43,51 @@ namespace riegeli {
 // Template parameter independent part of `FramedSnappyReader`.
 class FramedSnappyReaderBase : public PullableReader {
  public:
-  class Options {};
+  class Options {
+   public:
+    Options() noexcept {}
+
+    // Maximum number of batches of chunks being decompressed ahead in
+    // background. Chunks are located cheaply using their length prefixes, and
+    // their checksums are verified in background too.
+    //
+    // If `parallelism()` is 0, chunks are decompressed in the calling thread
+    // when needed.
+    //
+    // Default: 0.
+    Options& set_parallelism(int parallelism) & {
+      RIEGELI_ASSERT_GE(parallelism, 0)
+          << "Failed precondition of "
+             "FramedSnappyReaderBase::Options::set_parallelism(): "
+             "negative parallelism";
+      parallelism_ = parallelism;
+      return *this;
+    }
+    Options&& set_parallelism(int parallelism) && {
+      return std::move(set_parallelism(parallelism));
+    }
+    int parallelism() const { return parallelism_; }
+
+    // `Executor` which decompresses chunks in background if
+    // `parallelism() > 0`. It is not owned and must outlive the
+    // `FramedSnappyReader` and readers returned by `NewReader()`.
+    //
+    // `nullptr` means `Executor::global()`.
+    //
+    // Default: `nullptr`.
+    Options& set_executor(Executor* executor) & {
+      executor_ = executor;
+      return *this;
+    }
+    Options&& set_executor(Executor* executor) && {
+      return std::move(set_executor(executor));
+    }
+    Executor* executor() const { return executor_; }
+
+   private:
+    int parallelism_ = 0;
+    Executor* executor_ = nullptr;
+  };
 
   // Returns the compressed `Reader`. Unchanged by `Close()`.
   virtual Reader* SrcReader() = 0;
@@ -49,13 +98,15 @@ class FramedSnappyReaderBase : public PullableReader {
   bool SupportsNewReader() override;
 
  protected:
-  using PullableReader::PullableReader;
+  explicit FramedSnappyReaderBase(Closed) noexcept : PullableReader(kClosed) {}
+
+  explicit FramedSnappyReaderBase(int parallelism, Executor* executor);
 
   FramedSnappyReaderBase(FramedSnappyReaderBase&& that) noexcept;
   FramedSnappyReaderBase& operator=(FramedSnappyReaderBase&& that) noexcept;
 
   void Reset(Closed);
-  void Reset();
+  void Reset(int parallelism, Executor* executor);
   void Initialize(Reader* src);
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateOverSrc(absl::Status status);
 
@@ -67,8 +118,22 @@ class FramedSnappyReaderBase : public PullableReader {
   std::unique_ptr<Reader> NewReaderImpl(Position initial_pos) override;
 
  private:
+  // The result of decompressing a batch of chunks in background.
+  struct DecompressedBatch {
+    absl::Status status;
+    Buffer data;
+    size_t size = 0;
+  };
+
   ABSL_ATTRIBUTE_COLD bool FailInvalidStream(absl::string_view message);
 
+  // Implementation of `PullBehindScratch()` if `parallelism_ > 0`.
+  bool PullParallel();
+  // Reads complete data chunks from the source into `batch`, validating and
+  // skipping other chunks, until the batch is large enough. `batch` is left
+  // empty at the end of the source or if the source is truncated.
+  absl::Status ReadBatch(std::string& batch);
+
   // If `true`, the source is truncated (without a clean end of the compressed
   // stream) at the current position. If the source does not grow, `Close()`
   // will fail.
@@ -76,6 +141,11 @@ class FramedSnappyReaderBase : public PullableReader {
   Position initial_compressed_pos_ = 0;
   // Buffered uncompressed data.
   Buffer uncompressed_;
+  int parallelism_ = 0;
+  // `nullptr` means `Executor::global()`.
+  Executor* executor_ = nullptr;
+  // Batches being decompressed in background, in the order of their positions.
+  std::deque<std::future<DecompressedBatch>> pending_batches_;
 
   // Invariant if scratch is not used:
   //   `start() == nullptr` or `start() == uncompressed_.data()` or
@@ -173,12 +243,19 @@ bool RecognizeFramedSnappy(Reader& src);
 
 // Implementation details follow.
 
+inline FramedSnappyReaderBase::FramedSnappyReaderBase(int parallelism,
+                                                      Executor* executor)
+    : parallelism_(parallelism), executor_(executor) {}
+
 inline FramedSnappyReaderBase::FramedSnappyReaderBase(
     FramedSnappyReaderBase&& that) noexcept
     : PullableReader(static_cast<PullableReader&&>(that)),
       truncated_(that.truncated_),
       initial_compressed_pos_(that.initial_compressed_pos_),
-      uncompressed_(std::move(that.uncompressed_)) {}
+      uncompressed_(std::move(that.uncompressed_)),
+      parallelism_(that.parallelism_),
+      executor_(that.executor_),
+      pending_batches_(std::move(that.pending_batches_)) {}
 
 inline FramedSnappyReaderBase& FramedSnappyReaderBase::operator=(
     FramedSnappyReaderBase&& that) noexcept {
@@ -186,6 +263,9 @@ inline FramedSnappyReaderBase& FramedSnappyReaderBase::operator=(
   truncated_ = that.truncated_;
   initial_compressed_pos_ = that.initial_compressed_pos_;
   uncompressed_ = std::move(that.uncompressed_);
+  parallelism_ = that.parallelism_;
+  executor_ = that.executor_;
+  pending_batches_ = std::move(that.pending_batches_);
   return *this;
 }
 
@@ -194,24 +274,33 @@ inline void FramedSnappyReaderBase::Reset(Closed) {
   truncated_ = false;
   initial_compressed_pos_ = 0;
   uncompressed_ = Buffer();
+  parallelism_ = 0;
+  executor_ = nullptr;
+  pending_batches_.clear();
 }
 
-inline void FramedSnappyReaderBase::Reset() {
+inline void FramedSnappyReaderBase::Reset(int parallelism,
+                                          Executor* executor) {
   PullableReader::Reset();
   truncated_ = false;
   initial_compressed_pos_ = 0;
+  parallelism_ = parallelism;
+  executor_ = executor;
+  pending_batches_.clear();
 }
 
 template <typename Src>
 inline FramedSnappyReader<Src>::FramedSnappyReader(const Src& src,
                                                    Options options)
-    : src_(src) {
+    : FramedSnappyReaderBase(options.parallelism(), options.executor()),
+      src_(src) {
   Initialize(src_.get());
 }
 
 template <typename Src>
 inline FramedSnappyReader<Src>::FramedSnappyReader(Src&& src, Options options)
-    : src_(std::move(src)) {
+    : FramedSnappyReaderBase(options.parallelism(), options.executor()),
+      src_(std::move(src)) {
   Initialize(src_.get());
 }
 
@@ -219,7 +308,8 @@ template <typename Src>
 template <typename... SrcArgs>
 inline FramedSnappyReader<Src>::FramedSnappyReader(
     std::tuple<SrcArgs...> src_args, Options options)
-    : src_(std::move(src_args)) {
+    : FramedSnappyReaderBase(options.parallelism(), options.executor()),
+      src_(std::move(src_args)) {
   Initialize(src_.get());
 }
 
@@ -247,14 +337,14 @@ inline void FramedSnappyReader<Src>::Reset(Closed) {
 
 template <typename Src>
 inline void FramedSnappyReader<Src>::Reset(const Src& src, Options options) {
-  FramedSnappyReaderBase::Reset();
+  FramedSnappyReaderBase::Reset(options.parallelism(), options.executor());
   src_.Reset(src);
   Initialize(src_.get());
 }
 
 template <typename Src>
 inline void FramedSnappyReader<Src>::Reset(Src&& src, Options options) {
-  FramedSnappyReaderBase::Reset();
+  FramedSnappyReaderBase::Reset(options.parallelism(), options.executor());
   src_.Reset(std::move(src));
   Initialize(src_.get());
 }
@@ -263,7 +353,7 @@ template <typename Src>
 template <typename... SrcArgs>
 inline void FramedSnappyReader<Src>::Reset(std::tuple<SrcArgs...> src_args,
                                            Options options) {
-  FramedSnappyReaderBase::Reset();
+  FramedSnappyReaderBase::Reset(options.parallelism(), options.executor());
   src_.Reset(std::move(src_args));
   Initialize(src_.get());
 }
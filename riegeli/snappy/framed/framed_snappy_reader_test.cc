@@ -0,0 +1,162 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/snappy/framed/framed_snappy_reader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <random>
+#include <string>
+#include <tuple>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/endian/endian_reading.h"
+#include "riegeli/snappy/framed/framed_snappy_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Returns data which are compressible if `compressible`, or random otherwise.
+std::string TestData(size_t size, bool compressible, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    data.push_back(static_cast<char>(compressible ? 'a' + random() % 4
+                                                  : random()));
+  }
+  return data;
+}
+
+// Appends `data` compressed as a separate stream to `compressed`.
+void AppendStream(absl::string_view data, std::string& compressed) {
+  FramedSnappyWriter<StringWriter<>> writer(std::forward_as_tuple(
+      &compressed, StringWriterBase::Options().set_append(true)));
+  ASSERT_TRUE(writer.Write(data)) << writer.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+}
+
+// Returns the position of the header of the data chunk with the given index,
+// counting data chunks from 0 and skipping other chunks.
+size_t DataChunkPosition(absl::string_view compressed, size_t index) {
+  size_t pos = 0;
+  while (pos < compressed.size()) {
+    const uint32_t chunk_header = ReadLittleEndian32(compressed.data() + pos);
+    const uint8_t chunk_type = static_cast<uint8_t>(chunk_header);
+    if (chunk_type == 0x00 || chunk_type == 0x01) {
+      if (index == 0) return pos;
+      --index;
+    }
+    pos += sizeof(uint32_t) + (chunk_header >> 8);
+  }
+  ADD_FAILURE() << "Not enough data chunks";
+  return 0;
+}
+
+// Decompresses `compressed` and returns the decompressed data, or the data
+// decompressed before a failure. Sets `ok` to whether decompression succeeded.
+std::string Decompress(absl::string_view compressed, int parallelism,
+                       size_t read_size, bool& ok) {
+  FramedSnappyReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      FramedSnappyReaderBase::Options().set_parallelism(parallelism));
+  std::string decompressed;
+  std::string fragment;
+  while (reader.Read(read_size, fragment)) decompressed.append(fragment);
+  decompressed.append(fragment);
+  ok = reader.Close();
+  return decompressed;
+}
+
+std::string Decompress(absl::string_view compressed, int parallelism,
+                       size_t read_size) {
+  bool ok;
+  std::string decompressed =
+      Decompress(compressed, parallelism, read_size, ok);
+  EXPECT_TRUE(ok) << "parallelism " << parallelism;
+  return decompressed;
+}
+
+// Streams are not aligned to batches, so batch boundaries fall in the middle
+// of streams, and stream identifiers fall in the middle of batches.
+TEST(FramedSnappyReaderTest, ParallelMatchesSequential) {
+  std::string data;
+  std::string compressed;
+  for (uint32_t i = 0; i < 6; ++i) {
+    const std::string stream_data =
+        TestData((1500 << 10) + i * 1000, i % 2 == 0, i);
+    AppendStream(stream_data, compressed);
+    data.append(stream_data);
+  }
+  for (const size_t read_size : {size_t{1000}, size_t{1} << 20}) {
+    EXPECT_TRUE(Decompress(compressed, 0, read_size) == data)
+        << "read size " << read_size;
+    for (const int parallelism : {1, 2, 4}) {
+      EXPECT_TRUE(Decompress(compressed, parallelism, read_size) == data)
+          << "parallelism " << parallelism << ", read size " << read_size;
+    }
+  }
+}
+
+TEST(FramedSnappyReaderTest, WrongChecksumFails) {
+  const std::string data = TestData(4 << 20, true, 1);
+  std::string compressed;
+  AppendStream(data, compressed);
+  // Corrupt the checksum of a data chunk past the first batch.
+  const size_t corrupted_pos =
+      DataChunkPosition(compressed, 40) + sizeof(uint32_t);
+  compressed[corrupted_pos] = static_cast<char>(~compressed[corrupted_pos]);
+  bool ok;
+  const std::string sequential = Decompress(compressed, 0, 1000, ok);
+  EXPECT_FALSE(ok);
+  EXPECT_TRUE(absl::string_view(data).substr(0, sequential.size()) ==
+              sequential);
+  for (const int parallelism : {1, 4}) {
+    // Data decompressed in parallel before the failure is a prefix of data
+    // decompressed sequentially, which stops at the corrupted chunk.
+    const std::string parallel = Decompress(compressed, parallelism, 1000, ok);
+    EXPECT_FALSE(ok) << "parallelism " << parallelism;
+    EXPECT_LE(parallel.size(), sequential.size())
+        << "parallelism " << parallelism;
+    EXPECT_TRUE(absl::string_view(sequential).substr(0, parallel.size()) ==
+                parallel)
+        << "parallelism " << parallelism;
+  }
+}
+
+TEST(FramedSnappyReaderTest, TruncatedFinalChunkFails) {
+  const std::string data = TestData((3 << 20) + 12345, true, 1);
+  std::string compressed;
+  AppendStream(data, compressed);
+  compressed.resize(compressed.size() - 10);
+  bool ok;
+  const std::string sequential = Decompress(compressed, 0, 1000, ok);
+  EXPECT_FALSE(ok);
+  EXPECT_LT(sequential.size(), data.size());
+  EXPECT_TRUE(absl::string_view(data).substr(0, sequential.size()) ==
+              sequential);
+  for (const int parallelism : {1, 4}) {
+    // Complete chunks before the truncated chunk are decompressed.
+    EXPECT_TRUE(Decompress(compressed, parallelism, 1000, ok) == sequential)
+        << "parallelism " << parallelism;
+    EXPECT_FALSE(ok) << "parallelism " << parallelism;
+  }
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,140 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of reading and writing varints of various lengths.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "benchmark/benchmark.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/varint/varint_reading.h"
+#include "riegeli/varint/varint_writing.h"
+
+namespace riegeli {
+namespace {
+
+constexpr size_t kNumValues = 4096;
+
+// Returns values which are encoded in `length` bytes as varints.
+template <typename T>
+std::vector<T> ValuesOfLength(int length) {
+  std::vector<T> values;
+  values.reserve(kNumValues);
+  const T min_value = length == 1 ? T{0} : T{1} << (7 * (length - 1));
+  for (size_t i = 0; i < kNumValues; ++i) {
+    values.push_back(min_value + static_cast<T>(i % 128));
+  }
+  return values;
+}
+
+template <typename T>
+std::string EncodeValues(const std::vector<T>& values) {
+  std::string encoded;
+  StringWriter<> writer(&encoded);
+  for (const T value : values) {
+    if (sizeof(T) == sizeof(uint32_t)) {
+      WriteVarint32(static_cast<uint32_t>(value), writer);
+    } else {
+      WriteVarint64(static_cast<uint64_t>(value), writer);
+    }
+  }
+  writer.Close();
+  return encoded;
+}
+
+// Reads `kNumValues` varints of `state.range(0)` bytes each.
+void BM_ReadVarint32(benchmark::State& state) {
+  const std::string encoded = EncodeValues(
+      ValuesOfLength<uint32_t>(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    StringReader<> reader(encoded);
+    uint32_t value;
+    while (ReadVarint32(reader, value)) benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kNumValues));
+}
+BENCHMARK(BM_ReadVarint32)->DenseRange(1, 5);
+
+void BM_ReadVarint64(benchmark::State& state) {
+  const std::string encoded = EncodeValues(
+      ValuesOfLength<uint64_t>(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    StringReader<> reader(encoded);
+    uint64_t value;
+    while (ReadVarint64(reader, value)) benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kNumValues));
+}
+BENCHMARK(BM_ReadVarint64)->DenseRange(1, 10);
+
+// Like `BM_ReadVarint64()`, but reads from a flat array instead of a `Reader`.
+void BM_ReadVarint64FromArray(benchmark::State& state) {
+  const std::string encoded = EncodeValues(
+      ValuesOfLength<uint64_t>(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    const char* cursor = encoded.data();
+    const char* const limit = encoded.data() + encoded.size();
+    uint64_t value;
+    while (const absl::optional<const char*> next =
+               ReadVarint64(cursor, limit, value)) {
+      benchmark::DoNotOptimize(value);
+      cursor = *next;
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kNumValues));
+}
+BENCHMARK(BM_ReadVarint64FromArray)->DenseRange(1, 10);
+
+// Writes `kNumValues` varints of `state.range(0)` bytes each.
+void BM_WriteVarint32(benchmark::State& state) {
+  const std::vector<uint32_t> values =
+      ValuesOfLength<uint32_t>(static_cast<int>(state.range(0)));
+  std::string dest;
+  for (auto _ : state) {
+    StringWriter<> writer(&dest);
+    for (const uint32_t value : values) WriteVarint32(value, writer);
+    writer.Close();
+    benchmark::DoNotOptimize(dest);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kNumValues));
+}
+BENCHMARK(BM_WriteVarint32)->DenseRange(1, 5);
+
+void BM_WriteVarint64(benchmark::State& state) {
+  const std::vector<uint64_t> values =
+      ValuesOfLength<uint64_t>(static_cast<int>(state.range(0)));
+  std::string dest;
+  for (auto _ : state) {
+    StringWriter<> writer(&dest);
+    for (const uint64_t value : values) WriteVarint64(value, writer);
+    writer.Close();
+    benchmark::DoNotOptimize(dest);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kNumValues));
+}
+BENCHMARK(BM_WriteVarint64)->DenseRange(1, 10);
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,345 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/zlib/bgzf.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/recycling_pool.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/writer.h"
+#include "riegeli/endian/endian_reading.h"
+#include "riegeli/endian/endian_writing.h"
+#include "zconf.h"
+#include "zlib.h"
+
+namespace riegeli {
+
+namespace {
+
+struct DeflateDeleter {
+  void operator()(z_stream* ptr) const {
+    const int zlib_code = deflateEnd(ptr);
+    RIEGELI_ASSERT(zlib_code == Z_OK || zlib_code == Z_DATA_ERROR)
+        << "deflateEnd() failed: " << zlib_code;
+    delete ptr;
+  }
+};
+
+struct InflateDeleter {
+  void operator()(z_stream* ptr) const {
+    const int zlib_code = inflateEnd(ptr);
+    RIEGELI_ASSERT_EQ(zlib_code, Z_OK) << "inflateEnd() failed";
+    delete ptr;
+  }
+};
+
+// Gzip header fields.
+constexpr uint8_t kId1 = 31;
+constexpr uint8_t kId2 = 139;
+constexpr uint8_t kCmDeflate = 8;
+constexpr uint8_t kFlgExtra = 4;
+// Size of the fixed part of the header, up to and including `XLEN`.
+constexpr size_t kFixedHeaderSize = 12;
+
+absl::Status ZlibError(absl::StatusCode code, absl::string_view operation,
+                       const z_stream& stream, int zlib_code) {
+  return absl::Status(
+      code, stream.msg != nullptr
+                ? absl::StrCat(operation, " failed: ", stream.msg)
+                : absl::StrCat(operation, " failed: ", zlib_code));
+}
+
+bool DeflateBlock(z_stream& compressor, absl::string_view src, char* dest,
+                  size_t dest_size, size_t& length_written, int& zlib_code) {
+  compressor.next_in =
+      const_cast<z_const Bytef*>(reinterpret_cast<const Bytef*>(src.data()));
+  compressor.avail_in = IntCast<uInt>(src.size());
+  compressor.next_out = reinterpret_cast<Bytef*>(dest);
+  compressor.avail_out = IntCast<uInt>(dest_size);
+  zlib_code = deflate(&compressor, Z_FINISH);
+  length_written = dest_size - compressor.avail_out;
+  return zlib_code == Z_STREAM_END;
+}
+
+}  // namespace
+
+BgzfBlockPosition BgzfIndex::Find(Position uncompressed_pos) const {
+  const std::vector<BgzfBlockPosition>::const_iterator iter = std::upper_bound(
+      blocks_.begin(), blocks_.end(), uncompressed_pos,
+      [](Position pos, const BgzfBlockPosition& block) {
+        return pos < block.uncompressed_pos;
+      });
+  RIEGELI_ASSERT(iter != blocks_.begin())
+      << "Failed invariant of BgzfIndex: the first block is not at 0";
+  return *(iter - 1);
+}
+
+bool WriteGziIndex(const BgzfIndex& index, Writer& dest) {
+  // The `.gzi` format omits the first block, which is always at `{0, 0}`.
+  const std::vector<BgzfBlockPosition>& blocks = index.blocks();
+  if (ABSL_PREDICT_FALSE(
+          !WriteLittleEndian64(IntCast<uint64_t>(blocks.size() - 1), dest))) {
+    return false;
+  }
+  for (size_t i = 1; i < blocks.size(); ++i) {
+    if (ABSL_PREDICT_FALSE(
+            !WriteLittleEndian64(blocks[i].compressed_pos, dest) ||
+            !WriteLittleEndian64(blocks[i].uncompressed_pos, dest))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadGziIndex(Reader& src, BgzfIndex& index) {
+  index.Reset();
+  uint64_t num_blocks;
+  if (ABSL_PREDICT_FALSE(!ReadLittleEndian64(src, num_blocks))) return false;
+  for (uint64_t i = 0; i < num_blocks; ++i) {
+    uint64_t compressed_pos, uncompressed_pos;
+    if (ABSL_PREDICT_FALSE(!ReadLittleEndian64(src, compressed_pos) ||
+                           !ReadLittleEndian64(src, uncompressed_pos))) {
+      return false;
+    }
+    const BgzfBlockPosition last = index.back();
+    if (ABSL_PREDICT_FALSE(compressed_pos <= last.compressed_pos ||
+                           uncompressed_pos < last.uncompressed_pos)) {
+      return src.Fail(absl::InvalidArgumentError(
+          "Invalid gzi index: positions not increasing"));
+    }
+    index.Add(BgzfBlockPosition{compressed_pos, uncompressed_pos});
+  }
+  return true;
+}
+
+namespace bgzf_internal {
+
+absl::Status CompressBlock(absl::string_view src, int compression_level,
+                           std::string& dest) {
+  RIEGELI_ASSERT_LE(src.size(), kMaxUncompressedBlockSize)
+      << "Failed precondition of bgzf_internal::CompressBlock(): "
+         "block too large";
+  const size_t header_pos = dest.size();
+  dest.resize(header_pos + kMaxBlockSize);
+  char* const header = &dest[header_pos];
+  char* const data = header + kHeaderSize;
+  const size_t max_data_size = kMaxBlockSize - kHeaderSize - kFooterSize;
+  size_t data_size;
+  int zlib_code;
+  {
+    absl::Status status;
+    KeyedRecyclingPool<z_stream, int, DeflateDeleter>::Handle handle =
+        KeyedRecyclingPool<z_stream, int, DeflateDeleter>::global().Get(
+            compression_level,
+            [&] {
+              std::unique_ptr<z_stream, DeflateDeleter> ptr(new z_stream());
+              zlib_code = deflateInit2(ptr.get(), compression_level, Z_DEFLATED,
+                                       -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+              if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+                status = ZlibError(absl::StatusCode::kInternal,
+                                   "deflateInit2()", *ptr, zlib_code);
+              }
+              return ptr;
+            },
+            [&](z_stream* ptr) {
+              zlib_code = deflateReset(ptr);
+              if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+                status = ZlibError(absl::StatusCode::kInternal,
+                                   "deflateReset()", *ptr, zlib_code);
+              }
+            });
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      dest.resize(header_pos);
+      return status;
+    }
+    z_stream* const compressor = handle.get();
+    if (ABSL_PREDICT_FALSE(!DeflateBlock(*compressor, src, data, max_data_size,
+                                         data_size, zlib_code))) {
+      if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+        dest.resize(header_pos);
+        return ZlibError(absl::StatusCode::kInternal, "deflate()", *compressor,
+                         zlib_code);
+      }
+      // Compressed data did not fit: the data are incompressible. Store them
+      // instead; stored blocks of `kMaxUncompressedBlockSize` always fit.
+      zlib_code = deflateReset(compressor);
+      if (ABSL_PREDICT_TRUE(zlib_code == Z_OK)) {
+        zlib_code =
+            deflateParams(compressor, Z_NO_COMPRESSION, Z_DEFAULT_STRATEGY);
+      }
+      const bool stored =
+          zlib_code == Z_OK && DeflateBlock(*compressor, src, data,
+                                            max_data_size, data_size, zlib_code);
+      // Restore the level before the compressor gets recycled.
+      if (ABSL_PREDICT_FALSE(deflateReset(compressor) != Z_OK ||
+                             deflateParams(compressor, compression_level,
+                                           Z_DEFAULT_STRATEGY) != Z_OK)) {
+        handle.get_deleter().original_deleter()(handle.release());
+      }
+      if (ABSL_PREDICT_FALSE(!stored)) {
+        dest.resize(header_pos);
+        return absl::InternalError(
+            absl::StrCat("deflate() failed storing a block: ", zlib_code));
+      }
+    }
+  }
+  const size_t block_size = kHeaderSize + data_size + kFooterSize;
+  // Header: ID1, ID2, CM, FLG, MTIME, XFL, OS, XLEN, then the "BC" subfield
+  // with SLEN = 2 and BSIZE = block size - 1.
+  header[0] = static_cast<char>(kId1);
+  header[1] = static_cast<char>(kId2);
+  header[2] = static_cast<char>(kCmDeflate);
+  header[3] = static_cast<char>(kFlgExtra);
+  WriteLittleEndian32(0, header + 4);
+  header[8] = 0;
+  header[9] = static_cast<char>(0xff);
+  WriteLittleEndian16(6, header + 10);
+  header[12] = 'B';
+  header[13] = 'C';
+  WriteLittleEndian16(2, header + 14);
+  WriteLittleEndian16(IntCast<uint16_t>(block_size - 1), header + 16);
+  char* const footer = data + data_size;
+  WriteLittleEndian32(
+      IntCast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(src.data()),
+                              IntCast<uInt>(src.size()))),
+      footer);
+  WriteLittleEndian32(IntCast<uint32_t>(src.size()), footer + 4);
+  dest.resize(header_pos + block_size);
+  return absl::OkStatus();
+}
+
+absl::Status ReadBlockSize(Reader& src, size_t& block_size) {
+  if (ABSL_PREDICT_FALSE(!src.Pull(kFixedHeaderSize))) {
+    if (ABSL_PREDICT_FALSE(!src.ok())) return src.status();
+    if (ABSL_PREDICT_FALSE(src.available() > 0)) {
+      return absl::DataLossError("Truncated BGZF block header");
+    }
+    return absl::OutOfRangeError("No more BGZF blocks");
+  }
+  const char* const header = src.cursor();
+  if (ABSL_PREDICT_FALSE(static_cast<uint8_t>(header[0]) != kId1 ||
+                         static_cast<uint8_t>(header[1]) != kId2 ||
+                         static_cast<uint8_t>(header[2]) != kCmDeflate ||
+                         (static_cast<uint8_t>(header[3]) & kFlgExtra) == 0)) {
+    return absl::InvalidArgumentError("Invalid BGZF block header");
+  }
+  const size_t extra_size = ReadLittleEndian16(header + 10);
+  if (ABSL_PREDICT_FALSE(!src.Pull(kFixedHeaderSize + extra_size))) {
+    if (ABSL_PREDICT_FALSE(!src.ok())) return src.status();
+    return absl::DataLossError("Truncated BGZF block header");
+  }
+  // Look for the "BC" subfield among the extra fields.
+  const char* subfield = src.cursor() + kFixedHeaderSize;
+  const char* const extra_limit = subfield + extra_size;
+  while (PtrDistance(subfield, extra_limit) >= 4) {
+    const size_t subfield_size = ReadLittleEndian16(subfield + 2);
+    if (subfield[0] == 'B' && subfield[1] == 'C' && subfield_size == 2 &&
+        PtrDistance(subfield, extra_limit) >= 6) {
+      block_size = size_t{ReadLittleEndian16(subfield + 4)} + 1;
+      if (ABSL_PREDICT_FALSE(block_size <
+                             kFixedHeaderSize + extra_size + kFooterSize)) {
+        return absl::InvalidArgumentError("Invalid BGZF block size");
+      }
+      return absl::OkStatus();
+    }
+    subfield += 4 + subfield_size;
+  }
+  return absl::InvalidArgumentError(
+      "Missing BC extra field in a BGZF block header");
+}
+
+size_t UncompressedBlockSize(absl::string_view block) {
+  RIEGELI_ASSERT_GE(block.size(), kHeaderSize + kFooterSize)
+      << "Failed precondition of bgzf_internal::UncompressedBlockSize(): "
+         "block too small";
+  return size_t{ReadLittleEndian32(block.data() + block.size() - 4)};
+}
+
+absl::Status DecompressBlock(absl::string_view block, std::string& dest) {
+  const size_t extra_size = ReadLittleEndian16(block.data() + 10);
+  const size_t uncompressed_size = UncompressedBlockSize(block);
+  if (ABSL_PREDICT_FALSE(uncompressed_size > kMaxBlockSize)) {
+    return absl::InvalidArgumentError(
+        "Invalid BGZF block: uncompressed size too large");
+  }
+  const absl::string_view data = block.substr(
+      kFixedHeaderSize + extra_size,
+      block.size() - kFixedHeaderSize - extra_size - kFooterSize);
+  dest.resize(uncompressed_size);
+  absl::Status status;
+  const RecyclingPool<z_stream, InflateDeleter>::Handle decompressor =
+      RecyclingPool<z_stream, InflateDeleter>::global().Get(
+          [&] {
+            std::unique_ptr<z_stream, InflateDeleter> ptr(new z_stream());
+            const int zlib_code = inflateInit2(ptr.get(), -MAX_WBITS);
+            if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+              status = ZlibError(absl::StatusCode::kInternal, "inflateInit2()",
+                                 *ptr, zlib_code);
+            }
+            return ptr;
+          },
+          [&](z_stream* ptr) {
+            const int zlib_code = inflateReset2(ptr, -MAX_WBITS);
+            if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+              status = ZlibError(absl::StatusCode::kInternal,
+                                 "inflateReset2()", *ptr, zlib_code);
+            }
+          });
+  if (ABSL_PREDICT_FALSE(!status.ok())) return status;
+  decompressor->next_in =
+      const_cast<z_const Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+  decompressor->avail_in = IntCast<uInt>(data.size());
+  // One spare byte of output space lets `inflate()` detect data longer than
+  // claimed by the footer.
+  std::string::size_type output_size = uncompressed_size + 1;
+  dest.resize(output_size);
+  decompressor->next_out = reinterpret_cast<Bytef*>(&dest[0]);
+  decompressor->avail_out = IntCast<uInt>(output_size);
+  const int zlib_code = inflate(decompressor.get(), Z_FINISH);
+  if (ABSL_PREDICT_FALSE(zlib_code != Z_STREAM_END)) {
+    return ZlibError(absl::StatusCode::kInvalidArgument, "inflate()",
+                     *decompressor, zlib_code);
+  }
+  if (ABSL_PREDICT_FALSE(output_size - decompressor->avail_out !=
+                         uncompressed_size)) {
+    return absl::InvalidArgumentError(
+        "Invalid BGZF block: uncompressed size mismatch");
+  }
+  dest.resize(uncompressed_size);
+  const uint32_t crc = ReadLittleEndian32(block.data() + block.size() - 8);
+  if (ABSL_PREDICT_FALSE(
+          IntCast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(dest.data()),
+                                  IntCast<uInt>(dest.size()))) != crc)) {
+    return absl::InvalidArgumentError("Invalid BGZF block: CRC-32 mismatch");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace bgzf_internal
+
+}  // namespace riegeli
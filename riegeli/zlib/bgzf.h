@@ -0,0 +1,180 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_ZLIB_BGZF_H_
+#define RIEGELI_ZLIB_BGZF_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "riegeli/base/constexpr.h"
+#include "riegeli/base/types.h"
+
+namespace riegeli {
+
+class Reader;
+class Writer;
+
+// Blocked Gzip format (BGZF), as produced by `bgzip` and consumed by genomics
+// tools, is a sequence of independent Gzip members, each compressing at most
+// 64 KiB - 256 B of data into at most 64 KiB, with the size of each member
+// recorded in a "BC" extra field of its header. The stream ends with an empty
+// member.
+//
+// This is still a valid Gzip stream, which can be decompressed by any Gzip
+// decompressor supporting concatenated members (e.g. `ZlibReader` with
+// `set_concatenate(true)`), but it can also be compressed and decompressed in
+// parallel, and it supports efficient random access.
+
+// The beginning of a BGZF block. Positions are relative to the beginning of
+// the compressed stream and of the uncompressed data.
+struct BgzfBlockPosition {
+  Position compressed_pos;
+  Position uncompressed_pos;
+};
+
+// An index of blocks of a BGZF stream, mapping uncompressed positions to
+// compressed positions of beginnings of blocks.
+//
+// Not all blocks need to be present. Blocks which are absent can be found by
+// walking over block headers forwards from the closest preceding block.
+class BgzfIndex {
+ public:
+  // Creates an index containing only the beginning of the stream.
+  BgzfIndex() noexcept : blocks_{{0, 0}} {}
+
+  BgzfIndex(const BgzfIndex& that) = default;
+  BgzfIndex& operator=(const BgzfIndex& that) = default;
+
+  BgzfIndex(BgzfIndex&& that) noexcept;
+  BgzfIndex& operator=(BgzfIndex&& that) noexcept;
+
+  // Makes `*this` equivalent to a newly constructed `BgzfIndex`.
+  void Reset();
+
+  // Registers the beginning of a block.
+  //
+  // Blocks are expected to be added in the order of increasing positions.
+  // A block which does not follow the last known block is ignored.
+  void Add(BgzfBlockPosition block);
+
+  // Returns the last known block beginning at or before `uncompressed_pos`.
+  BgzfBlockPosition Find(Position uncompressed_pos) const;
+
+  // Returns the last known block.
+  BgzfBlockPosition back() const { return blocks_.back(); }
+
+  // Returns all known blocks, sorted by position, starting with `{0, 0}`.
+  const std::vector<BgzfBlockPosition>& blocks() const { return blocks_; }
+
+ private:
+  // Invariants:
+  //   `!blocks_.empty()`
+  //   `blocks_.front().compressed_pos == 0`
+  //   `blocks_.front().uncompressed_pos == 0`
+  //   `blocks_` are sorted by `compressed_pos` and by `uncompressed_pos`
+  std::vector<BgzfBlockPosition> blocks_;
+};
+
+// Writes a `BgzfIndex` in the `.gzi` format used by `bgzip --index`.
+//
+// Returns `false` on failure, with `dest.status()` explaining the failure.
+bool WriteGziIndex(const BgzfIndex& index, Writer& dest);
+
+// Reads a `BgzfIndex` in the `.gzi` format used by `bgzip --index`.
+//
+// Returns `false` on failure. If `src.ok()`, the index was invalid.
+bool ReadGziIndex(Reader& src, BgzfIndex& index);
+
+namespace bgzf_internal {
+
+// The maximum compressed size of a block, including its header and footer.
+RIEGELI_INLINE_CONSTEXPR(size_t, kMaxBlockSize, size_t{64} << 10);
+
+// The maximum uncompressed size of a block. `bgzip` uses this value to ensure
+// that even incompressible data fit in `kMaxBlockSize`.
+RIEGELI_INLINE_CONSTEXPR(size_t, kMaxUncompressedBlockSize, 0xff00);
+
+// The size of the block header written by `CompressBlock()`, and the minimum
+// size of any block header.
+RIEGELI_INLINE_CONSTEXPR(size_t, kHeaderSize, 18);
+
+// The size of the block footer: CRC-32 and uncompressed size.
+RIEGELI_INLINE_CONSTEXPR(size_t, kFooterSize, 8);
+
+// The empty block which terminates a BGZF stream.
+RIEGELI_INLINE_CONSTEXPR(absl::string_view, kEofBlock,
+                         absl::string_view("\x1f\x8b\x08\x04\x00\x00\x00\x00"
+                                           "\x00\xff\x06\x00\x42\x43\x02\x00"
+                                           "\x1b\x00\x03\x00\x00\x00\x00\x00"
+                                           "\x00\x00\x00\x00",
+                                           28));
+
+// Compresses `src` as a single block and appends it to `dest`.
+//
+// Precondition: `src.size() <= kMaxUncompressedBlockSize`
+absl::Status CompressBlock(absl::string_view src, int compression_level,
+                           std::string& dest);
+
+// Reads the size of the block beginning at the current position of `src`,
+// including its header and footer. The position of `src` is unchanged.
+//
+// Returns:
+//  * `absl::OkStatus()`          - success
+//  * `absl::OutOfRangeError()`   - `src` ends before the block header
+//  * `absl::InvalidArgumentError()`, `absl::DataLossError()` - invalid header
+//  * other status                - `src` failed
+absl::Status ReadBlockSize(Reader& src, size_t& block_size);
+
+// Returns the uncompressed size of a complete block, stored in its footer.
+//
+// Precondition: `block.size() >= kHeaderSize + kFooterSize`
+size_t UncompressedBlockSize(absl::string_view block);
+
+// Decompresses a complete block, replacing `dest`. Verifies the CRC-32 and the
+// uncompressed size.
+absl::Status DecompressBlock(absl::string_view block, std::string& dest);
+
+}  // namespace bgzf_internal
+
+// Implementation details follow.
+
+inline BgzfIndex::BgzfIndex(BgzfIndex&& that) noexcept
+    : blocks_(std::exchange(that.blocks_, {{0, 0}})) {}
+
+inline BgzfIndex& BgzfIndex::operator=(BgzfIndex&& that) noexcept {
+  blocks_ = std::exchange(that.blocks_, {{0, 0}});
+  return *this;
+}
+
+inline void BgzfIndex::Reset() {
+  blocks_.clear();
+  blocks_.push_back({0, 0});
+}
+
+inline void BgzfIndex::Add(BgzfBlockPosition block) {
+  if (block.compressed_pos > blocks_.back().compressed_pos &&
+      block.uncompressed_pos > blocks_.back().uncompressed_pos) {
+    blocks_.push_back(block);
+  }
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_ZLIB_BGZF_H_
@@ -0,0 +1,245 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/zlib/bgzf.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/executor.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/zlib/zlib_reader.h"
+#include "riegeli/zlib/zlib_writer.h"
+
+namespace riegeli {
+namespace {
+
+// Returns moderately compressible data.
+std::string TestData(size_t size) {
+  std::mt19937 random(42);
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    data.push_back(static_cast<char>('a' + random() % 8));
+  }
+  return data;
+}
+
+std::string CompressBlocked(absl::string_view data, int parallelism,
+                            BgzfIndex* index = nullptr) {
+  std::string compressed;
+  ZlibWriter<StringWriter<>> writer(
+      std::forward_as_tuple(&compressed),
+      ZlibWriterBase::Options().set_blocked(true).set_parallelism(
+          parallelism));
+  EXPECT_TRUE(writer.Write(data)) << writer.status();
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  if (index != nullptr) *index = writer.block_index();
+  return compressed;
+}
+
+TEST(BgzfTest, RoundTrip) {
+  const std::string data = TestData(300000);
+  for (const int write_parallelism : {0, 3}) {
+    const std::string compressed = CompressBlocked(data, write_parallelism);
+    ASSERT_GE(compressed.size(), bgzf_internal::kEofBlock.size());
+    EXPECT_EQ(absl::string_view(compressed).substr(
+                  compressed.size() - bgzf_internal::kEofBlock.size()),
+              bgzf_internal::kEofBlock);
+    for (const int read_parallelism : {0, 3}) {
+      ZlibReader<StringReader<>> reader(
+          std::forward_as_tuple(compressed),
+          ZlibReaderBase::Options().set_blocked(true).set_parallelism(
+              read_parallelism));
+      std::string decompressed;
+      EXPECT_TRUE(ReadAll(reader, decompressed).ok()) << reader.status();
+      EXPECT_TRUE(reader.Close()) << reader.status();
+      EXPECT_EQ(decompressed, data)
+          << "write parallelism " << write_parallelism
+          << ", read parallelism " << read_parallelism;
+    }
+  }
+}
+
+TEST(BgzfTest, RoundTripWithExecutor) {
+  const std::string data = TestData(300000);
+  WorkStealingExecutor executor(
+      WorkStealingExecutor::Options().set_num_threads(2));
+  std::string compressed;
+  ZlibWriter<StringWriter<>> writer(std::forward_as_tuple(&compressed),
+                                    ZlibWriterBase::Options()
+                                        .set_blocked(true)
+                                        .set_parallelism(3)
+                                        .set_executor(&executor));
+  ASSERT_TRUE(writer.Write(data)) << writer.status();
+  ASSERT_TRUE(writer.Close()) << writer.status();
+  ZlibReader<StringReader<>> reader(std::forward_as_tuple(compressed),
+                                    ZlibReaderBase::Options()
+                                        .set_blocked(true)
+                                        .set_parallelism(3)
+                                        .set_executor(&executor));
+  std::string decompressed;
+  EXPECT_TRUE(ReadAll(reader, decompressed).ok()) << reader.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  EXPECT_EQ(decompressed, data);
+}
+
+TEST(BgzfTest, ReadableAsConcatenatedGzip) {
+  const std::string data = TestData(200000);
+  const std::string compressed = CompressBlocked(data, 0);
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options()
+          .set_header(ZlibReaderBase::Header::kGzip)
+          .set_concatenate(true));
+  std::string decompressed;
+  EXPECT_TRUE(ReadAll(reader, decompressed).ok()) << reader.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  EXPECT_EQ(decompressed, data);
+}
+
+TEST(BgzfTest, BlockIndex) {
+  const std::string data = TestData(300000);
+  BgzfIndex index;
+  const std::string compressed = CompressBlocked(data, 2, &index);
+  // Every block except the last one is full.
+  ASSERT_EQ(index.blocks().size(),
+            (data.size() - 1) / bgzf_internal::kMaxUncompressedBlockSize + 1);
+  for (size_t i = 0; i < index.blocks().size(); ++i) {
+    EXPECT_EQ(index.blocks()[i].uncompressed_pos,
+              i * bgzf_internal::kMaxUncompressedBlockSize);
+    if (i > 0) {
+      EXPECT_GT(index.blocks()[i].compressed_pos,
+                index.blocks()[i - 1].compressed_pos);
+      EXPECT_LE(index.blocks()[i].compressed_pos -
+                    index.blocks()[i - 1].compressed_pos,
+                bgzf_internal::kMaxBlockSize);
+    }
+  }
+  const BgzfBlockPosition found =
+      index.Find(bgzf_internal::kMaxUncompressedBlockSize * 2 + 5);
+  EXPECT_EQ(found.uncompressed_pos,
+            bgzf_internal::kMaxUncompressedBlockSize * 2);
+  EXPECT_EQ(found.compressed_pos, index.blocks()[2].compressed_pos);
+
+  // Adding a block out of order is ignored.
+  BgzfIndex copy = index;
+  copy.Add(BgzfBlockPosition{1, 1});
+  EXPECT_EQ(copy.blocks().size(), index.blocks().size());
+}
+
+TEST(BgzfTest, GziIndexRoundTrip) {
+  const std::string data = TestData(300000);
+  BgzfIndex index;
+  CompressBlocked(data, 0, &index);
+  std::string gzi;
+  StringWriter<> gzi_writer(&gzi);
+  ASSERT_TRUE(WriteGziIndex(index, gzi_writer)) << gzi_writer.status();
+  ASSERT_TRUE(gzi_writer.Close()) << gzi_writer.status();
+  // The number of entries excludes the implicit first block.
+  EXPECT_EQ(gzi.size(), 8 + 16 * (index.blocks().size() - 1));
+
+  StringReader<> gzi_reader(gzi);
+  BgzfIndex read_index;
+  ASSERT_TRUE(ReadGziIndex(gzi_reader, read_index)) << gzi_reader.status();
+  ASSERT_EQ(read_index.blocks().size(), index.blocks().size());
+  for (size_t i = 0; i < index.blocks().size(); ++i) {
+    EXPECT_EQ(read_index.blocks()[i].compressed_pos,
+              index.blocks()[i].compressed_pos);
+    EXPECT_EQ(read_index.blocks()[i].uncompressed_pos,
+              index.blocks()[i].uncompressed_pos);
+  }
+
+  // A truncated index is invalid.
+  StringReader<> truncated_reader(absl::string_view(gzi).substr(0, 12));
+  EXPECT_FALSE(ReadGziIndex(truncated_reader, read_index));
+}
+
+TEST(BgzfTest, Seek) {
+  const std::string data = TestData(500000);
+  BgzfIndex index;
+  const std::string compressed = CompressBlocked(data, 0, &index);
+  std::mt19937 random(1);
+  for (const bool with_index : {false, true}) {
+    ZlibReaderBase::Options options;
+    options.set_blocked(true);
+    if (with_index) options.set_block_index(index);
+    ZlibReader<StringReader<>> reader(std::forward_as_tuple(compressed),
+                                      std::move(options));
+    for (int i = 0; i < 50; ++i) {
+      const Position pos = random() % (data.size() + 1);
+      ASSERT_TRUE(reader.Seek(pos)) << reader.status();
+      std::string fragment;
+      const size_t length = std::min(size_t{1000}, data.size() - pos);
+      ASSERT_TRUE(reader.Read(length, fragment)) << reader.status();
+      EXPECT_EQ(fragment, absl::string_view(data).substr(pos, length))
+          << "position " << pos;
+    }
+    // Blocks skipped while seeking are added to the index. It can also
+    // include the empty block which terminates the stream.
+    const BgzfIndex& reader_index = reader.block_index();
+    ASSERT_GE(reader_index.blocks().size(), index.blocks().size());
+    for (size_t i = 0; i < index.blocks().size(); ++i) {
+      EXPECT_EQ(reader_index.blocks()[i].compressed_pos,
+                index.blocks()[i].compressed_pos);
+    }
+    EXPECT_TRUE(reader.Close()) << reader.status();
+  }
+}
+
+TEST(BgzfTest, NewReader) {
+  const std::string data = TestData(300000);
+  const std::string compressed = CompressBlocked(data, 0);
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options().set_blocked(true));
+  ASSERT_TRUE(reader.SupportsNewReader());
+  const Position pos = bgzf_internal::kMaxUncompressedBlockSize + 123;
+  std::unique_ptr<Reader> new_reader = reader.NewReader(pos);
+  ASSERT_NE(new_reader, nullptr) << reader.status();
+  std::string rest;
+  EXPECT_TRUE(ReadAll(*new_reader, rest).ok()) << new_reader->status();
+  EXPECT_EQ(rest, absl::string_view(data).substr(pos));
+  EXPECT_TRUE(new_reader->Close()) << new_reader->status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST(BgzfTest, CorruptedBlockFails) {
+  const std::string data = TestData(100000);
+  std::string compressed = CompressBlocked(data, 0);
+  // Damage compressed data of the first block.
+  compressed[bgzf_internal::kHeaderSize + 10] ^= 0x55;
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options().set_blocked(true));
+  std::string decompressed;
+  EXPECT_FALSE(ReadAll(reader, decompressed).ok());
+  EXPECT_FALSE(reader.ok());
+}
+
+}  // namespace
+}  // namespace riegeli
@@ -0,0 +1,246 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/zlib/zlib_checkpoint_index.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/arithmetic.h"
+#include "riegeli/base/assert.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/writer.h"
+#include "riegeli/endian/endian_reading.h"
+#include "riegeli/endian/endian_writing.h"
+#include "zconf.h"
+#include "zlib.h"
+
+namespace riegeli {
+
+// Before C++17 if a constexpr static data member is ODR-used, its definition at
+// namespace scope is required. Since C++17 these definitions are deprecated:
+// http://en.cppreference.com/w/cpp/language/static
+#if __cplusplus < 201703
+constexpr Position ZlibCheckpointIndex::kDefaultInterval;
+#endif
+
+namespace {
+
+// "RZCKPT01" in little endian.
+constexpr uint64_t kMagic = 0x313054504b435a52;
+
+// Windows are never larger than the maximum deflate window.
+constexpr uint32_t kMaxWindowSize = uint32_t{1} << MAX_WBITS;
+
+inline bool CompareUncompressedPos(Position uncompressed_pos,
+                                   const ZlibCheckpoint& checkpoint) {
+  return uncompressed_pos < checkpoint.uncompressed_pos;
+}
+
+}  // namespace
+
+void ZlibCheckpointIndex::Add(ZlibCheckpoint checkpoint) {
+  RIEGELI_ASSERT(enabled())
+      << "Failed precondition of ZlibCheckpointIndex::Add(): "
+         "index disabled";
+  // Even if `interval` is 0, checkpoints must have distinct positions.
+  const Position min_distance = UnsignedMax(repr_->interval, Position{1});
+  absl::MutexLock lock(&repr_->mutex);
+  std::vector<ZlibCheckpoint>& checkpoints = repr_->checkpoints;
+  const std::vector<ZlibCheckpoint>::iterator next =
+      std::upper_bound(checkpoints.begin(), checkpoints.end(),
+                       checkpoint.uncompressed_pos, CompareUncompressedPos);
+  // The beginning of the stream acts as an implicit checkpoint.
+  Position prev_compressed_pos = 0;
+  Position prev_uncompressed_pos = 0;
+  if (next != checkpoints.begin()) {
+    prev_compressed_pos = std::prev(next)->compressed_pos;
+    prev_uncompressed_pos = std::prev(next)->uncompressed_pos;
+  }
+  if (checkpoint.uncompressed_pos - prev_uncompressed_pos < min_distance ||
+      checkpoint.compressed_pos <= prev_compressed_pos) {
+    return;
+  }
+  if (next != checkpoints.end() &&
+      (next->uncompressed_pos - checkpoint.uncompressed_pos < min_distance ||
+       next->compressed_pos <= checkpoint.compressed_pos)) {
+    return;
+  }
+  checkpoints.insert(next, std::move(checkpoint));
+}
+
+absl::optional<ZlibCheckpoint> ZlibCheckpointIndex::Find(
+    Position uncompressed_pos) const {
+  if (repr_ == nullptr) return absl::nullopt;
+  absl::MutexLock lock(&repr_->mutex);
+  const std::vector<ZlibCheckpoint>& checkpoints = repr_->checkpoints;
+  const std::vector<ZlibCheckpoint>::const_iterator next =
+      std::upper_bound(checkpoints.begin(), checkpoints.end(),
+                       uncompressed_pos, CompareUncompressedPos);
+  if (next == checkpoints.begin()) return absl::nullopt;
+  return *std::prev(next);
+}
+
+Position ZlibCheckpointIndex::NextCheckpointPos(
+    Position uncompressed_pos) const {
+  RIEGELI_ASSERT_GT(interval(), 0u)
+      << "Failed precondition of ZlibCheckpointIndex::NextCheckpointPos(): "
+         "checkpoints are not added";
+  const Position interval = repr_->interval;
+  absl::MutexLock lock(&repr_->mutex);
+  const std::vector<ZlibCheckpoint>& checkpoints = repr_->checkpoints;
+  std::vector<ZlibCheckpoint>::const_iterator next =
+      std::upper_bound(checkpoints.begin(), checkpoints.end(),
+                       uncompressed_pos, CompareUncompressedPos);
+  const Position prev_uncompressed_pos =
+      next == checkpoints.begin() ? 0 : std::prev(next)->uncompressed_pos;
+  Position candidate = UnsignedMax(
+      uncompressed_pos, SaturatingAdd(prev_uncompressed_pos, interval));
+  while (next != checkpoints.end() &&
+         next->uncompressed_pos < SaturatingAdd(candidate, interval)) {
+    candidate = UnsignedMax(candidate,
+                            SaturatingAdd(next->uncompressed_pos, interval));
+    ++next;
+  }
+  return candidate;
+}
+
+size_t ZlibCheckpointIndex::size() const {
+  if (repr_ == nullptr) return 0;
+  absl::MutexLock lock(&repr_->mutex);
+  return repr_->checkpoints.size();
+}
+
+std::vector<ZlibCheckpoint> ZlibCheckpointIndex::checkpoints() const {
+  if (repr_ == nullptr) return {};
+  absl::MutexLock lock(&repr_->mutex);
+  return repr_->checkpoints;
+}
+
+bool WriteZlibCheckpointIndex(const ZlibCheckpointIndex& index, Writer& dest) {
+  RIEGELI_ASSERT(index.enabled())
+      << "Failed precondition of WriteZlibCheckpointIndex(): "
+         "index disabled";
+  const std::vector<ZlibCheckpoint> checkpoints = index.checkpoints();
+  if (ABSL_PREDICT_FALSE(
+          !WriteLittleEndian64(kMagic, dest) ||
+          !WriteLittleEndian64(index.interval(), dest) ||
+          !WriteLittleEndian64(IntCast<uint64_t>(checkpoints.size()), dest))) {
+    return false;
+  }
+  std::string compressed;
+  for (const ZlibCheckpoint& checkpoint : checkpoints) {
+    uLongf compressed_size = compressBound(
+        SaturatingIntCast<uLong>(checkpoint.window.size()));
+    compressed.resize(compressed_size);
+    const int zlib_code = compress(
+        reinterpret_cast<Bytef*>(&compressed[0]), &compressed_size,
+        reinterpret_cast<const Bytef*>(checkpoint.window.data()),
+        SaturatingIntCast<uLong>(checkpoint.window.size()));
+    if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+      return dest.Fail(absl::InternalError("compress() failed"));
+    }
+    compressed.resize(compressed_size);
+    if (ABSL_PREDICT_FALSE(
+            !WriteLittleEndian64(checkpoint.compressed_pos, dest) ||
+            !WriteLittleEndian64(checkpoint.uncompressed_pos, dest) ||
+            !dest.WriteByte(IntCast<uint8_t>(checkpoint.bits)) ||
+            !dest.WriteByte(IntCast<uint8_t>(checkpoint.trailer_size)) ||
+            !WriteLittleEndian32(IntCast<uint32_t>(checkpoint.window.size()),
+                                 dest) ||
+            !WriteLittleEndian32(IntCast<uint32_t>(compressed.size()),
+                                 dest) ||
+            !dest.Write(compressed))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadZlibCheckpointIndex(Reader& src, ZlibCheckpointIndex& index) {
+  uint64_t magic, interval, num_checkpoints;
+  if (ABSL_PREDICT_FALSE(!ReadLittleEndian64(src, magic))) return false;
+  if (ABSL_PREDICT_FALSE(magic != kMagic)) {
+    return src.Fail(absl::InvalidArgumentError(
+        "Invalid zlib checkpoint index: wrong magic"));
+  }
+  if (ABSL_PREDICT_FALSE(!ReadLittleEndian64(src, interval) ||
+                         !ReadLittleEndian64(src, num_checkpoints))) {
+    return false;
+  }
+  index = ZlibCheckpointIndex(interval);
+  Position last_compressed_pos = 0;
+  Position last_uncompressed_pos = 0;
+  std::string compressed;
+  for (uint64_t i = 0; i < num_checkpoints; ++i) {
+    ZlibCheckpoint checkpoint;
+    uint8_t bits, trailer_size;
+    uint32_t window_size, compressed_size;
+    if (ABSL_PREDICT_FALSE(
+            !ReadLittleEndian64(src, checkpoint.compressed_pos) ||
+            !ReadLittleEndian64(src, checkpoint.uncompressed_pos) ||
+            !src.ReadByte(bits) || !src.ReadByte(trailer_size) ||
+            !ReadLittleEndian32(src, window_size) ||
+            !ReadLittleEndian32(src, compressed_size))) {
+      return false;
+    }
+    if (ABSL_PREDICT_FALSE(
+            checkpoint.compressed_pos <= last_compressed_pos ||
+            checkpoint.uncompressed_pos <= last_uncompressed_pos)) {
+      return src.Fail(absl::InvalidArgumentError(
+          "Invalid zlib checkpoint index: positions not increasing"));
+    }
+    if (ABSL_PREDICT_FALSE(bits > 7 ||
+                           (trailer_size != 0 && trailer_size != 4 &&
+                            trailer_size != 8) ||
+                           window_size > kMaxWindowSize)) {
+      return src.Fail(absl::InvalidArgumentError(
+          "Invalid zlib checkpoint index: invalid checkpoint"));
+    }
+    if (ABSL_PREDICT_FALSE(!src.Read(compressed_size, compressed))) {
+      return false;
+    }
+    checkpoint.bits = bits;
+    checkpoint.trailer_size = trailer_size;
+    checkpoint.window.resize(window_size);
+    uLongf uncompressed_size = window_size;
+    const int zlib_code =
+        uncompress(reinterpret_cast<Bytef*>(&checkpoint.window[0]),
+                   &uncompressed_size,
+                   reinterpret_cast<const Bytef*>(compressed.data()),
+                   SaturatingIntCast<uLong>(compressed.size()));
+    if (ABSL_PREDICT_FALSE(zlib_code != Z_OK ||
+                           uncompressed_size != window_size)) {
+      return src.Fail(absl::InvalidArgumentError(
+          "Invalid zlib checkpoint index: invalid window"));
+    }
+    last_compressed_pos = checkpoint.compressed_pos;
+    last_uncompressed_pos = checkpoint.uncompressed_pos;
+    index.Add(std::move(checkpoint));
+  }
+  return true;
+}
+
+}  // namespace riegeli
@@ -0,0 +1,164 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RIEGELI_ZLIB_ZLIB_CHECKPOINT_INDEX_H_
+#define RIEGELI_ZLIB_ZLIB_CHECKPOINT_INDEX_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "riegeli/base/types.h"
+
+namespace riegeli {
+
+class Reader;
+class Writer;
+
+// A point in a Zlib or Gzip stream at a deflate block boundary, from which
+// decompression can be resumed without decompressing preceding data.
+//
+// This is the technique of `zran.c` from the zlib distribution: decompression
+// is resumed in raw deflate mode, with the sliding window restored as a
+// dictionary.
+struct ZlibCheckpoint {
+  // Position in the compressed stream, relative to its beginning, of the first
+  // byte not taken by the decompressor yet.
+  Position compressed_pos = 0;
+  // Position in the uncompressed data.
+  Position uncompressed_pos = 0;
+  // Number of bits of the byte before `compressed_pos` which have not been
+  // processed yet, between 0 and 7.
+  int bits = 0;
+  // Size of the trailer of the current stream: 0 for raw deflate, 4 for Zlib,
+  // 8 for Gzip.
+  int trailer_size = 0;
+  // Up to 32 KiB of uncompressed data preceding `uncompressed_pos`.
+  std::string window;
+};
+
+// An index of checkpoints of a Zlib or Gzip stream, which lets `ZlibReader`
+// seek to a far position, or create a `NewReader()` at a far position, by
+// resuming decompression from the closest preceding checkpoint instead of from
+// the beginning of the stream. Ranges of a stream can then also be decompressed
+// in parallel by separate readers.
+//
+// The index can be built by `ZlibReader` during a sequential pass, and saved
+// in a sidecar file with `WriteZlibCheckpointIndex()` and loaded with
+// `ReadZlibCheckpointIndex()`.
+//
+// Checksums are not verified for a stream whose decompression was resumed from
+// a checkpoint.
+//
+// A default-constructed `ZlibCheckpointIndex` is disabled: it has no
+// checkpoints and no checkpoints can be added.
+//
+// Copying a `ZlibCheckpointIndex` object is cheap, sharing the checkpoints.
+// Checkpoints can be added concurrently, e.g. by readers created with
+// `NewReader()`.
+class ZlibCheckpointIndex {
+ public:
+  // The default distance between checkpoints, in uncompressed bytes.
+  static constexpr Position kDefaultInterval = Position{1} << 20;
+
+  // Creates a disabled `ZlibCheckpointIndex`.
+  ZlibCheckpointIndex() = default;
+
+  // Creates an empty `ZlibCheckpointIndex`, to be filled with checkpoints at
+  // least `interval` uncompressed bytes apart.
+  //
+  // If `interval` is 0, `ZlibReader` does not add checkpoints, but uses
+  // checkpoints added with `Add()`.
+  explicit ZlibCheckpointIndex(Position interval);
+
+  ZlibCheckpointIndex(const ZlibCheckpointIndex& that) = default;
+  ZlibCheckpointIndex& operator=(const ZlibCheckpointIndex& that) = default;
+
+  ZlibCheckpointIndex(ZlibCheckpointIndex&& that) = default;
+  ZlibCheckpointIndex& operator=(ZlibCheckpointIndex&& that) = default;
+
+  // Returns `true` if the index can hold checkpoints.
+  bool enabled() const { return repr_ != nullptr; }
+
+  // Returns the minimum distance between checkpoints added by `ZlibReader`, or
+  // 0 if `ZlibReader` does not add checkpoints.
+  Position interval() const;
+
+  // Registers a checkpoint. A checkpoint closer than `interval()` to an
+  // existing checkpoint is ignored.
+  //
+  // Precondition: `enabled()`
+  void Add(ZlibCheckpoint checkpoint);
+
+  // Returns the last checkpoint at or before `uncompressed_pos`, or
+  // `absl::nullopt` if there is none.
+  absl::optional<ZlibCheckpoint> Find(Position uncompressed_pos) const;
+
+  // Returns the smallest position not smaller than `uncompressed_pos` at which
+  // `Add()` would accept a checkpoint.
+  //
+  // Precondition: `interval() > 0`
+  Position NextCheckpointPos(Position uncompressed_pos) const;
+
+  // Returns the number of checkpoints.
+  size_t size() const;
+
+  // Returns a copy of all checkpoints, sorted by position.
+  std::vector<ZlibCheckpoint> checkpoints() const;
+
+ private:
+  struct Repr {
+    explicit Repr(Position interval) : interval(interval) {}
+
+    const Position interval;
+    mutable absl::Mutex mutex;
+    // Sorted by `compressed_pos` and by `uncompressed_pos`.
+    std::vector<ZlibCheckpoint> checkpoints ABSL_GUARDED_BY(mutex);
+  };
+
+  std::shared_ptr<Repr> repr_;
+};
+
+// Writes a `ZlibCheckpointIndex` in a sidecar file format specific to Riegeli.
+// Windows are compressed.
+//
+// Returns `false` on failure, with `dest.status()` explaining the failure.
+//
+// Precondition: `index.enabled()`
+bool WriteZlibCheckpointIndex(const ZlibCheckpointIndex& index, Writer& dest);
+
+// Reads a `ZlibCheckpointIndex` written by `WriteZlibCheckpointIndex()`,
+// replacing `index`.
+//
+// Returns `false` on failure. If `src.ok()`, the index was truncated, otherwise
+// `src.status()` explains the failure.
+bool ReadZlibCheckpointIndex(Reader& src, ZlibCheckpointIndex& index);
+
+// Implementation details follow.
+
+inline ZlibCheckpointIndex::ZlibCheckpointIndex(Position interval)
+    : repr_(std::make_shared<Repr>(interval)) {}
+
+inline Position ZlibCheckpointIndex::interval() const {
+  return repr_ == nullptr ? 0 : repr_->interval;
+}
+
+}  // namespace riegeli
+
+#endif  // RIEGELI_ZLIB_ZLIB_CHECKPOINT_INDEX_H_
@@ -0,0 +1,306 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "riegeli/zlib/zlib_checkpoint_index.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "gtest/gtest.h"
+#include "riegeli/base/types.h"
+#include "riegeli/bytes/read_all.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/zlib/zlib_reader.h"
+#include "riegeli/zlib/zlib_writer.h"
+
+namespace riegeli {
+namespace {
+
+constexpr Position kInterval = 64 << 10;
+
+// Returns moderately compressible data.
+std::string TestData(size_t size) {
+  std::mt19937 random(42);
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    data.push_back(static_cast<char>('a' + random() % 8));
+  }
+  return data;
+}
+
+std::string Compress(absl::string_view data, ZlibWriterBase::Header header) {
+  std::string compressed;
+  ZlibWriter<StringWriter<>> writer(std::forward_as_tuple(&compressed),
+                                    ZlibWriterBase::Options().set_header(
+                                        header));
+  EXPECT_TRUE(writer.Write(data)) << writer.status();
+  EXPECT_TRUE(writer.Close()) << writer.status();
+  return compressed;
+}
+
+ZlibReaderBase::Header ReaderHeader(ZlibWriterBase::Header header) {
+  return header == ZlibWriterBase::Header::kRaw
+             ? ZlibReaderBase::Header::kRaw
+             : ZlibReaderBase::Header::kZlibOrGzip;
+}
+
+// Decompresses `compressed` sequentially, filling the index from `options`.
+void BuildIndex(absl::string_view compressed, ZlibReaderBase::Options options,
+                absl::string_view expected) {
+  ZlibReader<StringReader<>> reader(std::forward_as_tuple(compressed),
+                                    std::move(options));
+  std::string decompressed;
+  EXPECT_TRUE(ReadAll(reader, decompressed).ok()) << reader.status();
+  EXPECT_TRUE(reader.Close()) << reader.status();
+  EXPECT_EQ(decompressed, expected);
+}
+
+// Returns `length` bytes read from `reader` at `pos`.
+std::string ReadAt(Reader& reader, Position pos, size_t length) {
+  std::string piece;
+  EXPECT_TRUE(reader.Seek(pos)) << reader.status();
+  EXPECT_TRUE(reader.Read(length, piece)) << reader.status();
+  return piece;
+}
+
+class ZlibCheckpointIndexTest
+    : public testing::TestWithParam<ZlibWriterBase::Header> {};
+
+TEST_P(ZlibCheckpointIndexTest, SequentialReadAddsCheckpoints) {
+  const std::string data = TestData(1 << 20);
+  const std::string compressed = Compress(data, GetParam());
+  const ZlibCheckpointIndex index(kInterval);
+  BuildIndex(compressed,
+             ZlibReaderBase::Options()
+                 .set_header(ReaderHeader(GetParam()))
+                 .set_checkpoint_index(index),
+             data);
+  EXPECT_GE(index.size(), 2u);
+  const std::vector<ZlibCheckpoint> checkpoints = index.checkpoints();
+  for (size_t i = 0; i < checkpoints.size(); ++i) {
+    const ZlibCheckpoint& checkpoint = checkpoints[i];
+    EXPECT_LE(checkpoint.window.size(), size_t{32} << 10);
+    EXPECT_EQ(checkpoint.window,
+              absl::string_view(data).substr(
+                  checkpoint.uncompressed_pos - checkpoint.window.size(),
+                  checkpoint.window.size()));
+    if (i > 0) {
+      EXPECT_GE(checkpoint.uncompressed_pos,
+                checkpoints[i - 1].uncompressed_pos + kInterval);
+      EXPECT_GT(checkpoint.compressed_pos, checkpoints[i - 1].compressed_pos);
+    }
+  }
+}
+
+TEST_P(ZlibCheckpointIndexTest, SeekResumesFromCheckpoint) {
+  const std::string data = TestData(1 << 20);
+  std::string compressed = Compress(data, GetParam());
+  const ZlibCheckpointIndex index(kInterval);
+  BuildIndex(compressed,
+             ZlibReaderBase::Options()
+                 .set_header(ReaderHeader(GetParam()))
+                 .set_checkpoint_index(index),
+             data);
+  const absl::optional<ZlibCheckpoint> checkpoint =
+      index.Find(data.size() / 2);
+  ASSERT_NE(checkpoint, absl::nullopt);
+  // Compressed data before the checkpoint are not needed to resume from it.
+  // Keep the header, which is read when the reader is created.
+  for (size_t i = 32; i + 1 < checkpoint->compressed_pos; ++i) {
+    compressed[i] = '\0';
+  }
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options()
+          .set_header(ReaderHeader(GetParam()))
+          .set_checkpoint_index(index));
+  std::mt19937 random(1);
+  for (int i = 0; i < 100; ++i) {
+    const Position pos =
+        checkpoint->uncompressed_pos +
+        random() % (data.size() - checkpoint->uncompressed_pos);
+    const size_t length = std::min(size_t{1000}, data.size() - pos);
+    EXPECT_EQ(ReadAt(reader, pos, length),
+              absl::string_view(data).substr(pos, length))
+        << "At " << pos;
+  }
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST_P(ZlibCheckpointIndexTest, NewReaderResumesFromCheckpoint) {
+  const std::string data = TestData(1 << 20);
+  const std::string compressed = Compress(data, GetParam());
+  const ZlibCheckpointIndex index(kInterval);
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options()
+          .set_header(ReaderHeader(GetParam()))
+          .set_checkpoint_index(index));
+  ASSERT_TRUE(reader.SupportsNewReader());
+  // Readers created before the index is filled decompress from the beginning.
+  // Reading to the end fills the index, then readers resume from checkpoints.
+  for (const bool filled : {false, true}) {
+    if (filled) {
+      ASSERT_TRUE(reader.Seek(data.size())) << reader.status();
+      ASSERT_GT(index.size(), 1u);
+    }
+    for (const Position pos : {Position{0}, Position{kInterval + 1},
+                               Position{data.size() / 2},
+                               Position{data.size() - 10}}) {
+      const std::unique_ptr<Reader> new_reader = reader.NewReader(pos);
+      ASSERT_NE(new_reader, nullptr) << reader.status();
+      std::string piece;
+      const size_t length = std::min(size_t{5000}, data.size() - pos);
+      ASSERT_TRUE(new_reader->Read(length, piece)) << new_reader->status();
+      EXPECT_EQ(piece, absl::string_view(data).substr(pos, length))
+          << "At " << pos;
+      EXPECT_TRUE(new_reader->Close()) << new_reader->status();
+    }
+  }
+  EXPECT_TRUE(reader.Close()) << reader.status();
+}
+
+TEST_P(ZlibCheckpointIndexTest, SidecarRoundTrip) {
+  const std::string data = TestData(1 << 20);
+  const std::string compressed = Compress(data, GetParam());
+  const ZlibCheckpointIndex index(kInterval);
+  BuildIndex(compressed,
+             ZlibReaderBase::Options()
+                 .set_header(ReaderHeader(GetParam()))
+                 .set_checkpoint_index(index),
+             data);
+
+  std::string sidecar;
+  StringWriter<> sidecar_writer(&sidecar);
+  ASSERT_TRUE(WriteZlibCheckpointIndex(index, sidecar_writer))
+      << sidecar_writer.status();
+  ASSERT_TRUE(sidecar_writer.Close()) << sidecar_writer.status();
+  StringReader<> sidecar_reader(sidecar);
+  ZlibCheckpointIndex loaded;
+  ASSERT_TRUE(ReadZlibCheckpointIndex(sidecar_reader, loaded))
+      << sidecar_reader.status();
+  EXPECT_TRUE(sidecar_reader.VerifyEndAndClose()) << sidecar_reader.status();
+
+  ASSERT_TRUE(loaded.enabled());
+  EXPECT_EQ(loaded.interval(), index.interval());
+  const std::vector<ZlibCheckpoint> expected = index.checkpoints();
+  const std::vector<ZlibCheckpoint> actual = loaded.checkpoints();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].compressed_pos, expected[i].compressed_pos);
+    EXPECT_EQ(actual[i].uncompressed_pos, expected[i].uncompressed_pos);
+    EXPECT_EQ(actual[i].bits, expected[i].bits);
+    EXPECT_EQ(actual[i].trailer_size, expected[i].trailer_size);
+    EXPECT_EQ(actual[i].window, expected[i].window);
+  }
+
+  // A fresh reader with the loaded index seeks near the end.
+  ZlibReader<StringReader<>> reader(
+      std::forward_as_tuple(compressed),
+      ZlibReaderBase::Options()
+          .set_header(ReaderHeader(GetParam()))
+          .set_checkpoint_index(loaded));
+  const Position pos = data.size() - 3000;
+  EXPECT_EQ(ReadAt(reader, pos, 3000), absl::string_view(data).substr(pos));
+  EXPECT_TRUE(reader.VerifyEndAndClose()) << reader.status();
+}
+
+INSTANTIATE_TEST_SUITE_P(Headers, ZlibCheckpointIndexTest,
+                         testing::Values(ZlibWriterBase::Header::kZlib,
+                                         ZlibWriterBase::Header::kGzip,
+                                         ZlibWriterBase::Header::kRaw));
+
+TEST(ZlibCheckpointIndexTest, ConcatenatedStreams) {
+  const std::string data = TestData(600000);
+  const absl::string_view first = absl::string_view(data).substr(0, 250000);
+  const absl::string_view second = absl::string_view(data).substr(250000);
+  const std::string compressed =
+      Compress(first, ZlibWriterBase::Header::kGzip) +
+      Compress(second, ZlibWriterBase::Header::kGzip);
+  const ZlibCheckpointIndex index(kInterval);
+  const ZlibReaderBase::Options options = ZlibReaderBase::Options()
+                                              .set_header(
+                                                  ZlibReaderBase::Header::kGzip)
+                                              .set_concatenate(true)
+                                              .set_checkpoint_index(index);
+  BuildIndex(compressed, options, data);
+  ASSERT_NE(index.Find(data.size() - 1), absl::nullopt);
+  ASSERT_GT(index.Find(data.size() - 1)->uncompressed_pos, first.size());
+
+  ZlibReader<StringReader<>> reader(std::forward_as_tuple(compressed),
+                                    options);
+  // Resume in the first stream and read across the boundary, then resume in
+  // the second stream and read to the end.
+  const Position pos = first.size() - 10000;
+  EXPECT_EQ(ReadAt(reader, pos, 20000),
+            absl::string_view(data).substr(pos, 20000));
+  const Position last_pos = data.size() - 5000;
+  EXPECT_EQ(ReadAt(reader, last_pos, 5000),
+            absl::string_view(data).substr(last_pos));
+  EXPECT_TRUE(reader.VerifyEndAndClose()) << reader.status();
+}
+
+TEST(ZlibCheckpointIndexTest, InvalidSidecar) {
+  ZlibCheckpointIndex index;
+  StringReader<> invalid_reader("Not a checkpoint index");
+  EXPECT_FALSE(ReadZlibCheckpointIndex(invalid_reader, index));
+  EXPECT_TRUE(absl::IsInvalidArgument(invalid_reader.status()))
+      << invalid_reader.status();
+
+  std::string sidecar;
+  StringWriter<> sidecar_writer(&sidecar);
+  ASSERT_TRUE(
+      WriteZlibCheckpointIndex(ZlibCheckpointIndex(kInterval), sidecar_writer))
+      << sidecar_writer.status();
+  ASSERT_TRUE(sidecar_writer.Close()) << sidecar_writer.status();
+  StringReader<> truncated_reader(
+      absl::string_view(sidecar).substr(0, sidecar.size() - 1));
+  EXPECT_FALSE(ReadZlibCheckpointIndex(truncated_reader, index));
+  EXPECT_TRUE(truncated_reader.ok()) << truncated_reader.status();
+}
+
+TEST(ZlibCheckpointIndexTest, AddIgnoresCloseCheckpoints) {
+  ZlibCheckpointIndex index(100);
+  ZlibCheckpoint checkpoint;
+  checkpoint.compressed_pos = 10;
+  checkpoint.uncompressed_pos = 1000;
+  index.Add(checkpoint);
+  checkpoint.compressed_pos = 15;
+  checkpoint.uncompressed_pos = 1050;
+  index.Add(checkpoint);
+  checkpoint.compressed_pos = 20;
+  checkpoint.uncompressed_pos = 1100;
+  index.Add(checkpoint);
+  EXPECT_EQ(index.size(), 2u);
+  EXPECT_EQ(index.Find(999), absl::nullopt);
+  EXPECT_EQ(index.Find(1099)->uncompressed_pos, 1000u);
+  EXPECT_EQ(index.Find(5000)->uncompressed_pos, 1100u);
+  EXPECT_EQ(index.NextCheckpointPos(1000), 1200u);
+}
+
+}  // namespace
+}  // namespace riegeli
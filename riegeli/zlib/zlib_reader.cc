@@ -17,6 +17,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <cstring>
+#include <functional>
+#include <future>
 #include <limits>
 #include <memory>
 #include <string>
@@ -30,12 +33,15 @@
 #include "absl/types/optional.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/recycling_pool.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffered_reader.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/endian/endian_reading.h"
+#include "riegeli/zlib/bgzf.h"
+#include "riegeli/zlib/zlib_checkpoint_index.h"
 #include "zconf.h"
 #include "zlib.h"
 
@@ -70,14 +76,18 @@ void ZlibReaderBase::Initialize(Reader* src) {
     return;
   }
   initial_compressed_pos_ = src->pos();
-  InitializeDecompressor();
+  if (blocked_) return;
+  if (checkpoint_index_.interval() > 0) {
+    next_checkpoint_pos_ = checkpoint_index_.NextCheckpointPos(0);
+  }
+  InitializeDecompressor(window_bits_);
 }
 
-inline void ZlibReaderBase::InitializeDecompressor() {
+inline void ZlibReaderBase::InitializeDecompressor(int window_bits) {
   decompressor_ = RecyclingPool<z_stream, ZStreamDeleter>::global().Get(
       [&] {
         std::unique_ptr<z_stream, ZStreamDeleter> ptr(new z_stream());
-        const int zlib_code = inflateInit2(ptr.get(), window_bits_);
+        const int zlib_code = inflateInit2(ptr.get(), window_bits);
         if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
           FailOperation(absl::StatusCode::kInternal, "inflateInit2()",
                         zlib_code);
@@ -85,7 +95,7 @@ inline void ZlibReaderBase::InitializeDecompressor() {
         return ptr;
       },
       [&](z_stream* ptr) {
-        const int zlib_code = inflateReset2(ptr, window_bits_);
+        const int zlib_code = inflateReset2(ptr, window_bits);
         if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
           FailOperation(absl::StatusCode::kInternal, "inflateReset2()",
                         zlib_code);
@@ -102,6 +112,8 @@ void ZlibReaderBase::Done() {
   BufferedReader::Done();
   decompressor_.reset();
   dictionary_ = ZlibDictionary();
+  block_ = std::string();
+  pending_blocks_.clear();
 }
 
 inline bool ZlibReaderBase::FailOperation(absl::StatusCode code,
@@ -114,7 +126,8 @@ inline bool ZlibReaderBase::FailOperation(absl::StatusCode code,
       << "Failed precondition of ZlibReaderBase::FailOperation(): "
          "Object closed";
   std::string message = absl::StrCat(operation, " failed");
-  const char* details = decompressor_->msg;
+  const char* details =
+      decompressor_ == nullptr ? nullptr : decompressor_->msg;
   if (details == nullptr) {
     switch (zlib_code) {
       case Z_STREAM_END:
@@ -174,7 +187,7 @@ bool ZlibReaderBase::PullSlow(size_t min_length, size_t recommended_length) {
          "enough data available, use Pull() instead";
   // After all data have been decompressed, skip `BufferedReader::PullSlow()`
   // to avoid allocating the buffer in case it was not allocated yet.
-  if (ABSL_PREDICT_FALSE(decompressor_ == nullptr)) return false;
+  if (ABSL_PREDICT_FALSE(!blocked_ && decompressor_ == nullptr)) return false;
   return BufferedReader::PullSlow(min_length, recommended_length);
 }
 
@@ -188,6 +201,7 @@ bool ZlibReaderBase::ReadInternal(size_t min_length, size_t max_length,
          "max_length < min_length";
   RIEGELI_ASSERT(ok())
       << "Failed precondition of BufferedReader::ReadInternal(): " << status();
+  if (blocked_) return ReadBlocked(min_length, max_length, dest);
   if (ABSL_PREDICT_FALSE(decompressor_ == nullptr)) return false;
   Reader& src = *SrcReader();
   truncated_ = false;
@@ -200,11 +214,32 @@ bool ZlibReaderBase::ReadInternal(size_t min_length, size_t max_length,
     decompressor_->next_in = const_cast<z_const Bytef*>(
         reinterpret_cast<const Bytef*>(src.cursor()));
     decompressor_->avail_in = SaturatingIntCast<uInt>(src.available());
-    if (decompressor_->avail_in > 0) stream_had_data_ = true;
-    int zlib_code = inflate(decompressor_.get(), Z_NO_FLUSH);
+    if (decompressor_->avail_in > 0 && !stream_had_data_) {
+      stream_had_data_ = true;
+      trailer_size_ = TrailerSize(*src.cursor());
+    }
+    // `Z_BLOCK` stops at a deflate block boundary, where a checkpoint can be
+    // added.
+    int flush = Z_NO_FLUSH;
+    if (checkpoint_index_.interval() > 0 &&
+        limit_pos() + PtrDistance(dest, reinterpret_cast<char*>(
+                                            decompressor_->next_out)) >=
+            next_checkpoint_pos_) {
+      flush = Z_BLOCK;
+    }
+    int zlib_code = inflate(decompressor_.get(), flush);
     src.set_cursor(reinterpret_cast<const char*>(decompressor_->next_in));
     const size_t length_read =
         PtrDistance(dest, reinterpret_cast<char*>(decompressor_->next_out));
+    if (flush == Z_BLOCK && zlib_code == Z_OK &&
+        (decompressor_->data_type & 128) != 0) {
+      // Stopped at a deflate block boundary. The end of the last block is
+      // not useful as a checkpoint.
+      if ((decompressor_->data_type & 64) == 0) {
+        AddCheckpoint(limit_pos() + length_read);
+      }
+      if (length_read < min_length) continue;
+    }
     switch (zlib_code) {
       case Z_OK:
         if (length_read >= min_length) break;
@@ -235,8 +270,23 @@ bool ZlibReaderBase::ReadInternal(size_t min_length, size_t max_length,
         }
         continue;
       case Z_STREAM_END:
+        if (resumed_) {
+          // In raw deflate mode `inflate()` does not process the trailer.
+          if (ABSL_PREDICT_FALSE(!src.Pull(IntCast<size_t>(trailer_size_)))) {
+            move_limit_pos(length_read);
+            if (ABSL_PREDICT_FALSE(!src.ok())) {
+              return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+            }
+            truncated_ = true;
+            return false;
+          }
+          src.move_cursor(IntCast<size_t>(trailer_size_));
+        }
         if (concatenate_) {
-          const int zlib_code = inflateReset(decompressor_.get());
+          const int zlib_code =
+              resumed_ ? inflateReset2(decompressor_.get(), window_bits_)
+                       : inflateReset(decompressor_.get());
+          resumed_ = false;
           if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
             FailOperation(absl::StatusCode::kInternal, "inflateReset()",
                           zlib_code);
@@ -246,6 +296,7 @@ bool ZlibReaderBase::ReadInternal(size_t min_length, size_t max_length,
           if (length_read >= min_length) break;
           continue;
         }
+        resumed_ = false;
         decompressor_.reset();
         break;
       case Z_NEED_DICT:
@@ -276,6 +327,233 @@ bool ZlibReaderBase::ReadInternal(size_t min_length, size_t max_length,
   }
 }
 
+inline int ZlibReaderBase::TrailerSize(char first_byte) const {
+  if (window_bits_ < 0) return 0;
+  if (window_bits_ >= static_cast<int>(Header::kZlibOrGzip)) {
+    // A Zlib header cannot begin with the first byte of the Gzip magic.
+    return first_byte == '\x1f' ? 8 : 4;
+  }
+  return window_bits_ >= static_cast<int>(Header::kGzip) ? 8 : 4;
+}
+
+void ZlibReaderBase::AddCheckpoint(Position uncompressed_pos) {
+  Reader& src = *SrcReader();
+  ZlibCheckpoint checkpoint;
+  checkpoint.compressed_pos = src.pos() - initial_compressed_pos_;
+  checkpoint.uncompressed_pos = uncompressed_pos;
+  checkpoint.bits = decompressor_->data_type & 7;
+  checkpoint.trailer_size = trailer_size_;
+  checkpoint.window.resize(size_t{1} << Options::kMaxWindowLog);
+  uInt window_size = 0;
+  const int zlib_code = inflateGetDictionary(
+      decompressor_.get(), reinterpret_cast<Bytef*>(&checkpoint.window[0]),
+      &window_size);
+  if (ABSL_PREDICT_TRUE(zlib_code == Z_OK)) {
+    checkpoint.window.resize(window_size);
+    checkpoint_index_.Add(std::move(checkpoint));
+  }
+  next_checkpoint_pos_ = checkpoint_index_.NextCheckpointPos(
+      SaturatingAdd(uncompressed_pos, Position{1}));
+}
+
+bool ZlibReaderBase::ResumeFromCheckpoint(const ZlibCheckpoint& checkpoint) {
+  Reader& src = *SrcReader();
+  truncated_ = false;
+  set_buffer();
+  set_limit_pos(checkpoint.uncompressed_pos);
+  decompressor_.reset();
+  // If `checkpoint.bits > 0`, the preceding byte is partially processed.
+  if (ABSL_PREDICT_FALSE(
+          !src.Seek(initial_compressed_pos_ + checkpoint.compressed_pos -
+                    (checkpoint.bits > 0 ? 1 : 0)))) {
+    return FailWithoutAnnotation(AnnotateOverSrc(src.StatusOrAnnotate(
+        absl::DataLossError("Zlib-compressed stream got truncated"))));
+  }
+  InitializeDecompressor(
+      -(window_bits_ < 0 ? -window_bits_ : window_bits_ & 15));
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  if (checkpoint.bits > 0) {
+    uint8_t byte;
+    if (ABSL_PREDICT_FALSE(!src.ReadByte(byte))) {
+      return FailWithoutAnnotation(AnnotateOverSrc(src.StatusOrAnnotate(
+          absl::DataLossError("Zlib-compressed stream got truncated"))));
+    }
+    const int zlib_code = inflatePrime(decompressor_.get(), checkpoint.bits,
+                                       byte >> (8 - checkpoint.bits));
+    if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+      return FailOperation(absl::StatusCode::kInternal, "inflatePrime()",
+                           zlib_code);
+    }
+  }
+  if (!checkpoint.window.empty()) {
+    const int zlib_code = inflateSetDictionary(
+        decompressor_.get(),
+        reinterpret_cast<const Bytef*>(checkpoint.window.data()),
+        SaturatingIntCast<uInt>(checkpoint.window.size()));
+    if (ABSL_PREDICT_FALSE(zlib_code != Z_OK)) {
+      return FailOperation(absl::StatusCode::kInvalidArgument,
+                           "inflateSetDictionary()", zlib_code);
+    }
+  }
+  stream_had_data_ = true;
+  trailer_size_ = checkpoint.trailer_size;
+  resumed_ = true;
+  if (checkpoint_index_.interval() > 0) {
+    next_checkpoint_pos_ =
+        checkpoint_index_.NextCheckpointPos(checkpoint.uncompressed_pos);
+  }
+  return true;
+}
+
+bool ZlibReaderBase::ReadBlocked(size_t min_length, size_t max_length,
+                                 char* dest) {
+  size_t length_read = 0;
+  for (;;) {
+    RIEGELI_ASSERT_GE(limit_pos(), block_pos_)
+        << "Failed invariant of ZlibReaderBase: "
+           "current position before the current block";
+    const size_t block_offset = IntCast<size_t>(limit_pos() - block_pos_);
+    RIEGELI_ASSERT_LE(block_offset, block_.size())
+        << "Failed invariant of ZlibReaderBase: "
+           "current position after the current block";
+    const size_t length = UnsignedMin(block_.size() - block_offset,
+                                      max_length - length_read);
+    if (length > 0) {
+      std::memcpy(dest + length_read, block_.data() + block_offset, length);
+      length_read += length;
+      move_limit_pos(length);
+      if (length_read >= min_length) return true;
+    }
+    if (ABSL_PREDICT_FALSE(!NextBlock())) return false;
+  }
+}
+
+inline bool ZlibReaderBase::NextBlock() {
+  truncated_ = false;
+  if (parallelism_ == 0) {
+    std::string compressed;
+    if (ABSL_PREDICT_FALSE(!ReadCompressedBlock(compressed))) return false;
+    block_pos_ += block_.size();
+    absl::Status status =
+        bgzf_internal::DecompressBlock(compressed, block_);
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      block_.clear();
+      return Fail(std::move(status));
+    }
+    return true;
+  }
+  while (pending_blocks_.size() < IntCast<size_t>(parallelism_)) {
+    std::string compressed;
+    if (!ReadCompressedBlock(compressed)) {
+      if (ABSL_PREDICT_FALSE(!ok())) return false;
+      break;
+    }
+    std::promise<DecompressedBlock>* const block_promise =
+        new std::promise<DecompressedBlock>();
+    pending_blocks_.push_back(block_promise->get_future());
+    Executor& executor = executor_ != nullptr ? *executor_ : Executor::global();
+    executor.Schedule(
+        [block_promise, compressed = std::move(compressed)] {
+          DecompressedBlock block;
+          block.status = bgzf_internal::DecompressBlock(compressed, block.data);
+          block_promise->set_value(std::move(block));
+          delete block_promise;
+        });
+  }
+  if (pending_blocks_.empty()) return false;
+  // The source might be truncated only after all pending blocks.
+  truncated_ = false;
+  DecompressedBlock block = pending_blocks_.front().get();
+  pending_blocks_.pop_front();
+  block_pos_ += block_.size();
+  if (ABSL_PREDICT_FALSE(!block.status.ok())) {
+    block_.clear();
+    return Fail(std::move(block.status));
+  }
+  block_ = std::move(block.data);
+  return true;
+}
+
+inline bool ZlibReaderBase::ReadCompressedBlock(std::string& compressed) {
+  Reader& src = *SrcReader();
+  size_t block_size;
+  {
+    absl::Status status = bgzf_internal::ReadBlockSize(src, block_size);
+    if (ABSL_PREDICT_FALSE(!status.ok())) {
+      if (absl::IsOutOfRange(status)) return false;
+      if (ABSL_PREDICT_FALSE(!src.ok())) {
+        return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+      }
+      if (absl::IsDataLoss(status)) {
+        truncated_ = true;
+        return false;
+      }
+      return Fail(std::move(status));
+    }
+  }
+  if (ABSL_PREDICT_FALSE(!src.Pull(block_size))) {
+    if (ABSL_PREDICT_FALSE(!src.ok())) {
+      return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+    }
+    truncated_ = true;
+    return false;
+  }
+  block_index_.Add(BgzfBlockPosition{src.pos() - initial_compressed_pos_,
+                                     next_block_pos_});
+  src.Read(block_size, compressed);
+  next_block_pos_ += bgzf_internal::UncompressedBlockSize(compressed);
+  return true;
+}
+
+bool ZlibReaderBase::SeekBlocked(Position new_pos) {
+  if (ABSL_PREDICT_FALSE(!ok())) return false;
+  if (new_pos >= block_pos_ && new_pos - block_pos_ <= block_.size()) {
+    // Seeking inside the current block.
+    set_limit_pos(new_pos);
+    return true;
+  }
+  Reader& src = *SrcReader();
+  if (new_pos < limit_pos() || src.SupportsRandomAccess()) {
+    // Restart from the closest known block.
+    truncated_ = false;
+    pending_blocks_.clear();
+    block_.clear();
+    const BgzfBlockPosition block = block_index_.Find(new_pos);
+    if (ABSL_PREDICT_FALSE(
+            !src.Seek(initial_compressed_pos_ + block.compressed_pos))) {
+      return FailWithoutAnnotation(AnnotateOverSrc(src.StatusOrAnnotate(
+          absl::DataLossError("Zlib-compressed stream got truncated"))));
+    }
+    next_block_pos_ = block.uncompressed_pos;
+    if (src.SupportsRandomAccess()) {
+      // Skip blocks which end before `new_pos` without decompressing them,
+      // reading only their headers and footers.
+      for (;;) {
+        const Position block_begin = src.pos();
+        size_t block_size;
+        uint32_t uncompressed_size;
+        if (!bgzf_internal::ReadBlockSize(src, block_size).ok() ||
+            !src.Seek(block_begin + block_size - sizeof(uint32_t)) ||
+            !ReadLittleEndian32(src, uncompressed_size) ||
+            next_block_pos_ + uncompressed_size > new_pos) {
+          // Let `ReadBlocked()` handle this block, including errors.
+          if (ABSL_PREDICT_FALSE(!src.Seek(block_begin))) {
+            return FailWithoutAnnotation(AnnotateOverSrc(src.status()));
+          }
+          break;
+        }
+        block_index_.Add(BgzfBlockPosition{
+            block_begin - initial_compressed_pos_, next_block_pos_});
+        next_block_pos_ += uncompressed_size;
+      }
+    }
+    block_pos_ = next_block_pos_;
+    set_limit_pos(next_block_pos_);
+    if (new_pos == limit_pos()) return true;
+  }
+  return BufferedReader::SeekBehindBuffer(new_pos);
+}
+
 bool ZlibReaderBase::ToleratesReadingAhead() {
   Reader* const src = SrcReader();
   return src != nullptr && src->ToleratesReadingAhead();
@@ -293,12 +571,28 @@ bool ZlibReaderBase::SeekBehindBuffer(Position new_pos) {
   RIEGELI_ASSERT_EQ(start_to_limit(), 0u)
       << "Failed precondition of BufferedReader::SeekBehindBuffer(): "
          "buffer not empty";
+  if (blocked_) return SeekBlocked(new_pos);
+  if (checkpoint_index_.enabled()) {
+    if (ABSL_PREDICT_FALSE(!ok())) return false;
+    const absl::optional<ZlibCheckpoint> checkpoint =
+        checkpoint_index_.Find(new_pos);
+    if (checkpoint != absl::nullopt &&
+        (new_pos <= limit_pos() ||
+         checkpoint->uncompressed_pos > limit_pos())) {
+      // Resume from the closest preceding checkpoint instead of decompressing
+      // from the beginning or from the current position.
+      if (ABSL_PREDICT_FALSE(!ResumeFromCheckpoint(*checkpoint))) return false;
+      if (new_pos == limit_pos()) return true;
+      return BufferedReader::SeekBehindBuffer(new_pos);
+    }
+  }
   if (new_pos <= limit_pos()) {
     // Seeking backwards.
     if (ABSL_PREDICT_FALSE(!ok())) return false;
     Reader& src = *SrcReader();
     truncated_ = false;
     stream_had_data_ = false;
+    resumed_ = false;
     set_buffer();
     set_limit_pos(0);
     decompressor_.reset();
@@ -306,7 +600,10 @@ bool ZlibReaderBase::SeekBehindBuffer(Position new_pos) {
       return FailWithoutAnnotation(AnnotateOverSrc(src.StatusOrAnnotate(
           absl::DataLossError("Zlib-compressed stream got truncated"))));
     }
-    InitializeDecompressor();
+    if (checkpoint_index_.interval() > 0) {
+      next_checkpoint_pos_ = checkpoint_index_.NextCheckpointPos(0);
+    }
+    InitializeDecompressor(window_bits_);
     if (ABSL_PREDICT_FALSE(!ok())) return false;
     if (new_pos == 0) return true;
   }
@@ -340,6 +637,11 @@ std::unique_ptr<Reader> ZlibReaderBase::NewReaderImpl(Position initial_pos) {
                               : static_cast<Header>(window_bits_ & ~15))
               .set_dictionary(dictionary_)
               .set_concatenate(concatenate_)
+              .set_blocked(blocked_)
+              .set_parallelism(parallelism_)
+              .set_executor(executor_)
+              .set_block_index(block_index_)
+              .set_checkpoint_index(checkpoint_index_)
               .set_buffer_options(buffer_options()));
   reader->Seek(initial_pos);
   return reader;
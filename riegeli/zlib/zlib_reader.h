@@ -18,7 +18,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <deque>
+#include <future>
 #include <memory>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -30,12 +33,15 @@
 #include "absl/types/optional.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/dependency.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/recycling_pool.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/buffered_reader.h"
 #include "riegeli/bytes/reader.h"
+#include "riegeli/zlib/bgzf.h"
+#include "riegeli/zlib/zlib_checkpoint_index.h"
 #include "riegeli/zlib/zlib_dictionary.h"
 
 struct z_stream_s;  // `zlib.h` has `typedef struct z_stream_s z_stream`.
@@ -136,11 +142,125 @@ class ZlibReaderBase : public BufferedReader {
     }
     bool concatenate() const { return concatenate_; }
 
+    // If `true`, the compressed stream is expected to be in the blocked Gzip
+    // format (BGZF), as written by `ZlibWriter` with `set_blocked(true)` or by
+    // `bgzip`. Block sizes recorded in block headers are used for efficient
+    // `Seek()` and `NewReader()`, and blocks can be decompressed in parallel.
+    // See `bgzf.h`.
+    //
+    // If `blocked()` is `true`, `header()`, `window_log()`, `dictionary()`, and
+    // `concatenate()` are ignored.
+    //
+    // Default: `false`.
+    Options& set_blocked(bool blocked) & {
+      blocked_ = blocked;
+      return *this;
+    }
+    Options&& set_blocked(bool blocked) && {
+      return std::move(set_blocked(blocked));
+    }
+    bool blocked() const { return blocked_; }
+
+    // Maximum number of blocks being decompressed ahead in background, if
+    // `blocked()` is `true`.
+    //
+    // If `parallelism()` is 0, blocks are decompressed in the calling thread
+    // when needed.
+    //
+    // Default: 0.
+    Options& set_parallelism(int parallelism) & {
+      RIEGELI_ASSERT_GE(parallelism, 0)
+          << "Failed precondition of "
+             "ZlibReaderBase::Options::set_parallelism(): "
+             "negative parallelism";
+      parallelism_ = parallelism;
+      return *this;
+    }
+    Options&& set_parallelism(int parallelism) && {
+      return std::move(set_parallelism(parallelism));
+    }
+    int parallelism() const { return parallelism_; }
+
+    // `Executor` which decompresses blocks in background if `blocked()` is
+    // `true` and `parallelism() > 0`. It is not owned and must outlive the
+    // `ZlibReader` and readers returned by `NewReader()`.
+    //
+    // `nullptr` means `Executor::global()`.
+    //
+    // Default: `nullptr`.
+    Options& set_executor(Executor* executor) & {
+      executor_ = executor;
+      return *this;
+    }
+    Options&& set_executor(Executor* executor) && {
+      return std::move(set_executor(executor));
+    }
+    Executor* executor() const { return executor_; }
+
+    // Known positions of blocks, if `blocked()` is `true`, e.g. returned by
+    // `ZlibWriterBase::block_index()` or by `ReadGziIndex()`. This speeds up
+    // `Seek()` to a far position. Blocks which are not indexed are found by
+    // walking over block headers.
+    //
+    // Default: `BgzfIndex()`.
+    Options& set_block_index(const BgzfIndex& block_index) & {
+      block_index_ = block_index;
+      return *this;
+    }
+    Options& set_block_index(BgzfIndex&& block_index) & {
+      block_index_ = std::move(block_index);
+      return *this;
+    }
+    Options&& set_block_index(const BgzfIndex& block_index) && {
+      return std::move(set_block_index(block_index));
+    }
+    Options&& set_block_index(BgzfIndex&& block_index) && {
+      return std::move(set_block_index(std::move(block_index)));
+    }
+    BgzfIndex& block_index() { return block_index_; }
+    const BgzfIndex& block_index() const { return block_index_; }
+
+    // Checkpoints of a stream which is not blocked, e.g. built by a previous
+    // `ZlibReader` or by `ReadZlibCheckpointIndex()`. `Seek()` and
+    // `NewReader()` resume decompression from the closest preceding
+    // checkpoint. If `checkpoint_index().interval() > 0`, checkpoints
+    // encountered while reading are added to the index, which is shared with
+    // the caller and with readers created by `NewReader()`.
+    //
+    // If `blocked()` is `true`, `checkpoint_index()` is ignored.
+    //
+    // Default: `ZlibCheckpointIndex()` (disabled).
+    Options& set_checkpoint_index(
+        const ZlibCheckpointIndex& checkpoint_index) & {
+      checkpoint_index_ = checkpoint_index;
+      return *this;
+    }
+    Options& set_checkpoint_index(ZlibCheckpointIndex&& checkpoint_index) & {
+      checkpoint_index_ = std::move(checkpoint_index);
+      return *this;
+    }
+    Options&& set_checkpoint_index(
+        const ZlibCheckpointIndex& checkpoint_index) && {
+      return std::move(set_checkpoint_index(checkpoint_index));
+    }
+    Options&& set_checkpoint_index(ZlibCheckpointIndex&& checkpoint_index) && {
+      return std::move(set_checkpoint_index(std::move(checkpoint_index)));
+    }
+    ZlibCheckpointIndex& checkpoint_index() { return checkpoint_index_; }
+    const ZlibCheckpointIndex& checkpoint_index() const {
+      return checkpoint_index_;
+    }
+
    private:
     int window_log_ = kDefaultWindowLog;
     Header header_ = kDefaultHeader;
     ZlibDictionary dictionary_;
     bool concatenate_ = false;
+    bool blocked_ = false;
+    int parallelism_ = 0;
+    Executor* executor_ = nullptr;
+    BgzfIndex block_index_;
+    ZlibCheckpointIndex checkpoint_index_;
   };
 
   // Returns the compressed `Reader`. Unchanged by `Close()`.
@@ -159,6 +279,17 @@ class ZlibReaderBase : public BufferedReader {
     return truncated_ && available() == 0;
   }
 
+  // Returns known positions of blocks, including blocks passed to
+  // `Options::set_block_index()` and blocks encountered while reading, if
+  // `Options::blocked()` was `true`. Unchanged by `Close()`.
+  const BgzfIndex& block_index() const { return block_index_; }
+
+  // Returns the index passed to `Options::set_checkpoint_index()`, including
+  // checkpoints added while reading. Unchanged by `Close()`.
+  const ZlibCheckpointIndex& checkpoint_index() const {
+    return checkpoint_index_;
+  }
+
   bool ToleratesReadingAhead() override;
   bool SupportsRewind() override;
   bool SupportsNewReader() override;
@@ -167,14 +298,19 @@ class ZlibReaderBase : public BufferedReader {
   explicit ZlibReaderBase(Closed) noexcept : BufferedReader(kClosed) {}
 
   explicit ZlibReaderBase(const BufferOptions& buffer_options, int window_bits,
-                          ZlibDictionary&& dictionary, bool concatenate);
+                          ZlibDictionary&& dictionary, bool concatenate,
+                          bool blocked, int parallelism, Executor* executor,
+                          BgzfIndex&& block_index,
+                          ZlibCheckpointIndex&& checkpoint_index);
 
   ZlibReaderBase(ZlibReaderBase&& that) noexcept;
   ZlibReaderBase& operator=(ZlibReaderBase&& that) noexcept;
 
   void Reset(Closed);
   void Reset(const BufferOptions& buffer_options, int window_bits,
-             ZlibDictionary&& dictionary, bool concatenate);
+             ZlibDictionary&& dictionary, bool concatenate, bool blocked,
+             int parallelism, Executor* executor, BgzfIndex&& block_index,
+             ZlibCheckpointIndex&& checkpoint_index);
   static int GetWindowBits(const Options& options);
   void Initialize(Reader* src);
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateOverSrc(absl::Status status);
@@ -195,11 +331,33 @@ class ZlibReaderBase : public BufferedReader {
     void operator()(z_stream_s* ptr) const;
   };
 
-  void InitializeDecompressor();
+  // The result of decompressing a block in background.
+  struct DecompressedBlock {
+    absl::Status status;
+    std::string data;
+  };
+
+  void InitializeDecompressor(int window_bits);
+  // Returns the size of the trailer of a stream beginning with `first_byte`.
+  int TrailerSize(char first_byte) const;
+  // Adds a checkpoint at the current position of the decompressor, which is at
+  // a deflate block boundary.
+  void AddCheckpoint(Position uncompressed_pos);
+  // Restarts decompression from `checkpoint`.
+  bool ResumeFromCheckpoint(const ZlibCheckpoint& checkpoint);
   ABSL_ATTRIBUTE_COLD bool FailOperation(absl::StatusCode code,
                                          absl::string_view operation,
                                          int zlib_code);
 
+  // Implementation of `ReadInternal()` if `blocked_`.
+  bool ReadBlocked(size_t min_length, size_t max_length, char* dest);
+  // Implementation of `SeekBehindBuffer()` if `blocked_`.
+  bool SeekBlocked(Position new_pos);
+  // Replaces `block_` with the next block.
+  bool NextBlock();
+  // Reads the next compressed block from the source into `compressed`.
+  bool ReadCompressedBlock(std::string& compressed);
+
   int window_bits_ = 0;
   bool concatenate_ = false;
   // If `true`, the source is truncated (without a clean end of the compressed
@@ -213,6 +371,32 @@ class ZlibReaderBase : public BufferedReader {
   ZlibDictionary dictionary_;
   Position initial_compressed_pos_ = 0;
   RecyclingPool<z_stream_s, ZStreamDeleter>::Handle decompressor_;
+  bool blocked_ = false;
+  int parallelism_ = 0;
+  // `nullptr` means `Executor::global()`.
+  Executor* executor_ = nullptr;
+  BgzfIndex block_index_;
+  ZlibCheckpointIndex checkpoint_index_;
+  // Size of the trailer of the current stream: 0 for raw deflate, 4 for Zlib,
+  // 8 for Gzip. Valid if `stream_had_data_`.
+  int trailer_size_ = 0;
+  // If `true`, decompression of the current stream was resumed from a
+  // checkpoint in raw deflate mode, so the trailer must be skipped explicitly.
+  bool resumed_ = false;
+  // Uncompressed position from which the next checkpoint should be added, if
+  // `checkpoint_index_.interval() > 0`.
+  Position next_checkpoint_pos_ = 0;
+  // The current decompressed block, if `blocked_`.
+  std::string block_;
+  // Uncompressed position of the beginning of `block_`.
+  //
+  // Invariant if `blocked_`:
+  //   `block_pos_ <= limit_pos() <= block_pos_ + block_.size()`
+  Position block_pos_ = 0;
+  // Uncompressed position of the next block to be read from the source.
+  Position next_block_pos_ = 0;
+  // Blocks being decompressed in background, in the order of their positions.
+  std::deque<std::future<DecompressedBlock>> pending_blocks_;
 };
 
 // A `Reader` which decompresses data with Zlib after getting it from another
@@ -320,11 +504,19 @@ absl::optional<uint32_t> GzipUncompressedSizeModulo4G(Reader& src);
 inline ZlibReaderBase::ZlibReaderBase(const BufferOptions& buffer_options,
                                       int window_bits,
                                       ZlibDictionary&& dictionary,
-                                      bool concatenate)
+                                      bool concatenate, bool blocked,
+                                      int parallelism, Executor* executor,
+                                      BgzfIndex&& block_index,
+                                      ZlibCheckpointIndex&& checkpoint_index)
     : BufferedReader(buffer_options),
       window_bits_(window_bits),
       concatenate_(concatenate),
-      dictionary_(std::move(dictionary)) {}
+      dictionary_(std::move(dictionary)),
+      blocked_(blocked),
+      parallelism_(parallelism),
+      executor_(executor),
+      block_index_(std::move(block_index)),
+      checkpoint_index_(std::move(checkpoint_index)) {}
 
 inline ZlibReaderBase::ZlibReaderBase(ZlibReaderBase&& that) noexcept
     : BufferedReader(static_cast<BufferedReader&&>(that)),
@@ -334,7 +526,19 @@ inline ZlibReaderBase::ZlibReaderBase(ZlibReaderBase&& that) noexcept
       stream_had_data_(that.stream_had_data_),
       dictionary_(std::move(that.dictionary_)),
       initial_compressed_pos_(that.initial_compressed_pos_),
-      decompressor_(std::move(that.decompressor_)) {}
+      decompressor_(std::move(that.decompressor_)),
+      blocked_(that.blocked_),
+      parallelism_(that.parallelism_),
+      executor_(that.executor_),
+      block_index_(std::move(that.block_index_)),
+      checkpoint_index_(std::move(that.checkpoint_index_)),
+      trailer_size_(that.trailer_size_),
+      resumed_(that.resumed_),
+      next_checkpoint_pos_(that.next_checkpoint_pos_),
+      block_(std::move(that.block_)),
+      block_pos_(that.block_pos_),
+      next_block_pos_(that.next_block_pos_),
+      pending_blocks_(std::move(that.pending_blocks_)) {}
 
 inline ZlibReaderBase& ZlibReaderBase::operator=(
     ZlibReaderBase&& that) noexcept {
@@ -346,6 +550,18 @@ inline ZlibReaderBase& ZlibReaderBase::operator=(
   dictionary_ = std::move(that.dictionary_);
   initial_compressed_pos_ = that.initial_compressed_pos_;
   decompressor_ = std::move(that.decompressor_);
+  blocked_ = that.blocked_;
+  parallelism_ = that.parallelism_;
+  executor_ = that.executor_;
+  block_index_ = std::move(that.block_index_);
+  checkpoint_index_ = std::move(that.checkpoint_index_);
+  trailer_size_ = that.trailer_size_;
+  resumed_ = that.resumed_;
+  next_checkpoint_pos_ = that.next_checkpoint_pos_;
+  block_ = std::move(that.block_);
+  block_pos_ = that.block_pos_;
+  next_block_pos_ = that.next_block_pos_;
+  pending_blocks_ = std::move(that.pending_blocks_);
   return *this;
 }
 
@@ -358,11 +574,26 @@ inline void ZlibReaderBase::Reset(Closed) {
   initial_compressed_pos_ = 0;
   decompressor_.reset();
   dictionary_ = ZlibDictionary();
+  blocked_ = false;
+  parallelism_ = 0;
+  executor_ = nullptr;
+  block_index_.Reset();
+  checkpoint_index_ = ZlibCheckpointIndex();
+  trailer_size_ = 0;
+  resumed_ = false;
+  next_checkpoint_pos_ = 0;
+  block_ = std::string();
+  block_pos_ = 0;
+  next_block_pos_ = 0;
+  pending_blocks_.clear();
 }
 
 inline void ZlibReaderBase::Reset(const BufferOptions& buffer_options,
                                   int window_bits, ZlibDictionary&& dictionary,
-                                  bool concatenate) {
+                                  bool concatenate, bool blocked,
+                                  int parallelism, Executor* executor,
+                                  BgzfIndex&& block_index,
+                                  ZlibCheckpointIndex&& checkpoint_index) {
   BufferedReader::Reset(buffer_options);
   window_bits_ = window_bits;
   concatenate_ = concatenate;
@@ -371,6 +602,18 @@ inline void ZlibReaderBase::Reset(const BufferOptions& buffer_options,
   initial_compressed_pos_ = 0;
   decompressor_.reset();
   dictionary_ = std::move(dictionary);
+  blocked_ = blocked;
+  parallelism_ = parallelism;
+  executor_ = executor;
+  block_index_ = std::move(block_index);
+  checkpoint_index_ = std::move(checkpoint_index);
+  trailer_size_ = 0;
+  resumed_ = false;
+  next_checkpoint_pos_ = 0;
+  block_.clear();
+  block_pos_ = 0;
+  next_block_pos_ = 0;
+  pending_blocks_.clear();
 }
 
 inline int ZlibReaderBase::GetWindowBits(const Options& options) {
@@ -382,7 +625,10 @@ inline int ZlibReaderBase::GetWindowBits(const Options& options) {
 template <typename Src>
 inline ZlibReader<Src>::ZlibReader(const Src& src, Options options)
     : ZlibReaderBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary()), options.concatenate()),
+                     std::move(options.dictionary()), options.concatenate(),
+                     options.blocked(), options.parallelism(),
+                     options.executor(), std::move(options.block_index()),
+                     std::move(options.checkpoint_index())),
       src_(src) {
   Initialize(src_.get());
 }
@@ -390,7 +636,10 @@ inline ZlibReader<Src>::ZlibReader(const Src& src, Options options)
 template <typename Src>
 inline ZlibReader<Src>::ZlibReader(Src&& src, Options options)
     : ZlibReaderBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary()), options.concatenate()),
+                     std::move(options.dictionary()), options.concatenate(),
+                     options.blocked(), options.parallelism(),
+                     options.executor(), std::move(options.block_index()),
+                     std::move(options.checkpoint_index())),
       src_(std::move(src)) {
   Initialize(src_.get());
 }
@@ -400,7 +649,10 @@ template <typename... SrcArgs>
 inline ZlibReader<Src>::ZlibReader(std::tuple<SrcArgs...> src_args,
                                    Options options)
     : ZlibReaderBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary()), options.concatenate()),
+                     std::move(options.dictionary()), options.concatenate(),
+                     options.blocked(), options.parallelism(),
+                     options.executor(), std::move(options.block_index()),
+                     std::move(options.checkpoint_index())),
       src_(std::move(src_args)) {
   Initialize(src_.get());
 }
@@ -426,7 +678,10 @@ inline void ZlibReader<Src>::Reset(Closed) {
 template <typename Src>
 inline void ZlibReader<Src>::Reset(const Src& src, Options options) {
   ZlibReaderBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()), options.concatenate());
+                        std::move(options.dictionary()), options.concatenate(),
+                        options.blocked(), options.parallelism(),
+                        options.executor(), std::move(options.block_index()),
+                        std::move(options.checkpoint_index()));
   src_.Reset(src);
   Initialize(src_.get());
 }
@@ -434,7 +689,10 @@ inline void ZlibReader<Src>::Reset(const Src& src, Options options) {
 template <typename Src>
 inline void ZlibReader<Src>::Reset(Src&& src, Options options) {
   ZlibReaderBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()), options.concatenate());
+                        std::move(options.dictionary()), options.concatenate(),
+                        options.blocked(), options.parallelism(),
+                        options.executor(), std::move(options.block_index()),
+                        std::move(options.checkpoint_index()));
   src_.Reset(std::move(src));
   Initialize(src_.get());
 }
@@ -444,7 +702,10 @@ template <typename... SrcArgs>
 inline void ZlibReader<Src>::Reset(std::tuple<SrcArgs...> src_args,
                                    Options options) {
   ZlibReaderBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()), options.concatenate());
+                        std::move(options.dictionary()), options.concatenate(),
+                        options.blocked(), options.parallelism(),
+                        options.executor(), std::move(options.block_index()),
+                        std::move(options.checkpoint_index()));
   src_.Reset(std::move(src_args));
   Initialize(src_.get());
 }
@@ -16,6 +16,8 @@
 
 #include <stddef.h>
 
+#include <functional>
+#include <future>
 #include <limits>
 #include <memory>
 #include <string>
@@ -27,12 +29,14 @@
 #include "absl/strings/string_view.h"
 #include "riegeli/base/arithmetic.h"
 #include "riegeli/base/assert.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/recycling_pool.h"
 #include "riegeli/base/status.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffered_writer.h"
 #include "riegeli/bytes/reader.h"
 #include "riegeli/bytes/writer.h"
+#include "riegeli/zlib/bgzf.h"
 #include "riegeli/zlib/zlib_reader.h"
 #include "zconf.h"
 #include "zlib.h"
@@ -77,6 +81,13 @@ void ZlibWriterBase::Initialize(Writer* dest, int compression_level) {
     return;
   }
   initial_compressed_pos_ = dest->pos();
+  if (blocked_) {
+    RIEGELI_ASSERT(dictionary_.empty())
+        << "Failed precondition of ZlibWriter: "
+           "a dictionary cannot be used with Options::blocked()";
+    compression_level_ = compression_level;
+    return;
+  }
   compressor_ =
       KeyedRecyclingPool<z_stream, ZStreamKey, ZStreamDeleter>::global().Get(
           ZStreamKey{compression_level, window_bits_},
@@ -114,6 +125,13 @@ void ZlibWriterBase::DoneBehindBuffer(absl::string_view src) {
          "buffer not empty";
   if (ABSL_PREDICT_FALSE(!ok())) return;
   Writer& dest = *DestWriter();
+  if (blocked_) {
+    if (ABSL_PREDICT_FALSE(!WriteBlocked(src, dest, true))) return;
+    if (ABSL_PREDICT_FALSE(!dest.Write(bgzf_internal::kEofBlock))) {
+      FailWithoutAnnotation(AnnotateOverDest(dest.status()));
+    }
+    return;
+  }
   WriteInternal(src, dest, Z_FINISH);
 }
 
@@ -121,6 +139,8 @@ void ZlibWriterBase::Done() {
   BufferedWriter::Done();
   compressor_.reset();
   dictionary_ = ZlibDictionary();
+  block_buffer_ = std::string();
+  pending_blocks_.clear();
   associated_reader_.Reset();
 }
 
@@ -129,7 +149,7 @@ bool ZlibWriterBase::FailOperation(absl::string_view operation, int zlib_code) {
       << "Failed precondition of ZlibWriterBase::FailOperation(): "
          "Object closed";
   std::string message = absl::StrCat(operation, " failed");
-  const char* details = compressor_->msg;
+  const char* details = compressor_ == nullptr ? nullptr : compressor_->msg;
   if (details == nullptr) {
     switch (zlib_code) {
       case Z_STREAM_END:
@@ -187,6 +207,7 @@ bool ZlibWriterBase::WriteInternal(absl::string_view src) {
   RIEGELI_ASSERT(ok())
       << "Failed precondition of BufferedWriter::WriteInternal(): " << status();
   Writer& dest = *DestWriter();
+  if (blocked_) return WriteBlocked(src, dest, false);
   return WriteInternal(src, dest, Z_NO_FLUSH);
 }
 
@@ -252,9 +273,105 @@ bool ZlibWriterBase::FlushBehindBuffer(absl::string_view src,
          "buffer not empty";
   if (ABSL_PREDICT_FALSE(!ok())) return false;
   Writer& dest = *DestWriter();
+  if (blocked_) return WriteBlocked(src, dest, true);
   return WriteInternal(src, dest, Z_SYNC_FLUSH);
 }
 
+bool ZlibWriterBase::WriteBlocked(absl::string_view src, Writer& dest,
+                                  bool flush) {
+  RIEGELI_ASSERT(ok())
+      << "Failed precondition of ZlibWriterBase::WriteBlocked(): " << status();
+  if (ABSL_PREDICT_FALSE(src.size() >
+                         std::numeric_limits<Position>::max() - start_pos())) {
+    return FailOverflow();
+  }
+  const size_t length = src.size();
+  while (!src.empty()) {
+    if (block_buffer_.empty() &&
+        src.size() >= bgzf_internal::kMaxUncompressedBlockSize) {
+      // Compress a whole block directly from `src`.
+      if (ABSL_PREDICT_FALSE(!CompressBlock(
+              src.substr(0, bgzf_internal::kMaxUncompressedBlockSize),
+              dest))) {
+        return false;
+      }
+      src.remove_prefix(bgzf_internal::kMaxUncompressedBlockSize);
+      continue;
+    }
+    const size_t length_to_copy = UnsignedMin(
+        bgzf_internal::kMaxUncompressedBlockSize - block_buffer_.size(),
+        src.size());
+    block_buffer_.append(src.data(), length_to_copy);
+    src.remove_prefix(length_to_copy);
+    if (block_buffer_.size() == bgzf_internal::kMaxUncompressedBlockSize) {
+      if (ABSL_PREDICT_FALSE(!CompressBlock(block_buffer_, dest))) return false;
+      block_buffer_.clear();
+    }
+  }
+  move_start_pos(length);
+  if (flush) {
+    if (!block_buffer_.empty()) {
+      if (ABSL_PREDICT_FALSE(!CompressBlock(block_buffer_, dest))) return false;
+      block_buffer_.clear();
+    }
+    return WritePendingBlocks(0, dest);
+  }
+  return true;
+}
+
+inline bool ZlibWriterBase::CompressBlock(absl::string_view src,
+                                          Writer& dest) {
+  if (parallelism_ == 0) {
+    CompressedBlock block;
+    block.uncompressed_size = src.size();
+    block.status =
+        bgzf_internal::CompressBlock(src, compression_level_, block.data);
+    return WriteBlock(std::move(block), dest);
+  }
+  if (ABSL_PREDICT_FALSE(
+          !WritePendingBlocks(IntCast<size_t>(parallelism_ - 1), dest))) {
+    return false;
+  }
+  std::promise<CompressedBlock>* const block_promise =
+      new std::promise<CompressedBlock>();
+  pending_blocks_.push_back(block_promise->get_future());
+  Executor& executor = executor_ != nullptr ? *executor_ : Executor::global();
+  executor.Schedule(
+      [block_promise, compression_level = compression_level_,
+       uncompressed = std::string(src)] {
+        CompressedBlock block;
+        block.uncompressed_size = uncompressed.size();
+        block.status = bgzf_internal::CompressBlock(
+            uncompressed, compression_level, block.data);
+        block_promise->set_value(std::move(block));
+        delete block_promise;
+      });
+  return true;
+}
+
+inline bool ZlibWriterBase::WriteBlock(CompressedBlock&& block, Writer& dest) {
+  if (ABSL_PREDICT_FALSE(!block.status.ok())) {
+    return Fail(std::move(block.status));
+  }
+  block_index_.Add(BgzfBlockPosition{dest.pos() - initial_compressed_pos_,
+                                     pending_pos_});
+  if (ABSL_PREDICT_FALSE(!dest.Write(block.data))) {
+    return FailWithoutAnnotation(AnnotateOverDest(dest.status()));
+  }
+  pending_pos_ += block.uncompressed_size;
+  return true;
+}
+
+inline bool ZlibWriterBase::WritePendingBlocks(size_t max_pending,
+                                               Writer& dest) {
+  while (pending_blocks_.size() > max_pending) {
+    CompressedBlock block = pending_blocks_.front().get();
+    pending_blocks_.pop_front();
+    if (ABSL_PREDICT_FALSE(!WriteBlock(std::move(block), dest))) return false;
+  }
+  return true;
+}
+
 bool ZlibWriterBase::SupportsReadMode() {
   Writer* const dest = DestWriter();
   return dest != nullptr && dest->SupportsReadMode();
@@ -282,6 +399,8 @@ Reader* ZlibWriterBase::ReadModeBehindBuffer(Position initial_pos) {
                                        : static_cast<ZlibReaderBase::Header>(
                                              window_bits_ & ~15))
           .set_dictionary(dictionary_)
+          .set_blocked(blocked_)
+          .set_block_index(block_index_)
           .set_buffer_options(buffer_options()));
   reader->Seek(initial_pos);
   return reader;
@@ -15,6 +15,11 @@
 #ifndef RIEGELI_ZLIB_ZLIB_WRITER_H_
 #define RIEGELI_ZLIB_ZLIB_WRITER_H_
 
+#include <stddef.h>
+
+#include <deque>
+#include <future>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -25,12 +30,14 @@
 #include "absl/strings/string_view.h"
 #include "riegeli/base/assert.h"
 #include "riegeli/base/dependency.h"
+#include "riegeli/base/executor.h"
 #include "riegeli/base/object.h"
 #include "riegeli/base/recycling_pool.h"
 #include "riegeli/base/types.h"
 #include "riegeli/bytes/buffer_options.h"
 #include "riegeli/bytes/buffered_writer.h"
 #include "riegeli/bytes/writer.h"
+#include "riegeli/zlib/bgzf.h"
 #include "riegeli/zlib/zlib_dictionary.h"
 
 struct z_stream_s;  // `zlib.h` has `typedef struct z_stream_s z_stream`.
@@ -142,31 +149,100 @@ class ZlibWriterBase : public BufferedWriter {
     ZlibDictionary& dictionary() { return dictionary_; }
     const ZlibDictionary& dictionary() const { return dictionary_; }
 
+    // If `true`, data are compressed in the blocked Gzip format (BGZF): a
+    // sequence of independent Gzip members of at most 64 KiB each, with the
+    // size of each member recorded in its header. This is still a valid Gzip
+    // stream, which can be decompressed with `ZlibReaderBase::Options`
+    // `set_concatenate(true)`, and with `set_blocked(true)` it supports
+    // efficient `Seek()` and `NewReader()`. See `bgzf.h`.
+    //
+    // If `blocked()` is `true`, `header()` and `window_log()` are ignored
+    // (Gzip headers with a 32 KiB window are always written), and
+    // `dictionary()` must be empty.
+    //
+    // Default: `false`.
+    Options& set_blocked(bool blocked) & {
+      blocked_ = blocked;
+      return *this;
+    }
+    Options&& set_blocked(bool blocked) && {
+      return std::move(set_blocked(blocked));
+    }
+    bool blocked() const { return blocked_; }
+
+    // Maximum number of blocks being compressed in background, if `blocked()`
+    // is `true`.
+    //
+    // If `parallelism()` is 0, blocks are compressed in the calling thread.
+    //
+    // Default: 0.
+    Options& set_parallelism(int parallelism) & {
+      RIEGELI_ASSERT_GE(parallelism, 0)
+          << "Failed precondition of "
+             "ZlibWriterBase::Options::set_parallelism(): "
+             "negative parallelism";
+      parallelism_ = parallelism;
+      return *this;
+    }
+    Options&& set_parallelism(int parallelism) && {
+      return std::move(set_parallelism(parallelism));
+    }
+    int parallelism() const { return parallelism_; }
+
+    // `Executor` which compresses blocks in background if `blocked()` is
+    // `true` and `parallelism() > 0`. It is not owned and must outlive the
+    // `ZlibWriter`.
+    //
+    // `nullptr` means `Executor::global()`.
+    //
+    // Default: `nullptr`.
+    Options& set_executor(Executor* executor) & {
+      executor_ = executor;
+      return *this;
+    }
+    Options&& set_executor(Executor* executor) && {
+      return std::move(set_executor(executor));
+    }
+    Executor* executor() const { return executor_; }
+
    private:
     int compression_level_ = kDefaultCompressionLevel;
     int window_log_ = kDefaultWindowLog;
     Header header_ = kDefaultHeader;
     ZlibDictionary dictionary_;
+    bool blocked_ = false;
+    int parallelism_ = 0;
+    Executor* executor_ = nullptr;
   };
 
   // Returns the compressed `Writer`. Unchanged by `Close()`.
   virtual Writer* DestWriter() = 0;
   virtual const Writer* DestWriter() const = 0;
 
+  // Returns the index of blocks written so far, if `Options::blocked()` was
+  // `true`. Blocks still being compressed in background are not included
+  // until `Flush()` or `Close()`. Unchanged by `Close()`.
+  //
+  // The index can be saved with `WriteGziIndex()` and passed to
+  // `ZlibReaderBase::Options::set_block_index()`.
+  const BgzfIndex& block_index() const { return block_index_; }
+
   bool SupportsReadMode() override;
 
  protected:
   explicit ZlibWriterBase(Closed) noexcept : BufferedWriter(kClosed) {}
 
   explicit ZlibWriterBase(const BufferOptions& buffer_options, int window_bits,
-                          ZlibDictionary&& dictionary);
+                          ZlibDictionary&& dictionary, bool blocked,
+                          int parallelism, Executor* executor);
 
   ZlibWriterBase(ZlibWriterBase&& that) noexcept;
   ZlibWriterBase& operator=(ZlibWriterBase&& that) noexcept;
 
   void Reset(Closed);
   void Reset(const BufferOptions& buffer_options, int window_bits,
-             ZlibDictionary&& dictionary);
+             ZlibDictionary&& dictionary, bool blocked, int parallelism,
+             Executor* executor);
   static int GetWindowBits(const Options& options);
   void Initialize(Writer* dest, int compression_level);
   ABSL_ATTRIBUTE_COLD absl::Status AnnotateOverDest(absl::Status status);
@@ -203,15 +279,47 @@ class ZlibWriterBase : public BufferedWriter {
     int window_bits;
   };
 
+  // The result of compressing a block in background.
+  struct CompressedBlock {
+    absl::Status status;
+    size_t uncompressed_size = 0;
+    std::string data;
+  };
+
   ABSL_ATTRIBUTE_COLD bool FailOperation(absl::string_view operation,
                                          int zlib_code);
   bool WriteInternal(absl::string_view src, Writer& dest, int flush);
 
+  // Implementation of `WriteInternal()` and `FlushBehindBuffer()` if
+  // `blocked_`. If `flush`, the last partial block is compressed and all
+  // pending blocks are written to `dest`.
+  bool WriteBlocked(absl::string_view src, Writer& dest, bool flush);
+  // Compresses a complete block, possibly in background.
+  bool CompressBlock(absl::string_view src, Writer& dest);
+  // Writes a compressed block to `dest`.
+  bool WriteBlock(CompressedBlock&& block, Writer& dest);
+  // Waits for blocks being compressed in background and writes them to `dest`,
+  // until at most `max_pending` blocks remain pending.
+  bool WritePendingBlocks(size_t max_pending, Writer& dest);
+
   int window_bits_ = 0;
   ZlibDictionary dictionary_;
   Position initial_compressed_pos_ = 0;
   KeyedRecyclingPool<z_stream_s, ZStreamKey, ZStreamDeleter>::Handle
       compressor_;
+  bool blocked_ = false;
+  int parallelism_ = 0;
+  // `nullptr` means `Executor::global()`.
+  Executor* executor_ = nullptr;
+  int compression_level_ = 0;
+  // Data of the current block which is not complete yet, if `blocked_`.
+  std::string block_buffer_;
+  // Blocks being compressed in background, in the order of their positions.
+  std::deque<std::future<CompressedBlock>> pending_blocks_;
+  // Uncompressed position of the first pending block, or of `block_buffer_` if
+  // there are no pending blocks.
+  Position pending_pos_ = 0;
+  BgzfIndex block_index_;
 
   AssociatedReader<ZlibReader<Reader*>> associated_reader_;
 };
@@ -298,10 +406,14 @@ explicit ZlibWriter(std::tuple<DestArgs...> dest_args,
 
 inline ZlibWriterBase::ZlibWriterBase(const BufferOptions& buffer_options,
                                       int window_bits,
-                                      ZlibDictionary&& dictionary)
+                                      ZlibDictionary&& dictionary, bool blocked,
+                                      int parallelism, Executor* executor)
     : BufferedWriter(buffer_options),
       window_bits_(window_bits),
-      dictionary_(std::move(dictionary)) {}
+      dictionary_(std::move(dictionary)),
+      blocked_(blocked),
+      parallelism_(parallelism),
+      executor_(executor) {}
 
 inline ZlibWriterBase::ZlibWriterBase(ZlibWriterBase&& that) noexcept
     : BufferedWriter(static_cast<BufferedWriter&&>(that)),
@@ -309,6 +421,14 @@ inline ZlibWriterBase::ZlibWriterBase(ZlibWriterBase&& that) noexcept
       dictionary_(std::move(that.dictionary_)),
       initial_compressed_pos_(that.initial_compressed_pos_),
       compressor_(std::move(that.compressor_)),
+      blocked_(that.blocked_),
+      parallelism_(that.parallelism_),
+      executor_(that.executor_),
+      compression_level_(that.compression_level_),
+      block_buffer_(std::move(that.block_buffer_)),
+      pending_blocks_(std::move(that.pending_blocks_)),
+      pending_pos_(that.pending_pos_),
+      block_index_(std::move(that.block_index_)),
       associated_reader_(std::move(that.associated_reader_)) {}
 
 inline ZlibWriterBase& ZlibWriterBase::operator=(
@@ -318,6 +438,14 @@ inline ZlibWriterBase& ZlibWriterBase::operator=(
   dictionary_ = std::move(that.dictionary_);
   initial_compressed_pos_ = that.initial_compressed_pos_;
   compressor_ = std::move(that.compressor_);
+  blocked_ = that.blocked_;
+  parallelism_ = that.parallelism_;
+  executor_ = that.executor_;
+  compression_level_ = that.compression_level_;
+  block_buffer_ = std::move(that.block_buffer_);
+  pending_blocks_ = std::move(that.pending_blocks_);
+  pending_pos_ = that.pending_pos_;
+  block_index_ = std::move(that.block_index_);
   associated_reader_ = std::move(that.associated_reader_);
   return *this;
 }
@@ -328,21 +456,41 @@ inline void ZlibWriterBase::Reset(Closed) {
   initial_compressed_pos_ = 0;
   compressor_.reset();
   dictionary_ = ZlibDictionary();
+  blocked_ = false;
+  parallelism_ = 0;
+  executor_ = nullptr;
+  compression_level_ = 0;
+  block_buffer_ = std::string();
+  pending_blocks_.clear();
+  pending_pos_ = 0;
+  block_index_.Reset();
   associated_reader_.Reset();
 }
 
 inline void ZlibWriterBase::Reset(const BufferOptions& buffer_options,
-                                  int window_bits,
-                                  ZlibDictionary&& dictionary) {
+                                  int window_bits, ZlibDictionary&& dictionary,
+                                  bool blocked, int parallelism,
+                                  Executor* executor) {
   BufferedWriter::Reset(buffer_options);
   window_bits_ = window_bits;
   initial_compressed_pos_ = 0;
   compressor_.reset();
   dictionary_ = std::move(dictionary);
+  blocked_ = blocked;
+  parallelism_ = parallelism;
+  executor_ = executor;
+  compression_level_ = 0;
+  block_buffer_.clear();
+  pending_blocks_.clear();
+  pending_pos_ = 0;
+  block_index_.Reset();
   associated_reader_.Reset();
 }
 
 inline int ZlibWriterBase::GetWindowBits(const Options& options) {
+  if (options.blocked()) {
+    return options.kMaxWindowLog + static_cast<int>(Header::kGzip);
+  }
   return options.header() == Header::kRaw
              ? -options.window_log()
              : options.window_log() + static_cast<int>(options.header());
@@ -351,7 +499,8 @@ inline int ZlibWriterBase::GetWindowBits(const Options& options) {
 template <typename Dest>
 inline ZlibWriter<Dest>::ZlibWriter(const Dest& dest, Options options)
     : ZlibWriterBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary())),
+                     std::move(options.dictionary()), options.blocked(),
+                     options.parallelism(), options.executor()),
       dest_(dest) {
   Initialize(dest_.get(), options.compression_level());
 }
@@ -359,7 +508,8 @@ inline ZlibWriter<Dest>::ZlibWriter(const Dest& dest, Options options)
 template <typename Dest>
 inline ZlibWriter<Dest>::ZlibWriter(Dest&& dest, Options options)
     : ZlibWriterBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary())),
+                     std::move(options.dictionary()), options.blocked(),
+                     options.parallelism(), options.executor()),
       dest_(std::move(dest)) {
   Initialize(dest_.get(), options.compression_level());
 }
@@ -369,7 +519,8 @@ template <typename... DestArgs>
 inline ZlibWriter<Dest>::ZlibWriter(std::tuple<DestArgs...> dest_args,
                                     Options options)
     : ZlibWriterBase(options.buffer_options(), GetWindowBits(options),
-                     std::move(options.dictionary())),
+                     std::move(options.dictionary()), options.blocked(),
+                     options.parallelism(), options.executor()),
       dest_(std::move(dest_args)) {
   Initialize(dest_.get(), options.compression_level());
 }
@@ -396,7 +547,8 @@ inline void ZlibWriter<Dest>::Reset(Closed) {
 template <typename Dest>
 inline void ZlibWriter<Dest>::Reset(const Dest& dest, Options options) {
   ZlibWriterBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()));
+                        std::move(options.dictionary()), options.blocked(),
+                        options.parallelism(), options.executor());
   dest_.Reset(dest);
   Initialize(dest_.get(), options.compression_level());
 }
@@ -404,7 +556,8 @@ inline void ZlibWriter<Dest>::Reset(const Dest& dest, Options options) {
 template <typename Dest>
 inline void ZlibWriter<Dest>::Reset(Dest&& dest, Options options) {
   ZlibWriterBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()));
+                        std::move(options.dictionary()), options.blocked(),
+                        options.parallelism(), options.executor());
   dest_.Reset(std::move(dest));
   Initialize(dest_.get(), options.compression_level());
 }
@@ -414,7 +567,8 @@ template <typename... DestArgs>
 inline void ZlibWriter<Dest>::Reset(std::tuple<DestArgs...> dest_args,
                                     Options options) {
   ZlibWriterBase::Reset(options.buffer_options(), GetWindowBits(options),
-                        std::move(options.dictionary()));
+                        std::move(options.dictionary()), options.blocked(),
+                        options.parallelism(), options.executor());
   dest_.Reset(std::move(dest_args));
   Initialize(dest_.get(), options.compression_level());
 }